@@ -1,6 +1,7 @@
 QT += charts
 # QT += network
 SUBDIRS += src
+SUBDIRS += src/cli
 TEMPLATE = subdirs
 CONFIG += ordered warn_on qt debug_and_release
 CONFIG += c++11
@@ -0,0 +1,230 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "FilterCheck.h"
+
+#include <memory>
+#include <random>
+#include <stdio.h>
+
+#include <QElapsedTimer>
+#include <QList>
+
+#include <driver/CanFilter/canfilter_bxcan.hpp>
+#include <driver/CanFilter/canfilter_emu.hpp>
+#include <driver/CanFilter/canfilter_fdcan.hpp>
+#include <driver/CanFilter/canfilter_fit.hpp>
+
+static const struct {
+    const char *name;
+    canfilter_hardware_t dev;
+} filterDevices[] = {
+    { "bxcan-f0", CANFILTER_DEV_BXCAN_F0 },
+    { "bxcan-f4", CANFILTER_DEV_BXCAN_F4 },
+    { "fdcan-g0", CANFILTER_DEV_FDCAN_G0 },
+    { "fdcan-h7", CANFILTER_DEV_FDCAN_H7 },
+};
+
+static canfilter *newBuilder(canfilter_hardware_t dev)
+{
+    switch (dev) {
+    case CANFILTER_DEV_BXCAN_F0:
+        return new canfilter_bxcan_f0();
+    case CANFILTER_DEV_BXCAN_F4:
+        return new canfilter_bxcan_f4();
+    case CANFILTER_DEV_FDCAN_G0:
+        return new canfilter_fdcan_g0();
+    case CANFILTER_DEV_FDCAN_H7:
+        return new canfilter_fdcan_h7();
+    case CANFILTER_DEV_NONE:
+    default:
+        return 0;
+    }
+}
+
+static bool selectDevices(const QString &name, QList<int> &devices)
+{
+    for (unsigned i=0; i<sizeof(filterDevices)/sizeof(filterDevices[0]); i++) {
+        if (name == "all" || name == filterDevices[i].name) {
+            devices.append(i);
+        }
+    }
+    if (devices.isEmpty()) {
+        fprintf(stderr, "cangaroo-cli: unknown filter device: %s\n", qPrintable(name));
+        return false;
+    }
+    return true;
+}
+
+static canfilter_emu::verify_options_t verifyOptions(const FilterCheckOptions &options)
+{
+    canfilter_emu::verify_options_t result;
+    result.exhaustive = options.exhaustive;
+    result.samples = options.samples;
+    result.threads = options.threads;
+    return result;
+}
+
+/* Every wanted ID must pass; an exact filter must not let anything else
+ * through, an approximated one no more than canfilter_fit reported. */
+static bool checkResult(const canfilter_fit &fit, const canfilter_emu::verify_result_t &result, QString *problem)
+{
+    const canfilter_fit::report_t &report = fit.get_report();
+    if (!result.complete()) {
+        *problem = "wanted IDs rejected";
+        return false;
+    }
+    if (!report.approximated && !result.equivalent()) {
+        *problem = "exact filter accepts unwanted IDs";
+        return false;
+    }
+    if (result.std_extra != report.false_std_ids) {
+        *problem = QString("%1 unwanted std IDs accepted, %2 reported").arg(result.std_extra).arg(report.false_std_ids);
+        return false;
+    }
+    if (result.exhaustive && result.ext_extra > report.false_ext_ids) {
+        *problem = QString("%1 unwanted ext IDs accepted, at most %2 reported").arg(result.ext_extra).arg(report.false_ext_ids);
+        return false;
+    }
+    return true;
+}
+
+int filterVerify(const QString &definition, const FilterCheckOptions &options)
+{
+    QList<int> devices;
+    if (!selectDevices(options.device, devices)) {
+        return 1;
+    }
+
+    bool ok = true;
+    foreach (int i, devices) {
+        std::unique_ptr<canfilter> builder(newBuilder(filterDevices[i].dev));
+        canfilter_fit fit(*builder, filterDevices[i].dev);
+        fit.begin();
+        if (!fit.parse(definition.toStdString())) {
+            fprintf(stderr, "cangaroo-cli: invalid filter definition: %s\n", qPrintable(definition));
+            return 1;
+        }
+        canfilter_error_t err = fit.end();
+        if (err != CANFILTER_SUCCESS) {
+            printf("%s: cannot build filter (error %d)\n", filterDevices[i].name, err);
+            ok = false;
+            continue;
+        }
+        fit.print_usage();
+
+        canfilter_emu emu;
+        if (!emu.load(fit.get_hw_config(), fit.get_hw_size())) {
+            printf("%s: invalid hardware image\n", filterDevices[i].name);
+            ok = false;
+            continue;
+        }
+
+        canfilter_emu::verify_result_t result = emu.verify(fit, verifyOptions(options));
+        emu.print_result(result);
+
+        QString problem;
+        if (!checkResult(fit, result, &problem)) {
+            printf("%s: FAIL: %s\n", filterDevices[i].name, qPrintable(problem));
+            ok = false;
+        }
+        printf("\n");
+    }
+
+    return ok ? 0 : 1;
+}
+
+int filterBenchmark(int maxIds, const FilterCheckOptions &options)
+{
+    QList<int> devices;
+    if (!selectDevices(options.device, devices)) {
+        return 1;
+    }
+
+    // sizes grow by 4 up to maxIds
+    QList<int> sizes;
+    for (int n=16; n<maxIds; n*=4) {
+        sizes.append(n);
+    }
+    sizes.append(qMax(1, maxIds));
+
+    printf("%-9s %8s %6s %12s %6s %10s %12s %s\n",
+           "device", "ids", "builds", "ms/build", "approx", "std extra", "ext extra", "check");
+
+    bool ok = true;
+    foreach (int i, devices) {
+        foreach (int n, sizes) {
+            // half standard, half extended, same set for every device
+            std::mt19937 random(n);
+            std::uniform_int_distribution<uint32_t> stdId(0, canfilter::max_std_id);
+            std::uniform_int_distribution<uint32_t> extId(0, canfilter::max_ext_id);
+            std::vector<uint32_t> ids;
+            for (int k=0; k<n; k++) {
+                ids.push_back((k & 1) ? (extId(random) | 0x80000000U) : stdId(random));
+            }
+
+            std::unique_ptr<canfilter> builder(newBuilder(filterDevices[i].dev));
+            canfilter_fit fit(*builder, filterDevices[i].dev);
+            canfilter_error_t err = CANFILTER_SUCCESS;
+
+            // repeat small sets for a stable time
+            QElapsedTimer timer;
+            timer.start();
+            int builds = 0;
+            do {
+                fit.begin();
+                for (uint32_t id : ids) {
+                    if (id & 0x80000000U) {
+                        fit.add_ext_id(id & canfilter::max_ext_id);
+                    } else {
+                        fit.add_std_id(id);
+                    }
+                }
+                err = fit.end();
+                builds++;
+            } while (timer.elapsed() < 200);
+            double ms = timer.nsecsElapsed() / 1e6 / builds;
+
+            if (err != CANFILTER_SUCCESS) {
+                printf("%-9s %8d %6d %12.3f  error %d\n", filterDevices[i].name, n, builds, ms, err);
+                ok = false;
+                continue;
+            }
+
+            canfilter_emu emu;
+            QString problem = "ok";
+            if (!emu.load(fit.get_hw_config(), fit.get_hw_size())) {
+                problem = "invalid hardware image";
+                ok = false;
+            } else if (!checkResult(fit, emu.verify(fit, verifyOptions(options)), &problem)) {
+                ok = false;
+            }
+
+            const canfilter_fit::report_t &report = fit.get_report();
+            printf("%-9s %8d %6d %12.3f %6s %10llu %12llu %s\n",
+                   filterDevices[i].name, n, builds, ms, report.approximated ? "yes" : "no",
+                   (unsigned long long)report.false_std_ids, (unsigned long long)report.false_ext_ids,
+                   qPrintable(problem));
+        }
+    }
+
+    return ok ? 0 : 1;
+}
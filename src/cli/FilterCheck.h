@@ -0,0 +1,42 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <QString>
+
+// Offline checks of the hardware filter builders, no interface needed:
+// build a filter, run the image through the software model of the
+// controller and compare it with the requested IDs.
+
+struct FilterCheckOptions
+{
+    QString device;         // bxcan-f0, bxcan-f4, fdcan-g0, fdcan-h7 or all
+    bool exhaustive;        // check all 2^29 extended IDs
+    quint64 samples;        // random extended IDs otherwise
+    unsigned threads;       // 0: one per core
+};
+
+// Returns the process exit code: 0 when every wanted ID is accepted
+int filterVerify(const QString &definition, const FilterCheckOptions &options);
+
+// Time filter construction for up to maxIds random IDs
+int filterBenchmark(int maxIds, const FilterCheckOptions &options);
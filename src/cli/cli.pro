@@ -0,0 +1,41 @@
+lessThan(QT_MAJOR_VERSION, 5): error("requires Qt 5")
+
+# command-line recorder: same Backend and drivers as the GUI,
+# without QtWidgets
+QT = core
+QT += xml
+QT += serialport
+
+TARGET = cangaroo-cli
+TEMPLATE = app
+CONFIG += console warn_on
+CONFIG -= app_bundle
+CONFIG += link_pkgconfig
+CONFIG += headless
+DEFINES += CANGAROO_HEADLESS
+
+INCLUDEPATH += $$PWD/..
+
+DESTDIR = ../../bin
+MOC_DIR = ../../build/cli/moc
+unix:OBJECTS_DIR = ../../build/cli/o/unix
+win32:OBJECTS_DIR = ../../build/cli/o/win32
+macx:OBJECTS_DIR = ../../build/cli/o/mac
+
+SOURCES += main.cpp \
+    FilterCheck.cpp
+HEADERS += FilterCheck.h
+
+include($$PWD/../core/core.pri)
+include($$PWD/../driver/driver.pri)
+include($$PWD/../parser/dbc/dbc.pri)
+
+unix:PKGCONFIG += libnl-3.0
+unix:PKGCONFIG += libnl-route-3.0
+unix:PKGCONFIG += libusb-1.0
+unix:include($$PWD/../driver/SocketCanDriver/SocketCanDriver.pri)
+
+include($$PWD/../driver/CANBlastDriver/CANBlastDriver.pri)
+include($$PWD/../driver/SLCANDriver/SLCANDriver.pri)
+
+win32:include($$PWD/../driver/CandleApiDriver/CandleApiDriver.pri)
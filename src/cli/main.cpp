@@ -0,0 +1,278 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+/*
+ * cangaroo-cli: records all frames of a measurement setup to a candump
+ * log file and/or streams them to remote viewers, without a GUI. The
+ * setup is read from a workspace file saved by cangaroo; without one,
+ * every interface found is opened with its current configuration.
+ *
+ *   cangaroo-cli -w bench.cangaroo -o capture.log -t 3600
+ *   cangaroo-cli -w bench.cangaroo --serve-tcp 29536 --serve-signals
+ *
+ * It also checks the hardware filter builders offline against a software
+ * model of the controllers:
+ *
+ *   cangaroo-cli --filter-verify "0x100-0x1ff 0x18daf110" --filter-exhaustive
+ *   cangaroo-cli --filter-bench 4096 --filter-device bxcan-f4
+ */
+
+#include <signal.h>
+#include <stdio.h>
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDomDocument>
+#include <QFile>
+#include <QTimer>
+
+#include <core/Backend.h>
+#include <core/Log.h>
+#include <core/MeasurementSetup.h>
+#include <core/CanStreamRecorder.h>
+#include <core/CanStreamServer.h>
+
+#include "FilterCheck.h"
+
+#include <driver/SLCANDriver/SLCANDriver.h>
+#include <driver/CANBlastDriver/CANBlasterDriver.h>
+
+#if defined(__linux__)
+#include <driver/SocketCanDriver/SocketCanDriver.h>
+#else
+#include <driver/CandleApiDriver/CandleApiDriver.h>
+#endif
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int sig)
+{
+    (void) sig;
+    stopRequested = 1;
+}
+
+static bool loadWorkspaceSetup(Backend &backend, QString filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        log_error(QString("Cannot open workspace settings file: %1").arg(filename));
+        return false;
+    }
+
+    QDomDocument doc;
+    if (!doc.setContent(&file)) {
+        log_error(QString("Cannot load settings from file: %1").arg(filename));
+        return false;
+    }
+
+    QDomElement setupRoot = doc.firstChild().firstChildElement("setup");
+    MeasurementSetup setup(&backend);
+    if (!setup.loadXML(backend, setupRoot)) {
+        log_error(QString("Unable to read measurement setup from workspace config file: %1").arg(filename));
+        return false;
+    }
+
+    backend.setSetup(setup);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("cangaroo-cli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Record CAN traffic to a candump log file without a GUI.");
+    parser.addHelpOption();
+    QCommandLineOption workspaceOption(QStringList() << "w" << "workspace", "Measurement setup from a cangaroo workspace file.", "file");
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "candump log file to write.", "file");
+    QCommandLineOption durationOption(QStringList() << "t" << "duration", "Stop after this many seconds.", "seconds");
+    QCommandLineOption flushOption("flush-interval", "Write to disk every ms milliseconds (default 200).", "ms", "200");
+    QCommandLineOption statsOption("stats", "Print frame counts every this many seconds.", "seconds");
+    QCommandLineOption serveTcpOption("serve-tcp", "Stream the live trace on this TCP port.", "port");
+    QCommandLineOption serveAnyOption("serve-any", "Accept stream subscribers from other hosts, not only localhost.");
+    QCommandLineOption serveLocalOption("serve-local", "Stream the live trace on this local socket.", "name");
+    QCommandLineOption serveSignalsOption("serve-signals", "Also stream decoded signals.");
+    QCommandLineOption serveQueueOption("serve-queue", "Queue size per subscriber in KiB (default 4096).", "KiB", "4096");
+    QCommandLineOption serveDropOption("serve-drop", "What to do with a subscriber that falls behind: newest, oldest or disconnect (default newest).", "policy", "newest");
+    QCommandLineOption verboseOption(QStringList() << "v" << "verbose", "Also print info and debug messages.");
+    QCommandLineOption filterVerifyOption("filter-verify", "Build this hardware filter and check it against a model of the controller.", "definition");
+    QCommandLineOption filterBenchOption("filter-bench", "Time hardware filter construction for up to this many random IDs.", "ids");
+    QCommandLineOption filterDeviceOption("filter-device", "Controller to check: bxcan-f0, bxcan-f4, fdcan-g0, fdcan-h7 or all (default all).", "device", "all");
+    QCommandLineOption filterExhaustiveOption("filter-exhaustive", "Check all 2^29 extended IDs instead of a random sample.");
+    QCommandLineOption filterSamplesOption("filter-samples", "Random extended IDs to check (default 1000000).", "count", "1000000");
+    QCommandLineOption filterThreadsOption("filter-threads", "Threads for the extended ID check (default one per core).", "count", "0");
+    parser.addOption(workspaceOption);
+    parser.addOption(outputOption);
+    parser.addOption(durationOption);
+    parser.addOption(flushOption);
+    parser.addOption(statsOption);
+    parser.addOption(serveTcpOption);
+    parser.addOption(serveAnyOption);
+    parser.addOption(serveLocalOption);
+    parser.addOption(serveSignalsOption);
+    parser.addOption(serveQueueOption);
+    parser.addOption(serveDropOption);
+    parser.addOption(verboseOption);
+    parser.addOption(filterVerifyOption);
+    parser.addOption(filterBenchOption);
+    parser.addOption(filterDeviceOption);
+    parser.addOption(filterExhaustiveOption);
+    parser.addOption(filterSamplesOption);
+    parser.addOption(filterThreadsOption);
+    parser.process(a);
+
+    if (parser.isSet(filterVerifyOption) || parser.isSet(filterBenchOption)) {
+        FilterCheckOptions filterOptions;
+        filterOptions.device = parser.value(filterDeviceOption);
+        filterOptions.exhaustive = parser.isSet(filterExhaustiveOption);
+        filterOptions.samples = parser.value(filterSamplesOption).toULongLong();
+        filterOptions.threads = parser.value(filterThreadsOption).toUInt();
+
+        int result = 0;
+        if (parser.isSet(filterVerifyOption)) {
+            result = filterVerify(parser.value(filterVerifyOption), filterOptions);
+        }
+        if (parser.isSet(filterBenchOption) && (result == 0)) {
+            result = filterBenchmark(parser.value(filterBenchOption).toInt(), filterOptions);
+        }
+        return result;
+    }
+
+    bool record = parser.isSet(outputOption);
+    bool serve = parser.isSet(serveTcpOption) || parser.isSet(serveLocalOption);
+    if (!record && !serve) {
+        fprintf(stderr, "cangaroo-cli: nothing to do, give an output file (-o) or a stream server option\n");
+        return 1;
+    }
+
+    CanStreamServerConfig serverConfig;
+    serverConfig.includeSignals = parser.isSet(serveSignalsOption);
+    serverConfig.queueBytes = qMax(64, parser.value(serveQueueOption).toInt()) * 1024;
+    QString dropPolicy = parser.value(serveDropOption);
+    if (dropPolicy == "newest") {
+        serverConfig.dropPolicy = stream_drop_newest;
+    } else if (dropPolicy == "oldest") {
+        serverConfig.dropPolicy = stream_drop_oldest;
+    } else if (dropPolicy == "disconnect") {
+        serverConfig.dropPolicy = stream_disconnect;
+    } else {
+        fprintf(stderr, "cangaroo-cli: unknown drop policy: %s\n", qPrintable(dropPolicy));
+        return 1;
+    }
+
+    Backend &backend = Backend::instance();
+
+    bool verbose = parser.isSet(verboseOption);
+    QObject::connect(&backend, &Backend::onLogMessage, [verbose](const QDateTime dt, const log_level_t level, const QString msg) {
+        if (verbose || (level >= log_level_warning)) {
+            fprintf(stderr, "%s %s\n", qPrintable(dt.toString("hh:mm:ss.zzz")), qPrintable(msg));
+        }
+    });
+
+#if defined(__linux__)
+    backend.addCanDriver(*(new SocketCanDriver(backend)));
+#else
+    backend.addCanDriver(*(new CandleApiDriver(backend)));
+#endif
+    backend.addCanDriver(*(new SLCANDriver(backend)));
+    // backend.addCanDriver(*(new CANBlasterDriver(backend)));
+
+    // scans the drivers for interfaces, which loading the setup relies on
+    backend.setDefaultSetup();
+
+    if (parser.isSet(workspaceOption)) {
+        if (!loadWorkspaceSetup(backend, parser.value(workspaceOption))) {
+            return 1;
+        }
+    }
+
+    // frames go straight to disk; the in-memory trace is only needed by the GUI
+    backend.setTraceEnabled(false);
+
+    CanStreamRecorder recorder(backend);
+    recorder.setFlushInterval(parser.value(flushOption).toInt());
+    QString error;
+    if (record && !recorder.startRecording(parser.value(outputOption), &error)) {
+        fprintf(stderr, "cangaroo-cli: cannot write %s: %s\n", qPrintable(parser.value(outputOption)), qPrintable(error));
+        return 1;
+    }
+
+    CanStreamServer &server = backend.getStreamServer();
+    server.setConfig(serverConfig);
+    if (parser.isSet(serveTcpOption)) {
+        if (!server.listenTcp(parser.value(serveTcpOption).toUShort(), !parser.isSet(serveAnyOption), &error)) {
+            fprintf(stderr, "cangaroo-cli: cannot listen on TCP port %s: %s\n", qPrintable(parser.value(serveTcpOption)), qPrintable(error));
+            return 1;
+        }
+    }
+    if (parser.isSet(serveLocalOption)) {
+        if (!server.listenLocal(parser.value(serveLocalOption), &error)) {
+            fprintf(stderr, "cangaroo-cli: cannot listen on %s: %s\n", qPrintable(parser.value(serveLocalOption)), qPrintable(error));
+            return 1;
+        }
+    }
+
+    backend.startMeasurement();
+
+    signal(SIGINT, requestStop);
+    signal(SIGTERM, requestStop);
+
+    QTimer stopTimer;
+    QObject::connect(&stopTimer, &QTimer::timeout, [&a]() {
+        if (stopRequested) {
+            a.quit();
+        }
+    });
+    stopTimer.start(100);
+
+    if (parser.isSet(durationOption)) {
+        QTimer::singleShot(parser.value(durationOption).toInt() * 1000, &a, SLOT(quit()));
+    }
+
+    QTimer statsTimer;
+    if (parser.isSet(statsOption)) {
+        QObject::connect(&statsTimer, &QTimer::timeout, [&recorder, &server]() {
+            fprintf(stderr, "frames written: %llu, dropped: %llu, bytes: %llu, subscribers: %d, stream drops: %llu\n",
+                    (unsigned long long)recorder.getFramesWritten(),
+                    (unsigned long long)recorder.getFramesDropped(),
+                    (unsigned long long)recorder.getBytesWritten(),
+                    server.getSubscriberCount(),
+                    (unsigned long long)server.getFramesDropped());
+        });
+        statsTimer.start(parser.value(statsOption).toInt() * 1000);
+    }
+
+    int result = a.exec();
+
+    backend.stopMeasurement();
+    server.close();
+    recorder.stopRecording();
+
+    if (record) {
+        fprintf(stderr, "%llu frames written to %s, %llu dropped\n",
+                (unsigned long long)recorder.getFramesWritten(),
+                qPrintable(parser.value(outputOption)),
+                (unsigned long long)recorder.getFramesDropped());
+    }
+
+    return result;
+}
@@ -25,11 +25,22 @@
 #include <QDateTime>
 
 #include <core/CanTrace.h>
+#include <core/CanDbMessage.h>
+#include <core/CanTxScheduler.h>
+#include <core/CanLoadGenerator.h>
+#include <core/CanTxSequencer.h>
+#include <core/CanRxObserver.h>
+#include <core/CanLatencyAnalyzer.h>
+#include <core/CanBridge.h>
+#include <core/CanTriggerCapture.h>
+#include <core/CanStreamServer.h>
 #include <core/MeasurementSetup.h>
 #include <core/MeasurementNetwork.h>
 #include <core/MeasurementInterface.h>
 #include <driver/CanDriver.h>
 #include <driver/CanInterface.h>
+#include <driver/HardwareFilter.h>
+#include <driver/SoftwareFilter.h>
 #include <driver/CanListener.h>
 #include <parser/dbc/DbcParser.h>
 
@@ -39,14 +50,24 @@ Backend::Backend()
   : QObject(0),
     _measurementRunning(false),
     _measurementStartTime(0),
-    _setup(this)
+    _setup(this),
+    _traceEnabled(true)
 {
     _logModel = new LogModel(*this);
 
     setDefaultSetup();
-    _trace = new CanTrace(*this, this, 1);
+    _trace = new CanTrace(*this, this, 16); // ~60 updates per second
+    _txScheduler = new CanTxScheduler(*this, this);
+    _loadGenerator = new CanLoadGenerator(*this);
+    _txSequencer = new CanTxSequencer(*this, this);
+    _latencyAnalyzer = new CanLatencyAnalyzer(this);
+    addRxObserver(_latencyAnalyzer);
+    _bridge = new CanBridge(*this, this);
+    _triggerCapture = new CanTriggerCapture(*this, this);
+    _streamServer = new CanStreamServer(*this, this);
 
     connect(&_setup, SIGNAL(onSetupChanged()), this, SIGNAL(onSetupChanged()));
+    connect(&_setup, SIGNAL(onSetupChanged()), this, SLOT(setupChanged()));
 }
 
 Backend &Backend::instance()
@@ -59,6 +80,14 @@ Backend &Backend::instance()
 
 Backend::~Backend()
 {
+    delete _streamServer;
+    delete _triggerCapture;
+    delete _bridge;
+    removeRxObserver(_latencyAnalyzer);
+    delete _latencyAnalyzer;
+    delete _txSequencer;
+    delete _loadGenerator;
+    delete _txScheduler;
     delete _trace;
 }
 
@@ -75,6 +104,11 @@ bool Backend::startMeasurement()
     _measurementStartTime = QDateTime::currentMSecsSinceEpoch();
     _timerSinceStart.start();
 
+    QElapsedTimer openTimer;
+    openTimer.start();
+
+    // every listener opens its interface in its own thread, so slow
+    // adapters open in parallel
     int i=0;
     foreach (MeasurementNetwork *network, _setup.getNetworks()) {
         i++;
@@ -86,12 +120,26 @@ bool Backend::startMeasurement()
 
                 log_info(QString(tr("Listening on interface: %1")).arg(intf->getName()));
                 CanListener *listener = new CanListener(0, *this, *intf);
-                listener->startThread();
                 _listeners.append(listener);
+                applyFilter(*network, *mi);
+                listener->startThread();
             }
         }
     }
 
+    // beginMeasurement is emitted only after all interfaces are open
+    foreach (CanListener *listener, _listeners) {
+        QString name = listener->getInterface().getName();
+        if (listener->waitOpen()) {
+            log_info(QString(tr("Interface %1 opened in %2 ms")).arg(name).arg(listener->getOpenTime()));
+        } else {
+            log_warning(QString(tr("Interface %1 failed to open after %2 ms")).arg(name).arg(listener->getOpenTime()));
+        }
+    }
+    log_info(QString(tr("%1 interfaces ready after %2 ms")).arg(_listeners.size()).arg(openTimer.elapsed()));
+
+    _txScheduler->start();
+
     _measurementRunning = true;
     emit beginMeasurement();
     return true;
@@ -100,6 +148,12 @@ bool Backend::startMeasurement()
 bool Backend::stopMeasurement()
 {
     if (_measurementRunning) {
+        _bridge->stop();
+        _triggerCapture->disarm();
+        _txSequencer->stopAll();
+        _txScheduler->stop();
+        _loadGenerator->stopLoad();
+
         foreach (CanListener *listener, _listeners) {
             listener->requestStop();
         }
@@ -176,6 +230,73 @@ void Backend::clearTrace()
     _trace->clear();
 }
 
+bool Backend::isTraceEnabled() const
+{
+    return _traceEnabled;
+}
+
+void Backend::setTraceEnabled(bool enabled)
+{
+    _traceEnabled = enabled;
+}
+
+CanTxScheduler &Backend::getTxScheduler()
+{
+    return *_txScheduler;
+}
+
+CanLoadGenerator &Backend::getLoadGenerator()
+{
+    return *_loadGenerator;
+}
+
+CanTxSequencer &Backend::getTxSequencer()
+{
+    return *_txSequencer;
+}
+
+CanLatencyAnalyzer &Backend::getLatencyAnalyzer()
+{
+    return *_latencyAnalyzer;
+}
+
+CanBridge &Backend::getBridge()
+{
+    return *_bridge;
+}
+
+CanTriggerCapture &Backend::getTriggerCapture()
+{
+    return *_triggerCapture;
+}
+
+CanStreamServer &Backend::getStreamServer()
+{
+    return *_streamServer;
+}
+
+void Backend::addRxObserver(CanRxObserver *observer)
+{
+    QWriteLocker locker(&_rxObserverLock);
+    if (!_rxObservers.contains(observer)) {
+        _rxObservers.append(observer);
+    }
+}
+
+void Backend::removeRxObserver(CanRxObserver *observer)
+{
+    QWriteLocker locker(&_rxObserverLock);
+    _rxObservers.removeAll(observer);
+}
+
+void Backend::notifyRxObservers(CanInterfaceId interface, const QList<CanMessage> &msgs)
+{
+    QReadLocker locker(&_rxObserverLock);
+    foreach (CanRxObserver *observer, _rxObservers) {
+        observer->messagesReceived(interface, msgs);
+    }
+}
+
 CanDbMessage *Backend::findDbMessage(const CanMessage &msg) const
 {
     return _setup.findDbMessage(msg);
@@ -267,6 +388,117 @@ LogModel &Backend::getLogModel() const
     return *_logModel;
 }
 
+void Backend::applyFilters()
+{
+    foreach (MeasurementNetwork *network, _setup.getNetworks()) {
+        foreach (MeasurementInterface *mi, network->interfaces()) {
+            applyFilter(*network, *mi);
+        }
+    }
+}
+
+bool Backend::applyFilter(MeasurementNetwork &network, MeasurementInterface &mi)
+{
+    CanInterface *intf = getInterfaceById(mi.canInterface());
+    if (!intf) {
+        return false;
+    }
+
+    CanListener *listener = getListener(mi.canInterface());
+    SoftwareFilter filter;
+    QList<uint32_t> ids;
+    switch (mi.hwFilterMode()) {
+        case MeasurementInterface::hw_filter_manual:
+            // an empty filter would silence the interface
+            if (mi.hwFilter().trimmed().isEmpty()) {
+                log_warning(tr("hwfilter: empty filter for interface %1, filter not changed").arg(intf->getName()));
+                return false;
+            }
+            if (!filter.setDefinition(mi.hwFilter())) {
+                log_error(tr("filter: syntax error in filter for interface %1").arg(intf->getName()));
+                return false;
+            }
+            break;
+
+        case MeasurementInterface::hw_filter_dbc:
+            foreach (pCanDb db, network._canDbs) {
+                foreach (CanDbMessage *msg, db->getMessages()) {
+                    ids.append(msg->getRaw_id());
+                }
+            }
+            break;
+
+        case MeasurementInterface::hw_filter_ids:
+            ids = mi.hwFilterIds();
+            break;
+
+        case MeasurementInterface::hw_filter_off:
+        default:
+            if (listener) {
+                listener->setSoftwareFilter(filter);
+            }
+            // the controller keeps an earlier filter, even across measurements
+            if (hasHardwareFilter(intf)) {
+                return clearHardwareFilter(intf);
+            }
+            return true;
+    }
+
+    if (mi.hwFilterMode() != MeasurementInterface::hw_filter_manual) {
+        // an empty filter would silence the interface
+        if (ids.isEmpty()) {
+            log_warning(tr("hwfilter: no IDs for interface %1, filter not changed").arg(intf->getName()));
+            return false;
+        }
+        filter.setIds(ids);
+    }
+
+    // also behind a hardware filter: drops what an approximated filter lets through
+    if (listener) {
+        listener->setSoftwareFilter(filter);
+    }
+
+    if (!hasHardwareFilter(intf)) {
+        log_info(tr("filter: interface %1 has no hardware filter, filtering in software").arg(intf->getName()));
+        return true;
+    }
+    // traffic is only fetched when the filter has to be approximated
+    CanInterfaceId id = mi.canInterface();
+    hw_filter_traffic_t traffic = [this, id]() { return getTrafficById(id); };
+    if (mi.hwFilterMode() == MeasurementInterface::hw_filter_manual) {
+        return setHardwareFilter(intf, mi.hwFilter(), traffic);
+    }
+    return setHardwareFilter(intf, ids, traffic);
+}
+
+void Backend::setupChanged()
+{
+    // new DBCs or filter settings take effect right away
+    if (_measurementRunning) {
+        applyFilters();
+    }
+}
+
+CanListener *Backend::getListener(CanInterfaceId id)
+{
+    foreach (CanListener *listener, _listeners) {
+        if (listener->getInterfaceId() == id) {
+            return listener;
+        }
+    }
+    return 0;
+}
+
+QMap<uint32_t, quint64> Backend::getTrafficById(CanInterfaceId id)
+{
+    // counted by the listener as frames arrive, no trace scan
+    CanListener *listener = getListener(id);
+    if (!listener) {
+        return QMap<uint32_t, quint64>();
+    }
+    return listener->getTrafficById();
+}
+
 double Backend::getTimestampAtMeasurementStart() const
 {
     return (double)_measurementStartTime / 1000.0;
@@ -289,5 +521,7 @@ uint64_t Backend::getUsecsSinceMeasurementStart() const
 
 void Backend::logMessage(const QDateTime dt, const log_level_t level, const QString msg)
 {
+    // called from any thread; the log model batches and rate-limits
+    _logModel->enqueue(dt, level, msg);
     emit onLogMessage(dt, level, msg);
 }
@@ -24,7 +24,9 @@
 #include <stdint.h>
 #include <QObject>
 #include <QList>
+#include <QMap>
 #include <QMutex>
+#include <QReadWriteLock>
 #include <QDateTime>
 #include <QElapsedTimer>
 #include <driver/CanDriver.h>
@@ -33,11 +35,20 @@
 #include <core/Log.h>
 
 class MeasurementNetwork;
+class MeasurementInterface;
 class CanTrace;
 class CanListener;
 class CanDbMessage;
 class SetupDialog;
 class LogModel;
+class CanTxScheduler;
+class CanLoadGenerator;
+class CanTxSequencer;
+class CanRxObserver;
+class CanLatencyAnalyzer;
+class CanBridge;
+class CanTriggerCapture;
+class CanStreamServer;
 
 class Backend : public QObject
 {
@@ -71,6 +82,22 @@ public:
     CanTrace *getTrace();
     void clearTrace();
 
+    // when disabled, received frames only go to the rx observers
+    bool isTraceEnabled() const;
+    void setTraceEnabled(bool enabled);
+
+    CanTxScheduler &getTxScheduler();
+    CanLoadGenerator &getLoadGenerator();
+    CanTxSequencer &getTxSequencer();
+    CanLatencyAnalyzer &getLatencyAnalyzer();
+    CanBridge &getBridge();
+    CanTriggerCapture &getTriggerCapture();
+    CanStreamServer &getStreamServer();
+
+    void addRxObserver(CanRxObserver *observer);
+    void removeRxObserver(CanRxObserver *observer);
+    void notifyRxObservers(CanInterfaceId interface, const QList<CanMessage> &msgs);
+
     CanDbMessage *findDbMessage(const CanMessage &msg) const;
 
     CanInterfaceIdList getInterfaceList();
@@ -87,6 +114,11 @@ public:
     void clearLog();
     LogModel &getLogModel() const;
 
+    // set up the acceptance filters of the setup's interfaces: in the
+    // listener thread for every interface, in the controller where it has one
+    void applyFilters();
+    bool applyFilter(MeasurementNetwork &network, MeasurementInterface &mi);
+
 signals:
     void beginMeasurement();
     void endMeasurement();
@@ -99,7 +131,13 @@ signals:
 
 public slots:
 
+private slots:
+    void setupChanged();
+
 private:
+    QMap<uint32_t, quint64> getTrafficById(CanInterfaceId id);
+    CanListener *getListener(CanInterfaceId id);
+
     static Backend *_instance;
 
     bool _measurementRunning;
@@ -108,7 +146,18 @@ private:
     QList<CanDriver*> _drivers;
     MeasurementSetup _setup;
     CanTrace *_trace;
+    bool _traceEnabled;
     QList<CanListener*> _listeners;
+    CanTxScheduler *_txScheduler;
+    CanLoadGenerator *_loadGenerator;
+    CanTxSequencer *_txSequencer;
+    CanLatencyAnalyzer *_latencyAnalyzer;
+    CanBridge *_bridge;
+    CanTriggerCapture *_triggerCapture;
+    CanStreamServer *_streamServer;
+
+    QReadWriteLock _rxObserverLock;
+    QList<CanRxObserver*> _rxObservers;
 
     LogModel *_logModel;
 };
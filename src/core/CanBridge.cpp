@@ -0,0 +1,181 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "CanBridge.h"
+
+#include <sys/time.h>
+
+#include <core/Backend.h>
+#include <driver/CanInterface.h>
+
+CanBridge::CanBridge(Backend &backend, QObject *parent)
+  : QObject(parent),
+    _backend(backend),
+    _isRunning(false)
+{
+    for (int i=0; i<2; i++) {
+        _directions[i].config.enabled = false;
+        _directions[i].peer = 0;
+        _directions[i].source = 0;
+        _directions[i].stats.forwarded = 0;
+        _directions[i].stats.filtered = 0;
+        _directions[i].stats.dropped = 0;
+    }
+}
+
+CanBridge::~CanBridge()
+{
+    stop();
+}
+
+bool CanBridge::start(CanInterfaceId a, CanInterfaceId b, const CanBridgeDirectionConfig &a_to_b, const CanBridgeDirectionConfig &b_to_a)
+{
+    stop();
+
+    CanInterface *intf_a = _backend.getInterfaceById(a);
+    CanInterface *intf_b = _backend.getInterfaceById(b);
+    if (!intf_a || !intf_b || (a == b)) {
+        return false;
+    }
+
+    QMutexLocker locker(&_mutex);
+
+    const CanBridgeDirectionConfig *configs[2] = { &a_to_b, &b_to_a };
+    CanInterface *peers[2] = { intf_b, intf_a };
+    CanInterfaceId sources[2] = { a, b };
+
+    for (int i=0; i<2; i++) {
+        direction_t &dir = _directions[i];
+        QMutexLocker dir_locker(&dir.mutex);
+        dir.config = *configs[i];
+        dir.peer = peers[i];
+        dir.source = sources[i];
+        dir.stats.forwarded = 0;
+        dir.stats.filtered = 0;
+        dir.stats.dropped = 0;
+        dir.stats.latency.reset();
+    }
+
+    _isRunning = true;
+    _backend.addRxObserver(this);
+    return true;
+}
+
+void CanBridge::stop()
+{
+    QMutexLocker locker(&_mutex);
+    if (_isRunning) {
+        // waits for listeners currently inside messagesReceived()
+        _backend.removeRxObserver(this);
+        _isRunning = false;
+    }
+}
+
+bool CanBridge::isRunning()
+{
+    QMutexLocker locker(&_mutex);
+    return _isRunning;
+}
+
+CanBridgeStats CanBridge::getStats(int direction)
+{
+    direction_t &dir = _directions[direction ? 1 : 0];
+    QMutexLocker locker(&dir.mutex);
+    return dir.stats;
+}
+
+void CanBridge::messagesReceived(CanInterfaceId interface, const QList<CanMessage> &msgs)
+{
+    for (int i=0; i<2; i++) {
+        if (_directions[i].source == interface) {
+            forward(_directions[i], msgs);
+        }
+    }
+}
+
+void CanBridge::forward(direction_t &dir, const QList<CanMessage> &msgs)
+{
+    QMutexLocker locker(&dir.mutex);
+    if (!dir.config.enabled) {
+        return;
+    }
+
+    dir.batch.clear();
+    foreach (const CanMessage &msg, msgs) {
+        if (!msg.isRX() || msg.isErrorFrame()) {
+            continue;
+        }
+
+        if (!dir.config.filters.isEmpty()) {
+            bool accept = false;
+            foreach (const CanFrameMatcher &filter, dir.config.filters) {
+                if (filter.matches(msg)) {
+                    accept = true;
+                    break;
+                }
+            }
+            if (!accept) {
+                dir.stats.filtered++;
+                continue;
+            }
+        }
+
+        CanMessage out(msg);
+        if (!dir.config.remap.isEmpty()) {
+            uint32_t key = msg.getId() | (msg.isExtended() ? 0x80000000 : 0);
+            QHash<uint32_t, uint32_t>::const_iterator it = dir.config.remap.constFind(key);
+            if (it != dir.config.remap.constEnd()) {
+                // keep the RTR flag, only replace the identifier
+                bool rtr = out.isRTR();
+                out.setId(it.value() & 0x1FFFFFFF);
+                out.setExtended((it.value() & 0x80000000) != 0);
+                out.setRTR(rtr);
+            }
+        }
+        out.setInterfaceId(dir.peer->getId());
+        out.setRX(false);
+        dir.batch.append(out);
+    }
+
+    if (dir.batch.isEmpty()) {
+        return;
+    }
+
+    if (!dir.peer->isOpen()) {
+        dir.stats.dropped += dir.batch.size();
+        return;
+    }
+
+    int sent = dir.peer->sendMessages(dir.batch);
+
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    uint64_t now = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+
+    for (int i=0; i<sent; i++) {
+        struct timeval ts = dir.batch[i].getTimestamp();
+        uint64_t t = (uint64_t)ts.tv_sec * 1000000 + ts.tv_usec;
+        dir.stats.latency.record((now > t) ? (now - t) : 0);
+    }
+
+    dir.stats.forwarded += sent;
+    dir.stats.dropped += dir.batch.size() - sent;
+}
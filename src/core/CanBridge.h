@@ -0,0 +1,95 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <QObject>
+#include <QMutex>
+#include <QList>
+#include <QHash>
+
+#include <core/CanFrameMatcher.h>
+#include <core/CanRxObserver.h>
+#include <core/HdrHistogram.h>
+#include <driver/CanDriver.h>
+
+class Backend;
+class CanInterface;
+
+typedef struct {
+    bool enabled;
+    QList<CanFrameMatcher> filters;     // empty: forward everything
+    QHash<uint32_t, uint32_t> remap;    // id | 0x80000000 if extended -> same
+} CanBridgeDirectionConfig;
+
+typedef struct {
+    uint64_t forwarded;
+    uint64_t filtered;
+    uint64_t dropped;
+    HdrHistogram latency;               // receive timestamp to handed to the peer driver, us
+} CanBridgeStats;
+
+/*
+ * Forwards frames between two interfaces. Forwarding happens directly on
+ * the receiving listener thread, before the frame is queued to the trace,
+ * so neither the GUI nor trace flushing is in the forwarding path. Only
+ * received frames are forwarded; our own transmissions looped back by the
+ * driver are not, which keeps the bridge from echoing frames back.
+ */
+class CanBridge : public QObject, public CanRxObserver
+{
+    Q_OBJECT
+
+public:
+    enum {
+        direction_a_to_b = 0,
+        direction_b_to_a = 1
+    };
+
+    explicit CanBridge(Backend &backend, QObject *parent=0);
+    virtual ~CanBridge();
+
+    bool start(CanInterfaceId a, CanInterfaceId b, const CanBridgeDirectionConfig &a_to_b, const CanBridgeDirectionConfig &b_to_a);
+    void stop();
+    bool isRunning();
+
+    CanBridgeStats getStats(int direction);
+
+    virtual void messagesReceived(CanInterfaceId interface, const QList<CanMessage> &msgs);
+
+private:
+    typedef struct {
+        QMutex mutex;
+        CanBridgeDirectionConfig config;
+        CanInterface *peer;
+        CanInterfaceId source;
+        QList<CanMessage> batch;
+        CanBridgeStats stats;
+    } direction_t;
+
+    Backend &_backend;
+    QMutex _mutex;
+    bool _isRunning;
+    direction_t _directions[2];
+
+    void forward(direction_t &dir, const QList<CanMessage> &msgs);
+};
@@ -57,6 +57,7 @@ class CanDb
 
         CanDbMessage *getMessageById(uint32_t raw_id);
         void addMessage(CanDbMessage *msg);
+        CanDbMessageList getMessages() { return _messages; }
 
         QString getComment() const;
         void setComment(const QString &comment);
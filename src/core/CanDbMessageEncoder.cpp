@@ -0,0 +1,309 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "CanDbMessageEncoder.h"
+
+#include <math.h>
+#include <QMutexLocker>
+
+#include "CanDbMessage.h"
+#include "CanDbSignal.h"
+
+struct crc8_table_t {
+    uint8_t table[256];
+
+    crc8_table_t(uint8_t poly)
+    {
+        for (int i=0; i<256; i++) {
+            uint8_t crc = i;
+            for (int bit=0; bit<8; bit++) {
+                crc = (crc & 0x80) ? ((crc << 1) ^ poly) : (crc << 1);
+            }
+            table[i] = crc;
+        }
+    }
+};
+
+static const crc8_table_t crc8_sae_j1850(0x1D);
+static const crc8_table_t crc8_autosar(0x2F);
+
+static uint64_t length_mask(uint8_t length)
+{
+    return (length >= 64) ? 0xFFFFFFFFFFFFFFFFULL : ((1ULL << length) - 1);
+}
+
+CanDbMessageEncoder::CanDbMessageEncoder(CanDbMessage *dbmsg)
+  : _dbmsg(dbmsg),
+    _rawId(dbmsg->getRaw_id()),
+    _dlc(dbmsg->getDlc()),
+    _muxer(-1)
+{
+    foreach (CanDbSignal *signal, dbmsg->getSignals()) {
+        compiled_signal_t sig;
+        sig.signal = signal;
+        sig.shift = signal->startBit();
+        sig.length = signal->length();
+        sig.mask = length_mask(sig.length);
+        sig.byteSwap = signal->isBigEndian() && (sig.length > 8);
+        sig.isSigned = !signal->isUnsigned();
+        sig.isMuxed = signal->isMuxed();
+        sig.muxValue = signal->getMuxValue();
+        sig.factor = (signal->getFactor() != 0) ? signal->getFactor() : 1;
+        sig.offset = signal->getOffset();
+        sig.min = signal->getMinimumValue();
+        sig.max = signal->getMaximumValue();
+        sig.role = role_value;
+        sig.checksumType = checksum_crc8_sae_j1850;
+        sig.dataId = 0;
+
+        uint64_t field = (sig.shift < 64) ? (sig.mask << sig.shift) : 0;
+        sig.byteMask = 0;
+        for (int i=0; i<8; i++) {
+            if ((field >> (8*i)) & 0xFF) {
+                sig.byteMask |= (1<<i);
+            }
+        }
+
+        if (signal->isMuxer()) {
+            _muxer = _signals.size();
+        }
+
+        _signals.append(sig);
+        setPhysicalValue(_signals.size()-1, (sig.min > 0 || sig.max < 0) ? sig.min : 0);
+    }
+}
+
+CanDbMessage *CanDbMessageEncoder::getDbMessage() const
+{
+    return _dbmsg;
+}
+
+int CanDbMessageEncoder::getSignalCount() const
+{
+    return _signals.size();
+}
+
+CanDbSignal *CanDbMessageEncoder::getSignal(int signal) const
+{
+    return _signals.value(signal).signal;
+}
+
+int CanDbMessageEncoder::findSignal(const QString &name) const
+{
+    for (int i=0; i<_signals.size(); i++) {
+        if (_signals[i].signal->name() == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+uint64_t CanDbMessageEncoder::physicalToRaw(const compiled_signal_t &sig, double value) const
+{
+    if (sig.max > sig.min) {
+        value = qBound(sig.min, value, sig.max);
+    }
+
+    double raw = round((value - sig.offset) / sig.factor);
+
+    if (sig.isSigned) {
+        double limit = ldexp(1.0, sig.length - 1);
+        raw = qBound(-limit, raw, limit - 1);
+        return ((uint64_t)(int64_t)raw) & sig.mask;
+    } else {
+        double limit = ldexp(1.0, sig.length);
+        if (raw <= 0) {
+            return 0;
+        } else if (raw >= limit - 1) {
+            return sig.mask;
+        } else {
+            return ((uint64_t)raw) & sig.mask;
+        }
+    }
+}
+
+uint64_t CanDbMessageEncoder::place(const compiled_signal_t &sig, uint64_t raw) const
+{
+    // inverse of CanMessage::extractRawSignal()
+    uint64_t data = raw & sig.mask;
+    if (sig.byteSwap) {
+        data = __builtin_bswap64(data << (64 - sig.length));
+    }
+    data &= sig.mask;
+    return (sig.shift < 64) ? (data << sig.shift) : 0;
+}
+
+bool CanDbMessageEncoder::setPhysicalValue(int signal, double value)
+{
+    QMutexLocker locker(&_mutex);
+    if ((signal<0) || (signal>=_signals.size())) {
+        return false;
+    }
+
+    compiled_signal_t &sig = _signals[signal];
+    sig.raw = physicalToRaw(sig, value);
+    sig.placed = place(sig, sig.raw);
+    sig.physical = sig.signal->convertRawValueToPhysical(sig.raw);
+    return true;
+}
+
+double CanDbMessageEncoder::getPhysicalValue(int signal)
+{
+    QMutexLocker locker(&_mutex);
+    if ((signal<0) || (signal>=_signals.size())) {
+        return 0;
+    }
+    return _signals[signal].physical;
+}
+
+CanDbMessageEncoder::signal_role_t CanDbMessageEncoder::getRole(int signal)
+{
+    QMutexLocker locker(&_mutex);
+    return _signals.value(signal).role;
+}
+
+CanDbMessageEncoder::checksum_type_t CanDbMessageEncoder::getChecksumType(int signal)
+{
+    QMutexLocker locker(&_mutex);
+    return _signals.value(signal).checksumType;
+}
+
+void CanDbMessageEncoder::setValueRole(int signal)
+{
+    QMutexLocker locker(&_mutex);
+    if ((signal>=0) && (signal<_signals.size())) {
+        _signals[signal].role = role_value;
+    }
+}
+
+void CanDbMessageEncoder::setCounterRole(int signal)
+{
+    QMutexLocker locker(&_mutex);
+    if ((signal>=0) && (signal<_signals.size())) {
+        _signals[signal].role = role_counter;
+    }
+}
+
+void CanDbMessageEncoder::setChecksumRole(int signal, checksum_type_t type, uint16_t data_id)
+{
+    QMutexLocker locker(&_mutex);
+    if ((signal>=0) && (signal<_signals.size())) {
+        _signals[signal].role = role_checksum;
+        _signals[signal].checksumType = type;
+        _signals[signal].dataId = data_id;
+    }
+}
+
+uint8_t CanDbMessageEncoder::checksum(const compiled_signal_t &sig, const uint8_t *data, int length) const
+{
+    const uint8_t *table = 0;
+    uint8_t result = 0;
+
+    switch (sig.checksumType) {
+        case checksum_crc8_sae_j1850:
+            table = crc8_sae_j1850.table;
+            break;
+        case checksum_crc8_autosar:
+            table = crc8_autosar.table;
+            break;
+        case checksum_xor:
+            for (int i=0; i<length; i++) {
+                if (!(sig.byteMask & (1<<i))) { result ^= data[i]; }
+            }
+            return result;
+        case checksum_sum:
+            for (int i=0; i<length; i++) {
+                if (!(sig.byteMask & (1<<i))) { result += data[i]; }
+            }
+            return result;
+    }
+
+    result = 0xFF;
+    if (sig.dataId) {
+        result = table[result ^ (sig.dataId & 0xFF)];
+        result = table[result ^ (sig.dataId >> 8)];
+    }
+    for (int i=0; i<length; i++) {
+        if (!(sig.byteMask & (1<<i))) {
+            result = table[result ^ data[i]];
+        }
+    }
+    return result ^ 0xFF;
+}
+
+void CanDbMessageEncoder::encode(CanMessage &msg)
+{
+    QMutexLocker locker(&_mutex);
+
+    uint64_t mux = (_muxer >= 0) ? _signals[_muxer].raw : 0;
+    uint64_t word = 0;
+    bool hasChecksum = false;
+
+    for (int i=0; i<_signals.size(); i++) {
+        compiled_signal_t &sig = _signals[i];
+        if (sig.isMuxed && ((_muxer < 0) || (sig.muxValue != mux))) {
+            continue;
+        }
+
+        switch (sig.role) {
+            case role_value:
+                word |= sig.placed;
+                break;
+            case role_counter:
+                sig.placed = place(sig, sig.raw);
+                sig.physical = sig.raw;
+                word |= sig.placed;
+                sig.raw = (sig.raw + 1) & sig.mask;
+                break;
+            case role_checksum:
+                hasChecksum = true;
+                break;
+        }
+    }
+
+    int length = qMin((int)_dlc, 8);
+    uint8_t data[8];
+
+    if (hasChecksum) {
+        for (int i=0; i<_signals.size(); i++) {
+            compiled_signal_t &sig = _signals[i];
+            if ((sig.role != role_checksum) || (sig.isMuxed && ((_muxer < 0) || (sig.muxValue != mux)))) {
+                continue;
+            }
+            for (int b=0; b<8; b++) {
+                data[b] = word >> (8*b);
+            }
+            sig.raw = checksum(sig, data, length) & sig.mask;
+            sig.placed = place(sig, sig.raw);
+            sig.physical = sig.raw;
+            word |= sig.placed;
+        }
+    }
+
+    msg.setRawId(_rawId);
+    msg.setLength(_dlc);
+    if (_dlc > 8) {
+        msg.setFD(true);
+    }
+    for (int b=0; b<8; b++) {
+        msg.setByte(b, word >> (8*b));
+    }
+}
@@ -0,0 +1,114 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <QString>
+#include <QVector>
+#include <QMutex>
+#include <QSharedPointer>
+
+#include "CanMessage.h"
+
+class CanDbMessage;
+class CanDbSignal;
+
+/*
+ * Builds CAN frames for a CanDbMessage from physical signal values.
+ *
+ * The signal layout is compiled once into shift/mask operations on the
+ * 64 bit payload word, as the exact inverse of CanMessage::extractRawSignal()
+ * and CanDbSignal::convertRawValueToPhysical(). Raw values are converted
+ * when a physical value is set, so encode() only has to combine precomputed
+ * words, step alive counters and calculate checksums. This makes it cheap
+ * enough to run from the TX scheduler on every cycle.
+ */
+class CanDbMessageEncoder
+{
+public:
+    typedef enum {
+        role_value,
+        role_counter,
+        role_checksum
+    } signal_role_t;
+
+    typedef enum {
+        checksum_crc8_sae_j1850,
+        checksum_crc8_autosar,
+        checksum_xor,
+        checksum_sum
+    } checksum_type_t;
+
+    explicit CanDbMessageEncoder(CanDbMessage *dbmsg);
+
+    CanDbMessage *getDbMessage() const;
+    int getSignalCount() const;
+    CanDbSignal *getSignal(int signal) const;
+    int findSignal(const QString &name) const;
+
+    bool setPhysicalValue(int signal, double value);
+    double getPhysicalValue(int signal);
+
+    signal_role_t getRole(int signal);
+    checksum_type_t getChecksumType(int signal);
+    void setValueRole(int signal);
+    void setCounterRole(int signal);
+    void setChecksumRole(int signal, checksum_type_t type, uint16_t data_id=0);
+
+    void encode(CanMessage &msg);
+
+private:
+    typedef struct {
+        CanDbSignal *signal;
+        uint8_t shift;
+        uint8_t length;
+        uint64_t mask;
+        bool byteSwap;
+        bool isSigned;
+        bool isMuxed;
+        uint32_t muxValue;
+        double factor;
+        double offset;
+        double min;
+        double max;
+        signal_role_t role;
+        checksum_type_t checksumType;
+        uint16_t dataId;
+        uint8_t byteMask;
+        uint64_t raw;
+        uint64_t placed;
+        double physical;
+    } compiled_signal_t;
+
+    CanDbMessage *_dbmsg;
+    uint32_t _rawId;
+    uint8_t _dlc;
+    int _muxer;
+    QVector<compiled_signal_t> _signals;
+    QMutex _mutex;
+
+    uint64_t physicalToRaw(const compiled_signal_t &sig, double value) const;
+    uint64_t place(const compiled_signal_t &sig, uint64_t raw) const;
+    uint8_t checksum(const compiled_signal_t &sig, const uint8_t *data, int length) const;
+};
+
+typedef QSharedPointer<CanDbMessageEncoder> pCanDbMessageEncoder;
@@ -0,0 +1,157 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "CanFrameMatcher.h"
+
+CanFrameMatcher::CanFrameMatcher()
+  : _id(0),
+    _mask(0),
+    _extended(false),
+    _payloadLength(0)
+{
+}
+
+bool CanFrameMatcher::setId(const QString &id, const QString &mask)
+{
+    bool ok;
+    uint32_t value = id.toUInt(&ok, 16);
+    if (!ok || (value > 0x1FFFFFFF)) {
+        return false;
+    }
+
+    uint32_t mask_value = 0x1FFFFFFF;
+    if (!mask.isEmpty()) {
+        mask_value = mask.toUInt(&ok, 16);
+        if (!ok) {
+            return false;
+        }
+    }
+
+    _id = value;
+    _mask = mask_value;
+    _extended = (id.length() > 3) || (value > 0x7FF);
+    _idString = id.toUpper();
+    _maskString = mask.toUpper();
+    return true;
+}
+
+bool CanFrameMatcher::setPayloadPattern(const QString &pattern)
+{
+    QString p = pattern.toUpper();
+    p.remove(' ');
+    if (((p.length() % 2) != 0) || (p.length() > 128)) {
+        return false;
+    }
+
+    for (int i=0; i<p.length(); i++) {
+        QChar c = p[i];
+        int shift = (i % 2) ? 0 : 4;
+        uint8_t nibble = 0;
+        uint8_t nibble_mask = 0x0F;
+
+        if (c == 'X') {
+            nibble_mask = 0;
+        } else if (c.isDigit()) {
+            nibble = c.toLatin1() - '0';
+        } else if ((c >= 'A') && (c <= 'F')) {
+            nibble = c.toLatin1() - 'A' + 10;
+        } else {
+            return false;
+        }
+
+        if (shift) {
+            _payload[i/2] = 0;
+            _payloadMask[i/2] = 0;
+        }
+        _payload[i/2] |= nibble << shift;
+        _payloadMask[i/2] |= nibble_mask << shift;
+    }
+
+    _payloadLength = p.length() / 2;
+    _pattern = p;
+    return true;
+}
+
+bool CanFrameMatcher::parse(const QString &str)
+{
+    QString id = str.trimmed();
+    QString mask;
+    QString pattern;
+
+    int colon = id.indexOf(':');
+    if (colon >= 0) {
+        pattern = id.mid(colon + 1);
+        id.truncate(colon);
+    }
+
+    int slash = id.indexOf('/');
+    if (slash >= 0) {
+        mask = id.mid(slash + 1);
+        id.truncate(slash);
+    }
+
+    return setId(id, mask) && setPayloadPattern(pattern);
+}
+
+QString CanFrameMatcher::toString() const
+{
+    QString str = _idString;
+    if (!_maskString.isEmpty()) {
+        str += "/" + _maskString;
+    }
+    if (!_pattern.isEmpty()) {
+        str += ":" + _pattern;
+    }
+    return str;
+}
+
+QString CanFrameMatcher::getIdString() const
+{
+    return _idString;
+}
+
+QString CanFrameMatcher::getMaskString() const
+{
+    return _maskString;
+}
+
+QString CanFrameMatcher::getPayloadPattern() const
+{
+    return _pattern;
+}
+
+bool CanFrameMatcher::matches(const CanMessage &msg) const
+{
+    if ((msg.isExtended() != _extended) || (((msg.getId() ^ _id) & _mask) != 0)) {
+        return false;
+    }
+
+    if (msg.getLength() < _payloadLength) {
+        return false;
+    }
+
+    for (int i=0; i<_payloadLength; i++) {
+        if ((msg.getByte(i) & _payloadMask[i]) != _payload[i]) {
+            return false;
+        }
+    }
+    return true;
+}
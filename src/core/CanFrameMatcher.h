@@ -0,0 +1,61 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <QString>
+
+#include <core/CanMessage.h>
+
+/*
+ * Matches a frame by ID/mask and an optional payload pattern. The pattern
+ * is a hex string where 'X' marks a don't-care nibble, e.g. "0250" or "7FXX78".
+ * As text, a matcher is written ID[/MASK][:PATTERN], e.g. "7E8/7F0:XX50".
+ */
+class CanFrameMatcher
+{
+public:
+    CanFrameMatcher();
+
+    bool setId(const QString &id, const QString &mask);
+    bool setPayloadPattern(const QString &pattern);
+
+    bool parse(const QString &str);
+    QString toString() const;
+
+    QString getIdString() const;
+    QString getMaskString() const;
+    QString getPayloadPattern() const;
+
+    bool matches(const CanMessage &msg) const;
+
+private:
+    uint32_t _id;
+    uint32_t _mask;
+    bool _extended;
+    int _payloadLength;
+    uint8_t _payload[64];
+    uint8_t _payloadMask[64];
+    QString _idString;
+    QString _maskString;
+    QString _pattern;
+};
@@ -0,0 +1,130 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "CanLatencyAnalyzer.h"
+
+// one minute is plenty for request/response latencies
+static const uint64_t highest_latency_us = 60000000;
+
+CanLatencyAnalyzer::CanLatencyAnalyzer(QObject *parent)
+  : QObject(parent)
+{
+}
+
+CanLatencyAnalyzer::~CanLatencyAnalyzer()
+{
+}
+
+int CanLatencyAnalyzer::addRule(const CanLatencyRule &rule)
+{
+    entry_t entry = {
+        rule,
+        false,
+        0,
+        { 0, 0, 0, HdrHistogram(highest_latency_us) }
+    };
+
+    QMutexLocker locker(&_mutex);
+    _entries.append(entry);
+    return _entries.size() - 1;
+}
+
+void CanLatencyAnalyzer::removeRule(int index)
+{
+    QMutexLocker locker(&_mutex);
+    if ((index >= 0) && (index < _entries.size())) {
+        _entries.removeAt(index);
+    }
+}
+
+int CanLatencyAnalyzer::getRuleCount()
+{
+    QMutexLocker locker(&_mutex);
+    return _entries.size();
+}
+
+CanLatencyRule CanLatencyAnalyzer::getRule(int index)
+{
+    QMutexLocker locker(&_mutex);
+    return _entries.value(index).rule;
+}
+
+bool CanLatencyAnalyzer::getResult(int index, CanLatencyResult &result)
+{
+    QMutexLocker locker(&_mutex);
+    if ((index < 0) || (index >= _entries.size())) {
+        return false;
+    }
+    result = _entries[index].result;
+    return true;
+}
+
+void CanLatencyAnalyzer::reset()
+{
+    QMutexLocker locker(&_mutex);
+    for (int i=0; i<_entries.size(); i++) {
+        entry_t &entry = _entries[i];
+        entry.pending = false;
+        entry.result.requests = 0;
+        entry.result.responses = 0;
+        entry.result.timeouts = 0;
+        entry.result.histogram.reset();
+    }
+}
+
+void CanLatencyAnalyzer::messagesReceived(CanInterfaceId interface, const QList<CanMessage> &msgs)
+{
+    (void) interface;
+
+    QMutexLocker locker(&_mutex);
+    if (_entries.isEmpty()) {
+        return;
+    }
+
+    foreach (const CanMessage &msg, msgs) {
+        struct timeval tv = msg.getTimestamp();
+        uint64_t t = (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+
+        for (int i=0; i<_entries.size(); i++) {
+            entry_t &entry = _entries[i];
+
+            if (entry.pending && (t > entry.requestTime) && (t - entry.requestTime > entry.rule.timeout_us)) {
+                entry.pending = false;
+                entry.result.timeouts++;
+            }
+
+            if (!msg.isRX()) {
+                if (entry.rule.request.matches(msg)) {
+                    if (entry.pending) {
+                        entry.result.timeouts++;
+                    }
+                    entry.pending = true;
+                    entry.requestTime = t;
+                    entry.result.requests++;
+                }
+            } else if (entry.pending && entry.rule.response.matches(msg)) {
+                entry.pending = false;
+                entry.result.responses++;
+                entry.result.histogram.record((t > entry.requestTime) ? (t - entry.requestTime) : 0);
+            }
+        }
+    }
+}
@@ -0,0 +1,83 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <QObject>
+#include <QMutex>
+#include <QList>
+#include <QString>
+
+#include <core/CanMessage.h>
+#include <core/CanFrameMatcher.h>
+#include <core/CanRxObserver.h>
+#include <core/HdrHistogram.h>
+
+typedef struct {
+    QString name;
+    CanFrameMatcher request;
+    CanFrameMatcher response;
+    uint32_t timeout_us;
+} CanLatencyRule;
+
+typedef struct {
+    uint64_t requests;
+    uint64_t responses;
+    uint64_t timeouts;
+    HdrHistogram histogram;
+} CanLatencyResult;
+
+/*
+ * Pairs transmitted frames (as looped back by the driver, see CanMessage::isRX())
+ * with the first received frame matching the rule's response and records the
+ * difference of the frame timestamps in a fixed size histogram, in microseconds.
+ * A request still unanswered when the next one is sent, or after the timeout,
+ * counts as a timeout.
+ */
+class CanLatencyAnalyzer : public QObject, public CanRxObserver
+{
+    Q_OBJECT
+
+public:
+    explicit CanLatencyAnalyzer(QObject *parent=0);
+    virtual ~CanLatencyAnalyzer();
+
+    int addRule(const CanLatencyRule &rule);
+    void removeRule(int index);
+    int getRuleCount();
+    CanLatencyRule getRule(int index);
+    bool getResult(int index, CanLatencyResult &result);
+    void reset();
+
+    virtual void messagesReceived(CanInterfaceId interface, const QList<CanMessage> &msgs);
+
+private:
+    typedef struct {
+        CanLatencyRule rule;
+        bool pending;
+        uint64_t requestTime;
+        CanLatencyResult result;
+    } entry_t;
+
+    QMutex _mutex;
+    QList<entry_t> _entries;
+};
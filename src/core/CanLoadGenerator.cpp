@@ -0,0 +1,348 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "CanLoadGenerator.h"
+
+#include <sys/time.h>
+#include <QMutexLocker>
+#include <QRandomGenerator>
+
+#include <core/Backend.h>
+#include <core/CanTxScheduler.h>
+#include <core/MeasurementSetup.h>
+#include <core/MeasurementInterface.h>
+#include <driver/CanInterface.h>
+
+enum {
+    max_batch_frames = 256,
+    paced_batch_ns = 1000000
+};
+
+// counts the stuff bits the controller inserts into a bit stream
+class BitStuffCounter
+{
+public:
+    BitStuffCounter() : _last(-1), _run(0), _stuffBits(0) {}
+
+    void push(uint32_t value, int num_bits)
+    {
+        for (int i=num_bits-1; i>=0; i--) {
+            int bit = (value >> i) & 1;
+            if (bit == _last) {
+                _run++;
+            } else {
+                _last = bit;
+                _run = 1;
+            }
+            if (_run == 5) {
+                // stuff bit of opposite polarity starts a new run
+                _stuffBits++;
+                _last = !bit;
+                _run = 1;
+            }
+        }
+    }
+
+    uint32_t stuffBits() const { return _stuffBits; }
+
+private:
+    int _last;
+    int _run;
+    uint32_t _stuffBits;
+};
+
+static uint8_t length_to_dlc(uint8_t length)
+{
+    if (length <= 8) { return length; }
+    if (length <= 12) { return 9; }
+    if (length <= 16) { return 10; }
+    if (length <= 20) { return 11; }
+    if (length <= 24) { return 12; }
+    if (length <= 32) { return 13; }
+    if (length <= 48) { return 14; }
+    return 15;
+}
+
+void CanLoadGenerator::getFrameBits(const CanMessage &msg, uint32_t *nominal_bits, uint32_t *data_bits)
+{
+    // Dynamic stuff bits are counted exactly over the header and payload.
+    // The CRC is not calculated, its stuff bits are assumed worst case.
+    BitStuffCounter stuff;
+    uint32_t id = msg.getId();
+    int length = msg.getLength();
+
+    stuff.push(0, 1); // SOF
+    if (msg.isExtended()) {
+        stuff.push(id >> 18, 11);
+        stuff.push(3, 2); // SRR, IDE
+        stuff.push(id & 0x3FFFF, 18);
+    } else {
+        stuff.push(id, 11);
+    }
+
+    if (!msg.isFD()) {
+        stuff.push(msg.isRTR() ? 1 : 0, 1);
+        stuff.push(0, 2); // IDE, r0 (std) or r1, r0 (ext)
+        stuff.push(length_to_dlc(length), 4);
+        int payload = msg.isRTR() ? 0 : qMin(length, 8);
+        for (int i=0; i<payload; i++) {
+            stuff.push(msg.getByte(i), 8);
+        }
+
+        uint32_t header = msg.isExtended() ? 39 : 19;
+        uint32_t stuffed = header + 8*payload + 15;
+        *nominal_bits = stuffed + stuff.stuffBits() + 3 + 13; // CRC stuffing, CRC delimiter, ACK, EOF, IFS
+        *data_bits = 0;
+        return;
+    }
+
+    // FD: arbitration phase up to and including BRS at nominal bitrate
+    stuff.push(0, 1); // RRS
+    if (!msg.isExtended()) {
+        stuff.push(0, 1); // IDE
+    }
+    stuff.push(2, 2); // FDF, res
+    stuff.push(msg.isBRS() ? 1 : 0, 1);
+    uint32_t arbitration = (msg.isExtended() ? 36 : 17) + stuff.stuffBits();
+
+    // data phase: ESI, DLC, payload, stuff count and CRC with fixed stuff bits
+    uint32_t arb_stuff = stuff.stuffBits();
+    stuff.push(0, 1);
+    stuff.push(length_to_dlc(length), 4);
+    for (int i=0; i<length; i++) {
+        stuff.push(msg.getByte(i), 8);
+    }
+    uint32_t crc_len = (length > 16) ? 21 : 17;
+    uint32_t data = 5 + 8*length + (stuff.stuffBits() - arb_stuff) + 4 + crc_len + (crc_len + 4 + 3) / 4 + 1;
+
+    // ACK, EOF and IFS are back at nominal bitrate
+    if (msg.isBRS()) {
+        *nominal_bits = arbitration + 12;
+        *data_bits = data;
+    } else {
+        *nominal_bits = arbitration + 12 + data;
+        *data_bits = 0;
+    }
+}
+
+uint64_t CanLoadGenerator::getFrameTimeNs(const CanMessage &msg, unsigned bitrate, unsigned fd_bitrate)
+{
+    uint32_t nominal_bits, data_bits;
+    getFrameBits(msg, &nominal_bits, &data_bits);
+
+    if (bitrate == 0) {
+        return 0;
+    }
+    if (fd_bitrate == 0) {
+        fd_bitrate = bitrate;
+    }
+    return (uint64_t)nominal_bits * 1000000000ULL / bitrate
+         + (uint64_t)data_bits * 1000000000ULL / fd_bitrate;
+}
+
+CanLoadGenerator::CanLoadGenerator(Backend &backend)
+  : QThread(0),
+    _backend(backend),
+    _intf(0),
+    _bitrate(0),
+    _fdBitrate(0),
+    _shouldBeRunning(false),
+    _framesSent(0),
+    _framesRejected(0),
+    _busTimeNs(0),
+    _startNs(0),
+    _stopNs(0),
+    _txErrorsAtStart(0),
+    _txDroppedAtStart(0)
+{
+}
+
+CanLoadGenerator::~CanLoadGenerator()
+{
+    stopLoad();
+}
+
+bool CanLoadGenerator::startLoad(const CanLoadGeneratorConfig &config)
+{
+    stopLoad();
+
+    CanInterface *intf = _backend.getInterfaceById(config.interface);
+    if (!intf || !intf->isOpen()) {
+        log_error(tr("Load generator: interface is not open"));
+        return false;
+    }
+
+    if ((config.targetLoad <= 0) || (config.targetLoad > 100) || config.lengths.isEmpty() || (config.idMin > config.idMax)) {
+        log_error(tr("Load generator: invalid configuration"));
+        return false;
+    }
+
+    _bitrate = intf->getBitrate();
+    _fdBitrate = 0;
+    MeasurementInterface *mi = _backend.getSetup().findInterface(config.interface);
+    if (mi) {
+        if (_bitrate == 0) {
+            _bitrate = mi->bitrate();
+        }
+        _fdBitrate = mi->fdBitrate();
+    }
+    if (_bitrate == 0) {
+        log_error(tr("Load generator: cannot determine bitrate of %1").arg(intf->getName()));
+        return false;
+    }
+
+    _intf = intf;
+    _config = config;
+    if (!(intf->getCapabilities() & CanInterface::capability_canfd)) {
+        _config.fdPercent = 0;
+    }
+    _config.burstLength = qMax(config.burstLength, 1);
+
+    {
+        QMutexLocker locker(&_statsMutex);
+        _framesSent = 0;
+        _framesRejected = 0;
+        _busTimeNs = 0;
+        _startNs = CanTxScheduler::monotonicNs();
+        _stopNs = 0;
+        _txErrorsAtStart = intf->getNumTxErrors();
+        _txDroppedAtStart = intf->getNumTxDropped();
+    }
+
+    log_info(tr("Load generator: %1% on %2 at %3 bit/s").arg(_config.targetLoad).arg(intf->getName()).arg(_bitrate));
+
+    _shouldBeRunning = true;
+    start(QThread::HighPriority);
+    return true;
+}
+
+void CanLoadGenerator::stopLoad()
+{
+    _shouldBeRunning = false;
+    wait();
+}
+
+bool CanLoadGenerator::isGenerating()
+{
+    return isRunning();
+}
+
+CanLoadGeneratorStats CanLoadGenerator::getStats()
+{
+    CanLoadGeneratorStats stats;
+    QMutexLocker locker(&_statsMutex);
+
+    uint64_t end = _stopNs ? _stopNs : CanTxScheduler::monotonicNs();
+    uint64_t elapsed = (end > _startNs) ? (end - _startNs) : 0;
+
+    stats.framesSent = _framesSent;
+    stats.framesRejected = _framesRejected;
+    stats.elapsed = elapsed / 1e9;
+    stats.achievedLoad = elapsed ? (100.0 * _busTimeNs / elapsed) : 0;
+    stats.txErrors = _intf ? (_intf->getNumTxErrors() - _txErrorsAtStart) : 0;
+    stats.txDropped = _intf ? (_intf->getNumTxDropped() - _txDroppedAtStart) : 0;
+    return stats;
+}
+
+void CanLoadGenerator::run()
+{
+    QRandomGenerator rng(QRandomGenerator::global()->generate());
+    QList<CanMessage> batch;
+    QList<uint64_t> frameTimes;
+
+    // a batch is either one burst, or about one millisecond of scheduled time
+    bool bursting = _config.burstLength > 1;
+    uint64_t paced_bus_ns = (uint64_t)(paced_batch_ns * _config.targetLoad / 100.0);
+
+    uint64_t deadline = CanTxScheduler::monotonicNs();
+
+    while (_shouldBeRunning) {
+
+        batch.clear();
+        frameTimes.clear();
+        uint64_t batch_bus_ns = 0;
+
+        while (batch.size() < max_batch_frames) {
+            CanMessage msg;
+            msg.setInterfaceId(_intf->getId());
+            msg.setRX(false);
+            msg.setShow(false);
+            msg.setId(_config.idMin + rng.bounded((quint32)(_config.idMax - _config.idMin + 1)));
+            msg.setExtended(_config.extended);
+
+            bool fd = rng.bounded(100) < _config.fdPercent;
+            int length = _config.lengths[rng.bounded(_config.lengths.size())];
+            if (!fd && (length > 8)) {
+                length = 8;
+            }
+            msg.setFD(fd);
+            msg.setBRS(fd && (rng.bounded(100) < _config.brsPercent));
+            msg.setLength(length);
+            for (int i=0; i<length; i+=4) {
+                quint32 r = rng.generate();
+                for (int j=0; (j<4) && (i+j<length); j++) {
+                    msg.setByte(i+j, r >> (8*j));
+                }
+            }
+
+            uint64_t t = getFrameTimeNs(msg, _bitrate, _fdBitrate);
+            batch.append(msg);
+            frameTimes.append(t);
+            batch_bus_ns += t;
+
+            if (bursting ? (batch.size() >= _config.burstLength) : (batch_bus_ns >= paced_bus_ns)) {
+                break;
+            }
+        }
+
+        struct timeval tv;
+        gettimeofday(&tv, NULL);
+        for (int i=0; i<batch.size(); i++) {
+            batch[i].setTimestamp(tv);
+        }
+
+        int accepted = _intf->sendMessages(batch);
+
+        {
+            QMutexLocker locker(&_statsMutex);
+            _framesSent += accepted;
+            _framesRejected += batch.size() - accepted;
+            for (int i=0; i<accepted; i++) {
+                _busTimeNs += frameTimes[i];
+            }
+        }
+
+        // the batch occupies the bus for batch_bus_ns, which is targetLoad percent of the period
+        deadline += (uint64_t)(batch_bus_ns * 100.0 / _config.targetLoad);
+
+        uint64_t now = CanTxScheduler::monotonicNs();
+        if (deadline + 100 * paced_batch_ns < now) {
+            // we fell far behind (driver blocked?), don't try to catch up in one go
+            deadline = now;
+        }
+        if (deadline > now) {
+            CanTxScheduler::sleepUntilNs(deadline);
+        }
+    }
+
+    QMutexLocker locker(&_statsMutex);
+    _stopNs = CanTxScheduler::monotonicNs();
+}
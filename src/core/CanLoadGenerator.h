@@ -0,0 +1,100 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <QThread>
+#include <QMutex>
+#include <QList>
+
+#include <core/CanMessage.h>
+#include <driver/CanDriver.h>
+
+class Backend;
+class CanInterface;
+
+typedef struct {
+    CanInterfaceId interface;
+    double targetLoad;
+    uint32_t idMin;
+    uint32_t idMax;
+    bool extended;
+    QList<int> lengths;
+    int fdPercent;
+    int brsPercent;
+    int burstLength;
+} CanLoadGeneratorConfig;
+
+typedef struct {
+    uint64_t framesSent;
+    uint64_t framesRejected;
+    double elapsed;
+    double achievedLoad;
+    int txErrors;
+    int txDropped;
+} CanLoadGeneratorStats;
+
+/*
+ * Generates random traffic at a given bus load on one interface.
+ *
+ * Frames are generated in batches (one batch per burst, or about one
+ * millisecond worth of traffic when not bursting) and handed to the driver
+ * with CanInterface::sendMessages(). After each batch the generator sleeps
+ * until the batch's bus time, scaled by the target load, has elapsed.
+ */
+class CanLoadGenerator : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit CanLoadGenerator(Backend &backend);
+    virtual ~CanLoadGenerator();
+
+    bool startLoad(const CanLoadGeneratorConfig &config);
+    void stopLoad();
+    bool isGenerating();
+
+    CanLoadGeneratorStats getStats();
+
+    static void getFrameBits(const CanMessage &msg, uint32_t *nominal_bits, uint32_t *data_bits);
+    static uint64_t getFrameTimeNs(const CanMessage &msg, unsigned bitrate, unsigned fd_bitrate);
+
+protected:
+    virtual void run();
+
+private:
+    Backend &_backend;
+    CanInterface *_intf;
+    CanLoadGeneratorConfig _config;
+    unsigned _bitrate;
+    unsigned _fdBitrate;
+    bool _shouldBeRunning;
+
+    QMutex _statsMutex;
+    uint64_t _framesSent;
+    uint64_t _framesRejected;
+    uint64_t _busTimeNs;
+    uint64_t _startNs;
+    uint64_t _stopNs;
+    int _txErrorsAtStart;
+    int _txDroppedAtStart;
+};
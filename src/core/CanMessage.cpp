@@ -196,6 +196,11 @@ uint8_t CanMessage::getByte(const uint8_t index) const {
 	}
 }
 
+const uint8_t *CanMessage::getData() const
+{
+    return _u8;
+}
+
 void CanMessage::setByte(const uint8_t index, const uint8_t value) {
 	if (index<sizeof(_u8)) {
 		_u8[index] = value;
@@ -342,13 +347,22 @@ QDateTime CanMessage::getDateTime() const
     return QDateTime::fromMSecsSinceEpoch((qint64)(1000*getFloatTimestamp()));
 }
 
+static const char hex_digits[] = "0123456789ABCDEF";
+
 QString CanMessage::getIdString() const
 {
-    if (isExtended()) {
-        return QString().asprintf("0x%08X", getId());
-    } else {
-        return QString().asprintf("0x%03X", getId());
+    // formatted by hand, this is called for every visible trace row
+    int digits = isExtended() ? 8 : 3;
+    uint32_t id = getId();
+
+    QString outstr(2 + digits, Qt::Uninitialized);
+    QChar *p = outstr.data();
+    *p++ = QLatin1Char('0');
+    *p++ = QLatin1Char('x');
+    for (int i=digits-1; i>=0; i--) {
+        *p++ = QLatin1Char(hex_digits[(id >> (4*i)) & 0x0F]);
     }
+    return outstr;
 }
 
 QString CanMessage::getDataHexString() const
@@ -356,10 +370,14 @@ QString CanMessage::getDataHexString() const
     if(getLength() == 0)
         return "";
 
-    QString outstr = "";
+    QString outstr(3*getLength(), Qt::Uninitialized);
+    QChar *p = outstr.data();
     for(int i=0; i<getLength(); i++)
     {
-        outstr += QString().asprintf("%02X ", getByte(i));
+        uint8_t b = getByte(i);
+        *p++ = QLatin1Char(hex_digits[b >> 4]);
+        *p++ = QLatin1Char(hex_digits[b & 0x0F]);
+        *p++ = QLatin1Char(' ');
     }
 
     return outstr;
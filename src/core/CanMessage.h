@@ -70,6 +70,7 @@ public:
 
 	uint8_t getByte(const uint8_t index) const;
 	void setByte(const uint8_t index, const uint8_t value);
+	const uint8_t *getData() const; // all 64 payload bytes, valid up to getLength()
 
     uint64_t extractRawSignal(uint8_t start_bit, const uint8_t length, const bool isBigEndian) const;
 
@@ -0,0 +1,215 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "CanMetrics.h"
+
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QThreadStorage>
+#include <cstring>
+
+class CanMetricsBlock
+{
+public:
+    CanMetricsBlock() : interfaceId(-1) {}
+
+    QAtomicInt interfaceId;
+    QAtomicInteger<quint64> counters[CanMetrics::counter_count];
+    QAtomicInteger<quint64> buckets[CanMetrics::histogram_count][CanMetrics::histogram_buckets];
+    QAtomicInteger<quint64> sum[CanMetrics::histogram_count];
+    QAtomicInteger<quint64> max[CanMetrics::histogram_count];
+};
+
+// QThreadStorage would delete a pointer on thread exit, the blocks must outlive their threads
+typedef struct {
+    CanMetricsBlock *block;
+} block_ref_t;
+
+static QMutex &registryMutex()
+{
+    static QMutex mutex;
+    return mutex;
+}
+
+static QList<CanMetricsBlock*> &registry()
+{
+    static QList<CanMetricsBlock*> blocks;
+    return blocks;
+}
+
+static QThreadStorage<block_ref_t> &threadBlocks()
+{
+    static QThreadStorage<block_ref_t> storage;
+    return storage;
+}
+
+CanMetricsBlock *CanMetrics::threadBlock()
+{
+    QThreadStorage<block_ref_t> &storage = threadBlocks();
+    if (!storage.hasLocalData()) {
+        block_ref_t ref;
+        ref.block = new CanMetricsBlock();
+        QMutexLocker locker(&registryMutex());
+        registry().append(ref.block);
+        storage.setLocalData(ref);
+    }
+    return storage.localData().block;
+}
+
+void CanMetrics::setThreadInterface(CanInterfaceId id)
+{
+    threadBlock()->interfaceId.storeRelaxed(id);
+}
+
+void CanMetrics::count(counter_t counter, quint64 n)
+{
+    // only this thread writes to its block
+    QAtomicInteger<quint64> &c = threadBlock()->counters[counter];
+    c.storeRelaxed(c.loadRelaxed() + n);
+}
+
+void CanMetrics::sample(histogram_t histogram, quint64 value)
+{
+    CanMetricsBlock *block = threadBlock();
+
+    int bucket = value ? qMin(64 - qCountLeadingZeroBits(value), (int)histogram_buckets - 1) : 0;
+    QAtomicInteger<quint64> &b = block->buckets[histogram][bucket];
+    b.storeRelaxed(b.loadRelaxed() + 1);
+
+    QAtomicInteger<quint64> &sum = block->sum[histogram];
+    sum.storeRelaxed(sum.loadRelaxed() + value);
+
+    QAtomicInteger<quint64> &max = block->max[histogram];
+    if (value > max.loadRelaxed()) {
+        max.storeRelaxed(value);
+    }
+}
+
+void CanMetrics::clearValues(values_t &values)
+{
+    memset(&values, 0, sizeof(values));
+}
+
+static void addBlock(CanMetrics::values_t &values, const CanMetricsBlock *block)
+{
+    for (int i=0; i<CanMetrics::counter_count; i++) {
+        values.counters[i] += block->counters[i].loadRelaxed();
+    }
+    for (int h=0; h<CanMetrics::histogram_count; h++) {
+        for (int i=0; i<CanMetrics::histogram_buckets; i++) {
+            values.buckets[h][i] += block->buckets[h][i].loadRelaxed();
+        }
+        values.sum[h] += block->sum[h].loadRelaxed();
+        values.max[h] = qMax(values.max[h], (quint64)block->max[h].loadRelaxed());
+    }
+}
+
+void CanMetrics::snapshot(values_t &total, QMap<CanInterfaceId, values_t> &perInterface)
+{
+    clearValues(total);
+    perInterface.clear();
+
+    QMutexLocker locker(&registryMutex());
+    foreach (const CanMetricsBlock *block, registry()) {
+        addBlock(total, block);
+        int id = block->interfaceId.loadRelaxed();
+        if (id >= 0) {
+            if (!perInterface.contains(id)) {
+                clearValues(perInterface[id]);
+            }
+            addBlock(perInterface[id], block);
+        }
+    }
+}
+
+void CanMetrics::subtractValues(values_t &values, const values_t &base)
+{
+    // max can't be subtracted, it stays the overall maximum
+    for (int i=0; i<counter_count; i++) {
+        values.counters[i] -= qMin(values.counters[i], base.counters[i]);
+    }
+    for (int h=0; h<histogram_count; h++) {
+        for (int i=0; i<histogram_buckets; i++) {
+            values.buckets[h][i] -= qMin(values.buckets[h][i], base.buckets[h][i]);
+        }
+        values.sum[h] -= qMin(values.sum[h], base.sum[h]);
+    }
+}
+
+quint64 CanMetrics::histogramCount(const values_t &values, histogram_t histogram)
+{
+    quint64 n = 0;
+    for (int i=0; i<histogram_buckets; i++) {
+        n += values.buckets[histogram][i];
+    }
+    return n;
+}
+
+double CanMetrics::histogramMean(const values_t &values, histogram_t histogram)
+{
+    quint64 n = histogramCount(values, histogram);
+    return n ? ((double)values.sum[histogram] / n) : 0;
+}
+
+quint64 CanMetrics::histogramPercentile(const values_t &values, histogram_t histogram, double percentile)
+{
+    quint64 n = histogramCount(values, histogram);
+    if (!n) {
+        return 0;
+    }
+
+    // upper end of the bucket the percentile falls into
+    quint64 rank = (quint64)(percentile * n);
+    quint64 seen = 0;
+    for (int i=0; i<histogram_buckets; i++) {
+        seen += values.buckets[histogram][i];
+        if (seen > rank) {
+            quint64 upper = i ? ((((quint64)1) << i) - 1) : 0;
+            return qMin(upper, values.max[histogram]);
+        }
+    }
+    return values.max[histogram];
+}
+
+QString CanMetrics::counterName(counter_t counter)
+{
+    switch (counter) {
+        case counter_rx_frames: return QObject::tr("rx frames");
+        case counter_rx_batches: return QObject::tr("rx batches");
+        case counter_rx_filtered: return QObject::tr("rx filtered");
+        case counter_trace_frames: return QObject::tr("trace frames");
+        case counter_lock_contended: return QObject::tr("trace lock contended");
+        default: return QString();
+    }
+}
+
+QString CanMetrics::histogramName(histogram_t histogram)
+{
+    switch (histogram) {
+        case histogram_rx_batch_size: return QObject::tr("rx batch size [frames]");
+        case histogram_lock_wait: return QObject::tr("trace lock wait [us]");
+        case histogram_queue_depth: return QObject::tr("ingest queue depth [frames]");
+        case histogram_flush_time: return QObject::tr("trace flush [us]");
+        case histogram_model_update: return QObject::tr("model update [us]");
+        default: return QString();
+    }
+}
@@ -0,0 +1,93 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <QAtomicInteger>
+#include <QMap>
+#include <QString>
+
+#include <driver/CanDriver.h>
+
+class CanMetricsBlock;
+
+/*
+ * Low overhead counters and histograms for the receive pipeline.
+ *
+ * Every thread writes to a block of its own, so counting is a relaxed
+ * load and store without any locking or cache line ping-pong. snapshot()
+ * sums up the blocks of all threads; blocks of threads that have ended
+ * are kept, so totals don't go backwards. Histograms use power of two
+ * buckets: bucket i holds values in [2^(i-1), 2^i).
+ *
+ * A listener thread tags its block with its interface, which gives the
+ * per-interface numbers.
+ */
+class CanMetrics
+{
+public:
+    typedef enum {
+        counter_rx_frames,      // frames returned by readMessage()
+        counter_rx_batches,     // readMessage() calls that returned frames
+        counter_rx_filtered,    // frames dropped by the software filter
+        counter_trace_frames,   // frames enqueued into the trace
+        counter_lock_contended, // enqueueMessage() had to wait for the trace
+        counter_count
+    } counter_t;
+
+    typedef enum {
+        histogram_rx_batch_size,   // frames per readMessage() [frames]
+        histogram_lock_wait,       // trace lock wait when contended [us]
+        histogram_queue_depth,     // frames waiting at a trace flush [frames]
+        histogram_flush_time,      // CanTrace::flushQueue() [us]
+        histogram_model_update,    // views handling the appended rows [us]
+        histogram_count
+    } histogram_t;
+
+    enum {
+        histogram_buckets = 32
+    };
+
+    typedef struct {
+        quint64 counters[counter_count];
+        quint64 buckets[histogram_count][histogram_buckets];
+        quint64 sum[histogram_count];
+        quint64 max[histogram_count];
+    } values_t;
+
+    static void setThreadInterface(CanInterfaceId id);
+    static void count(counter_t counter, quint64 n=1);
+    static void sample(histogram_t histogram, quint64 value);
+
+    static void snapshot(values_t &total, QMap<CanInterfaceId, values_t> &perInterface);
+
+    static void clearValues(values_t &values);
+    static void subtractValues(values_t &values, const values_t &base);
+    static quint64 histogramCount(const values_t &values, histogram_t histogram);
+    static double histogramMean(const values_t &values, histogram_t histogram);
+    static quint64 histogramPercentile(const values_t &values, histogram_t histogram, double percentile);
+
+    static QString counterName(counter_t counter);
+    static QString histogramName(histogram_t histogram);
+
+private:
+    static CanMetricsBlock *threadBlock();
+};
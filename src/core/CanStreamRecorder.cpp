@@ -0,0 +1,233 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "CanStreamRecorder.h"
+
+#include <stdio.h>
+#include <QMutexLocker>
+
+#include <core/Backend.h>
+#include <core/Log.h>
+
+CanStreamRecorder::CanStreamRecorder(Backend &backend, QObject *parent)
+  : QThread(parent),
+    _backend(backend),
+    _shouldBeRunning(false),
+    _flushInterval(200),
+    _framesPending(0),
+    _framesWritten(0),
+    _framesDropped(0),
+    _bytesWritten(0)
+{
+}
+
+CanStreamRecorder::~CanStreamRecorder()
+{
+    stopRecording();
+}
+
+bool CanStreamRecorder::startRecording(const QString &filename, QString *errorMessage)
+{
+    stopRecording();
+
+    _file.setFileName(filename);
+    if (!_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (errorMessage) {
+            *errorMessage = _file.errorString();
+        }
+        return false;
+    }
+
+    QMutexLocker locker(&_mutex);
+    _interfaceNames.clear();
+    foreach (CanInterfaceId ifid, _backend.getInterfaceList()) {
+        _interfaceNames[ifid] = _backend.getInterfaceName(ifid).toLocal8Bit();
+    }
+    _pending.clear();
+    _pending.reserve(flush_threshold_bytes);
+    _framesPending = 0;
+    _framesWritten = 0;
+    _framesDropped = 0;
+    _bytesWritten = 0;
+    _shouldBeRunning = true;
+    locker.unlock();
+
+    start();
+    _backend.addRxObserver(this);
+
+    log_info(tr("Recording to %1").arg(filename));
+    return true;
+}
+
+void CanStreamRecorder::stopRecording()
+{
+    if (!isRunning()) {
+        return;
+    }
+
+    // no callbacks are in flight once the observer is removed, so the
+    // writer thread sees the last frames on its final pass
+    _backend.removeRxObserver(this);
+
+    _mutex.lock();
+    _shouldBeRunning = false;
+    _cond.wakeAll();
+    _mutex.unlock();
+
+    wait();
+    _file.close();
+
+    log_info(tr("Recording stopped: %1 frames written, %2 dropped").arg(_framesWritten).arg(_framesDropped));
+}
+
+bool CanStreamRecorder::isRecording()
+{
+    QMutexLocker locker(&_mutex);
+    return _shouldBeRunning;
+}
+
+void CanStreamRecorder::setFlushInterval(int ms)
+{
+    QMutexLocker locker(&_mutex);
+    _flushInterval = qMax(1, ms);
+}
+
+uint64_t CanStreamRecorder::getFramesWritten()
+{
+    QMutexLocker locker(&_mutex);
+    return _framesWritten;
+}
+
+uint64_t CanStreamRecorder::getFramesDropped()
+{
+    QMutexLocker locker(&_mutex);
+    return _framesDropped;
+}
+
+uint64_t CanStreamRecorder::getBytesWritten()
+{
+    QMutexLocker locker(&_mutex);
+    return _bytesWritten;
+}
+
+void CanStreamRecorder::messagesReceived(CanInterfaceId interface, const QList<CanMessage> &msgs)
+{
+    QMutexLocker locker(&_mutex);
+    if (!_shouldBeRunning) {
+        return;
+    }
+
+    QHash<CanInterfaceId, QByteArray>::const_iterator it = _interfaceNames.constFind(interface);
+    if (it == _interfaceNames.constEnd()) {
+        it = _interfaceNames.insert(interface, _backend.getInterfaceName(interface).toLocal8Bit());
+    }
+
+    foreach (const CanMessage &msg, msgs) {
+        if (_pending.size() >= max_pending_bytes) {
+            _framesDropped++;
+            continue;
+        }
+        appendFrame(it.value(), msg);
+        _framesPending++;
+    }
+
+    if (_pending.size() >= flush_threshold_bytes) {
+        _cond.wakeAll();
+    }
+}
+
+void CanStreamRecorder::appendFrame(const QByteArray &ifname, const CanMessage &msg)
+{
+    // same format as CanTrace::saveCanDump(), plus the candump notation
+    // for remote, FD and error frames
+    static const char hex[] = "0123456789ABCDEF";
+    char buf[32 + 2*64 + 8];
+
+    struct timeval tv = msg.getTimestamp();
+    int n = snprintf(buf, sizeof(buf), "(%lu.%06lu) ", (unsigned long)tv.tv_sec, (unsigned long)tv.tv_usec);
+    _pending.append(buf, n);
+    _pending.append(ifname);
+
+    if (msg.isErrorFrame()) {
+        n = snprintf(buf, sizeof(buf), " %08X#", (unsigned)(msg.getId() | 0x20000000));
+    } else if (msg.isExtended()) {
+        n = snprintf(buf, sizeof(buf), " %08X#", (unsigned)msg.getId());
+    } else {
+        n = snprintf(buf, sizeof(buf), " %03X#", (unsigned)msg.getId());
+    }
+
+    if (msg.isRTR()) {
+        buf[n++] = 'R';
+    } else {
+        if (msg.isFD()) {
+            buf[n++] = '#';
+            buf[n++] = msg.isBRS() ? '1' : '0';
+        }
+        for (int i=0; i<msg.getLength(); i++) {
+            uint8_t b = msg.getByte(i);
+            buf[n++] = hex[b >> 4];
+            buf[n++] = hex[b & 0x0F];
+        }
+    }
+    buf[n++] = '\n';
+    _pending.append(buf, n);
+}
+
+void CanStreamRecorder::run()
+{
+    bool writeFailed = false;
+
+    QMutexLocker locker(&_mutex);
+    forever {
+        if (_shouldBeRunning && (_pending.size() < flush_threshold_bytes)) {
+            _cond.wait(&_mutex, _flushInterval);
+        }
+
+        QByteArray data;
+        data.swap(_pending);
+        _pending.reserve(flush_threshold_bytes);
+        uint64_t frames = _framesPending;
+        _framesPending = 0;
+        bool stop = !_shouldBeRunning;
+        locker.unlock();
+
+        bool ok = true;
+        if (!data.isEmpty()) {
+            ok = (_file.write(data) == data.size()) && _file.flush();
+            if (!ok && !writeFailed) {
+                log_error(tr("Cannot write to %1: %2").arg(_file.fileName(), _file.errorString()));
+                writeFailed = true;
+            }
+        }
+
+        locker.relock();
+        if (ok) {
+            _framesWritten += frames;
+            _bytesWritten += data.size();
+        } else {
+            _framesDropped += frames;
+        }
+
+        if (stop) {
+            break;
+        }
+    }
+}
@@ -0,0 +1,92 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QByteArray>
+#include <QHash>
+#include <QFile>
+#include <QString>
+
+#include <core/CanMessage.h>
+#include <core/CanRxObserver.h>
+
+class Backend;
+
+/*
+ * Writes every received frame to a candump log file while the measurement
+ * is running, instead of keeping it in the trace. Frames are formatted on
+ * the listener threads into a pending buffer; a writer thread swaps the
+ * buffer out and writes it to disk every flush interval. If the disk cannot
+ * keep up and the pending buffer exceeds max_pending_bytes, frames are
+ * dropped and counted rather than stalling reception.
+ */
+class CanStreamRecorder : public QThread, public CanRxObserver
+{
+    Q_OBJECT
+
+public:
+    explicit CanStreamRecorder(Backend &backend, QObject *parent=0);
+    virtual ~CanStreamRecorder();
+
+    bool startRecording(const QString &filename, QString *errorMessage=0);
+    void stopRecording();
+    bool isRecording();
+
+    void setFlushInterval(int ms);
+
+    uint64_t getFramesWritten();
+    uint64_t getFramesDropped();
+    uint64_t getBytesWritten();
+
+    virtual void messagesReceived(CanInterfaceId interface, const QList<CanMessage> &msgs);
+
+protected:
+    virtual void run();
+
+private:
+    enum {
+        flush_threshold_bytes = 256*1024,
+        max_pending_bytes = 16*1024*1024
+    };
+
+    Backend &_backend;
+    QFile _file;
+
+    QMutex _mutex;
+    QWaitCondition _cond;
+    bool _shouldBeRunning;
+    int _flushInterval;
+
+    QByteArray _pending;
+    QHash<CanInterfaceId, QByteArray> _interfaceNames;
+
+    uint64_t _framesPending;
+    uint64_t _framesWritten;
+    uint64_t _framesDropped;
+    uint64_t _bytesWritten;
+
+    void appendFrame(const QByteArray &ifname, const CanMessage &msg);
+};
@@ -0,0 +1,472 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "CanStreamServer.h"
+
+#include <string.h>
+#include <QMutexLocker>
+#include <QMetaObject>
+#include <QtEndian>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QLocalServer>
+#include <QLocalSocket>
+
+#include <core/Backend.h>
+#include <core/CanDbMessage.h>
+#include <core/CanDbSignal.h>
+#include <core/Log.h>
+
+static void appendU8(QByteArray &buf, uint8_t v)
+{
+    buf.append((char)v);
+}
+
+static void appendU16(QByteArray &buf, uint16_t v)
+{
+    uchar b[2];
+    qToLittleEndian<quint16>(v, b);
+    buf.append((const char*)b, sizeof(b));
+}
+
+static void appendU32(QByteArray &buf, uint32_t v)
+{
+    uchar b[4];
+    qToLittleEndian<quint32>(v, b);
+    buf.append((const char*)b, sizeof(b));
+}
+
+static void appendU64(QByteArray &buf, uint64_t v)
+{
+    uchar b[8];
+    qToLittleEndian<quint64>(v, b);
+    buf.append((const char*)b, sizeof(b));
+}
+
+static void appendRecordHeader(QByteArray &buf, uint8_t type, int payloadLength)
+{
+    appendU8(buf, type);
+    appendU8(buf, 0);
+    appendU16(buf, payloadLength);
+}
+
+static uint64_t timestampUs(const CanMessage &msg)
+{
+    struct timeval tv = msg.getTimestamp();
+    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+
+CanStreamServer::CanStreamServer(Backend &backend, QObject *parent)
+  : QObject(parent),
+    _backend(backend),
+    _tcpServer(0),
+    _localServer(0),
+    _framesDropped(0),
+    _observing(false),
+    _feedScheduled(0)
+{
+    _config.includeSignals = false;
+    _config.queueBytes = 4*1024*1024;
+    _config.dropPolicy = stream_drop_newest;
+
+    connect(&backend, SIGNAL(onSetupChanged()), this, SLOT(setupChanged()));
+}
+
+CanStreamServer::~CanStreamServer()
+{
+    close();
+}
+
+bool CanStreamServer::listenTcp(uint16_t port, bool localhostOnly, QString *errorMessage)
+{
+    if (!_tcpServer) {
+        _tcpServer = new QTcpServer(this);
+        connect(_tcpServer, SIGNAL(newConnection()), this, SLOT(acceptTcp()));
+    }
+    _tcpServer->close();
+
+    if (!_tcpServer->listen(localhostOnly ? QHostAddress::LocalHost : QHostAddress::Any, port)) {
+        if (errorMessage) {
+            *errorMessage = _tcpServer->errorString();
+        }
+        return false;
+    }
+
+    log_info(tr("Streaming trace on TCP port %1").arg(_tcpServer->serverPort()));
+    startObserving();
+    return true;
+}
+
+bool CanStreamServer::listenLocal(const QString &name, QString *errorMessage)
+{
+    if (!_localServer) {
+        _localServer = new QLocalServer(this);
+        connect(_localServer, SIGNAL(newConnection()), this, SLOT(acceptLocal()));
+    }
+    _localServer->close();
+
+    // remove a stale socket file left by a previous run
+    QLocalServer::removeServer(name);
+    if (!_localServer->listen(name)) {
+        if (errorMessage) {
+            *errorMessage = _localServer->errorString();
+        }
+        return false;
+    }
+
+    log_info(tr("Streaming trace on local socket %1").arg(_localServer->fullServerName()));
+    startObserving();
+    return true;
+}
+
+void CanStreamServer::close()
+{
+    stopObserving();
+
+    if (_tcpServer) {
+        _tcpServer->close();
+    }
+    if (_localServer) {
+        _localServer->close();
+    }
+
+    QList<subscriber_t*> subscribers;
+    _mutex.lock();
+    subscribers.swap(_subscribers);
+    _mutex.unlock();
+
+    foreach (subscriber_t *sub, subscribers) {
+        sub->socket->disconnect(this);
+        sub->socket->close();
+        sub->socket->deleteLater();
+        delete sub;
+    }
+}
+
+bool CanStreamServer::isListening() const
+{
+    return (_tcpServer && _tcpServer->isListening()) || (_localServer && _localServer->isListening());
+}
+
+void CanStreamServer::setConfig(const CanStreamServerConfig &config)
+{
+    QMutexLocker locker(&_mutex);
+    _config = config;
+}
+
+CanStreamServerConfig CanStreamServer::getConfig()
+{
+    QMutexLocker locker(&_mutex);
+    return _config;
+}
+
+int CanStreamServer::getSubscriberCount()
+{
+    QMutexLocker locker(&_mutex);
+    return _subscribers.size();
+}
+
+uint64_t CanStreamServer::getFramesDropped()
+{
+    QMutexLocker locker(&_mutex);
+    return _framesDropped;
+}
+
+void CanStreamServer::startObserving()
+{
+    if (!_observing) {
+        _observing = true;
+        _backend.addRxObserver(this);
+    }
+}
+
+void CanStreamServer::stopObserving()
+{
+    if (_observing) {
+        _backend.removeRxObserver(this);
+        _observing = false;
+    }
+}
+
+void CanStreamServer::acceptTcp()
+{
+    while (_tcpServer->hasPendingConnections()) {
+        QTcpSocket *socket = _tcpServer->nextPendingConnection();
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        // subscribers have nothing to say, don't let them fill our memory
+        socket->setReadBufferSize(4096);
+        addSubscriber(socket);
+        log_info(tr("Stream subscriber connected from %1").arg(socket->peerAddress().toString()));
+    }
+}
+
+void CanStreamServer::acceptLocal()
+{
+    while (_localServer->hasPendingConnections()) {
+        QLocalSocket *socket = _localServer->nextPendingConnection();
+        socket->setReadBufferSize(4096);
+        addSubscriber(socket);
+        log_info(tr("Stream subscriber connected on %1").arg(_localServer->serverName()));
+    }
+}
+
+void CanStreamServer::addSubscriber(QIODevice *socket)
+{
+    subscriber_t *sub = new subscriber_t;
+    sub->socket = socket;
+    sub->pendingFrames = 0;
+    sub->dropped = 0;
+    sub->overflow = false;
+
+    appendRecordHeader(sub->definitions, record_hello, 6);
+    sub->definitions.append("CGRO", 4);
+    appendU16(sub->definitions, 1);
+
+    connect(socket, SIGNAL(disconnected()), this, SLOT(subscriberDisconnected()));
+    connect(socket, SIGNAL(bytesWritten(qint64)), this, SLOT(feedSubscribers()));
+
+    _mutex.lock();
+    sub->definitions.append(_definitions);
+    _subscribers.append(sub);
+    _mutex.unlock();
+
+    feedSubscribers();
+}
+
+void CanStreamServer::subscriberDisconnected()
+{
+    QIODevice *socket = qobject_cast<QIODevice*>(sender());
+
+    QMutexLocker locker(&_mutex);
+    for (int i=0; i<_subscribers.size(); i++) {
+        subscriber_t *sub = _subscribers[i];
+        if (sub->socket == socket) {
+            _subscribers.removeAt(i);
+            socket->deleteLater();
+            delete sub;
+            locker.unlock();
+            log_info(tr("Stream subscriber disconnected"));
+            return;
+        }
+    }
+}
+
+void CanStreamServer::feedSubscribers()
+{
+    _feedScheduled.storeRelease(0);
+
+    QList<QIODevice*> slowSubscribers;
+
+    QMutexLocker locker(&_mutex);
+    for (int i=0; i<_subscribers.size(); i++) {
+        subscriber_t *sub = _subscribers[i];
+
+        if (sub->overflow) {
+            _subscribers.removeAt(i--);
+            slowSubscribers.append(sub->socket);
+            delete sub;
+            continue;
+        }
+
+        if ((sub->definitions.isEmpty() && sub->pending.isEmpty()) || (sub->socket->bytesToWrite() >= socket_high_water)) {
+            // bytesWritten() brings us back here once the socket drained
+            continue;
+        }
+
+        // definitions go first, the queued records may refer to them
+        if (!sub->definitions.isEmpty()) {
+            sub->socket->write(sub->definitions);
+            sub->definitions.clear();
+        }
+        sub->socket->write(sub->pending);
+        sub->pending.clear();
+        sub->pendingFrames = 0;
+    }
+    locker.unlock();
+
+    foreach (QIODevice *socket, slowSubscribers) {
+        log_warning(tr("Stream subscriber too slow, disconnecting"));
+        socket->disconnect(this);
+        socket->close();
+        socket->deleteLater();
+    }
+}
+
+void CanStreamServer::setupChanged()
+{
+    // the signal table holds pointers into the old setup's databases
+    QMutexLocker locker(&_mutex);
+    _knownInterfaces.clear();
+    _signalIndex.clear();
+    _definitions.clear();
+
+    // records queued so far use the old indices, keep them ahead of the new
+    // definitions that are about to reuse those indices
+    foreach (subscriber_t *sub, _subscribers) {
+        sub->definitions.append(sub->pending);
+        sub->pending.clear();
+        sub->pendingFrames = 0;
+    }
+}
+
+void CanStreamServer::messagesReceived(CanInterfaceId interface, const QList<CanMessage> &msgs)
+{
+    QMutexLocker locker(&_mutex);
+    if (_subscribers.isEmpty()) {
+        return;
+    }
+
+    QByteArray defs;
+    if (!_knownInterfaces.contains(interface)) {
+        _knownInterfaces.insert(interface, true);
+        encodeInterface(defs, interface);
+    }
+
+    QByteArray chunk;
+    chunk.reserve(msgs.size() * 32);
+    foreach (const CanMessage &msg, msgs) {
+        encodeFrame(chunk, msg);
+        if (_config.includeSignals) {
+            encodeSignals(defs, chunk, msg);
+        }
+    }
+
+    if (!defs.isEmpty()) {
+        _definitions.append(defs);
+    }
+
+    foreach (subscriber_t *sub, _subscribers) {
+        // definitions are never dropped, later records depend on them
+        sub->definitions.append(defs);
+        enqueue(sub, chunk, msgs.size());
+    }
+
+    if (_feedScheduled.testAndSetOrdered(0, 1)) {
+        QMetaObject::invokeMethod(this, "feedSubscribers", Qt::QueuedConnection);
+    }
+}
+
+void CanStreamServer::enqueue(subscriber_t *sub, const QByteArray &chunk, int frames)
+{
+    if (sub->overflow) {
+        return;
+    }
+
+    if (sub->pending.size() + chunk.size() > _config.queueBytes) {
+        switch (_config.dropPolicy) {
+            case stream_drop_oldest:
+                if (chunk.size() <= _config.queueBytes) {
+                    sub->dropped += sub->pendingFrames;
+                    _framesDropped += sub->pendingFrames;
+                    sub->pending.clear();
+                    sub->pendingFrames = 0;
+                    break;
+                }
+                // fall through: the chunk alone is too big for the queue
+            case stream_drop_newest:
+                sub->dropped += frames;
+                _framesDropped += frames;
+                return;
+            case stream_disconnect:
+                sub->overflow = true;
+                _framesDropped += frames;
+                return;
+        }
+    }
+
+    if (sub->dropped) {
+        appendRecordHeader(sub->pending, record_dropped, 4);
+        appendU32(sub->pending, sub->dropped);
+        sub->dropped = 0;
+    }
+
+    sub->pending.append(chunk);
+    sub->pendingFrames += frames;
+}
+
+void CanStreamServer::encodeInterface(QByteArray &buf, CanInterfaceId interface)
+{
+    QByteArray name = _backend.getInterfaceName(interface).toUtf8();
+    appendRecordHeader(buf, record_interface, 2 + name.size());
+    appendU16(buf, interface);
+    buf.append(name);
+}
+
+void CanStreamServer::encodeSignalDefinition(QByteArray &buf, uint16_t index, const QString &name, const QString &unit)
+{
+    QByteArray n = name.toUtf8().left(255);
+    QByteArray u = unit.toUtf8();
+    appendRecordHeader(buf, record_signal_def, 3 + n.size() + u.size());
+    appendU16(buf, index);
+    appendU8(buf, n.size());
+    buf.append(n);
+    buf.append(u);
+}
+
+void CanStreamServer::encodeFrame(QByteArray &buf, const CanMessage &msg)
+{
+    uint8_t length = msg.getLength();
+    uint8_t flags = (msg.isRX() ? 0x01 : 0) | (msg.isFD() ? 0x02 : 0) | (msg.isBRS() ? 0x04 : 0);
+
+    appendRecordHeader(buf, record_frame, 16 + length);
+    appendU64(buf, timestampUs(msg));
+    appendU16(buf, msg.getInterfaceId());
+    appendU32(buf, msg.getRawId());
+    appendU8(buf, flags);
+    appendU8(buf, length);
+    for (int i=0; i<length; i++) {
+        appendU8(buf, msg.getByte(i));
+    }
+}
+
+void CanStreamServer::encodeSignals(QByteArray &defs, QByteArray &buf, const CanMessage &msg)
+{
+    CanDbMessage *dbmsg = _backend.findDbMessage(msg);
+    if (!dbmsg) {
+        return;
+    }
+
+    uint64_t ts = timestampUs(msg);
+    foreach (CanDbSignal *signal, dbmsg->getSignals()) {
+        if (!signal->isPresentInMessage(msg)) {
+            continue;
+        }
+
+        QHash<const CanDbSignal*, uint16_t>::const_iterator it = _signalIndex.constFind(signal);
+        if (it == _signalIndex.constEnd()) {
+            if (_signalIndex.size() > 0xFFFF) {
+                continue;
+            }
+            it = _signalIndex.insert(signal, _signalIndex.size());
+            encodeSignalDefinition(defs, it.value(), dbmsg->getName() + "." + signal->name(), signal->getUnit());
+        }
+
+        double value = signal->extractPhysicalFromMessage(msg);
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        appendRecordHeader(buf, record_signal, 18);
+        appendU64(buf, ts);
+        appendU16(buf, it.value());
+        appendU64(buf, bits);
+    }
+}
@@ -0,0 +1,153 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <QObject>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include <core/CanMessage.h>
+#include <core/CanRxObserver.h>
+
+class Backend;
+class CanDbSignal;
+class QIODevice;
+class QTcpServer;
+class QLocalServer;
+
+typedef enum {
+    stream_drop_newest,     // keep the queue, discard frames that do not fit
+    stream_drop_oldest,     // discard the queue, keep the latest frames
+    stream_disconnect       // close the connection of a subscriber that falls behind
+} stream_drop_policy_t;
+
+typedef struct {
+    bool includeSignals;
+    int queueBytes;
+    stream_drop_policy_t dropPolicy;
+} CanStreamServerConfig;
+
+/*
+ * Publishes the live trace to any number of subscribers over TCP and/or a
+ * local socket. Frames are encoded once per batch on the listener threads
+ * and appended to a bounded queue per subscriber; the sockets are fed from
+ * the main thread and only while their own write buffer is small, so a
+ * slow subscriber only ever loses its own frames.
+ *
+ * The stream is a sequence of records, all integers little endian:
+ *
+ *   u8 type, u8 reserved, u16 payload length, payload
+ *
+ *   0x01 hello       4 bytes 'CGRO', u16 version (1)
+ *   0x02 interface   u16 interface id, utf8 name
+ *   0x03 signal def  u16 signal index, u8 name length, utf8 "Message.Signal", utf8 unit
+ *   0x10 frame       u64 timestamp us, u16 interface id, u32 raw id (bit31 extended,
+ *                    bit30 rtr, bit29 error), u8 flags (bit0 rx, bit1 fd, bit2 brs),
+ *                    u8 length, data
+ *   0x11 signal      u64 timestamp us, u16 signal index, f64 physical value
+ *   0x20 dropped     u32 frames dropped for this subscriber since the last notice
+ *
+ * Interface and signal definitions are sent before their first use, and
+ * the full tables are sent to each new subscriber after the hello record.
+ * When the measurement setup changes, signal indices are assigned anew;
+ * a definition replaces any earlier one with the same index.
+ */
+class CanStreamServer : public QObject, public CanRxObserver
+{
+    Q_OBJECT
+
+public:
+    enum {
+        record_hello = 0x01,
+        record_interface = 0x02,
+        record_signal_def = 0x03,
+        record_frame = 0x10,
+        record_signal = 0x11,
+        record_dropped = 0x20
+    };
+
+    explicit CanStreamServer(Backend &backend, QObject *parent=0);
+    virtual ~CanStreamServer();
+
+    bool listenTcp(uint16_t port, bool localhostOnly=true, QString *errorMessage=0);
+    bool listenLocal(const QString &name, QString *errorMessage=0);
+    void close();
+    bool isListening() const;
+
+    void setConfig(const CanStreamServerConfig &config);
+    CanStreamServerConfig getConfig();
+
+    int getSubscriberCount();
+    uint64_t getFramesDropped();
+
+    virtual void messagesReceived(CanInterfaceId interface, const QList<CanMessage> &msgs);
+
+private slots:
+    void acceptTcp();
+    void acceptLocal();
+    void subscriberDisconnected();
+    void feedSubscribers();
+    void setupChanged();
+
+private:
+    enum {
+        socket_high_water = 64*1024
+    };
+
+    typedef struct {
+        QIODevice *socket;
+        QByteArray definitions; // hello and definition records, never dropped
+        QByteArray pending;     // frame and signal records, bounded by queueBytes
+        int pendingFrames;
+        uint32_t dropped;
+        bool overflow;
+    } subscriber_t;
+
+    Backend &_backend;
+    QTcpServer *_tcpServer;
+    QLocalServer *_localServer;
+
+    QMutex _mutex;
+    CanStreamServerConfig _config;
+    QList<subscriber_t*> _subscribers;
+    QHash<CanInterfaceId, bool> _knownInterfaces;
+    QHash<const CanDbSignal*, uint16_t> _signalIndex;
+    QByteArray _definitions;
+    uint64_t _framesDropped;
+    bool _observing;
+    QAtomicInt _feedScheduled;
+
+    void addSubscriber(QIODevice *socket);
+    void startObserving();
+    void stopObserving();
+
+    void encodeInterface(QByteArray &buf, CanInterfaceId interface);
+    void encodeSignalDefinition(QByteArray &buf, uint16_t index, const QString &name, const QString &unit);
+    void encodeFrame(QByteArray &buf, const CanMessage &msg);
+    void encodeSignals(QByteArray &defs, QByteArray &buf, const CanMessage &msg);
+    void enqueue(subscriber_t *sub, const QByteArray &chunk, int frames);
+};
@@ -23,27 +23,88 @@
 #include <QMutexLocker>
 #include <QFile>
 #include <QTextStream>
+#include <QTemporaryDir>
+#include <QDir>
+#include <QRunnable>
 
 #include <core/Backend.h>
+#include <core/CanTraceSegment.h>
+#include <core/CanMetrics.h>
+#include <core/Log.h>
 #include <core/CanMessage.h>
 #include <core/CanDbMessage.h>
 #include <core/CanDbSignal.h>
 #include <driver/CanInterface.h>
 
+// compresses and writes one full hot block, off the GUI thread and
+// without holding the trace lock. nobody writes to a full block, so it
+// can be read here while the views keep reading it too.
+class CanTraceSealTask : public QRunnable
+{
+public:
+    CanTraceSealTask(CanTrace *trace, CanTraceSpool *spool, const CanMessage *block, int count)
+      : _trace(trace), _spool(spool), _block(block), _count(count)
+    {
+    }
+
+    virtual void run()
+    {
+        CanTraceSegment *segment = new CanTraceSegment();
+        bool ok = segment->write(*_spool, _block, _count);
+        _trace->sealFinished(segment, ok);
+    }
+
+private:
+    CanTrace *_trace;
+    CanTraceSpool *_spool;
+    const CanMessage *_block;
+    int _count;
+};
+
 CanTrace::CanTrace(Backend &backend, QObject *parent, int flushInterval)
   : QObject(parent),
     _backend(backend),
+    _spoolDir(0),
+    _spool(0),
+    _sealedRows(0),
+    _spoolFailed(false),
+    _sealing(false),
+    _sealedSegment(0),
+    _sealFailed(false),
+    _chunkCache(chunk_cache_size),
+    _chunkCacheClock(0),
+    _dataRowsUsed(0),
+    _newRows(0),
     _isTimerRunning(false),
     _mutex(QMutex::Recursive),
     _timerMutex(),
-    _flushTimer(this)
+    _flushTimer(this),
+    _minFlushInterval(flushInterval),
+    _flushLoad(0)
 {
+    for (int i=0; i<_chunkCache.size(); i++) {
+        _chunkCache[i].segment = -1;
+        _chunkCache[i].chunk = -1;
+        _chunkCache[i].lastUsed = 0;
+        _chunkCache[i].data = new CanMessage[CanTraceSegment::chunk_size];
+    }
+    _sealPool.setMaxThreadCount(1);
+
     clear();
     _flushTimer.setSingleShot(true);
     _flushTimer.setInterval(flushInterval);
     connect(&_flushTimer, SIGNAL(timeout()), this, SLOT(flushQueue()));
 }
 
+CanTrace::~CanTrace()
+{
+    freeStorage();
+    for (int i=0; i<_chunkCache.size(); i++) {
+        delete[] _chunkCache[i].data;
+    }
+    delete _spoolDir;
+}
+
 unsigned long CanTrace::size()
 {
     QMutexLocker locker(&_mutex);
@@ -54,32 +115,78 @@ void CanTrace::clear()
 {
     QMutexLocker locker(&_mutex);
     emit beforeClear();
-    _data.resize(pool_chunk_size);
+    freeStorage();
     _dataRowsUsed = 0;
     _newRows = 0;
+    _spoolFailed = false;
     emit afterClear();
 }
 
 const CanMessage *CanTrace::getMessage(int idx)
 {
     QMutexLocker locker(&_mutex);
-    if (idx >= (_dataRowsUsed + _newRows)) {
+    if ((idx < 0) || (idx >= (_dataRowsUsed + _newRows))) {
         return 0;
+    } else if (idx >= _sealedRows) {
+        return getHotMessage(idx);
     } else {
-        return &_data[idx];
+        return getSealedMessage(idx);
     }
 }
 
-void CanTrace::enqueueMessage(const CanMessage &msg, bool more_to_follow)
+int CanTrace::copyMessages(int first, int count, QVector<CanMessage> &out)
 {
+    // for worker threads: pointers from getMessage() into the chunk cache
+    // are only valid until the next call, so copy under the lock. sealed
+    // rows are decompressed into a private buffer, a background scan must
+    // not evict the chunks the views are working on.
     QMutexLocker locker(&_mutex);
+    int n = qMax(0, qMin(count, _dataRowsUsed - first));
+    out.resize(n);
+
+    QVector<CanMessage> chunk;
+    int i = 0;
+    while (i < n) {
+        int idx = first + i;
+        if (idx >= _sealedRows) {
+            out[i++].cloneFrom(*getHotMessage(idx));
+            continue;
+        }
+
+        int segment = idx / hot_block_size;
+        int offset = idx % CanTraceSegment::chunk_size;
+        int num = qMin(CanTraceSegment::chunk_size - offset, n - i);
+
+        chunk.resize(CanTraceSegment::chunk_size);
+        if (_segments[segment]->readChunk((idx % hot_block_size) / CanTraceSegment::chunk_size, chunk.data())) {
+            for (int k=0; k<num; k++) {
+                out[i+k].cloneFrom(chunk[offset+k]);
+            }
+        }
+        i += num;
+    }
+
+    return n;
+}
+
+void CanTrace::enqueueMessage(const CanMessage &msg, bool more_to_follow)
+{
+    // listener threads compete with the views for the trace, measure how long they wait
+    if (!_mutex.tryLock()) {
+        QElapsedTimer wait;
+        wait.start();
+        _mutex.lock();
+        CanMetrics::count(CanMetrics::counter_lock_contended);
+        CanMetrics::sample(CanMetrics::histogram_lock_wait, wait.nsecsElapsed() / 1000);
+    }
+    CanMetrics::count(CanMetrics::counter_trace_frames);
 
-    int idx = size() + _newRows;
-    if (idx>=_data.size()) {
-        _data.resize(_data.size() + pool_chunk_size);
+    int idx = _dataRowsUsed + _newRows;
+    if ((idx - _sealedRows) >= (_hotBlocks.size() * hot_block_size)) {
+        _hotBlocks.append(new CanMessage[hot_block_size]);
     }
 
-    _data[idx].cloneFrom(msg);
+    getHotMessage(idx)->cloneFrom(msg);
     _newRows++;
 
     if (!more_to_follow) {
@@ -87,23 +194,170 @@ void CanTrace::enqueueMessage(const CanMessage &msg, bool more_to_follow)
     }
 
     emit messageEnqueued(idx);
+    _mutex.unlock();
+}
+
+CanMessage *CanTrace::getHotMessage(int idx)
+{
+    int row = idx - _sealedRows;
+    return &_hotBlocks[row / hot_block_size][row % hot_block_size];
+}
+
+const CanMessage *CanTrace::getSealedMessage(int idx)
+{
+    int segment = idx / hot_block_size;
+    int chunk = (idx % hot_block_size) / CanTraceSegment::chunk_size;
+    int offset = idx % CanTraceSegment::chunk_size;
+
+    _chunkCacheClock++;
+
+    int lru = 0;
+    for (int i=0; i<_chunkCache.size(); i++) {
+        cached_chunk_t &entry = _chunkCache[i];
+        if ((entry.segment == segment) && (entry.chunk == chunk)) {
+            entry.lastUsed = _chunkCacheClock;
+            return &entry.data[offset];
+        }
+        if (entry.lastUsed < _chunkCache[lru].lastUsed) {
+            lru = i;
+        }
+    }
+
+    cached_chunk_t &entry = _chunkCache[lru];
+    if (!_segments[segment]->readChunk(chunk, entry.data)) {
+        entry.segment = -1;
+        entry.chunk = -1;
+        return 0;
+    }
+
+    entry.segment = segment;
+    entry.chunk = chunk;
+    entry.lastUsed = _chunkCacheClock;
+    return &entry.data[offset];
+}
+
+void CanTrace::sealBlocks()
+{
+    // one block at a time; installSegment() starts the next one
+    if (_spoolFailed || _sealing || (_hotBlocks.size() <= hot_blocks_max) || ((_sealedRows + hot_block_size) > _dataRowsUsed)) {
+        return;
+    }
+
+    if (!_spoolDir) {
+        _spoolDir = new QTemporaryDir(QDir::tempPath() + "/cangaroo-trace-XXXXXX");
+    }
+
+    if (!_spoolDir->isValid()) {
+        log_error(tr("Cannot create trace spool directory in %1, keeping trace in memory").arg(QDir::tempPath()));
+        _spoolFailed = true;
+        return;
+    }
+    if (!_spool) {
+        _spool = new CanTraceSpool(_spoolDir->path());
+    }
+
+    _sealing = true;
+    _sealPool.start(new CanTraceSealTask(this, _spool, _hotBlocks.first(), hot_block_size));
+}
+
+void CanTrace::sealFinished(CanTraceSegment *segment, bool ok)
+{
+    // called on the worker thread
+    {
+        QMutexLocker locker(&_sealMutex);
+        _sealedSegment = segment;
+        _sealFailed = !ok;
+    }
+    QMetaObject::invokeMethod(this, "installSegment", Qt::QueuedConnection);
+}
+
+void CanTrace::installSegment()
+{
+    QMutexLocker locker(&_mutex);
+
+    CanTraceSegment *segment;
+    bool failed;
+    {
+        QMutexLocker sealLocker(&_sealMutex);
+        segment = _sealedSegment;
+        failed = _sealFailed;
+        _sealedSegment = 0;
+    }
+    if (!segment) {
+        // the trace was cleared meanwhile
+        return;
+    }
+
+    _sealing = false;
+    if (failed) {
+        log_error(tr("Cannot write trace segment to %1, keeping trace in memory").arg(_spool->path()));
+        delete segment;
+        _spoolFailed = true;
+        return;
+    }
+
+    delete[] _hotBlocks.takeFirst();
+    _segments.append(segment);
+    _sealedRows += hot_block_size;
+
+    sealBlocks();
+}
+
+void CanTrace::freeStorage()
+{
+    // the worker may still read the oldest hot block
+    _sealPool.waitForDone();
+    {
+        QMutexLocker locker(&_sealMutex);
+        delete _sealedSegment;
+        _sealedSegment = 0;
+    }
+    _sealing = false;
+
+    foreach (CanMessage *block, _hotBlocks) {
+        delete[] block;
+    }
+    _hotBlocks.clear();
+
+    qDeleteAll(_segments);
+    _segments.clear();
+    delete _spool;
+    _spool = 0;
+    _sealedRows = 0;
+
+    for (int i=0; i<_chunkCache.size(); i++) {
+        _chunkCache[i].segment = -1;
+        _chunkCache[i].chunk = -1;
+        _chunkCache[i].lastUsed = 0;
+    }
 }
 
 void CanTrace::flushQueue()
 {
+    // how late the timer fired tells how busy the GUI thread is
+    qint64 lateness;
     {
         QMutexLocker locker(&_timerMutex);
         _isTimerRunning = false;
+        lateness = qMax<qint64>(0, _flushRequested.elapsed() - _flushTimer.interval());
     }
 
+    QElapsedTimer cost;
+    cost.start();
+
     QMutexLocker locker(&_mutex);
     if (_newRows) {
+        CanMetrics::sample(CanMetrics::histogram_queue_depth, _newRows);
+
+        QElapsedTimer modelUpdate;
+        modelUpdate.start();
         emit beforeAppend(_newRows);
+        qint64 modelUpdateNs = modelUpdate.nsecsElapsed();
 
         // see if we have muxed messages. cache muxed values, if any.
         MeasurementSetup &setup = _backend.getSetup();
         for (int i=_dataRowsUsed; i<_dataRowsUsed + _newRows; i++) {
-            CanMessage &msg = _data[i];
+            CanMessage &msg = *getHotMessage(i);
             CanDbMessage *dbmsg = setup.findDbMessage(msg);
             if (dbmsg && dbmsg->getMuxer()) {
                 foreach (CanDbSignal *signal, dbmsg->getSignals()) {
@@ -116,7 +370,15 @@ void CanTrace::flushQueue()
 
         _dataRowsUsed += _newRows;
         _newRows = 0;
+        modelUpdate.restart();
         emit afterAppend();
+        modelUpdateNs += modelUpdate.nsecsElapsed();
+
+        sealBlocks();
+        adaptFlushInterval(cost.elapsed() + lateness);
+
+        CanMetrics::sample(CanMetrics::histogram_model_update, modelUpdateNs / 1000);
+        CanMetrics::sample(CanMetrics::histogram_flush_time, cost.nsecsElapsed() / 1000);
     }
 
 }
@@ -126,16 +388,29 @@ void CanTrace::startTimer()
     QMutexLocker locker(&_timerMutex);
     if (!_isTimerRunning) {
         _isTimerRunning = true;
+        _flushRequested.start();
         QMetaObject::invokeMethod(&_flushTimer, "start", Qt::QueuedConnection);
     }
 }
 
+void CanTrace::adaptFlushInterval(qint64 costMs)
+{
+    // keep the views busy for at most about a quarter of the time: a
+    // cheap update runs at the minimum interval, an expensive one (big
+    // trace, filters, slow painting) backs off up to max_flush_interval
+    _flushLoad = 0.8*_flushLoad + 0.2*costMs;
+    _flushTimer.setInterval(qBound(_minFlushInterval, (int)(4*_flushLoad), (int)max_flush_interval));
+}
+
 void CanTrace::saveCanDump(QFile &file)
 {
     QMutexLocker locker(&_mutex);
     QTextStream stream(&file);
     for (unsigned int i=0; i<size(); i++) {
-        CanMessage *msg = &_data[i];
+        const CanMessage *msg = getMessage(i);
+        if (!msg) {
+            continue;
+        }
         QString line;
         line.append(QString().asprintf("(%.6f) ", msg->getFloatTimestamp()));
         line.append(_backend.getInterfaceName(msg->getInterfaceId()));
@@ -156,12 +431,13 @@ void CanTrace::saveVectorAsc(QFile &file)
     QMutexLocker locker(&_mutex);
     QTextStream stream(&file);
 
-    if (_data.length()<1) {
+    const CanMessage *first = getMessage(0);
+    if (!first) {
         return;
     }
 
 
-    auto firstMessage = _data.first();
+    CanMessage firstMessage(*first);
     double t_start = firstMessage.getFloatTimestamp();
 
     QLocale locale_c(QLocale::C);
@@ -175,7 +451,11 @@ void CanTrace::saveVectorAsc(QFile &file)
     stream << "   0.000000 Start of measurement" << Qt::endl;
 
     for (unsigned int i=0; i<size(); i++) {
-        CanMessage &msg = _data[i];
+        const CanMessage *p = getMessage(i);
+        if (!p) {
+            continue;
+        }
+        const CanMessage &msg = *p;
 
         double t_current = msg.getFloatTimestamp();
         QString id_hex_str = QString().asprintf("%x", msg.getId());
@@ -24,9 +24,12 @@
 #include <QObject>
 #include <QMutex>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QVector>
 #include <QMap>
 #include <QFile>
+#include <QList>
+#include <QThreadPool>
 
 #include "CanMessage.h"
 
@@ -35,17 +38,24 @@ class CanDbMessage;
 class CanDbSignal;
 class MeasurementSetup;
 class Backend;
+class CanTraceSegment;
+class CanTraceSpool;
+class QTemporaryDir;
 
 class CanTrace : public QObject
 {
     Q_OBJECT
 
 public:
+    // new messages are handed to the views at most every flushInterval ms;
+    // the interval grows up to max_flush_interval when the views are slow
     explicit CanTrace(Backend &backend, QObject *parent, int flushInterval);
+    virtual ~CanTrace();
 
     unsigned long size();
     void clear();
     const CanMessage *getMessage(int idx);
+    int copyMessages(int first, int count, QVector<CanMessage> &out);
     void enqueueMessage(const CanMessage &msg, bool more_to_follow=false);
 
     void saveCanDump(QFile &file);
@@ -62,15 +72,48 @@ signals:
 
 private slots:
     void flushQueue();
+    void installSegment();
 
 private:
+    friend class CanTraceSealTask;
+
     enum {
-        pool_chunk_size = 1024
+        hot_block_size = 16384,
+        hot_blocks_max = 16,
+        chunk_cache_size = 8,
+        max_flush_interval = 100
     };
 
+    typedef struct {
+        int segment;
+        int chunk;
+        unsigned long lastUsed;
+        CanMessage *data;
+    } cached_chunk_t;
+
     Backend &_backend;
 
-    QVector<CanMessage> _data;
+    // the most recent messages are kept in memory in blocks of
+    // hot_block_size messages. when there are more than hot_blocks_max
+    // blocks, the oldest block is sealed into a compressed segment that is
+    // appended to the spool files.
+    // sealing runs on _sealPool; the block stays readable in _hotBlocks
+    // until installSegment() swaps in the finished segment.
+    QList<CanMessage*> _hotBlocks;
+    QList<CanTraceSegment*> _segments;
+    QTemporaryDir *_spoolDir;
+    CanTraceSpool *_spool;
+    int _sealedRows;
+    bool _spoolFailed;
+    bool _sealing;
+    QThreadPool _sealPool;
+    QMutex _sealMutex;
+    CanTraceSegment *_sealedSegment; // finished by the worker, not yet installed
+    bool _sealFailed;
+
+    QVector<cached_chunk_t> _chunkCache;
+    unsigned long _chunkCacheClock;
+
     int _dataRowsUsed;
     int _newRows;
     bool _isTimerRunning;
@@ -80,8 +123,17 @@ private:
     QMutex _mutex;
     QMutex _timerMutex;
     QTimer _flushTimer;
+    QElapsedTimer _flushRequested;
+    int _minFlushInterval;
+    double _flushLoad;
 
     void startTimer();
+    void adaptFlushInterval(qint64 costMs);
 
+    CanMessage *getHotMessage(int idx);
+    const CanMessage *getSealedMessage(int idx);
+    void sealBlocks();
+    void sealFinished(CanTraceSegment *segment, bool ok);
+    void freeStorage();
 
 };
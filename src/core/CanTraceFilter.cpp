@@ -0,0 +1,507 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "CanTraceFilter.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <QRegExp>
+
+#include <core/Backend.h>
+#include <core/CanDb.h>
+#include <core/CanDbMessage.h>
+#include <core/CanDbNode.h>
+#include <core/MeasurementSetup.h>
+#include <core/MeasurementNetwork.h>
+
+CanTraceFilter::CanTraceFilter()
+  : _root(-1),
+    _backend(0),
+    _pos(0)
+{
+}
+
+bool CanTraceFilter::compile(Backend &backend, const QString &text, QString *errorMessage)
+{
+    _text = text;
+    _nodes.clear();
+    _conditions.clear();
+    _root = -1;
+
+    _backend = &backend;
+    _tokens = tokenize(text);
+    _pos = 0;
+    _error.clear();
+
+    if (!_tokens.isEmpty()) {
+        _root = parseOr();
+        if (_error.isEmpty() && (_pos < _tokens.size())) {
+            _error = QObject::tr("unexpected '%1'").arg(_tokens[_pos]);
+        }
+    }
+
+    _backend = 0;
+    _tokens.clear();
+
+    if (!_error.isEmpty()) {
+        if (errorMessage) {
+            *errorMessage = _error;
+        }
+        _nodes.clear();
+        _conditions.clear();
+        _root = -1;
+        return false;
+    }
+    return true;
+}
+
+QString CanTraceFilter::getText() const
+{
+    return _text;
+}
+
+bool CanTraceFilter::isEmpty() const
+{
+    return _root < 0;
+}
+
+bool CanTraceFilter::matches(const CanMessage &msg) const
+{
+    return (_root < 0) || matchNode(_root, msg);
+}
+
+QStringList CanTraceFilter::tokenize(const QString &text)
+{
+    QStringList tokens;
+    QString current;
+    for (int i=0; i<text.length(); i++) {
+        QChar c = text[i];
+        if (c.isSpace() || (c == '(') || (c == ')') || ((c == '!') && current.isEmpty() && (i+1 < text.length()) && (text[i+1] != '='))) {
+            if (!current.isEmpty()) {
+                tokens.append(current);
+                current.clear();
+            }
+            if (!c.isSpace()) {
+                tokens.append(QString(c));
+            }
+        } else {
+            current.append(c);
+        }
+    }
+    if (!current.isEmpty()) {
+        tokens.append(current);
+    }
+    return tokens;
+}
+
+int CanTraceFilter::parseOr()
+{
+    int left = parseAnd();
+    while (_error.isEmpty() && (_pos < _tokens.size())) {
+        QString t = _tokens[_pos].toLower();
+        if ((t != "or") && (t != "|") && (t != "||")) {
+            break;
+        }
+        _pos++;
+        node_t node = newNode(node_or);
+        node.left = left;
+        node.right = parseAnd();
+        left = addNode(node);
+    }
+    return left;
+}
+
+int CanTraceFilter::parseAnd()
+{
+    int left = parseUnary();
+    while (_error.isEmpty() && (_pos < _tokens.size())) {
+        QString t = _tokens[_pos].toLower();
+        if ((t == "or") || (t == "|") || (t == "||") || (t == ")")) {
+            break;
+        }
+        if ((t == "and") || (t == "&") || (t == "&&")) {
+            _pos++;
+        }
+        node_t node = newNode(node_and);
+        node.left = left;
+        node.right = parseUnary();
+        left = addNode(node);
+    }
+    return left;
+}
+
+int CanTraceFilter::parseUnary()
+{
+    if (_pos >= _tokens.size()) {
+        _error = QObject::tr("unexpected end of filter");
+        return -1;
+    }
+
+    QString token = _tokens[_pos++];
+    QString t = token.toLower();
+
+    if ((t == "not") || (t == "!")) {
+        node_t node = newNode(node_not);
+        node.left = parseUnary();
+        return addNode(node);
+    }
+
+    if (t == "(") {
+        int inner = parseOr();
+        if (_error.isEmpty()) {
+            if ((_pos >= _tokens.size()) || (_tokens[_pos] != ")")) {
+                _error = QObject::tr("missing ')'");
+            } else {
+                _pos++;
+            }
+        }
+        return inner;
+    }
+
+    if ((t == ")") || (t == "and") || (t == "or") || (t == "&") || (t == "&&") || (t == "|") || (t == "||")) {
+        _error = QObject::tr("unexpected '%1'").arg(token);
+        return -1;
+    }
+
+    return parseTerm(token);
+}
+
+static bool parseRange(const QString &s, uint32_t &lo, uint32_t &hi, int base)
+{
+    bool ok1, ok2;
+    int dash = s.indexOf('-');
+    if (dash > 0) {
+        lo = s.left(dash).toUInt(&ok1, base);
+        hi = s.mid(dash+1).toUInt(&ok2, base);
+        return ok1 && ok2 && (lo <= hi);
+    } else {
+        lo = hi = s.toUInt(&ok1, base);
+        return ok1;
+    }
+}
+
+int CanTraceFilter::parseTerm(const QString &token)
+{
+    static const struct {
+        const char *name;
+        uint32_t flag;
+    } flagTerms[] = {
+        { "rx", flag_rx }, { "tx", flag_tx }, { "std", flag_std }, { "ext", flag_ext },
+        { "fd", flag_fd }, { "brs", flag_brs }, { "rtr", flag_rtr }, { "err", flag_err }
+    };
+
+    QString t = token.toLower();
+    for (unsigned i=0; i<sizeof(flagTerms)/sizeof(flagTerms[0]); i++) {
+        if (t == flagTerms[i].name) {
+            node_t node = newNode(node_flags);
+            node.flags = flagTerms[i].flag;
+            return addNode(node);
+        }
+    }
+
+    int colon = token.indexOf(':');
+    QString key = (colon > 0) ? token.left(colon).toLower() : QString();
+    QString value = (colon > 0) ? token.mid(colon+1) : QString();
+
+    if (key == "id") {
+        node_t node = newNode(node_id);
+        bool ok;
+        int slash = value.indexOf('/');
+        if (slash > 0) {
+            bool ok2;
+            node.useMask = true;
+            node.lo = value.left(slash).toUInt(&ok, 16);
+            node.mask = value.mid(slash+1).toUInt(&ok2, 16);
+            ok = ok && ok2;
+        } else {
+            ok = parseRange(value, node.lo, node.hi, 16);
+        }
+        if (!ok) {
+            _error = QObject::tr("expected id:ID, id:FROM-TO or id:ID/MASK in hex, got '%1'").arg(token);
+            return -1;
+        }
+        return addNode(node);
+    }
+
+    if (key == "len" || key == "dlc") {
+        node_t node = newNode(node_length);
+        if (!parseRange(value, node.lo, node.hi, 10)) {
+            _error = QObject::tr("expected len:N or len:FROM-TO, got '%1'").arg(token);
+            return -1;
+        }
+        return addNode(node);
+    }
+
+    if ((key == "data") || (key == "bytes")) {
+        node_t node = newNode((key == "data") ? node_data : node_bytes);
+        node.hi = 0xFFFFFFFF; // index of the first fixed byte, if any
+        QString p = value.toUpper();
+        if (p.isEmpty() || ((p.length() % 2) != 0) || (p.length() > 128)) {
+            _error = QObject::tr("expected %1:HEX with an even number of digits, got '%2'").arg(key, token);
+            return -1;
+        }
+        for (int i=0; i<p.length(); i+=2) {
+            uint8_t byte = 0, mask = 0;
+            for (int n=0; n<2; n++) {
+                QChar c = p[i+n];
+                byte <<= 4;
+                mask <<= 4;
+                if (c != 'X') {
+                    bool ok;
+                    byte |= QString(c).toUInt(&ok, 16);
+                    mask |= 0x0F;
+                    if (!ok) {
+                        _error = QObject::tr("invalid digit in '%1'").arg(token);
+                        return -1;
+                    }
+                }
+            }
+            if ((mask == 0xFF) && (node.hi == 0xFFFFFFFF)) {
+                node.hi = node.pattern.size(); // first fixed byte, used to find candidates
+            }
+            node.pattern.append((char)byte);
+            node.patternMask.append((char)mask);
+        }
+
+        // compared in 64 bit words; padding bytes have an empty mask
+        node.lo = node.pattern.size();
+        while ((node.pattern.size() % 8) != 0) {
+            node.pattern.append((char)0);
+            node.patternMask.append((char)0);
+        }
+        return addNode(node);
+    }
+
+    if (key == "if") {
+        node_t node = newNode(node_interface);
+        QRegExp rx(value, Qt::CaseInsensitive, QRegExp::Wildcard);
+        foreach (CanInterfaceId ifid, _backend->getInterfaceList()) {
+            if (rx.exactMatch(_backend->getInterfaceName(ifid))) {
+                node.interfaces.insert(ifid);
+            }
+        }
+        return addNode(node);
+    }
+
+    if (key == "msg") {
+        node_t node = newNode(node_raw_ids);
+        QRegExp rx(value, Qt::CaseInsensitive, QRegExp::Wildcard);
+        foreach (MeasurementNetwork *network, _backend->getSetup().getNetworks()) {
+            foreach (pCanDb db, network->_canDbs) {
+                foreach (CanDbMessage *m, db->getMessages()) {
+                    if (rx.exactMatch(m->getName())) {
+                        node.rawIds.insert(m->getRaw_id());
+                    }
+                }
+            }
+        }
+        return addNode(node);
+    }
+
+    if (key == "sig") {
+        QRegExp rx("^([^<>=!]+)(>=|<=|==|!=|>|<)(.+)$");
+        if (!rx.exactMatch(value)) {
+            _error = QObject::tr("expected sig:Message.Signal<op><value>, got '%1'").arg(token);
+            return -1;
+        }
+
+        CanTriggerCondition condition;
+        QString error;
+        if (!condition.parse(*_backend, QString("signal %1 %2 %3").arg(rx.cap(1), rx.cap(2), rx.cap(3)), &error)) {
+            _error = error;
+            return -1;
+        }
+
+        node_t node = newNode(node_signal);
+        node.condition = _conditions.size();
+        _conditions.append(condition);
+        return addNode(node);
+    }
+
+    if (!key.isEmpty()) {
+        _error = QObject::tr("unknown filter term '%1'").arg(token);
+        return -1;
+    }
+
+    // plain text: resolve the names it can match now, the id is checked per frame
+    node_t node = newNode(node_text);
+    node.text = token.toUpper().toLatin1();
+    foreach (CanInterfaceId ifid, _backend->getInterfaceList()) {
+        if (_backend->getInterfaceName(ifid).contains(token, Qt::CaseInsensitive)) {
+            node.interfaces.insert(ifid);
+        }
+    }
+    foreach (MeasurementNetwork *network, _backend->getSetup().getNetworks()) {
+        foreach (pCanDb db, network->_canDbs) {
+            foreach (CanDbMessage *m, db->getMessages()) {
+                CanDbNode *sender = m->getSender();
+                if (m->getName().contains(token, Qt::CaseInsensitive) || (sender && sender->name().contains(token, Qt::CaseInsensitive))) {
+                    node.rawIds.insert(m->getRaw_id());
+                }
+            }
+        }
+    }
+    return addNode(node);
+}
+
+CanTraceFilter::node_t CanTraceFilter::newNode(node_type_t type)
+{
+    node_t node;
+    node.type = type;
+    node.left = -1;
+    node.right = -1;
+    node.lo = 0;
+    node.hi = 0;
+    node.mask = 0;
+    node.useMask = false;
+    node.flags = 0;
+    node.condition = -1;
+    return node;
+}
+
+int CanTraceFilter::addNode(const node_t &node)
+{
+    if (!_error.isEmpty()) {
+        return -1;
+    }
+    _nodes.append(node);
+    return _nodes.size() - 1;
+}
+
+bool CanTraceFilter::matchNode(int idx, const CanMessage &msg) const
+{
+    const node_t &node = _nodes[idx];
+
+    switch (node.type) {
+
+        case node_and:
+            return matchNode(node.left, msg) && matchNode(node.right, msg);
+
+        case node_or:
+            return matchNode(node.left, msg) || matchNode(node.right, msg);
+
+        case node_not:
+            return !matchNode(node.left, msg);
+
+        case node_id:
+            if (node.useMask) {
+                return (msg.getId() & node.mask) == (node.lo & node.mask);
+            } else {
+                return (msg.getId() >= node.lo) && (msg.getId() <= node.hi);
+            }
+
+        case node_interface:
+            return node.interfaces.contains(msg.getInterfaceId());
+
+        case node_flags:
+            switch (node.flags) {
+                case flag_rx: return msg.isRX();
+                case flag_tx: return !msg.isRX();
+                case flag_std: return !msg.isExtended();
+                case flag_ext: return msg.isExtended();
+                case flag_fd: return msg.isFD();
+                case flag_brs: return msg.isBRS();
+                case flag_rtr: return msg.isRTR();
+                case flag_err: return msg.isErrorFrame();
+            }
+            return false;
+
+        case node_length:
+            return (msg.getLength() >= node.lo) && (msg.getLength() <= node.hi);
+
+        case node_data:
+            return (msg.getLength() >= node.lo) && matchPattern(node, msg.getData(), 0);
+
+        case node_bytes:
+            return findPattern(node, msg);
+
+        case node_raw_ids:
+            return node.rawIds.contains(msg.getRawId());
+
+        case node_signal:
+            return _conditions[node.condition].matches(msg);
+
+        case node_text: {
+            if (node.interfaces.contains(msg.getInterfaceId()) || node.rawIds.contains(msg.getRawId())) {
+                return true;
+            }
+            // the id as the trace shows it, see CanMessage::getIdString()
+            char buf[16];
+            snprintf(buf, sizeof(buf), msg.isExtended() ? "0X%08X" : "0X%03X", msg.getId());
+            return strstr(buf, node.text.constData()) != 0;
+        }
+    }
+
+    return false;
+}
+
+bool CanTraceFilter::matchPattern(const node_t &node, const uint8_t *data, int offset)
+{
+    const char *pattern = node.pattern.constData();
+    const char *mask = node.patternMask.constData();
+
+    for (int i=0; i<node.pattern.size(); i+=8) {
+        uint64_t d, p, m;
+        memcpy(&d, data + offset + i, 8);
+        memcpy(&p, pattern + i, 8);
+        memcpy(&m, mask + i, 8);
+        if ((d & m) != p) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CanTraceFilter::findPattern(const node_t &node, const CanMessage &msg)
+{
+    int len = msg.getLength();
+    int n = node.lo;
+    if (len < n) {
+        return false;
+    }
+
+    // room for a pattern word starting at the last payload byte
+    uint8_t buf[64+64];
+    memcpy(buf, msg.getData(), 64);
+    memset(buf+64, 0, 64);
+    int last = len - n;
+
+    if (node.hi == 0xFFFFFFFF) { // only wildcards before, try every offset
+        for (int offset=0; offset<=last; offset++) {
+            if (matchPattern(node, buf, offset)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // only offsets where the first fixed byte matches are candidates
+    int anchor = node.hi;
+    const uint8_t *end = buf + anchor + last + 1;
+    const uint8_t *p = buf + anchor;
+    while ((p < end) && (p = (const uint8_t*)memchr(p, (uint8_t)node.pattern[anchor], end - p))) {
+        if (matchPattern(node, buf, p - buf - anchor)) {
+            return true;
+        }
+        p++;
+    }
+    return false;
+}
@@ -0,0 +1,135 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QList>
+#include <QSet>
+#include <QByteArray>
+
+#include <core/CanMessage.h>
+#include <core/CanTriggerCapture.h>
+
+class Backend;
+
+/*
+ * A trace filter expression, compiled once into a predicate over raw
+ * frames so it can be evaluated for millions of rows without formatting
+ * them. Terms are combined with "and" (or just whitespace), "or" and
+ * "not" (or "!"), with parentheses for grouping:
+ *
+ *   id:7E8  id:700-7FF  id:18DA00F1/1FFFFF00   CAN id, range or id/mask (hex)
+ *   if:can0                                     interface name, * wildcards
+ *   rx  tx  std  ext  fd  brs  rtr  err         direction and frame flags
+ *   len:8  len:1-4                              data length
+ *   data:XX50                                   payload starts with, X = any nibble
+ *   bytes:55XXAA                                byte sequence anywhere in the payload
+ *   msg:Engine*                                 DBC message name, * wildcards
+ *   sig:Engine.Rpm>3000                         DBC signal, op one of > >= < <= == !=
+ *   anything else                               part of the id, interface,
+ *                                               DBC message or sender name
+ *
+ * DBC names and interface names are resolved when compiling, so the
+ * filter must be compiled again after the measurement setup changed.
+ * A compiled filter is read-only and can be shared between threads.
+ */
+class CanTraceFilter
+{
+public:
+    CanTraceFilter();
+
+    bool compile(Backend &backend, const QString &text, QString *errorMessage=0);
+    QString getText() const;
+    bool isEmpty() const;
+
+    bool matches(const CanMessage &msg) const;
+
+private:
+    typedef enum {
+        node_and,
+        node_or,
+        node_not,
+        node_id,
+        node_interface,
+        node_flags,
+        node_length,
+        node_data,
+        node_bytes,
+        node_raw_ids,
+        node_signal,
+        node_text
+    } node_type_t;
+
+    typedef struct {
+        node_type_t type;
+        int left;
+        int right;
+        uint32_t lo;            // id/length range, or id value for masks
+        uint32_t hi;
+        uint32_t mask;
+        bool useMask;
+        uint32_t flags;         // node_flags: required flag
+        QByteArray pattern;     // node_data, node_bytes: padded to 8 byte words
+        QByteArray patternMask;
+        QSet<uint32_t> rawIds;  // node_raw_ids, node_text
+        QSet<CanInterfaceId> interfaces; // node_interface, node_text
+        QByteArray text;        // node_text: upper case, matched against the hex id
+        int condition;          // node_signal: index into _conditions
+    } node_t;
+
+    enum {
+        flag_rx = 0x01,
+        flag_tx = 0x02,
+        flag_std = 0x04,
+        flag_ext = 0x08,
+        flag_fd = 0x10,
+        flag_brs = 0x20,
+        flag_rtr = 0x40,
+        flag_err = 0x80
+    };
+
+    QString _text;
+    QVector<node_t> _nodes;
+    QList<CanTriggerCondition> _conditions;
+    int _root;
+
+    // parser state, only used while compiling
+    Backend *_backend;
+    QStringList _tokens;
+    int _pos;
+    QString _error;
+
+    static QStringList tokenize(const QString &text);
+    int parseOr();
+    int parseAnd();
+    int parseUnary();
+    int parseTerm(const QString &token);
+    int addNode(const node_t &node);
+    node_t newNode(node_type_t type);
+
+    bool matchNode(int idx, const CanMessage &msg) const;
+    static bool matchPattern(const node_t &node, const uint8_t *data, int offset);
+    static bool findPattern(const node_t &node, const CanMessage &msg);
+};
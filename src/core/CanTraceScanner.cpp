@@ -0,0 +1,229 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "CanTraceScanner.h"
+
+#include <QRunnable>
+
+#include <core/CanTrace.h>
+#include <core/CanTraceFilter.h>
+
+class CanTraceScanTask : public QRunnable
+{
+public:
+    CanTraceScanTask(CanTraceScanner *scanner, const QAtomicInt *currentGeneration, int generation, int sequence,
+                     CanTrace &trace, QSharedPointer<const CanTraceFilter> filter, int first, int count,
+                     bool firstOnly, bool backward)
+      : _scanner(scanner), _currentGeneration(currentGeneration), _generation(generation), _sequence(sequence),
+        _trace(trace), _filter(filter), _first(first), _count(count),
+        _firstOnly(firstOnly), _backward(backward)
+    {
+    }
+
+    virtual void run()
+    {
+        if (_currentGeneration->loadAcquire() != _generation) {
+            return; // cancelled before we got a thread
+        }
+
+        QVector<CanMessage> block;
+        int n = _trace.copyMessages(_first, _count, block);
+
+        QVector<int> rows;
+        for (int k=0; k<n; k++) {
+            int i = _backward ? (n-1-k) : k;
+            if (_filter->matches(block[i])) {
+                rows.append(_first + i);
+                if (_firstOnly) {
+                    break;
+                }
+            }
+        }
+
+        // the scanner waits for the pool before it goes away
+        QMetaObject::invokeMethod(_scanner, "chunkFinished", Qt::QueuedConnection,
+            Q_ARG(int, _generation), Q_ARG(int, _sequence), Q_ARG(int, _first), Q_ARG(int, n), Q_ARG(QVector<int>, rows)
+        );
+    }
+
+private:
+    CanTraceScanner *_scanner;
+    const QAtomicInt *_currentGeneration;
+    int _generation;
+    int _sequence;
+    CanTrace &_trace;
+    QSharedPointer<const CanTraceFilter> _filter;
+    int _first;
+    int _count;
+    bool _firstOnly;
+    bool _backward;
+};
+
+
+CanTraceScanner::CanTraceScanner(CanTrace &trace, QObject *parent)
+  : QObject(parent),
+    _trace(trace),
+    _generation(0),
+    _running(false),
+    _finding(false),
+    _backward(false),
+    _cursor(0),
+    _sequence(0),
+    _reported(0),
+    _rowsScanned(0)
+{
+    qRegisterMetaType<QVector<int> >("QVector<int>");
+}
+
+CanTraceScanner::~CanTraceScanner()
+{
+    cancel();
+    _pool.waitForDone();
+}
+
+void CanTraceScanner::start(QSharedPointer<const CanTraceFilter> filter)
+{
+    reset(filter, false, false, 0);
+    scheduleChunks();
+}
+
+void CanTraceScanner::find(QSharedPointer<const CanTraceFilter> filter, int from, bool backward)
+{
+    reset(filter, true, backward, backward ? (from + 1) : qMax(0, from));
+    scheduleChunks();
+}
+
+void CanTraceScanner::reset(QSharedPointer<const CanTraceFilter> filter, bool finding, bool backward, int cursor)
+{
+    cancel();
+
+    _filter = filter;
+    _running = true;
+    _finding = finding;
+    _backward = backward;
+    _cursor = cursor;
+    _sequence = 0;
+    _reported = 0;
+    _rowsScanned = 0;
+}
+
+void CanTraceScanner::cancel()
+{
+    // tasks of older generations return early and their results are ignored
+    _generation.fetchAndAddOrdered(1);
+    _pool.clear();
+    _running = false;
+    _done.clear();
+}
+
+bool CanTraceScanner::isRunning() const
+{
+    return _running;
+}
+
+int CanTraceScanner::rowsScanned() const
+{
+    return _rowsScanned;
+}
+
+void CanTraceScanner::schedule(int first, int count)
+{
+    _pool.start(new CanTraceScanTask(
+        this, &_generation, _generation.loadAcquire(), _sequence++,
+        _trace, _filter, first, count, _finding, _backward
+    ));
+}
+
+void CanTraceScanner::scheduleChunks()
+{
+    int size = _trace.size();
+
+    if (!_finding) {
+        while (_cursor < size) {
+            int count = qMin((int)scan_chunk_size, size - _cursor);
+            schedule(_cursor, count);
+            _cursor += count;
+        }
+        if (_sequence == _reported) {
+            _running = false;
+            emit finished(_rowsScanned);
+        }
+        return;
+    }
+
+    int budget = _pool.maxThreadCount() * find_chunks_per_thread - (_sequence - _reported);
+    while (budget-- > 0) {
+        if (_backward) {
+            _cursor = qMin(_cursor, size);
+            if (_cursor <= 0) {
+                break;
+            }
+            int first = qMax(0, _cursor - find_chunk_size);
+            schedule(first, _cursor - first);
+            _cursor = first;
+        } else {
+            if (_cursor >= size) {
+                break;
+            }
+            int count = qMin((int)find_chunk_size, size - _cursor);
+            schedule(_cursor, count);
+            _cursor += count;
+        }
+    }
+
+    if (_sequence == _reported) {
+        _running = false;
+        emit found(-1);
+    }
+}
+
+void CanTraceScanner::chunkFinished(int generation, int sequence, int first, int count, QVector<int> rows)
+{
+    if (!_running || (generation != _generation.loadAcquire())) {
+        return;
+    }
+
+    chunk_result_t result;
+    result.first = first;
+    result.count = count;
+    result.rows = rows;
+    _done.insert(sequence, result);
+
+    while (_done.contains(_reported)) {
+        chunk_result_t next = _done.take(_reported++);
+
+        if (_finding) {
+            if (!next.rows.isEmpty()) {
+                cancel();
+                emit found(next.rows.first());
+                return;
+            }
+        } else if (next.count > 0) {
+            emit rowsMatched(next.first, next.count, next.rows);
+            _rowsScanned = next.first + next.count;
+        }
+    }
+
+    if (_finding || (_sequence == _reported)) {
+        // keep the pool busy, or go on with rows appended while scanning
+        scheduleChunks();
+    }
+}
@@ -0,0 +1,103 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QMap>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QVector>
+
+class CanTrace;
+class CanTraceFilter;
+
+/*
+ * Evaluates a compiled CanTraceFilter over the trace on a thread pool.
+ * The trace is cut into chunks which are scanned in parallel; results are
+ * handed out in trace order as soon as all chunks before them are done.
+ *
+ * start() matches all rows, so a view can show the first results while
+ * the scan continues. Rows appended during the scan are picked up before
+ * finished() is emitted, rows appended after that are left to the caller.
+ *
+ * find() looks for the next match in one direction and only keeps a few
+ * chunks per thread in flight, so a match close by is found without
+ * scanning the rest of the trace.
+ */
+class CanTraceScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CanTraceScanner(CanTrace &trace, QObject *parent = 0);
+    virtual ~CanTraceScanner();
+
+    void start(QSharedPointer<const CanTraceFilter> filter);
+    void find(QSharedPointer<const CanTraceFilter> filter, int from, bool backward);
+    void cancel();
+    bool isRunning() const;
+
+    int rowsScanned() const;
+
+signals:
+    // trace indexes of matching rows in [first, first+count), ascending
+    void rowsMatched(int first, int count, QVector<int> rows);
+    void finished(int rowsScanned);
+
+    // first match at or after (before, if backward) the row given to find(), or -1
+    void found(int traceIndex);
+
+private slots:
+    void chunkFinished(int generation, int sequence, int first, int count, QVector<int> rows);
+
+private:
+    enum {
+        scan_chunk_size = 16384,
+        find_chunk_size = 4096,
+        find_chunks_per_thread = 2
+    };
+
+    typedef struct {
+        int first;
+        int count;
+        QVector<int> rows;
+    } chunk_result_t;
+
+    CanTrace &_trace;
+    QThreadPool _pool;
+    QAtomicInt _generation;
+    QSharedPointer<const CanTraceFilter> _filter;
+
+    bool _running;
+    bool _finding;
+    bool _backward;
+    int _cursor;      // next row to schedule; when finding backward, the end of the next chunk
+    int _sequence;    // chunks handed to the pool
+    int _reported;    // chunks handled in order
+    int _rowsScanned;
+    QMap<int, chunk_result_t> _done; // finished chunks waiting for their predecessors
+
+    void reset(QSharedPointer<const CanTraceFilter> filter, bool finding, bool backward, int cursor);
+    void schedule(int first, int count);
+    void scheduleChunks();
+};
@@ -0,0 +1,177 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "CanTraceSegment.h"
+
+#include <QByteArray>
+#include <QDir>
+#include <QMutexLocker>
+#include <string.h>
+
+enum {
+    segment_compression_level = 1
+};
+
+CanTraceSpool::CanTraceSpool(const QString &path)
+  : _path(path)
+{
+}
+
+CanTraceSpool::~CanTraceSpool()
+{
+    foreach (QFile *file, _files) {
+        file->close();
+        file->remove();
+        delete file;
+    }
+}
+
+QString CanTraceSpool::path() const
+{
+    return _path;
+}
+
+bool CanTraceSpool::append(const QList<QByteArray> &data, int *file, qint64 *offset)
+{
+    qint64 length = 0;
+    foreach (const QByteArray &d, data) {
+        length += d.size();
+    }
+
+    QMutexLocker locker(&_mutex);
+
+    if (_files.isEmpty() || ((_files.last()->size() > 0) && (_files.last()->size() + length > spool_file_size))) {
+        QFile *f = new QFile(QDir(_path).filePath(QString("spool-%1.bin").arg(_files.size())));
+        if (!f->open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+            delete f;
+            return false;
+        }
+        _files.append(f);
+    }
+
+    QFile *f = _files.last();
+    qint64 pos = f->size();
+    bool ok = f->seek(pos);
+    foreach (const QByteArray &d, data) {
+        ok = ok && (f->write(d) == d.size());
+    }
+    ok = ok && f->flush();
+    if (!ok) {
+        // later appends go after whatever part did get written
+        return false;
+    }
+
+    *file = _files.size() - 1;
+    *offset = pos;
+    return true;
+}
+
+bool CanTraceSpool::read(int file, qint64 offset, qint64 length, QByteArray &data)
+{
+    QMutexLocker locker(&_mutex);
+    if ((file < 0) || (file >= _files.size()) || !_files[file]->seek(offset)) {
+        return false;
+    }
+    data = _files[file]->read(length);
+    return data.size() == length;
+}
+
+CanTraceSegment::CanTraceSegment()
+  : _spool(0),
+    _file(-1),
+    _count(0)
+{
+}
+
+bool CanTraceSegment::write(CanTraceSpool &spool, const CanMessage *messages, int count)
+{
+    int chunk_count = (count + chunk_size - 1) / chunk_size;
+
+    // chunk offsets are relative to the start of the segment until it is
+    // appended, with one extra entry marking the end of the last chunk.
+    QVector<qint64> offsets(chunk_count + 1);
+    qint64 pos = 0;
+
+    QList<QByteArray> chunks;
+    for (int i=0; i<chunk_count; i++) {
+        int first = i * chunk_size;
+        int num = qMin((int)chunk_size, count - first);
+        QByteArray raw = QByteArray::fromRawData((const char*)&messages[first], num * sizeof(CanMessage));
+        chunks.append(qCompress(raw, segment_compression_level));
+        offsets[i] = pos;
+        pos += chunks.last().size();
+    }
+    offsets[chunk_count] = pos;
+
+    int file;
+    qint64 base;
+    if (!spool.append(chunks, &file, &base)) {
+        return false;
+    }
+
+    for (int i=0; i<offsets.size(); i++) {
+        offsets[i] += base;
+    }
+
+    _spool = &spool;
+    _file = file;
+    _count = count;
+    _chunkOffsets = offsets;
+    return true;
+}
+
+int CanTraceSegment::size() const
+{
+    return _count;
+}
+
+int CanTraceSegment::chunkCount() const
+{
+    return _chunkOffsets.isEmpty() ? 0 : _chunkOffsets.size() - 1;
+}
+
+qint64 CanTraceSegment::fileSize() const
+{
+    return _chunkOffsets.isEmpty() ? 0 : _chunkOffsets.last() - _chunkOffsets.first();
+}
+
+bool CanTraceSegment::readChunk(int chunk, CanMessage *messages) const
+{
+    if (!_spool || (chunk<0) || (chunk>=chunkCount())) {
+        return false;
+    }
+
+    qint64 offset = _chunkOffsets[chunk];
+    qint64 length = _chunkOffsets[chunk+1] - offset;
+    QByteArray compressed;
+    if (!_spool->read(_file, offset, length, compressed)) {
+        return false;
+    }
+    QByteArray raw = qUncompress(compressed);
+
+    int num = qMin((int)chunk_size, _count - chunk * chunk_size);
+    if (raw.size() != (int)(num * sizeof(CanMessage))) {
+        return false;
+    }
+
+    memcpy((void*)messages, raw.constData(), raw.size());
+    return true;
+}
@@ -0,0 +1,93 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QVector>
+#include <QString>
+
+#include "CanMessage.h"
+
+/*
+ * Append-only storage for sealed trace segments.
+ *
+ * Segments are appended to a few large files in the spool directory, a new
+ * file is started every spool_file_size bytes, so the number of open files
+ * grows with the size of the trace on disk, not with the number of
+ * segments. Files are read with plain reads, nothing is memory mapped.
+ * Appending and reading may run on different threads. The files are
+ * removed when the spool is destroyed.
+ */
+class CanTraceSpool
+{
+public:
+    enum {
+        spool_file_size = 1024*1024*1024
+    };
+
+    explicit CanTraceSpool(const QString &path);
+    ~CanTraceSpool();
+
+    bool append(const QList<QByteArray> &data, int *file, qint64 *offset);
+    bool read(int file, qint64 offset, qint64 length, QByteArray &data);
+
+    QString path() const;
+
+private:
+    QString _path;
+    QMutex _mutex;
+    QList<QFile*> _files;
+};
+
+/*
+ * A sealed, read-only block of trace messages spilled to disk.
+ *
+ * Messages are stored in chunks of chunk_size messages, each chunk
+ * compressed individually so that single chunks can be decompressed on
+ * demand. The segment only holds the index of its chunks in the spool,
+ * the data stays on disk until the spool is destroyed.
+ */
+class CanTraceSegment
+{
+public:
+    enum {
+        chunk_size = 1024
+    };
+
+    CanTraceSegment();
+
+    bool write(CanTraceSpool &spool, const CanMessage *messages, int count);
+
+    int size() const;
+    int chunkCount() const;
+    qint64 fileSize() const;
+
+    bool readChunk(int chunk, CanMessage *messages) const;
+
+private:
+    CanTraceSpool *_spool;
+    int _file;
+    int _count;
+    QVector<qint64> _chunkOffsets;
+};
@@ -0,0 +1,412 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "CanTriggerCapture.h"
+
+#include <sys/time.h>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QTimer>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QStringList>
+
+#include <core/Backend.h>
+#include <core/CanDb.h>
+#include <core/CanDbMessage.h>
+#include <core/CanDbSignal.h>
+#include <core/MeasurementSetup.h>
+#include <core/MeasurementNetwork.h>
+
+static uint64_t timestamp_us(const CanMessage &msg)
+{
+    struct timeval tv = msg.getTimestamp();
+    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static uint64_t now_us()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+CanTriggerCondition::CanTriggerCondition()
+  : _type(condition_error_frame),
+    _rawId(0),
+    _startBit(0),
+    _length(0),
+    _isBigEndian(false),
+    _isUnsigned(true),
+    _factor(1),
+    _offset(0),
+    _isMuxed(false),
+    _muxStartBit(0),
+    _muxLength(0),
+    _muxIsBigEndian(false),
+    _muxValue(0),
+    _compare(compare_gt),
+    _threshold(0)
+{
+}
+
+bool CanTriggerCondition::parse(Backend &backend, const QString &text, QString *errorMessage)
+{
+    QStringList args = text.simplified().split(' ', Qt::SkipEmptyParts);
+    QString error;
+
+    if (args.isEmpty()) {
+        error = QObject::tr("empty condition");
+    } else if (args[0] == "frame") {
+        _type = condition_frame;
+        if ((args.size() != 2) || !_matcher.parse(args[1])) {
+            error = QObject::tr("expected: frame ID[/MASK][:PATTERN]");
+        }
+    } else if (args[0] == "error") {
+        _type = condition_error_frame;
+    } else if (args[0] == "signal") {
+        _type = condition_signal;
+
+        static const char *ops[] = { ">", ">=", "<", "<=", "==", "!=" };
+        int op = -1;
+        bool ok = (args.size() == 4);
+        for (int i=0; ok && i<6; i++) {
+            if (args[2] == ops[i]) { op = i; }
+        }
+        double threshold = ok ? args[3].toDouble(&ok) : 0;
+        QStringList names = ok ? args[1].split('.') : QStringList();
+
+        CanDbMessage *dbmsg = 0;
+        CanDbSignal *signal = 0;
+        if (names.size() == 2) {
+            foreach (MeasurementNetwork *network, backend.getSetup().getNetworks()) {
+                foreach (pCanDb db, network->_canDbs) {
+                    foreach (CanDbMessage *m, db->getMessages()) {
+                        if (!signal && (m->getName() == names[0])) {
+                            dbmsg = m;
+                            signal = m->getSignalByName(names[1]);
+                        }
+                    }
+                }
+            }
+        }
+
+        if (!ok || (op < 0)) {
+            error = QObject::tr("expected: signal Message.Signal <op> <value>");
+        } else if (!signal) {
+            error = QObject::tr("unknown signal '%1'").arg(args[1]);
+        } else {
+            _compare = (compare_t)op;
+            _threshold = threshold;
+            _rawId = dbmsg->getRaw_id();
+            _startBit = signal->startBit();
+            _length = signal->length();
+            _isBigEndian = signal->isBigEndian();
+            _isUnsigned = signal->isUnsigned();
+            _factor = signal->getFactor();
+            _offset = signal->getOffset();
+            _isMuxed = signal->isMuxed();
+            CanDbSignal *muxer = dbmsg->getMuxer();
+            if (_isMuxed && muxer) {
+                _muxStartBit = muxer->startBit();
+                _muxLength = muxer->length();
+                _muxIsBigEndian = muxer->isBigEndian();
+                _muxValue = signal->getMuxValue();
+            } else if (_isMuxed) {
+                error = QObject::tr("signal '%1' is multiplexed, but message has no multiplexer").arg(args[1]);
+            }
+        }
+    } else {
+        error = QObject::tr("unknown condition '%1'").arg(args[0]);
+    }
+
+    if (!error.isEmpty()) {
+        if (errorMessage) {
+            *errorMessage = error;
+        }
+        return false;
+    }
+
+    _text = text.simplified();
+    return true;
+}
+
+QString CanTriggerCondition::getText() const
+{
+    return _text;
+}
+
+bool CanTriggerCondition::matches(const CanMessage &msg) const
+{
+    switch (_type) {
+        case condition_frame:
+            return !msg.isErrorFrame() && _matcher.matches(msg);
+
+        case condition_error_frame:
+            return msg.isErrorFrame();
+
+        case condition_signal: {
+            if ((msg.getRawId() != _rawId) || ((_startBit + _length) > (8 * msg.getLength()))) {
+                return false;
+            }
+            if (_isMuxed && (msg.extractRawSignal(_muxStartBit, _muxLength, _muxIsBigEndian) != _muxValue)) {
+                return false;
+            }
+
+            uint64_t raw = msg.extractRawSignal(_startBit, _length, _isBigEndian);
+            double value;
+            if (_isUnsigned) {
+                value = raw * _factor + _offset;
+            } else {
+                int64_t v = (int64_t)(raw << (64 - _length));
+                v >>= (64 - _length);
+                value = v * _factor + _offset;
+            }
+
+            switch (_compare) {
+                case compare_gt: return value > _threshold;
+                case compare_ge: return value >= _threshold;
+                case compare_lt: return value < _threshold;
+                case compare_le: return value <= _threshold;
+                case compare_eq: return value == _threshold;
+                case compare_ne: return value != _threshold;
+            }
+            return false;
+        }
+    }
+    return false;
+}
+
+
+class CaptureWriter : public QRunnable
+{
+public:
+    CaptureWriter(CanTriggerCapture *capture, QString filename, QVector<CanMessage> frames, QHash<CanInterfaceId, QString> names)
+      : _capture(capture), _filename(filename), _frames(frames), _names(names)
+    {
+    }
+
+    virtual void run()
+    {
+        QFile file(_filename);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+            log_error(QObject::tr("Cannot write trigger capture %1: %2").arg(_filename, file.errorString()));
+            return;
+        }
+
+        // same format as CanTrace::saveCanDump()
+        QTextStream stream(&file);
+        foreach (const CanMessage &msg, _frames) {
+            QString line;
+            line.append(QString().asprintf("(%.6f) ", msg.getFloatTimestamp()));
+            line.append(_names.value(msg.getInterfaceId()));
+            if (msg.isExtended()) {
+                line.append(QString().asprintf(" %08X#", msg.getId()));
+            } else {
+                line.append(QString().asprintf(" %03X#", msg.getId()));
+            }
+            for (int i=0; i<msg.getLength(); i++) {
+                line.append(QString().asprintf("%02X", msg.getByte(i)));
+            }
+            stream << line << Qt::endl;
+        }
+        file.close();
+
+        log_info(QObject::tr("Trigger capture written to %1 (%2 frames)").arg(_filename).arg(_frames.size()));
+        emit _capture->captureWritten(_filename);
+    }
+
+private:
+    CanTriggerCapture *_capture;
+    QString _filename;
+    QVector<CanMessage> _frames;
+    QHash<CanInterfaceId, QString> _names;
+};
+
+
+CanTriggerCapture::CanTriggerCapture(Backend &backend, QObject *parent)
+  : QObject(parent),
+    _backend(backend),
+    _state(trigger_state_idle),
+    _observing(false),
+    _ringHead(0),
+    _ringCount(0),
+    _triggerTime(0),
+    _triggerWallClock(0),
+    _triggerCount(0)
+{
+    _timer = new QTimer(this);
+    _timer->setInterval(200);
+    connect(_timer, SIGNAL(timeout()), this, SLOT(checkPostTrigger()));
+}
+
+CanTriggerCapture::~CanTriggerCapture()
+{
+    disarm();
+}
+
+bool CanTriggerCapture::arm(const CanTriggerCaptureConfig &config)
+{
+    disarm();
+
+    if (config.conditions.isEmpty() || (config.bufferSize <= 0) || !QDir(config.directory).exists()) {
+        return false;
+    }
+
+    QMutexLocker locker(&_mutex);
+    _config = config;
+    _ring.resize(config.bufferSize);
+    _ringHead = 0;
+    _ringCount = 0;
+    _capture.clear();
+    _triggerCount = 0;
+    _state = trigger_state_armed;
+
+    _interfaceNames.clear();
+    foreach (CanInterfaceId ifid, _backend.getInterfaceList()) {
+        _interfaceNames[ifid] = _backend.getInterfaceName(ifid);
+    }
+    locker.unlock();
+
+    _observing = true;
+    _backend.addRxObserver(this);
+    _timer->start();
+    return true;
+}
+
+void CanTriggerCapture::disarm()
+{
+    if (_observing) {
+        _backend.removeRxObserver(this);
+        _observing = false;
+    }
+    _timer->stop();
+
+    QMutexLocker locker(&_mutex);
+    if (_state == trigger_state_capturing) {
+        // keep what we have so far
+        finishCapture();
+    }
+    _state = trigger_state_idle;
+    _ring.clear();
+    _ring.squeeze();
+    _ringCount = 0;
+}
+
+trigger_state_t CanTriggerCapture::getState()
+{
+    QMutexLocker locker(&_mutex);
+    return _state;
+}
+
+int CanTriggerCapture::getTriggerCount()
+{
+    QMutexLocker locker(&_mutex);
+    return _triggerCount;
+}
+
+QString CanTriggerCapture::getLastFileName()
+{
+    QMutexLocker locker(&_mutex);
+    return _lastFileName;
+}
+
+void CanTriggerCapture::messagesReceived(CanInterfaceId interface, const QList<CanMessage> &msgs)
+{
+    (void) interface;
+
+    QMutexLocker locker(&_mutex);
+    if (_state == trigger_state_idle) {
+        return;
+    }
+
+    int size = _ring.size();
+
+    foreach (const CanMessage &msg, msgs) {
+        _ring[_ringHead] = msg;
+        _ringHead = (_ringHead + 1) % size;
+        if (_ringCount < size) {
+            _ringCount++;
+        }
+
+        if (_state == trigger_state_capturing) {
+            if ((timestamp_us(msg) > _triggerTime + _config.postTriggerUs) || (_capture.size() >= size)) {
+                finishCapture();
+            } else {
+                _capture.append(msg);
+                continue;
+            }
+        }
+
+        if (_state != trigger_state_armed) {
+            continue;
+        }
+
+        foreach (const CanTriggerCondition &condition, _config.conditions) {
+            if (!condition.matches(msg)) {
+                continue;
+            }
+
+            _state = trigger_state_capturing;
+            _triggerTime = timestamp_us(msg);
+            _triggerWallClock = now_us();
+            _triggerText = condition.getText();
+            _triggerCount++;
+
+            // copy the pre-trigger window out of the ring, the trigger frame included
+            uint64_t start = (_triggerTime > _config.preTriggerUs) ? (_triggerTime - _config.preTriggerUs) : 0;
+            int first = _ringCount;
+            while ((first > 0) && (timestamp_us(_ring[(_ringHead - first + size) % size]) < start)) {
+                first--;
+            }
+            _capture.clear();
+            _capture.reserve(first);
+            for (int i=first; i>0; i--) {
+                _capture.append(_ring[(_ringHead - i + size) % size]);
+            }
+            break;
+        }
+    }
+}
+
+void CanTriggerCapture::checkPostTrigger()
+{
+    QMutexLocker locker(&_mutex);
+
+    // if the bus went quiet after the trigger, no frame will close the capture. use the wall clock.
+    if ((_state == trigger_state_capturing) && (now_us() > _triggerWallClock + _config.postTriggerUs + 500000)) {
+        finishCapture();
+    }
+}
+
+void CanTriggerCapture::finishCapture()
+{
+    QDateTime dt = QDateTime::fromMSecsSinceEpoch(_triggerTime / 1000);
+    QString filename = QDir(_config.directory).filePath(QString("capture-%1.log").arg(dt.toString("yyyyMMdd-HHmmss-zzz")));
+
+    log_info(tr("Trigger '%1' fired, writing %2 frames").arg(_triggerText).arg(_capture.size()));
+    QThreadPool::globalInstance()->start(new CaptureWriter(this, filename, _capture, _interfaceNames));
+
+    _capture = QVector<CanMessage>();
+    _lastFileName = filename;
+    _state = _config.rearm ? trigger_state_armed : trigger_state_idle;
+}
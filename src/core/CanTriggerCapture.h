@@ -0,0 +1,162 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <QObject>
+#include <QMutex>
+#include <QVector>
+#include <QList>
+#include <QHash>
+#include <QString>
+
+#include <core/CanMessage.h>
+#include <core/CanFrameMatcher.h>
+#include <core/CanRxObserver.h>
+
+class Backend;
+class QTimer;
+
+/*
+ * A trigger condition, compiled once so it can be evaluated for every
+ * frame on the listener thread. Text form, one condition per line:
+ *
+ *   frame ID[/MASK][:PATTERN]            see CanFrameMatcher
+ *   error                                any error frame
+ *   signal Message.Signal <op> <value>   op is one of > >= < <= == !=
+ */
+class CanTriggerCondition
+{
+public:
+    CanTriggerCondition();
+
+    bool parse(Backend &backend, const QString &text, QString *errorMessage=0);
+    QString getText() const;
+
+    bool matches(const CanMessage &msg) const;
+
+private:
+    typedef enum {
+        condition_frame,
+        condition_error_frame,
+        condition_signal
+    } condition_type_t;
+
+    typedef enum {
+        compare_gt,
+        compare_ge,
+        compare_lt,
+        compare_le,
+        compare_eq,
+        compare_ne
+    } compare_t;
+
+    condition_type_t _type;
+    QString _text;
+
+    CanFrameMatcher _matcher;
+
+    uint32_t _rawId;
+    uint8_t _startBit;
+    uint8_t _length;
+    bool _isBigEndian;
+    bool _isUnsigned;
+    double _factor;
+    double _offset;
+    bool _isMuxed;
+    uint8_t _muxStartBit;
+    uint8_t _muxLength;
+    bool _muxIsBigEndian;
+    uint64_t _muxValue;
+    compare_t _compare;
+    double _threshold;
+};
+
+typedef struct {
+    QList<CanTriggerCondition> conditions;  // any of them triggers
+    uint64_t preTriggerUs;
+    uint64_t postTriggerUs;
+    int bufferSize;                         // frames kept for the pre-trigger window
+    QString directory;
+    bool rearm;
+} CanTriggerCaptureConfig;
+
+typedef enum {
+    trigger_state_idle,
+    trigger_state_armed,
+    trigger_state_capturing
+} trigger_state_t;
+
+/*
+ * Keeps the most recent frames in a fixed ring buffer and evaluates the
+ * trigger conditions inline, on the listener threads. When a condition
+ * fires, the pre-trigger part of the ring is copied out, frames are
+ * collected until the post-trigger time has passed and the capture is
+ * written to a candump log file on the global thread pool. With rearm
+ * set, the trigger is armed again right away.
+ */
+class CanTriggerCapture : public QObject, public CanRxObserver
+{
+    Q_OBJECT
+
+public:
+    explicit CanTriggerCapture(Backend &backend, QObject *parent=0);
+    virtual ~CanTriggerCapture();
+
+    bool arm(const CanTriggerCaptureConfig &config);
+    void disarm();
+
+    trigger_state_t getState();
+    int getTriggerCount();
+    QString getLastFileName();
+
+    virtual void messagesReceived(CanInterfaceId interface, const QList<CanMessage> &msgs);
+
+signals:
+    void captureWritten(QString filename);
+
+private slots:
+    void checkPostTrigger();
+
+private:
+    Backend &_backend;
+    QMutex _mutex;
+    CanTriggerCaptureConfig _config;
+    trigger_state_t _state;
+    bool _observing;
+
+    QVector<CanMessage> _ring;
+    int _ringHead;
+    int _ringCount;
+
+    QVector<CanMessage> _capture;
+    uint64_t _triggerTime;
+    uint64_t _triggerWallClock;
+    QString _triggerText;
+    int _triggerCount;
+    QString _lastFileName;
+    QHash<CanInterfaceId, QString> _interfaceNames;
+
+    QTimer *_timer;
+
+    void finishCapture();
+};
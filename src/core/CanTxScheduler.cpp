@@ -0,0 +1,535 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "CanTxScheduler.h"
+
+#include <algorithm>
+#include <sys/time.h>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+
+#include <core/Backend.h>
+#include <driver/CanInterface.h>
+
+#if defined(__linux__)
+#include <time.h>
+#include <errno.h>
+#include <sys/prctl.h>
+#endif
+
+enum {
+    default_spin_us = 50,
+    coarse_wait_threshold_ns = 2000000
+};
+
+struct heap_later {
+    template <class T> bool operator()(const T &a, const T &b) const
+    {
+        return a.deadline > b.deadline;
+    }
+};
+
+
+CanTxSchedulerThread::CanTxSchedulerThread(CanInterface &intf)
+  : QThread(0),
+    _intf(intf),
+    _shouldBeRunning(false),
+    _spinNs(default_spin_us * 1000)
+{
+}
+
+CanTxSchedulerThread::~CanTxSchedulerThread()
+{
+    stopScheduling();
+}
+
+void CanTxSchedulerThread::schedule(int handle, entry_t &entry, uint64_t deadline)
+{
+    entry.deadline = deadline;
+    entry.generation++;
+    if (entry.enabled) {
+        heap_node_t node;
+        node.deadline = deadline;
+        node.handle = handle;
+        node.generation = entry.generation;
+        _heap.append(node);
+        std::push_heap(_heap.begin(), _heap.end(), heap_later());
+    }
+    _cond.wakeAll();
+}
+
+void CanTxSchedulerThread::addEntry(int handle, const CanMessage &msg, uint32_t period_us, bool enabled, pCanDbMessageEncoder encoder)
+{
+    QMutexLocker locker(&_mutex);
+    entry_t entry;
+    entry.msg.cloneFrom(msg);
+    entry.encoder = encoder;
+    entry.period_ns = (uint64_t)qMax(period_us, (uint32_t)1) * 1000;
+    entry.deadline = 0;
+    entry.enabled = enabled;
+    entry.generation = 0;
+    entry.stats.sent = 0;
+    entry.stats.overruns = 0;
+    entry.stats.latenessSumNs = 0;
+    entry.stats.latenessMaxNs = 0;
+    _entries.insert(handle, entry);
+    schedule(handle, _entries[handle], CanTxScheduler::monotonicNs() + entry.period_ns);
+}
+
+bool CanTxSchedulerThread::updateMessage(int handle, const CanMessage &msg)
+{
+    QMutexLocker locker(&_mutex);
+    if (!_entries.contains(handle)) {
+        return false;
+    }
+    _entries[handle].msg.cloneFrom(msg);
+    return true;
+}
+
+bool CanTxSchedulerThread::setPeriod(int handle, uint32_t period_us)
+{
+    QMutexLocker locker(&_mutex);
+    if (!_entries.contains(handle)) {
+        return false;
+    }
+    entry_t &entry = _entries[handle];
+    entry.period_ns = (uint64_t)qMax(period_us, (uint32_t)1) * 1000;
+    schedule(handle, entry, CanTxScheduler::monotonicNs() + entry.period_ns);
+    return true;
+}
+
+bool CanTxSchedulerThread::setEnabled(int handle, bool enabled)
+{
+    QMutexLocker locker(&_mutex);
+    if (!_entries.contains(handle)) {
+        return false;
+    }
+    entry_t &entry = _entries[handle];
+    if (entry.enabled != enabled) {
+        entry.enabled = enabled;
+        schedule(handle, entry, CanTxScheduler::monotonicNs() + entry.period_ns);
+    }
+    return true;
+}
+
+bool CanTxSchedulerThread::removeEntry(int handle)
+{
+    // stale heap nodes are skipped by the scheduler loop
+    QMutexLocker locker(&_mutex);
+    return _entries.remove(handle) > 0;
+}
+
+bool CanTxSchedulerThread::getStats(int handle, CanTxCyclicStats &stats)
+{
+    QMutexLocker locker(&_mutex);
+    if (!_entries.contains(handle)) {
+        return false;
+    }
+    stats = _entries[handle].stats;
+    return true;
+}
+
+bool CanTxSchedulerThread::getMessage(int handle, CanMessage &msg)
+{
+    QMutexLocker locker(&_mutex);
+    if (!_entries.contains(handle)) {
+        return false;
+    }
+    msg.cloneFrom(_entries[handle].msg);
+    return true;
+}
+
+uint32_t CanTxSchedulerThread::getPeriod(int handle)
+{
+    QMutexLocker locker(&_mutex);
+    return _entries.contains(handle) ? _entries[handle].period_ns / 1000 : 0;
+}
+
+bool CanTxSchedulerThread::isEnabled(int handle)
+{
+    QMutexLocker locker(&_mutex);
+    return _entries.contains(handle) ? _entries[handle].enabled : false;
+}
+
+int CanTxSchedulerThread::count()
+{
+    QMutexLocker locker(&_mutex);
+    return _entries.count();
+}
+
+void CanTxSchedulerThread::setSpinTime(uint32_t spin_us)
+{
+    QMutexLocker locker(&_mutex);
+    _spinNs = spin_us * 1000;
+}
+
+void CanTxSchedulerThread::startScheduling()
+{
+    if (isRunning()) {
+        return;
+    }
+
+    {
+        // restart all deadlines relative to now, so we don't send a burst
+        // of overdue messages from a previous measurement.
+        QMutexLocker locker(&_mutex);
+        _heap.clear();
+        uint64_t now = CanTxScheduler::monotonicNs();
+        QHash<int, entry_t>::iterator it;
+        for (it=_entries.begin(); it!=_entries.end(); ++it) {
+            schedule(it.key(), it.value(), now + it.value().period_ns);
+        }
+        _shouldBeRunning = true;
+    }
+
+    start(QThread::TimeCriticalPriority);
+}
+
+void CanTxSchedulerThread::stopScheduling()
+{
+    {
+        QMutexLocker locker(&_mutex);
+        _shouldBeRunning = false;
+        _cond.wakeAll();
+    }
+    wait();
+}
+
+void CanTxSchedulerThread::run()
+{
+#if defined(__linux__)
+    // we do our own sleeping with absolute deadlines, don't let the kernel
+    // coalesce our wakeups with others.
+    prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+#endif
+
+    QVector<CanMessage> due;
+    QMutexLocker locker(&_mutex);
+
+    while (_shouldBeRunning) {
+
+        if (_heap.isEmpty()) {
+            _cond.wait(&_mutex);
+            continue;
+        }
+
+        const heap_node_t &top = _heap.first();
+        if (!_entries.contains(top.handle) || (_entries[top.handle].generation != top.generation)) {
+            // entry was removed or rescheduled, drop the stale node
+            std::pop_heap(_heap.begin(), _heap.end(), heap_later());
+            _heap.removeLast();
+            continue;
+        }
+
+        uint64_t deadline = top.deadline;
+        uint64_t now = CanTxScheduler::monotonicNs();
+
+        if (deadline > now + _spinNs + coarse_wait_threshold_ns) {
+            // far away: wait on the condition so changes to the schedule wake us up
+            unsigned long wait_ms = (deadline - now - _spinNs - coarse_wait_threshold_ns/2) / 1000000;
+            _cond.wait(&_mutex, qMax(wait_ms, 1UL));
+            continue;
+        }
+
+        if (deadline > now) {
+            uint32_t spin_ns = _spinNs;
+            locker.unlock();
+            if (deadline > now + spin_ns) {
+                CanTxScheduler::sleepUntilNs(deadline - spin_ns);
+            }
+            while (CanTxScheduler::monotonicNs() < deadline) {
+                // spin for the last few microseconds
+            }
+            locker.relock();
+            if (!_shouldBeRunning) {
+                break;
+            }
+        }
+
+        // collect everything that is due now
+        now = CanTxScheduler::monotonicNs();
+        due.clear();
+        while (!_heap.isEmpty() && (_heap.first().deadline <= now)) {
+            heap_node_t node = _heap.first();
+            std::pop_heap(_heap.begin(), _heap.end(), heap_later());
+            _heap.removeLast();
+
+            if (!_entries.contains(node.handle)) {
+                continue;
+            }
+            entry_t &entry = _entries[node.handle];
+            if ((entry.generation != node.generation) || !entry.enabled) {
+                continue;
+            }
+
+            uint64_t lateness = now - node.deadline;
+            entry.stats.sent++;
+            entry.stats.latenessSumNs += lateness;
+            if (lateness > entry.stats.latenessMaxNs) {
+                entry.stats.latenessMaxNs = qMin(lateness, (uint64_t)0xFFFFFFFF);
+            }
+
+            if (entry.encoder) {
+                // signal-level messages are re-encoded every cycle (counters, checksums)
+                entry.encoder->encode(entry.msg);
+            }
+            due.append(entry.msg);
+
+            // advance on the absolute grid. if we missed whole periods, skip them
+            uint64_t next = node.deadline + entry.period_ns;
+            if (next <= now) {
+                uint64_t missed = (now - node.deadline) / entry.period_ns;
+                entry.stats.overruns += missed;
+                next = node.deadline + (missed + 1) * entry.period_ns;
+            }
+            entry.deadline = next;
+            heap_node_t again;
+            again.deadline = next;
+            again.handle = node.handle;
+            again.generation = entry.generation;
+            _heap.append(again);
+            std::push_heap(_heap.begin(), _heap.end(), heap_later());
+        }
+
+        if (!due.isEmpty()) {
+            locker.unlock();
+            if (_intf.isOpen()) {
+                struct timeval tv;
+                gettimeofday(&tv, NULL);
+                for (int i=0; i<due.size(); i++) {
+                    due[i].setTimestamp(tv);
+                    _intf.sendMessage(due[i]);
+                }
+            }
+            locker.relock();
+        }
+    }
+}
+
+
+CanTxScheduler::CanTxScheduler(Backend &backend, QObject *parent)
+  : QObject(parent),
+    _backend(backend),
+    _nextHandle(1),
+    _spinUs(default_spin_us),
+    _isRunning(false)
+{
+}
+
+CanTxScheduler::~CanTxScheduler()
+{
+    stop();
+    qDeleteAll(_threads);
+}
+
+CanTxSchedulerThread *CanTxScheduler::getThread(int handle)
+{
+    if (!_handles.contains(handle)) {
+        return 0;
+    }
+    return _threads.value(_handles[handle], 0);
+}
+
+int CanTxScheduler::addCyclicMessage(CanInterfaceId interface, const CanMessage &msg, uint32_t period_us, bool enabled)
+{
+    return addCyclicDbMessage(interface, msg, pCanDbMessageEncoder(), period_us, enabled);
+}
+
+int CanTxScheduler::addCyclicDbMessage(CanInterfaceId interface, const CanMessage &msg, pCanDbMessageEncoder encoder, uint32_t period_us, bool enabled)
+{
+    int handle;
+    {
+        QMutexLocker locker(&_mutex);
+
+        CanTxSchedulerThread *thread = _threads.value(interface, 0);
+        if (!thread) {
+            CanInterface *intf = _backend.getInterfaceById(interface);
+            if (!intf) {
+                return -1;
+            }
+            thread = new CanTxSchedulerThread(*intf);
+            thread->setSpinTime(_spinUs);
+            _threads.insert(interface, thread);
+            if (_isRunning) {
+                thread->startScheduling();
+            }
+        }
+
+        handle = _nextHandle++;
+        _handles.insert(handle, interface);
+        thread->addEntry(handle, msg, period_us, enabled, encoder);
+    }
+
+    emit cyclicMessagesChanged();
+    return handle;
+}
+
+bool CanTxScheduler::updateCyclicMessage(int handle, const CanMessage &msg)
+{
+    QMutexLocker locker(&_mutex);
+    CanTxSchedulerThread *thread = getThread(handle);
+    return thread ? thread->updateMessage(handle, msg) : false;
+}
+
+bool CanTxScheduler::setCyclicPeriod(int handle, uint32_t period_us)
+{
+    QMutexLocker locker(&_mutex);
+    CanTxSchedulerThread *thread = getThread(handle);
+    return thread ? thread->setPeriod(handle, period_us) : false;
+}
+
+bool CanTxScheduler::setCyclicEnabled(int handle, bool enabled)
+{
+    QMutexLocker locker(&_mutex);
+    CanTxSchedulerThread *thread = getThread(handle);
+    return thread ? thread->setEnabled(handle, enabled) : false;
+}
+
+bool CanTxScheduler::removeCyclicMessage(int handle)
+{
+    bool retval = false;
+    {
+        QMutexLocker locker(&_mutex);
+        CanTxSchedulerThread *thread = getThread(handle);
+        if (thread) {
+            retval = thread->removeEntry(handle);
+            _handles.remove(handle);
+        }
+    }
+
+    if (retval) {
+        emit cyclicMessagesChanged();
+    }
+    return retval;
+}
+
+void CanTxScheduler::removeAll()
+{
+    {
+        QMutexLocker locker(&_mutex);
+        foreach (int handle, _handles.keys()) {
+            CanTxSchedulerThread *thread = getThread(handle);
+            if (thread) {
+                thread->removeEntry(handle);
+            }
+        }
+        _handles.clear();
+    }
+    emit cyclicMessagesChanged();
+}
+
+QList<int> CanTxScheduler::getHandles()
+{
+    QMutexLocker locker(&_mutex);
+    return _handles.keys();
+}
+
+CanInterfaceId CanTxScheduler::getInterfaceId(int handle)
+{
+    QMutexLocker locker(&_mutex);
+    return _handles.value(handle, 0);
+}
+
+bool CanTxScheduler::getCyclicMessage(int handle, CanMessage &msg)
+{
+    QMutexLocker locker(&_mutex);
+    CanTxSchedulerThread *thread = getThread(handle);
+    return thread ? thread->getMessage(handle, msg) : false;
+}
+
+uint32_t CanTxScheduler::getCyclicPeriod(int handle)
+{
+    QMutexLocker locker(&_mutex);
+    CanTxSchedulerThread *thread = getThread(handle);
+    return thread ? thread->getPeriod(handle) : 0;
+}
+
+bool CanTxScheduler::isCyclicEnabled(int handle)
+{
+    QMutexLocker locker(&_mutex);
+    CanTxSchedulerThread *thread = getThread(handle);
+    return thread ? thread->isEnabled(handle) : false;
+}
+
+bool CanTxScheduler::getCyclicStats(int handle, CanTxCyclicStats &stats)
+{
+    QMutexLocker locker(&_mutex);
+    CanTxSchedulerThread *thread = getThread(handle);
+    return thread ? thread->getStats(handle, stats) : false;
+}
+
+void CanTxScheduler::setSpinTime(uint32_t spin_us)
+{
+    QMutexLocker locker(&_mutex);
+    _spinUs = spin_us;
+    foreach (CanTxSchedulerThread *thread, _threads) {
+        thread->setSpinTime(spin_us);
+    }
+}
+
+void CanTxScheduler::start()
+{
+    QMutexLocker locker(&_mutex);
+    _isRunning = true;
+    foreach (CanTxSchedulerThread *thread, _threads) {
+        thread->startScheduling();
+    }
+}
+
+void CanTxScheduler::stop()
+{
+    QMutexLocker locker(&_mutex);
+    _isRunning = false;
+    foreach (CanTxSchedulerThread *thread, _threads) {
+        thread->stopScheduling();
+    }
+}
+
+uint64_t CanTxScheduler::monotonicNs()
+{
+#if defined(__linux__)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#else
+    static QElapsedTimer timer;
+    if (!timer.isValid()) {
+        timer.start();
+    }
+    return timer.nsecsElapsed();
+#endif
+}
+
+void CanTxScheduler::sleepUntilNs(uint64_t deadline)
+{
+#if defined(__linux__)
+    struct timespec ts;
+    ts.tv_sec = deadline / 1000000000ULL;
+    ts.tv_nsec = deadline % 1000000000ULL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, 0) == EINTR) {
+    }
+#else
+    uint64_t now = monotonicNs();
+    if (deadline > now) {
+        QThread::usleep((deadline - now) / 1000);
+    }
+#endif
+}
@@ -0,0 +1,147 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+#include <QMap>
+#include <QVector>
+#include <QList>
+
+#include <core/CanMessage.h>
+#include <core/CanDbMessageEncoder.h>
+#include <driver/CanDriver.h>
+
+class CanInterface;
+class Backend;
+
+typedef struct {
+    uint64_t sent;
+    uint64_t overruns;
+    uint64_t latenessSumNs;
+    uint32_t latenessMaxNs;
+} CanTxCyclicStats;
+
+class CanTxSchedulerThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    explicit CanTxSchedulerThread(CanInterface &intf);
+    virtual ~CanTxSchedulerThread();
+
+    void addEntry(int handle, const CanMessage &msg, uint32_t period_us, bool enabled, pCanDbMessageEncoder encoder);
+    bool updateMessage(int handle, const CanMessage &msg);
+    bool setPeriod(int handle, uint32_t period_us);
+    bool setEnabled(int handle, bool enabled);
+    bool removeEntry(int handle);
+    bool getStats(int handle, CanTxCyclicStats &stats);
+    bool getMessage(int handle, CanMessage &msg);
+    uint32_t getPeriod(int handle);
+    bool isEnabled(int handle);
+    int count();
+
+    void setSpinTime(uint32_t spin_us);
+    void startScheduling();
+    void stopScheduling();
+
+protected:
+    virtual void run();
+
+private:
+    typedef struct {
+        CanMessage msg;
+        pCanDbMessageEncoder encoder;
+        uint64_t period_ns;
+        uint64_t deadline;
+        bool enabled;
+        unsigned generation;
+        CanTxCyclicStats stats;
+    } entry_t;
+
+    typedef struct {
+        uint64_t deadline;
+        int handle;
+        unsigned generation;
+    } heap_node_t;
+
+    CanInterface &_intf;
+    QMutex _mutex;
+    QWaitCondition _cond;
+    QHash<int, entry_t> _entries;
+    QVector<heap_node_t> _heap;
+    bool _shouldBeRunning;
+    uint32_t _spinNs;
+
+    void schedule(int handle, entry_t &entry, uint64_t deadline);
+};
+
+class CanTxScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CanTxScheduler(Backend &backend, QObject *parent=0);
+    virtual ~CanTxScheduler();
+
+    int addCyclicMessage(CanInterfaceId interface, const CanMessage &msg, uint32_t period_us, bool enabled=true);
+    int addCyclicDbMessage(CanInterfaceId interface, const CanMessage &msg, pCanDbMessageEncoder encoder, uint32_t period_us, bool enabled=true);
+    bool updateCyclicMessage(int handle, const CanMessage &msg);
+    bool setCyclicPeriod(int handle, uint32_t period_us);
+    bool setCyclicEnabled(int handle, bool enabled);
+    bool removeCyclicMessage(int handle);
+    void removeAll();
+
+    QList<int> getHandles();
+    CanInterfaceId getInterfaceId(int handle);
+    bool getCyclicMessage(int handle, CanMessage &msg);
+    uint32_t getCyclicPeriod(int handle);
+    bool isCyclicEnabled(int handle);
+    bool getCyclicStats(int handle, CanTxCyclicStats &stats);
+
+    void setSpinTime(uint32_t spin_us);
+
+    static uint64_t monotonicNs();
+    static void sleepUntilNs(uint64_t deadline);
+
+public slots:
+    void start();
+    void stop();
+
+signals:
+    void cyclicMessagesChanged();
+
+private:
+    Backend &_backend;
+    QMutex _mutex;
+    QMap<CanInterfaceId, CanTxSchedulerThread*> _threads;
+    QMap<int, CanInterfaceId> _handles;
+    int _nextHandle;
+    uint32_t _spinUs;
+    bool _isRunning;
+
+    CanTxSchedulerThread *getThread(int handle);
+};
@@ -0,0 +1,270 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "CanTxSequence.h"
+
+#include <QObject>
+#include <QFile>
+#include <QHash>
+#include <QStringList>
+#include <QPair>
+
+CanTxSequence::CanTxSequence()
+{
+}
+
+bool CanTxSequence::parse(const QString &text, QString *errorMessage)
+{
+    QList<CanTxSequenceStep> steps;
+    QHash<QString, int> labels;
+    QList<QPair<int, QString> > fixups; // step index, label to resolve
+
+    QStringList lines = text.split('\n');
+    for (int lineNo=0; lineNo<lines.size(); lineNo++) {
+        QString line = lines[lineNo];
+        // '#' also separates ID and data in frames, only a leading or space-separated one starts a comment
+        for (int i=0; i<line.length(); i++) {
+            if ((line[i] == '#') && ((i == 0) || line[i-1].isSpace())) {
+                line.truncate(i);
+                break;
+            }
+        }
+
+        QStringList args = line.simplified().split(' ', Qt::SkipEmptyParts);
+        if (args.isEmpty()) {
+            continue;
+        }
+
+        QString error;
+        QString cmd = args[0].toLower();
+
+        CanTxSequenceStep step;
+        step.time_us = 0;
+        step.rxId = 0;
+        step.rxMask = 0;
+        step.rxExtended = false;
+        step.target = -1;
+        step.count = 0;
+        step.line = lineNo + 1;
+
+        if (cmd.endsWith(':') && (args.size() == 1)) {
+            labels[args[0].left(args[0].length()-1)] = steps.size();
+            continue;
+        } else if (cmd == "send") {
+            step.type = sequence_step_send;
+            if ((args.size() != 2) || !parseFrame(args[1], step.msg)) {
+                error = QObject::tr("invalid frame");
+            }
+        } else if (cmd == "wait") {
+            bool ok = (args.size() == 2);
+            step.type = sequence_step_wait;
+            step.time_us = ok ? args[1].toULongLong(&ok) : 0;
+            if (!ok) {
+                error = QObject::tr("expected: wait <us>");
+            }
+        } else if (cmd == "waitrx") {
+            bool ok = (args.size() == 4) || (args.size() == 5);
+            step.type = sequence_step_wait_rx;
+            if (ok) { ok = parseId(args[1], &step.rxId, &step.rxExtended); }
+            if (ok) { step.rxMask = args[2].toUInt(&ok, 16); }
+            if (ok) { step.time_us = args[3].toULongLong(&ok); }
+            if (!ok) {
+                error = QObject::tr("expected: waitrx <id> <mask> <timeout_us> [label]");
+            } else if (args.size() == 5) {
+                fixups.append(qMakePair(steps.size(), args[4]));
+            }
+        } else if (cmd == "loop") {
+            bool ok = (args.size() == 3);
+            step.type = sequence_step_loop;
+            step.count = ok ? args[2].toInt(&ok) : 0;
+            if (!ok || step.count < 0) {
+                error = QObject::tr("expected: loop <label> <count>");
+            } else {
+                fixups.append(qMakePair(steps.size(), args[1]));
+            }
+        } else {
+            error = QObject::tr("unknown command '%1'").arg(args[0]);
+        }
+
+        if (!error.isEmpty()) {
+            if (errorMessage) {
+                *errorMessage = QObject::tr("line %1: %2").arg(lineNo + 1).arg(error);
+            }
+            return false;
+        }
+
+        steps.append(step);
+    }
+
+    for (int i=0; i<fixups.size(); i++) {
+        CanTxSequenceStep &step = steps[fixups[i].first];
+        if (!labels.contains(fixups[i].second)) {
+            if (errorMessage) {
+                *errorMessage = QObject::tr("line %1: unknown label '%2'").arg(step.line).arg(fixups[i].second);
+            }
+            return false;
+        }
+        step.target = labels[fixups[i].second];
+    }
+
+    _steps = steps;
+    _text = text;
+    return true;
+}
+
+bool CanTxSequence::loadFile(const QString &filename, QString *errorMessage)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (errorMessage) {
+            *errorMessage = file.errorString();
+        }
+        return false;
+    }
+    return parse(QString::fromUtf8(file.readAll()), errorMessage);
+}
+
+const QList<CanTxSequenceStep> &CanTxSequence::getSteps() const
+{
+    return _steps;
+}
+
+QString CanTxSequence::getText() const
+{
+    return _text;
+}
+
+bool CanTxSequence::isEmpty() const
+{
+    return _steps.isEmpty();
+}
+
+bool CanTxSequence::parseId(const QString &str, uint32_t *id, bool *extended)
+{
+    bool ok;
+    uint32_t value = str.toUInt(&ok, 16);
+    if (!ok) {
+        return false;
+    }
+
+    if (str.length() == 3) {
+        *extended = false;
+        ok = (value <= 0x7FF);
+    } else if (str.length() == 8) {
+        *extended = true;
+        ok = (value <= 0x1FFFFFFF);
+    } else {
+        ok = false;
+    }
+
+    *id = value;
+    return ok;
+}
+
+bool CanTxSequence::parseFrame(const QString &str, CanMessage &msg)
+{
+    int sep = str.indexOf('#');
+    if (sep < 0) {
+        return false;
+    }
+
+    uint32_t id;
+    bool extended;
+    if (!parseId(str.left(sep), &id, &extended)) {
+        return false;
+    }
+
+    QString data = str.mid(sep + 1);
+    bool fd = false;
+    bool brs = false;
+    bool rtr = false;
+
+    if (data.startsWith('#')) {
+        // CAN FD: flags nibble, then data
+        if (data.length() < 2) {
+            return false;
+        }
+        bool ok;
+        int flags = data.mid(1, 1).toInt(&ok, 16);
+        if (!ok) {
+            return false;
+        }
+        fd = true;
+        brs = (flags & 0x01) != 0;
+        data = data.mid(2);
+    } else if (data.compare("R", Qt::CaseInsensitive) == 0) {
+        rtr = true;
+        data.clear();
+    }
+
+    data.remove('.');
+    if ((data.length() % 2) != 0) {
+        return false;
+    }
+
+    int length = data.length() / 2;
+    static const int fd_lengths[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+    bool valid = false;
+    for (unsigned i=0; i<sizeof(fd_lengths)/sizeof(fd_lengths[0]); i++) {
+        if ((fd_lengths[i] == length) && (fd || (length <= 8))) {
+            valid = true;
+        }
+    }
+    if (!valid) {
+        return false;
+    }
+
+    msg.setId(id);
+    msg.setExtended(extended);
+    msg.setRTR(rtr);
+    msg.setErrorFrame(false);
+    msg.setFD(fd);
+    msg.setBRS(brs);
+    msg.setLength(length);
+    for (int i=0; i<length; i++) {
+        bool ok;
+        msg.setDataAt(i, data.mid(2*i, 2).toUInt(&ok, 16));
+        if (!ok) {
+            return false;
+        }
+    }
+    msg.setRX(false);
+    msg.setShow(true);
+    return true;
+}
+
+QString CanTxSequence::formatFrame(const CanMessage &msg)
+{
+    QString str = QString("%1").arg(msg.getId(), msg.isExtended() ? 8 : 3, 16, QChar('0')).toUpper();
+
+    if (msg.isFD()) {
+        str += QString("##%1").arg(msg.isBRS() ? 1 : 0);
+    } else if (msg.isRTR()) {
+        return str + "#R";
+    } else {
+        str += "#";
+    }
+
+    for (int i=0; i<msg.getLength(); i++) {
+        str += QString("%1").arg(msg.getByte(i), 2, 16, QChar('0')).toUpper();
+    }
+    return str;
+}
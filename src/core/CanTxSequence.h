@@ -0,0 +1,81 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <QString>
+#include <QList>
+
+#include <core/CanMessage.h>
+
+typedef enum {
+    sequence_step_send,
+    sequence_step_wait,
+    sequence_step_wait_rx,
+    sequence_step_loop
+} sequence_step_type_t;
+
+typedef struct {
+    sequence_step_type_t type;
+    CanMessage msg;         // send
+    uint64_t time_us;       // wait: delay, wait_rx: timeout
+    uint32_t rxId;          // wait_rx
+    uint32_t rxMask;        // wait_rx
+    bool rxExtended;        // wait_rx
+    int target;             // wait_rx: step on timeout (-1: abort), loop: first step of loop
+    int count;              // loop: number of repetitions, 0 for endless
+    int line;               // source line, for status display
+} CanTxSequenceStep;
+
+/*
+ * A list of transmit steps, parsed from a plain text script:
+ *
+ *   # comment
+ *   label:
+ *   send <frame>                              frame in cansend notation, e.g. 7E0#0210010000000000,
+ *                                             18DAF110#1122, 123#R, 123##1112233 (FD, flags nibble first)
+ *   wait <us>                                 relative to the previous wait, so loops do not drift
+ *   waitrx <id> <mask> <timeout_us> [label]   wait for a received frame; on timeout jump to label or abort
+ *   loop <label> <count>                      jump back to label count times (0: forever)
+ *
+ * IDs with three digits are standard, with eight digits extended.
+ */
+class CanTxSequence
+{
+public:
+    CanTxSequence();
+
+    bool parse(const QString &text, QString *errorMessage=0);
+    bool loadFile(const QString &filename, QString *errorMessage=0);
+
+    const QList<CanTxSequenceStep> &getSteps() const;
+    QString getText() const;
+    bool isEmpty() const;
+
+    static bool parseFrame(const QString &str, CanMessage &msg);
+    static QString formatFrame(const CanMessage &msg);
+    static bool parseId(const QString &str, uint32_t *id, bool *extended);
+
+private:
+    QList<CanTxSequenceStep> _steps;
+    QString _text;
+};
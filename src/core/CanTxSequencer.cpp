@@ -0,0 +1,349 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "CanTxSequencer.h"
+
+#include <sys/time.h>
+#include <QVector>
+
+#include <core/Backend.h>
+#include <core/CanTxScheduler.h>
+#include <core/Log.h>
+#include <driver/CanInterface.h>
+
+// waits longer than this are done on the condition variable so stop() is responsive
+static const uint64_t coarse_wait_threshold_ns = 2000000;
+
+// if the time line falls behind by more than this (e.g. a blocking send), restart it from now
+static const uint64_t resync_threshold_ns = 100000000;
+
+CanTxSequencerThread::CanTxSequencerThread(Backend &backend, CanInterface &intf)
+  : QThread(),
+    _backend(backend),
+    _intf(intf),
+    _shouldBeRunning(false),
+    _rxArmed(false),
+    _rxMatched(false),
+    _rxMatchNs(0),
+    _rxId(0),
+    _rxMask(0),
+    _rxExtended(false)
+{
+    _state.running = false;
+    _state.step = -1;
+    _state.line = 0;
+    _state.framesSent = 0;
+    _state.rxMatched = 0;
+    _state.rxTimeouts = 0;
+}
+
+CanTxSequencerThread::~CanTxSequencerThread()
+{
+    stopSequence();
+}
+
+bool CanTxSequencerThread::startSequence(const CanTxSequence &sequence)
+{
+    stopSequence();
+
+    if (sequence.isEmpty()) {
+        return false;
+    }
+
+    QMutexLocker locker(&_mutex);
+    _sequence = sequence;
+    _shouldBeRunning = true;
+    _rxArmed = false;
+    _state.running = true;
+    _state.step = -1;
+    _state.line = 0;
+    _state.framesSent = 0;
+    _state.rxMatched = 0;
+    _state.rxTimeouts = 0;
+    _state.error.clear();
+    locker.unlock();
+
+    start(QThread::TimeCriticalPriority);
+    return true;
+}
+
+void CanTxSequencerThread::stopSequence()
+{
+    {
+        QMutexLocker locker(&_mutex);
+        _shouldBeRunning = false;
+        _cond.wakeAll();
+    }
+    wait();
+}
+
+CanTxSequencerState CanTxSequencerThread::getState()
+{
+    QMutexLocker locker(&_mutex);
+    return _state;
+}
+
+void CanTxSequencerThread::messagesReceived(CanInterfaceId interface, const QList<CanMessage> &msgs)
+{
+    if (interface != _intf.getId()) {
+        return;
+    }
+
+    QMutexLocker locker(&_mutex);
+    if (!_rxArmed || _rxMatched) {
+        return;
+    }
+
+    foreach (const CanMessage &msg, msgs) {
+        if (msg.isRX() && (msg.isExtended() == _rxExtended) && (((msg.getId() ^ _rxId) & _rxMask) == 0)) {
+            _rxMatched = true;
+            _rxMatchNs = CanTxScheduler::monotonicNs();
+            _cond.wakeAll();
+            break;
+        }
+    }
+}
+
+void CanTxSequencerThread::armRx(const CanTxSequenceStep &step)
+{
+    QMutexLocker locker(&_mutex);
+    _rxId = step.rxId;
+    _rxMask = step.rxMask;
+    _rxExtended = step.rxExtended;
+    _rxMatched = false;
+    _rxArmed = true;
+}
+
+bool CanTxSequencerThread::sleepUntil(uint64_t deadline)
+{
+    QMutexLocker locker(&_mutex);
+    while (_shouldBeRunning) {
+        uint64_t now = CanTxScheduler::monotonicNs();
+        if (deadline <= now) {
+            return true;
+        }
+        if (deadline - now > coarse_wait_threshold_ns) {
+            _cond.wait(&_mutex, (deadline - now - coarse_wait_threshold_ns/2) / 1000000);
+            continue;
+        }
+        locker.unlock();
+        CanTxScheduler::sleepUntilNs(deadline);
+        locker.relock();
+    }
+    return false;
+}
+
+void CanTxSequencerThread::setStep(int step)
+{
+    QMutexLocker locker(&_mutex);
+    _state.step = step;
+    _state.line = _sequence.getSteps()[step].line;
+}
+
+void CanTxSequencerThread::run()
+{
+    _backend.addRxObserver(this);
+
+    const QList<CanTxSequenceStep> steps = _sequence.getSteps();
+    QVector<int> loopRemaining(steps.size(), -1);
+    uint64_t timeline = CanTxScheduler::monotonicNs();
+    QString error;
+    int pc = 0;
+
+    while ((pc >= 0) && (pc < steps.size()) && error.isEmpty()) {
+        {
+            QMutexLocker locker(&_mutex);
+            if (!_shouldBeRunning) {
+                break;
+            }
+        }
+
+        setStep(pc);
+        const CanTxSequenceStep &step = steps[pc];
+
+        if (step.type == sequence_step_send) {
+            if (!_intf.isOpen()) {
+                error = tr("interface %1 is not open").arg(_intf.getName());
+                break;
+            }
+
+            // arm the receive match before sending, so a fast response is not missed
+            if ((pc+1 < steps.size()) && (steps[pc+1].type == sequence_step_wait_rx)) {
+                armRx(steps[pc+1]);
+            }
+
+            CanMessage msg = step.msg;
+            struct timeval tv;
+            gettimeofday(&tv, NULL);
+            msg.setTimestamp(tv);
+            msg.setInterfaceId(_intf.getId());
+            _intf.sendMessage(msg);
+
+            QMutexLocker locker(&_mutex);
+            _state.framesSent++;
+            pc++;
+
+        } else if (step.type == sequence_step_wait) {
+            timeline += step.time_us * 1000;
+            uint64_t now = CanTxScheduler::monotonicNs();
+            if (timeline + resync_threshold_ns < now) {
+                timeline = now;
+            }
+            if (!sleepUntil(timeline)) {
+                break;
+            }
+            pc++;
+
+        } else if (step.type == sequence_step_wait_rx) {
+            QMutexLocker locker(&_mutex);
+            if (!_rxArmed) {
+                locker.unlock();
+                armRx(step);
+                locker.relock();
+            }
+
+            uint64_t deadline = CanTxScheduler::monotonicNs() + step.time_us * 1000;
+            while (_shouldBeRunning && !_rxMatched) {
+                uint64_t now = CanTxScheduler::monotonicNs();
+                if (now >= deadline) {
+                    break;
+                }
+                _cond.wait(&_mutex, (deadline - now) / 1000000 + 1);
+            }
+            _rxArmed = false;
+
+            if (!_shouldBeRunning) {
+                break;
+            }
+
+            if (_rxMatched) {
+                _state.rxMatched++;
+                timeline = _rxMatchNs;
+                pc++;
+            } else {
+                _state.rxTimeouts++;
+                timeline = CanTxScheduler::monotonicNs();
+                if (step.target >= 0) {
+                    pc = step.target;
+                } else {
+                    error = tr("timeout waiting for %1 on line %2").arg(step.rxId, 0, 16).arg(step.line);
+                }
+            }
+
+        } else if (step.type == sequence_step_loop) {
+            if (loopRemaining[pc] < 0) {
+                loopRemaining[pc] = step.count;
+            }
+
+            if (step.count == 0) {
+                pc = step.target;
+            } else if (loopRemaining[pc] > 0) {
+                loopRemaining[pc]--;
+                pc = step.target;
+            } else {
+                // done, re-arm the counter for the next time we get here (nested loops)
+                loopRemaining[pc] = -1;
+                pc++;
+            }
+        }
+    }
+
+    _backend.removeRxObserver(this);
+
+    QMutexLocker locker(&_mutex);
+    _state.running = false;
+    _state.error = error;
+    _rxArmed = false;
+    locker.unlock();
+
+    if (!error.isEmpty()) {
+        log_warning(tr("Sequence on %1 stopped: %2").arg(_intf.getName(), error));
+    }
+}
+
+
+CanTxSequencer::CanTxSequencer(Backend &backend, QObject *parent)
+  : QObject(parent),
+    _backend(backend)
+{
+}
+
+CanTxSequencer::~CanTxSequencer()
+{
+    stopAll();
+    qDeleteAll(_threads);
+}
+
+bool CanTxSequencer::start(CanInterfaceId interface, const CanTxSequence &sequence)
+{
+    CanInterface *intf = _backend.getInterfaceById(interface);
+    if (!intf) {
+        return false;
+    }
+
+    CanTxSequencerThread *thread = _threads.value(interface, 0);
+    if (!thread) {
+        thread = new CanTxSequencerThread(_backend, *intf);
+        connect(thread, SIGNAL(finished()), this, SLOT(threadFinished()));
+        _threads[interface] = thread;
+    }
+
+    return thread->startSequence(sequence);
+}
+
+void CanTxSequencer::stop(CanInterfaceId interface)
+{
+    CanTxSequencerThread *thread = _threads.value(interface, 0);
+    if (thread) {
+        thread->stopSequence();
+    }
+}
+
+void CanTxSequencer::stopAll()
+{
+    foreach (CanTxSequencerThread *thread, _threads) {
+        thread->stopSequence();
+    }
+}
+
+bool CanTxSequencer::isRunning(CanInterfaceId interface)
+{
+    CanTxSequencerThread *thread = _threads.value(interface, 0);
+    return thread && thread->getState().running;
+}
+
+bool CanTxSequencer::getState(CanInterfaceId interface, CanTxSequencerState &state)
+{
+    CanTxSequencerThread *thread = _threads.value(interface, 0);
+    if (!thread) {
+        return false;
+    }
+    state = thread->getState();
+    return true;
+}
+
+void CanTxSequencer::threadFinished()
+{
+    CanTxSequencerThread *thread = qobject_cast<CanTxSequencerThread*>(sender());
+    if (thread) {
+        emit sequenceFinished(_threads.key(thread));
+    }
+}
@@ -0,0 +1,116 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QMap>
+
+#include <core/CanTxSequence.h>
+#include <core/CanRxObserver.h>
+#include <driver/CanDriver.h>
+
+class Backend;
+class CanInterface;
+
+typedef struct {
+    bool running;
+    int step;
+    int line;
+    uint64_t framesSent;
+    uint64_t rxMatched;
+    uint64_t rxTimeouts;
+    QString error;
+} CanTxSequencerState;
+
+class CanTxSequencerThread : public QThread, public CanRxObserver
+{
+    Q_OBJECT
+
+public:
+    explicit CanTxSequencerThread(Backend &backend, CanInterface &intf);
+    virtual ~CanTxSequencerThread();
+
+    bool startSequence(const CanTxSequence &sequence);
+    void stopSequence();
+    CanTxSequencerState getState();
+
+    virtual void messagesReceived(CanInterfaceId interface, const QList<CanMessage> &msgs);
+
+protected:
+    virtual void run();
+
+private:
+    Backend &_backend;
+    CanInterface &_intf;
+    CanTxSequence _sequence;
+
+    QMutex _mutex;
+    QWaitCondition _cond;
+    bool _shouldBeRunning;
+    CanTxSequencerState _state;
+
+    bool _rxArmed;
+    bool _rxMatched;
+    uint64_t _rxMatchNs;
+    uint32_t _rxId;
+    uint32_t _rxMask;
+    bool _rxExtended;
+
+    void armRx(const CanTxSequenceStep &step);
+    bool sleepUntil(uint64_t deadline);
+    void setStep(int step);
+};
+
+/*
+ * Plays transmit sequences (see CanTxSequence), one per interface, each on
+ * its own thread. Waits are kept on an absolute time line, so the spacing
+ * between frames does not depend on how long a send took.
+ */
+class CanTxSequencer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CanTxSequencer(Backend &backend, QObject *parent=0);
+    virtual ~CanTxSequencer();
+
+    bool start(CanInterfaceId interface, const CanTxSequence &sequence);
+    void stop(CanInterfaceId interface);
+    void stopAll();
+
+    bool isRunning(CanInterfaceId interface);
+    bool getState(CanInterfaceId interface, CanTxSequencerState &state);
+
+signals:
+    void sequenceFinished(CanInterfaceId interface);
+
+private slots:
+    void threadFinished();
+
+private:
+    Backend &_backend;
+    QMap<CanInterfaceId, CanTxSequencerThread*> _threads;
+};
@@ -0,0 +1,184 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "HdrHistogram.h"
+
+static int highest_bit(uint64_t value)
+{
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(value);
+#else
+    int bit = 0;
+    while (value >>= 1) {
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+HdrHistogram::HdrHistogram(uint64_t highestTrackableValue, int precisionBits)
+  : _precisionBits(precisionBits),
+    _subBucketCount(1ULL << precisionBits),
+    _totalCount(0),
+    _min(0),
+    _max(0),
+    _sum(0)
+{
+    if (highestTrackableValue < _subBucketCount) {
+        highestTrackableValue = _subBucketCount;
+    }
+    _counts.fill(0, indexOf(highestTrackableValue) + 1);
+}
+
+int HdrHistogram::indexOf(uint64_t value) const
+{
+    if (value < _subBucketCount) {
+        return value;
+    }
+
+    // shift so the value lands in [subBucketCount/2, subBucketCount)
+    int shift = highest_bit(value) - _precisionBits + 1;
+    uint64_t half = _subBucketCount / 2;
+    return _subBucketCount + (shift - 1) * half + ((value >> shift) - half);
+}
+
+void HdrHistogram::record(uint64_t value, uint64_t count)
+{
+    int index = indexOf(value);
+    if (index >= _counts.size()) {
+        index = _counts.size() - 1;
+    }
+    _counts[index] += count;
+
+    if ((_totalCount == 0) || (value < _min)) {
+        _min = value;
+    }
+    if (value > _max) {
+        _max = value;
+    }
+    _totalCount += count;
+    _sum += (double)value * count;
+}
+
+void HdrHistogram::add(const HdrHistogram &other)
+{
+    if (other._totalCount == 0) {
+        return;
+    }
+
+    for (int i=0; i<other._counts.size(); i++) {
+        if (other._counts[i]) {
+            _counts[qMin(i, _counts.size()-1)] += other._counts[i];
+        }
+    }
+
+    if ((_totalCount == 0) || (other._min < _min)) {
+        _min = other._min;
+    }
+    if (other._max > _max) {
+        _max = other._max;
+    }
+    _totalCount += other._totalCount;
+    _sum += other._sum;
+}
+
+void HdrHistogram::reset()
+{
+    _counts.fill(0);
+    _totalCount = 0;
+    _min = 0;
+    _max = 0;
+    _sum = 0;
+}
+
+uint64_t HdrHistogram::getTotalCount() const
+{
+    return _totalCount;
+}
+
+uint64_t HdrHistogram::getMin() const
+{
+    return _min;
+}
+
+uint64_t HdrHistogram::getMax() const
+{
+    return _max;
+}
+
+double HdrHistogram::getMean() const
+{
+    return _totalCount ? (_sum / _totalCount) : 0;
+}
+
+uint64_t HdrHistogram::getValueAtPercentile(double percentile) const
+{
+    if (_totalCount == 0) {
+        return 0;
+    }
+
+    uint64_t target = (uint64_t)((percentile / 100.0) * _totalCount + 0.5);
+    if (target < 1) {
+        target = 1;
+    }
+
+    uint64_t seen = 0;
+    for (int i=0; i<_counts.size(); i++) {
+        seen += _counts[i];
+        if (seen >= target) {
+            // report the highest value equivalent to this bucket, but never beyond what we saw
+            return qBound(_min, getBucketUpperBound(i), _max);
+        }
+    }
+    return _max;
+}
+
+int HdrHistogram::getBucketCount() const
+{
+    return _counts.size();
+}
+
+uint64_t HdrHistogram::getBucketLowerBound(int bucket) const
+{
+    if ((uint64_t)bucket < _subBucketCount) {
+        return bucket;
+    }
+
+    uint64_t half = _subBucketCount / 2;
+    int shift = (bucket - _subBucketCount) / half + 1;
+    uint64_t sub = (bucket - _subBucketCount) % half + half;
+    return sub << shift;
+}
+
+uint64_t HdrHistogram::getBucketUpperBound(int bucket) const
+{
+    if ((uint64_t)bucket < _subBucketCount) {
+        return bucket;
+    }
+
+    int shift = (bucket - _subBucketCount) / (_subBucketCount / 2) + 1;
+    return getBucketLowerBound(bucket) + (1ULL << shift) - 1;
+}
+
+uint64_t HdrHistogram::getCountAt(int bucket) const
+{
+    return _counts.value(bucket, 0);
+}
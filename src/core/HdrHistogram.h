@@ -0,0 +1,66 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <QVector>
+
+/*
+ * Fixed-size log-linear histogram in the spirit of HdrHistogram.
+ *
+ * Values below 2^precision_bits are counted exactly, above that every
+ * power-of-two range is split into 2^(precision_bits-1) equal buckets,
+ * so the relative error stays below 2^-(precision_bits-1). Memory is
+ * allocated once in the constructor and never grows; values above
+ * the highest trackable value are clamped into the last bucket.
+ */
+class HdrHistogram
+{
+public:
+    explicit HdrHistogram(uint64_t highestTrackableValue=60000000, int precisionBits=8);
+
+    void record(uint64_t value, uint64_t count=1);
+    void add(const HdrHistogram &other);
+    void reset();
+
+    uint64_t getTotalCount() const;
+    uint64_t getMin() const;
+    uint64_t getMax() const;
+    double getMean() const;
+    uint64_t getValueAtPercentile(double percentile) const;
+
+    int getBucketCount() const;
+    uint64_t getBucketLowerBound(int bucket) const;
+    uint64_t getBucketUpperBound(int bucket) const;
+    uint64_t getCountAt(int bucket) const;
+
+private:
+    int _precisionBits;
+    uint64_t _subBucketCount;
+    QVector<uint64_t> _counts;
+    uint64_t _totalCount;
+    uint64_t _min;
+    uint64_t _max;
+    double _sum;
+
+    int indexOf(uint64_t value) const;
+};
@@ -23,23 +23,52 @@
 #include "LogModel.h"
 
 LogModel::LogModel(Backend &backend)
+  : _items(max_items),
+    _first(0),
+    _count(0),
+    _lastRepeats(0),
+    _haveLast(false),
+    _lastLevel(log_level_info),
+    _messagesInWindow(0),
+    _suppressed(0)
 {
-    connect(&backend, SIGNAL(onLogMessage(QDateTime,log_level_t,QString)), this, SLOT(onLogMessage(QDateTime,log_level_t,QString)));
+    // Backend::logMessage() hands messages to enqueue() directly
+    (void) backend;
+
+    _rateWindow.start();
+    connect(&_flushTimer, SIGNAL(timeout()), this, SLOT(flush()));
+    _flushTimer.start(flush_interval);
 }
 
 LogModel::~LogModel()
 {
-    qDeleteAll(_items);
-    _items.clear();
 }
 
 void LogModel::clear()
 {
+    {
+        QMutexLocker locker(&_pendingMutex);
+        _pending.clear();
+        _lastRepeats = 0;
+        _haveLast = false;
+    }
+
     beginResetModel();
-    _items.clear();
+    _first = 0;
+    _count = 0;
     endResetModel();
 }
 
+const LogItem &LogModel::item(int row) const
+{
+    return _items[(_first + row) % max_items];
+}
+
+LogItem &LogModel::item(int row)
+{
+    return _items[(_first + row) % max_items];
+}
+
 QModelIndex LogModel::index(int row, int column, const QModelIndex &parent) const
 {
     if (parent.isValid()) {
@@ -58,7 +87,7 @@ QModelIndex LogModel::parent(const QModelIndex &child) const
 int LogModel::rowCount(const QModelIndex &parent) const
 {
     (void) parent;
-    return _items.size();
+    return _count;
 }
 
 int LogModel::columnCount(const QModelIndex &parent) const
@@ -125,15 +154,18 @@ QVariant LogModel::data(const QModelIndex &index, int role) const
             return QVariant();
         }
 
-        LogItem *item = _items.value(index.row(), 0);
-        if (item) {
+        if ((index.row() >= 0) && (index.row() < _count)) {
+            const LogItem &it = item(index.row());
             switch (index.column()) {
                 case column_time:
-                    return item->dt.toString("hh:mm:ss");
+                    return it.dt.toString("hh:mm:ss");
                 case column_level:
-                    return logLevelText(item->level);
+                    return logLevelText(it.level);
                 case column_text:
-                    return item->text;
+                    if (it.repeat > 1) {
+                        return tr("%1 (x%2 repeated)").arg(it.text).arg(it.repeat);
+                    }
+                    return it.text;
                 default:
                     return QVariant();
             }
@@ -156,15 +188,97 @@ QVariant LogModel::data(const QModelIndex &index, int role) const
     return QVariant();
 }
 
-void LogModel::onLogMessage(const QDateTime dt, const log_level_t level, const QString msg)
+void LogModel::enqueue(const QDateTime dt, const log_level_t level, const QString msg)
+{
+    QMutexLocker locker(&_pendingMutex);
+
+    if (_haveLast && (level == _lastLevel) && (msg == _lastText)) {
+        if (_pending.isEmpty()) {
+            _lastRepeats++;
+        } else {
+            _pending.last().repeat++;
+        }
+        return;
+    }
+
+    checkRateWindow();
+    if ((_messagesInWindow >= max_messages_per_second) || (_pending.size() >= max_pending)) {
+        _suppressed++;
+        return;
+    }
+    _messagesInWindow++;
+
+    LogItem it;
+    it.dt = dt;
+    it.level = level;
+    it.text = msg;
+    it.repeat = 1;
+    _pending.append(it);
+
+    _haveLast = true;
+    _lastLevel = level;
+    _lastText = msg;
+}
+
+void LogModel::checkRateWindow()
 {
-    LogItem *item = new LogItem();
-    item->dt = dt;
-    item->level = level;
-    item->text = msg;
+    // called with _pendingMutex held
+    if (_rateWindow.elapsed() < 1000) {
+        return;
+    }
+
+    if (_suppressed > 0) {
+        LogItem it;
+        it.dt = QDateTime::currentDateTime();
+        it.level = log_level_warning;
+        it.text = tr("%1 log messages suppressed").arg(_suppressed);
+        it.repeat = 1;
+        _pending.append(it);
+        _haveLast = false;
+    }
+
+    _rateWindow.restart();
+    _messagesInWindow = 0;
+    _suppressed = 0;
+}
+
+void LogModel::flush()
+{
+    QList<LogItem> items;
+    int repeats;
+    {
+        QMutexLocker locker(&_pendingMutex);
+        checkRateWindow();
+        items.swap(_pending);
+        repeats = _lastRepeats;
+        _lastRepeats = 0;
+    }
 
-    beginInsertRows(QModelIndex(), _items.size(), _items.size());
-    _items.append(item);
+    if ((repeats > 0) && (_count > 0)) {
+        item(_count-1).repeat += repeats;
+        emit dataChanged(index(_count-1, 0, QModelIndex()), index(_count-1, column_count-1, QModelIndex()));
+    }
+
+    if (items.isEmpty()) {
+        return;
+    }
+
+    if (items.size() > max_items) {
+        items = items.mid(items.size() - max_items);
+    }
+
+    int overflow = _count + items.size() - max_items;
+    if (overflow > 0) {
+        beginRemoveRows(QModelIndex(), 0, overflow-1);
+        _first = (_first + overflow) % max_items;
+        _count -= overflow;
+        endRemoveRows();
+    }
+
+    beginInsertRows(QModelIndex(), _count, _count + items.size() - 1);
+    foreach (const LogItem &it, items) {
+        item(_count++) = it;
+    }
     endInsertRows();
 }
 
@@ -23,7 +23,11 @@
 
 #include <QAbstractItemModel>
 #include <QDateTime>
+#include <QElapsedTimer>
 #include <QList>
+#include <QMutex>
+#include <QTimer>
+#include <QVector>
 #include <core/Backend.h>
 
 class LogItem {
@@ -31,8 +35,20 @@ public:
     QDateTime dt;
     log_level_t level;
     QString text;
+    int repeat;
 };
 
+/*
+ * The log, kept as a ring of the last max_items messages.
+ *
+ * Messages may come from any thread. They are collected in a pending list
+ * and handed to the views in one batch every flush_interval ms, so a
+ * driver logging per error frame costs one row insert per batch instead
+ * of one queued event and one insert per message. A message equal to the
+ * one before only bumps its repeat count, and more than
+ * max_messages_per_second distinct messages are dropped and summarized.
+ */
+
 class LogModel : public QAbstractItemModel
 {
     Q_OBJECT
@@ -50,6 +66,7 @@ public:
     virtual ~LogModel();
 
     void clear();
+    void enqueue(const QDateTime dt, const log_level_t level, const QString msg);
 
     virtual QModelIndex index(int row, int column, const QModelIndex &parent) const;
     virtual QModelIndex parent(const QModelIndex &child) const;
@@ -61,11 +78,37 @@ public:
     virtual QVariant headerData(int section, Qt::Orientation orientation, int role) const;
     virtual QVariant data(const QModelIndex &index, int role) const;
 
-public slots:
-    void onLogMessage(const QDateTime dt, const log_level_t level, const QString msg);
+private slots:
+    void flush();
 
 private:
-    QList<LogItem*> _items;
+    enum {
+        max_items = 10000,
+        max_pending = 1000,
+        max_messages_per_second = 200,
+        flush_interval = 100
+    };
+
+    // ring of displayed items, oldest at _first
+    QVector<LogItem> _items;
+    int _first;
+    int _count;
+    QTimer _flushTimer;
+
+    // shared with the logging threads
+    QMutex _pendingMutex;
+    QList<LogItem> _pending;
+    int _lastRepeats;          // repeats of the newest displayed item, not yet shown
+    bool _haveLast;
+    log_level_t _lastLevel;
+    QString _lastText;
+    QElapsedTimer _rateWindow;
+    int _messagesInWindow;
+    int _suppressed;
+
+    const LogItem &item(int row) const;
+    LogItem &item(int row);
+    void checkRateWindow();
 
     static QString logLevelText(log_level_t level);
 };
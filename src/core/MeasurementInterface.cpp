@@ -21,6 +21,8 @@
 
 #include "MeasurementInterface.h"
 
+#include <QStringList>
+
 #include <core/Backend.h>
 #include <driver/CanDriver.h>
 #include <driver/CanInterface.h>
@@ -44,7 +46,9 @@ MeasurementInterface::MeasurementInterface()
     _isCustomFdBitrate(false),
 
     _CustomBitrate(0x023407),
-    _CustomFdBitrate(0x011508)
+    _CustomFdBitrate(0x011508),
+
+    _hwFilterMode(hw_filter_off)
 {
 
 }
@@ -72,6 +76,22 @@ bool MeasurementInterface::loadXML(Backend &backend, QDomElement &el)
 
     _CustomBitrate = el.attribute("custom-bitrate", "0").toInt();
     _CustomFdBitrate = el.attribute("custom-fdbitrate", "0").toInt();
+
+    QString mode = el.attribute("hw-filter-mode", "off");
+    if (mode == "manual") {
+        _hwFilterMode = hw_filter_manual;
+    } else if (mode == "dbc") {
+        _hwFilterMode = hw_filter_dbc;
+    } else if (mode == "ids") {
+        _hwFilterMode = hw_filter_ids;
+    } else {
+        _hwFilterMode = hw_filter_off;
+    }
+    _hwFilter = el.attribute("hw-filter");
+    _hwFilterIds.clear();
+    foreach (QString id, el.attribute("hw-filter-ids").split(QChar(' '), Qt::SkipEmptyParts)) {
+        _hwFilterIds.append(id.toUInt(0, 16));
+    }
     return true;
 }
 
@@ -102,6 +122,20 @@ bool MeasurementInterface::saveXML(Backend &backend, QDomDocument &xml, QDomElem
 
     root.setAttribute("custom-bitrate", _CustomBitrate);
     root.setAttribute("custom-fdbitrate", _CustomFdBitrate);
+
+    switch (_hwFilterMode) {
+        case hw_filter_manual: root.setAttribute("hw-filter-mode", "manual"); break;
+        case hw_filter_dbc: root.setAttribute("hw-filter-mode", "dbc"); break;
+        case hw_filter_ids: root.setAttribute("hw-filter-mode", "ids"); break;
+        default: root.setAttribute("hw-filter-mode", "off"); break;
+    }
+    root.setAttribute("hw-filter", _hwFilter);
+
+    QStringList ids;
+    foreach (uint32_t id, _hwFilterIds) {
+        ids.append(QString::number(id, 16));
+    }
+    root.setAttribute("hw-filter-ids", ids.join(QChar(' ')));
     return true;
 }
 
@@ -269,3 +303,33 @@ void MeasurementInterface::setCustomFdBitrate(uint32_t customFdBitrate)
 {
     _CustomFdBitrate = customFdBitrate;
 }
+
+MeasurementInterface::hw_filter_mode_t MeasurementInterface::hwFilterMode() const
+{
+    return _hwFilterMode;
+}
+
+void MeasurementInterface::setHwFilterMode(hw_filter_mode_t mode)
+{
+    _hwFilterMode = mode;
+}
+
+QString MeasurementInterface::hwFilter() const
+{
+    return _hwFilter;
+}
+
+void MeasurementInterface::setHwFilter(QString filter_def)
+{
+    _hwFilter = filter_def;
+}
+
+QList<uint32_t> MeasurementInterface::hwFilterIds() const
+{
+    return _hwFilterIds;
+}
+
+void MeasurementInterface::setHwFilterIds(const QList<uint32_t> &rawIds)
+{
+    _hwFilterIds = rawIds;
+}
@@ -30,6 +30,13 @@ class Backend;
 class MeasurementInterface
 {
 public:
+    typedef enum {
+        hw_filter_off,
+        hw_filter_manual,   // hand-typed definition, see canfilter::parse()
+        hw_filter_dbc,      // messages of the DBCs assigned to the network
+        hw_filter_ids       // IDs picked in the trace view
+    } hw_filter_mode_t;
+
     MeasurementInterface();
 
     CanInterfaceId canInterface() const;
@@ -83,6 +90,16 @@ public:
 
     uint32_t customFdBitrate() const;
     void setCustomFdBitrate(uint32_t customFdBitrate);
+
+    hw_filter_mode_t hwFilterMode() const;
+    void setHwFilterMode(hw_filter_mode_t mode);
+
+    QString hwFilter() const;
+    void setHwFilter(QString filter_def);
+
+    // raw IDs (CanMessage::getRawId()) for hw_filter_ids
+    QList<uint32_t> hwFilterIds() const;
+    void setHwFilterIds(const QList<uint32_t> &rawIds);
 private:
     CanInterfaceId _canif;
 
@@ -106,4 +123,8 @@ private:
 
     uint32_t _CustomBitrate;
     uint32_t _CustomFdBitrate;
+
+    hw_filter_mode_t _hwFilterMode;
+    QString _hwFilter;
+    QList<uint32_t> _hwFilterIds;
 };
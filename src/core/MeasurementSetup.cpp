@@ -27,6 +27,7 @@
 #include <core/CanTrace.h>
 #include <core/CanMessage.h>
 #include <core/MeasurementNetwork.h>
+#include <core/MeasurementInterface.h>
 
 MeasurementSetup::MeasurementSetup(QObject *parent)
   : QObject(parent)
@@ -118,6 +119,18 @@ QString MeasurementSetup::getInterfaceName(const CanInterface &interface) const
     return interface.getName();
 }
 
+MeasurementInterface *MeasurementSetup::findInterface(CanInterfaceId id) const
+{
+    foreach (MeasurementNetwork *network, _networks) {
+        foreach (MeasurementInterface *mi, network->interfaces()) {
+            if (mi->canInterface() == id) {
+                return mi;
+            }
+        }
+    }
+    return 0;
+}
+
 int MeasurementSetup::countNetworks() const
 {
     return _networks.length();
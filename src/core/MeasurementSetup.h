@@ -24,9 +24,11 @@
 #include <QObject>
 #include <QList>
 #include <QDomDocument>
+#include <driver/CanDriver.h>
 
 class Backend;
 class MeasurementNetwork;
+class MeasurementInterface;
 class CanTrace;
 class CanMessage;
 class CanInterface;
@@ -43,6 +45,7 @@ public:
 
     CanDbMessage *findDbMessage(const CanMessage &msg) const;
     QString getInterfaceName(const CanInterface &interface) const;
+    MeasurementInterface *findInterface(CanInterfaceId id) const;
 
     int countNetworks() const;
     MeasurementNetwork *getNetwork(int index) const;
@@ -1,8 +1,27 @@
+# CanStreamServer
+QT += network
+
 SOURCES += \
     $$PWD/Backend.cpp \
     $$PWD/CanMessage.cpp \
     $$PWD/CanTrace.cpp \
+    $$PWD/CanTraceSegment.cpp \
+    $$PWD/CanTxScheduler.cpp \
+    $$PWD/CanLoadGenerator.cpp \
+    $$PWD/CanTxSequence.cpp \
+    $$PWD/CanTxSequencer.cpp \
+    $$PWD/CanFrameMatcher.cpp \
+    $$PWD/CanLatencyAnalyzer.cpp \
+    $$PWD/CanBridge.cpp \
+    $$PWD/CanTriggerCapture.cpp \
+    $$PWD/CanStreamRecorder.cpp \
+    $$PWD/CanStreamServer.cpp \
+    $$PWD/CanTraceFilter.cpp \
+    $$PWD/CanTraceScanner.cpp \
+    $$PWD/CanMetrics.cpp \
+    $$PWD/HdrHistogram.cpp \
     $$PWD/CanDbMessage.cpp \
+    $$PWD/CanDbMessageEncoder.cpp \
     $$PWD/CanDb.cpp \
     $$PWD/CanDbNode.cpp \
     $$PWD/CanDbSignal.cpp \
@@ -10,7 +29,6 @@ SOURCES += \
     $$PWD/MeasurementNetwork.cpp \
     $$PWD/MeasurementInterface.cpp \
     $$PWD/LogModel.cpp \
-    $$PWD/ConfigurableWidget.cpp \
     $$PWD/Log.cpp
 
 HEADERS += \
@@ -18,7 +36,24 @@ HEADERS += \
     $$PWD/Backend.h \
     $$PWD/CanMessage.h \
     $$PWD/CanTrace.h \
+    $$PWD/CanTraceSegment.h \
+    $$PWD/CanTxScheduler.h \
+    $$PWD/CanLoadGenerator.h \
+    $$PWD/CanTxSequence.h \
+    $$PWD/CanTxSequencer.h \
+    $$PWD/CanRxObserver.h \
+    $$PWD/CanFrameMatcher.h \
+    $$PWD/CanLatencyAnalyzer.h \
+    $$PWD/CanBridge.h \
+    $$PWD/CanTriggerCapture.h \
+    $$PWD/CanStreamRecorder.h \
+    $$PWD/CanStreamServer.h \
+    $$PWD/CanTraceFilter.h \
+    $$PWD/CanTraceScanner.h \
+    $$PWD/CanMetrics.h \
+    $$PWD/HdrHistogram.h \
     $$PWD/CanDbMessage.h \
+    $$PWD/CanDbMessageEncoder.h \
     $$PWD/CanDb.h \
     $$PWD/CanDbNode.h \
     $$PWD/CanDbSignal.h \
@@ -26,5 +61,10 @@ HEADERS += \
     $$PWD/MeasurementNetwork.h \
     $$PWD/MeasurementInterface.h \
     $$PWD/LogModel.h \
-    $$PWD/ConfigurableWidget.h \
     $$PWD/Log.h
+
+# ConfigurableWidget needs QtWidgets, leave it out of the command-line build
+!headless {
+    SOURCES += $$PWD/ConfigurableWidget.cpp
+    HEADERS += $$PWD/ConfigurableWidget.h
+}
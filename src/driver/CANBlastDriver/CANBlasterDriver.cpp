@@ -23,7 +23,9 @@
 #include "CANBlasterDriver.h"
 #include "CANBlasterInterface.h"
 #include <core/Backend.h>
+#ifndef CANGAROO_HEADLESS
 #include <driver/GenericCanSetupPage.h>
+#endif
 
 #include <errno.h>
 #include <cstring>
@@ -41,9 +43,12 @@
 
 CANBlasterDriver::CANBlasterDriver(Backend &backend)
   : CanDriver(backend),
-    setupPage(new GenericCanSetupPage())
+    setupPage(0)
 {
+#ifndef CANGAROO_HEADLESS
+    setupPage = new GenericCanSetupPage();
     QObject::connect(&backend, SIGNAL(onSetupDialogCreated(SetupDialog&)), setupPage, SLOT(onSetupDialogCreated(SetupDialog&)));
+#endif
 }
 
 CANBlasterDriver::~CANBlasterDriver() {
@@ -69,6 +69,21 @@ class canfilter {
     // Add extended range
     virtual canfilter_error_t add_ext_range(uint32_t start, uint32_t end) = 0;
 
+    // Add standard id/mask pair, accepts every id with (id & mask) equal
+    // Only controllers with mask filters implement these
+    virtual canfilter_error_t add_std_mask(uint32_t id, uint32_t mask) {
+        (void)id;
+        (void)mask;
+        return CANFILTER_ERROR_PARAM;
+    }
+
+    // Add extended id/mask pair
+    virtual canfilter_error_t add_ext_mask(uint32_t id, uint32_t mask) {
+        (void)id;
+        (void)mask;
+        return CANFILTER_ERROR_PARAM;
+    }
+
     // Finalize filter configuration
     virtual canfilter_error_t end() = 0;
 
@@ -78,8 +78,9 @@ canfilter_error_t canfilter_bxcan<max_banks_t, dev_val>::emit_std_mask(uint32_t
     if (id1 > max_std_id || mask1 > max_std_id || id2 > max_std_id || mask2 > max_std_id)
         return CANFILTER_ERROR_PARAM;
 
-    uint32_t fr1 = (mask1 << 21) | (id1 << 5);
-    uint32_t fr2 = (mask2 << 21) | (id2 << 5);
+    /* mask includes IDE, or extended frames with matching STID pass too */
+    uint32_t fr1 = (mask1 << 21) | (0x1U << 19) | (id1 << 5);
+    uint32_t fr2 = (mask2 << 21) | (0x1U << 19) | (id2 << 5);
 
     hw_config.fr1[bank] = fr1;
     hw_config.fr2[bank] = fr2;
@@ -128,8 +129,9 @@ canfilter_error_t canfilter_bxcan<max_banks_t, dev_val>::emit_ext_mask(uint32_t
     if (id1 > max_ext_id || mask1 > max_ext_id)
         return CANFILTER_ERROR_PARAM;
 
+    /* mask includes IDE, or standard frames with matching STID pass too */
     uint32_t fr1 = (id1 << 3) | (0x1U << 2);
-    uint32_t fr2 = (mask1 << 3);
+    uint32_t fr2 = (mask1 << 3) | (0x1U << 2);
 
     hw_config.fr1[bank] = fr1;
     hw_config.fr2[bank] = fr2;
@@ -57,6 +57,8 @@ template <uint8_t max_banks_t, uint8_t dev_val> class canfilter_bxcan : public c
     canfilter_error_t add_ext_id(uint32_t id) override;
     canfilter_error_t add_std_range(uint32_t begin, uint32_t end) override;
     canfilter_error_t add_ext_range(uint32_t begin, uint32_t end) override;
+    canfilter_error_t add_std_mask(uint32_t id, uint32_t mask) override;
+    canfilter_error_t add_ext_mask(uint32_t id, uint32_t mask) override;
     canfilter_error_t end() override;
 
     void *get_hw_config() override;
@@ -95,11 +97,9 @@ template <uint8_t max_banks_t, uint8_t dev_val> class canfilter_bxcan : public c
     canfilter_error_t emit_ext_list(uint32_t id1, uint32_t id2);
     canfilter_error_t emit_ext_mask(uint32_t id1, uint32_t mask1);
 
-    // Add to list or mask
+    // Add to list
     canfilter_error_t add_std_list(uint32_t id);
-    canfilter_error_t add_std_mask(uint32_t id, uint32_t mask);
     canfilter_error_t add_ext_list(uint32_t id);
-    canfilter_error_t add_ext_mask(uint32_t id, uint32_t mask);
 };
 
 // bxCAN for STM32F0/F1/F3 (14 banks)
@@ -0,0 +1,374 @@
+/*
+ * canfilter_emu.cpp
+ *
+ * Software model of the bxCAN and FDCAN acceptance filters.
+ *
+ * Responsibilities:
+ * - Decode a hardware image into a list of matching rules per frame type.
+ * - Match identifiers the way the controller does, including the bits the
+ *   image leaves as don't care.
+ * - Compare the emulated filter with the wanted IDs and count misses and
+ *   unwanted accepts.
+ *
+ * Notes:
+ * - Only data frames are modelled; RTR is 0 in every frame word.
+ * - FDCAN: the global filter is assumed to reject non-matching frames and
+ *   the extended ID and mask (XIDAM) to be all ones, as the firmware sets
+ *   them when a filter is loaded. "Set priority" elements do not store the
+ *   frame and count as rejecting.
+ * - Sampled extended checks are deterministic for a given seed and thread
+ *   count.
+ */
+
+#include "canfilter_emu.hpp"
+#include "canfilter_bxcan.hpp"
+#include "canfilter_fdcan.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+
+// hex formatting macro
+#define FORMAT_HEX(val, width)                                                                                         \
+    "0x" << std::hex << std::setw(width) << std::setfill('0') << (val) << std::dec << std::setfill(' ')
+
+// FDCAN filter element configuration
+#define FEC_DISABLE 0x0U
+#define FEC_REJECT 0x3U
+#define FEC_PRIORITY 0x4U
+
+// FDCAN filter types
+#define FT_RANGE 0x0U
+#define FT_DUAL 0x1U
+#define FT_CLASSIC 0x2U
+#define FT_RANGE_NO_XIDAM 0x3U // extended only, disabled for standard
+
+// Frame as the bxCAN filter sees it in a 32-bit bank
+static uint32_t bxcan_word32(bool ext, uint32_t id) {
+    return ext ? (id << 3) | (0x1U << 2) : id << 21;
+}
+
+// Frame as the bxCAN filter sees it in a 16-bit bank: STID, RTR, IDE, EXID[17:15]
+static uint32_t bxcan_word16(bool ext, uint32_t id) {
+    return ext ? ((id >> 18) << 5) | (0x1U << 3) | ((id >> 15) & 0x7U) : id << 5;
+}
+
+static const char *dev_name(canfilter_hardware_t dev) {
+    switch (dev) {
+    case CANFILTER_DEV_BXCAN_F0:
+        return "bxcan f0";
+    case CANFILTER_DEV_BXCAN_F4:
+        return "bxcan f4";
+    case CANFILTER_DEV_FDCAN_G0:
+        return "fdcan g0";
+    case CANFILTER_DEV_FDCAN_H7:
+        return "fdcan h7";
+    case CANFILTER_DEV_NONE:
+    default:
+        return "none";
+    }
+}
+
+template <typename builder_t> bool canfilter_emu::load_bxcan(const void *config, size_t size) {
+    typename builder_t::hw_t hw;
+    if (size != sizeof(hw))
+        return false;
+    std::memcpy(&hw, config, sizeof(hw));
+
+    for (uint32_t bank = 0; bank < builder_t::max_banks; bank++) {
+        uint32_t bit = 1U << bank;
+        if (!(hw.fa1r & bit))
+            continue;
+
+        bool list = hw.fm1r & bit;
+        std::vector<rule_t> bank_rules;
+        if (hw.fs1r & bit) {
+            if (list) {
+                bank_rules.push_back({rule_bx32, false, hw.fr1[bank], 0xFFFFFFFFU});
+                bank_rules.push_back({rule_bx32, false, hw.fr2[bank], 0xFFFFFFFFU});
+            } else {
+                bank_rules.push_back({rule_bx32, false, hw.fr1[bank] & hw.fr2[bank], hw.fr2[bank]});
+            }
+        } else {
+            uint32_t lo1 = hw.fr1[bank] & 0xFFFFU, hi1 = hw.fr1[bank] >> 16;
+            uint32_t lo2 = hw.fr2[bank] & 0xFFFFU, hi2 = hw.fr2[bank] >> 16;
+            if (list) {
+                bank_rules.push_back({rule_bx16, false, lo1, 0xFFFFU});
+                bank_rules.push_back({rule_bx16, false, hi1, 0xFFFFU});
+                bank_rules.push_back({rule_bx16, false, lo2, 0xFFFFU});
+                bank_rules.push_back({rule_bx16, false, hi2, 0xFFFFU});
+            } else {
+                bank_rules.push_back({rule_bx16, false, lo1 & hi1, hi1});
+                bank_rules.push_back({rule_bx16, false, lo2 & hi2, hi2});
+            }
+        }
+
+        // every bank sees both frame types
+        std_rules.insert(std_rules.end(), bank_rules.begin(), bank_rules.end());
+        ext_rules.insert(ext_rules.end(), bank_rules.begin(), bank_rules.end());
+    }
+    return true;
+}
+
+template <typename builder_t> bool canfilter_emu::load_fdcan(const void *config, size_t size) {
+    typename builder_t::hw_t hw;
+    if (size != sizeof(hw))
+        return false;
+    std::memcpy(&hw, config, sizeof(hw));
+
+    size_t max_std = sizeof(hw.std_filter) / sizeof(hw.std_filter[0]);
+    size_t max_ext = sizeof(hw.ext_filter) / sizeof(hw.ext_filter[0]);
+    if (hw.std_filter_nbr > max_std || hw.ext_filter_nbr > max_ext)
+        return false;
+
+    for (uint32_t i = 0; i < hw.std_filter_nbr; i++) {
+        uint32_t sf = hw.std_filter[i];
+        uint32_t sft = sf >> 30;
+        uint32_t sfec = (sf >> 27) & 0x7U;
+        uint32_t id1 = (sf >> 16) & canfilter::max_std_id;
+        uint32_t id2 = sf & canfilter::max_std_id;
+        if (sfec == FEC_DISABLE || sft == FT_RANGE_NO_XIDAM)
+            continue;
+
+        bool reject = (sfec == FEC_REJECT) || (sfec == FEC_PRIORITY);
+        if (sft == FT_RANGE)
+            std_rules.push_back({rule_range, reject, id1, id2});
+        else if (sft == FT_DUAL)
+            std_rules.push_back({rule_dual, reject, id1, id2});
+        else
+            std_rules.push_back({rule_mask, reject, id1, id2});
+    }
+
+    for (uint32_t i = 0; i < hw.ext_filter_nbr; i++) {
+        uint32_t f0 = hw.ext_filter[i][0];
+        uint32_t f1 = hw.ext_filter[i][1];
+        uint32_t efec = f0 >> 29;
+        uint32_t eft = f1 >> 30;
+        uint32_t id1 = f0 & canfilter::max_ext_id;
+        uint32_t id2 = f1 & canfilter::max_ext_id;
+        if (efec == FEC_DISABLE)
+            continue;
+
+        bool reject = (efec == FEC_REJECT) || (efec == FEC_PRIORITY);
+        if (eft == FT_RANGE || eft == FT_RANGE_NO_XIDAM)
+            ext_rules.push_back({rule_range, reject, id1, id2});
+        else if (eft == FT_DUAL)
+            ext_rules.push_back({rule_dual, reject, id1, id2});
+        else
+            ext_rules.push_back({rule_mask, reject, id1, id2});
+    }
+    return true;
+}
+
+bool canfilter_emu::load(const void *config, size_t size) {
+    dev = CANFILTER_DEV_NONE;
+    std_rules.clear();
+    ext_rules.clear();
+    if (!config || size < 1)
+        return false;
+
+    bool ok = false;
+    canfilter_hardware_t image_dev = (canfilter_hardware_t) * (const uint8_t *)config;
+    switch (image_dev) {
+    case CANFILTER_DEV_BXCAN_F0:
+        ok = load_bxcan<canfilter_bxcan_f0>(config, size);
+        break;
+    case CANFILTER_DEV_BXCAN_F4:
+        ok = load_bxcan<canfilter_bxcan_f4>(config, size);
+        break;
+    case CANFILTER_DEV_FDCAN_G0:
+        ok = load_fdcan<canfilter_fdcan_g0>(config, size);
+        break;
+    case CANFILTER_DEV_FDCAN_H7:
+        ok = load_fdcan<canfilter_fdcan_h7>(config, size);
+        break;
+    case CANFILTER_DEV_NONE:
+    default:
+        break;
+    }
+
+    if (!ok) {
+        std_rules.clear();
+        ext_rules.clear();
+        return false;
+    }
+    dev = image_dev;
+    return true;
+}
+
+canfilter_hardware_t canfilter_emu::get_dev() const {
+    return dev;
+}
+
+bool canfilter_emu::accepts(bool ext, uint32_t id) const {
+    uint32_t word32 = bxcan_word32(ext, id);
+    uint32_t word16 = bxcan_word16(ext, id);
+
+    for (const rule_t &rule : ext ? ext_rules : std_rules) {
+        bool match;
+        switch (rule.kind) {
+        case rule_bx32:
+            match = (word32 & rule.b) == rule.a;
+            break;
+        case rule_bx16:
+            match = (word16 & rule.b) == rule.a;
+            break;
+        case rule_range:
+            match = id >= rule.a && id <= rule.b;
+            break;
+        case rule_dual:
+            match = id == rule.a || id == rule.b;
+            break;
+        case rule_mask:
+        default:
+            match = (id & rule.b) == (rule.a & rule.b);
+            break;
+        }
+        if (match)
+            return !rule.reject;
+    }
+    return false;
+}
+
+void canfilter_emu::count(const canfilter_fit &wanted, bool ext, uint32_t id, verify_result_t &result) const {
+    bool want = wanted.is_wanted(ext, id);
+    bool accepted = accepts(ext, id);
+
+    if (ext) {
+        result.ext_checked++;
+        result.ext_accepted += accepted;
+        result.ext_extra += accepted && !want;
+    } else {
+        result.std_checked++;
+        result.std_accepted += accepted;
+        result.std_extra += accepted && !want;
+    }
+
+    if (want && !accepted) {
+        if (!result.std_missed && !result.ext_missed)
+            result.first_missed_id = ext ? id | 0x80000000U : id;
+        if (ext)
+            result.ext_missed++;
+        else
+            result.std_missed++;
+    }
+}
+
+/* Check every extended ID in [first, last], walking the wanted ranges along */
+void canfilter_emu::count_ext_block(const canfilter_fit &wanted, uint32_t first, uint32_t last,
+                                    verify_result_t &result) const {
+    std::vector<std::pair<uint32_t, uint32_t>> ranges = wanted.get_ranges(true);
+    auto range = std::lower_bound(
+        ranges.begin(), ranges.end(), first,
+        [](const std::pair<uint32_t, uint32_t> &r, uint32_t value) { return r.second < value; });
+
+    for (uint64_t i = first; i <= last; i++) {
+        uint32_t id = (uint32_t)i;
+        while (range != ranges.end() && range->second < id)
+            ++range;
+        bool want = range != ranges.end() && range->first <= id;
+        bool accepted = accepts(true, id);
+
+        result.ext_accepted += accepted;
+        result.ext_extra += accepted && !want;
+        if (want && !accepted) {
+            if (!result.ext_missed)
+                result.first_missed_id = id | 0x80000000U;
+            result.ext_missed++;
+        }
+    }
+    result.ext_checked += (uint64_t)last - first + 1;
+}
+
+void canfilter_emu::add_result(verify_result_t &total, const verify_result_t &part) {
+    if (!total.std_missed && !total.ext_missed && (part.std_missed || part.ext_missed))
+        total.first_missed_id = part.first_missed_id;
+    total.std_checked += part.std_checked;
+    total.std_accepted += part.std_accepted;
+    total.std_missed += part.std_missed;
+    total.std_extra += part.std_extra;
+    total.ext_checked += part.ext_checked;
+    total.ext_accepted += part.ext_accepted;
+    total.ext_missed += part.ext_missed;
+    total.ext_extra += part.ext_extra;
+}
+
+canfilter_emu::verify_result_t canfilter_emu::verify(const canfilter_fit &wanted,
+                                                     const verify_options_t &options) const {
+    auto start = std::chrono::steady_clock::now();
+    verify_result_t result;
+    result.exhaustive = options.exhaustive;
+
+    for (uint32_t id = 0; id <= canfilter::max_std_id; id++)
+        count(wanted, false, id, result);
+
+    unsigned threads = options.threads ? options.threads : std::thread::hardware_concurrency();
+    threads = std::max(1U, threads);
+
+    std::vector<verify_result_t> parts(threads);
+    std::vector<std::thread> workers;
+    if (options.exhaustive) {
+        uint64_t space = (uint64_t)canfilter::max_ext_id + 1;
+        for (unsigned t = 0; t < threads; t++) {
+            uint64_t first = space * t / threads;
+            uint64_t next = space * (t + 1) / threads;
+            if (first == next)
+                continue;
+            workers.emplace_back([this, &wanted, &parts, t, first, next]() {
+                count_ext_block(wanted, (uint32_t)first, (uint32_t)(next - 1), parts[t]);
+            });
+        }
+    } else {
+        // the edges of every wanted range, where an off-by-one would show
+        for (const auto &r : wanted.get_ranges(true)) {
+            if (r.first > 0)
+                count(wanted, true, r.first - 1, result);
+            count(wanted, true, r.first, result);
+            if (r.second != r.first)
+                count(wanted, true, r.second, result);
+            if (r.second < canfilter::max_ext_id)
+                count(wanted, true, r.second + 1, result);
+        }
+
+        for (unsigned t = 0; t < threads; t++) {
+            uint64_t n = options.samples * (t + 1) / threads - options.samples * t / threads;
+            workers.emplace_back([this, &wanted, &parts, &options, t, n]() {
+                std::mt19937 random(options.seed + t);
+                std::uniform_int_distribution<uint32_t> id(0, canfilter::max_ext_id);
+                for (uint64_t i = 0; i < n; i++)
+                    count(wanted, true, id(random), parts[t]);
+            });
+        }
+    }
+
+    for (std::thread &worker : workers)
+        worker.join();
+    for (const verify_result_t &part : parts)
+        add_result(result, part);
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void canfilter_emu::print_result(const verify_result_t &result) const {
+    std::cout << "verify " << dev_name(dev) << ", " << std_rules.size() << " std rules, " << ext_rules.size()
+              << " ext rules, " << (result.exhaustive ? "exhaustive" : "sampled") << " in " << result.seconds
+              << " s" << std::endl;
+    std::cout << "std: " << result.std_checked << " checked, " << result.std_accepted << " accepted, "
+              << result.std_missed << " missed, " << result.std_extra << " unwanted accepted" << std::endl;
+    std::cout << "ext: " << result.ext_checked << " checked, " << result.ext_accepted << " accepted, "
+              << result.ext_missed << " missed, " << result.ext_extra << " unwanted accepted" << std::endl;
+
+    if (!result.complete()) {
+        bool ext = result.first_missed_id & 0x80000000U;
+        std::cout << "FAIL: wanted IDs rejected, first " << (ext ? "ext " : "std ")
+                  << FORMAT_HEX(result.first_missed_id & canfilter::max_ext_id, ext ? 8 : 3) << std::endl;
+    } else if (result.equivalent()) {
+        std::cout << "OK: equivalent to the requested filter" << std::endl;
+    } else {
+        std::cout << "OK: all wanted IDs accepted, filter is wider than requested" << std::endl;
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef CANFILTER_EMU_H
+#define CANFILTER_EMU_H
+
+// canfilter_emu
+//
+// Software model of the acceptance stage of bxCAN and FDCAN controllers.
+// load() takes a hardware image as returned by get_hw_config() and
+// accepts() tells whether the controller would receive a data frame with
+// the given identifier, the way the registers are actually matched:
+//   • bxCAN: 32-bit and 16-bit banks in list or mask mode, including the
+//     IDE bit and the extended ID bits that 16-bit banks compare
+//   • FDCAN: range, dual and classic filter elements in order, first match
+//     wins, reject elements reject; frames matching nothing are rejected
+//
+// verify() compares the emulated controller with the set of wanted IDs of
+// a canfilter_fit: all 2048 standard IDs are checked, extended IDs either
+// exhaustively (split across threads) or by random sampling plus the edges
+// of every wanted range. Every wanted ID must be accepted; the unwanted IDs
+// accepted should match what canfilter_fit reported.
+//
+// Like the builders, this class is compute-only.
+
+#include "canfilter.hpp"
+#include "canfilter_fit.hpp"
+
+class canfilter_emu {
+  public:
+    struct verify_options_t {
+        bool exhaustive = false;     // enumerate all 2^29 extended IDs
+        uint64_t samples = 1000000;  // random extended IDs when not exhaustive
+        uint32_t seed = 1;           // random generator seed
+        unsigned threads = 0;        // worker threads, 0: one per core
+    };
+
+    struct verify_result_t {
+        uint64_t std_checked = 0;
+        uint64_t std_accepted = 0;
+        uint64_t std_missed = 0; // wanted, but rejected
+        uint64_t std_extra = 0;  // unwanted, but accepted
+        uint64_t ext_checked = 0;
+        uint64_t ext_accepted = 0;
+        uint64_t ext_missed = 0;
+        uint64_t ext_extra = 0;
+        bool exhaustive = false;
+        uint32_t first_missed_id = 0; // first missed ID, with bit 31 set for extended
+        double seconds = 0;
+
+        // No wanted ID lost
+        bool complete() const {
+            return !std_missed && !ext_missed;
+        }
+
+        // Accepts exactly the wanted IDs (for the IDs checked)
+        bool equivalent() const {
+            return complete() && !std_extra && !ext_extra;
+        }
+    };
+
+    // Load a hardware image, false if it is not a valid bxCAN or FDCAN image
+    bool load(const void *config, size_t size);
+
+    canfilter_hardware_t get_dev() const;
+
+    // Whether a data frame with this identifier passes the filter
+    bool accepts(bool ext, uint32_t id) const;
+
+    verify_result_t verify(const canfilter_fit &wanted, const verify_options_t &options) const;
+
+    void print_result(const verify_result_t &result) const;
+
+  private:
+    enum rule_kind_t {
+        rule_bx32,  // bxCAN 32-bit: (word32 & b) == a
+        rule_bx16,  // bxCAN 16-bit: (word16 & b) == a
+        rule_range, // FDCAN: a <= id <= b
+        rule_dual,  // FDCAN: id == a or id == b
+        rule_mask,  // FDCAN classic: (id & b) == (a & b)
+    };
+
+    struct rule_t {
+        rule_kind_t kind;
+        bool reject; // FDCAN: element rejects matching frames
+        uint32_t a;
+        uint32_t b;
+    };
+
+    canfilter_hardware_t dev = CANFILTER_DEV_NONE;
+    std::vector<rule_t> std_rules; // rules seen by standard frames, in order
+    std::vector<rule_t> ext_rules; // rules seen by extended frames, in order
+
+    template <typename builder_t> bool load_bxcan(const void *config, size_t size);
+    template <typename builder_t> bool load_fdcan(const void *config, size_t size);
+
+    void count(const canfilter_fit &wanted, bool ext, uint32_t id, verify_result_t &result) const;
+    void count_ext_block(const canfilter_fit &wanted, uint32_t first, uint32_t last,
+                         verify_result_t &result) const;
+    static void add_result(verify_result_t &total, const verify_result_t &part);
+};
+
+#endif
@@ -0,0 +1,573 @@
+/*
+ * canfilter_fit.cpp
+ *
+ * Best-effort approximation of CAN filters that do not fit the hardware.
+ *
+ * Responsibilities:
+ * - Collect the wanted IDs and ranges, try the exact filter first.
+ * - bxCAN: start from the CIDR decomposition of the wanted ranges and
+ *   greedily merge pairs of entries into one id/mask entry. Merging two
+ *   entries keeps the bits both agree on; every merge is scored by the
+ *   extra unwanted traffic it lets through per bank it saves.
+ * - FDCAN: greedily close the gap between neighbouring ranges that costs
+ *   least per filter element saved.
+ * - Report how many unwanted IDs and observed frames the result accepts.
+ *
+ * Notes:
+ * - Merging only considers the nearest entries, so the result is a good
+ *   packing, not a proven optimum.
+ * - Pairs of single IDs share one bxCAN list slot or one FDCAN dual element;
+ *   merging such a pair saves nothing on its own, these merges count as half
+ *   a saved slot so a cheap one can still open the way to a better merge.
+ */
+
+#include "canfilter_fit.hpp"
+#include "canfilter_bxcan.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <queue>
+
+// hex formatting macro
+#define FORMAT_HEX(val, width)                                                                                         \
+    "0x" << std::hex << std::setw(width) << std::setfill('0') << (val) << std::dec << std::setfill(' ')
+
+// nearest entries considered for a bxCAN merge
+static const size_t merge_window = 8;
+
+static uint32_t id_space(bool ext) {
+    return ext ? canfilter::max_ext_id : canfilter::max_std_id;
+}
+
+static int id_bits(bool ext) {
+    return ext ? 29 : 11;
+}
+
+// Number of x in [0, n] with (x & mask) == id, id already masked
+static uint64_t count_matching(uint32_t n, uint32_t id, uint32_t mask, int bits) {
+    uint64_t count = 0;
+    for (int b = bits - 1; b >= 0; b--) {
+        uint32_t bit = 1U << b;
+        bool fixed = mask & bit;
+        bool one = id & bit;
+        if (n & bit) {
+            // x has a 0 here, everything below is below n
+            if (!fixed || !one)
+                count += 1ULL << __builtin_popcount(~mask & (bit - 1));
+            if (fixed && !one)
+                return count;
+        } else if (fixed && one) {
+            return count;
+        }
+    }
+    return count + 1; // x == n
+}
+
+canfilter_fit::canfilter_fit(canfilter &target, canfilter_hardware_t dev) : target(target), dev(dev) {}
+
+canfilter_error_t canfilter_fit::begin() {
+    std_ranges.clear();
+    ext_ranges.clear();
+    accepts.clear();
+    report = report_t();
+    return CANFILTER_SUCCESS;
+}
+
+canfilter_error_t canfilter_fit::add_std_id(uint32_t id) {
+    return add_std_range(id, id);
+}
+
+canfilter_error_t canfilter_fit::add_ext_id(uint32_t id) {
+    return add_ext_range(id, id);
+}
+
+canfilter_error_t canfilter_fit::add_std_range(uint32_t begin, uint32_t end) {
+    if (begin > max_std_id || end > max_std_id)
+        return CANFILTER_ERROR_PARAM;
+
+    std_ranges.push_back({std::min(begin, end), std::max(begin, end)});
+    return CANFILTER_SUCCESS;
+}
+
+canfilter_error_t canfilter_fit::add_ext_range(uint32_t begin, uint32_t end) {
+    if (begin > max_ext_id || end > max_ext_id)
+        return CANFILTER_ERROR_PARAM;
+
+    ext_ranges.push_back({std::min(begin, end), std::max(begin, end)});
+    return CANFILTER_SUCCESS;
+}
+
+void canfilter_fit::add_std_traffic(uint32_t id, uint64_t frames) {
+    if (id <= max_std_id)
+        std_traffic[id] += frames;
+}
+
+void canfilter_fit::add_ext_traffic(uint32_t id, uint64_t frames) {
+    if (id <= max_ext_id)
+        ext_traffic[id] += frames;
+}
+
+void canfilter_fit::clear_traffic() {
+    std_traffic.clear();
+    ext_traffic.clear();
+}
+
+const canfilter_fit::report_t &canfilter_fit::get_report() const {
+    return report;
+}
+
+canfilter_error_t canfilter_fit::end() {
+    normalize(std_ranges);
+    normalize(ext_ranges);
+    accepts.clear();
+    report = report_t();
+
+    canfilter_error_t err = build_exact();
+    if (err == CANFILTER_SUCCESS) {
+        for (const range_t &r : std_ranges)
+            accepts.push_back({false, false, r.begin, r.end});
+        for (const range_t &r : ext_ranges)
+            accepts.push_back({true, false, r.begin, r.end});
+        make_report();
+        return err;
+    }
+    if (err != CANFILTER_ERROR_FULL)
+        return err;
+
+    if (verbose)
+        std::cout << "filter does not fit, approximating" << std::endl;
+
+    report.approximated = true;
+    switch (dev) {
+    case CANFILTER_DEV_BXCAN_F0:
+        err = fit_bxcan(canfilter_bxcan_f0::max_banks);
+        break;
+    case CANFILTER_DEV_BXCAN_F4:
+        err = fit_bxcan(canfilter_bxcan_f4::max_banks);
+        break;
+    case CANFILTER_DEV_FDCAN_G0:
+        err = fit_fdcan(28, 8);
+        break;
+    case CANFILTER_DEV_FDCAN_H7:
+        err = fit_fdcan(128, 64);
+        break;
+    case CANFILTER_DEV_NONE:
+    default:
+        return CANFILTER_ERROR_PARAM;
+    }
+
+    if (err == CANFILTER_SUCCESS)
+        make_report();
+    return err;
+}
+
+canfilter_error_t canfilter_fit::build_exact() {
+    canfilter_error_t err = target.begin();
+    for (const range_t &r : std_ranges) {
+        if (err != CANFILTER_SUCCESS)
+            return err;
+        err = target.add_std_range(r.begin, r.end);
+    }
+    for (const range_t &r : ext_ranges) {
+        if (err != CANFILTER_SUCCESS)
+            return err;
+        err = target.add_ext_range(r.begin, r.end);
+    }
+    if (err != CANFILTER_SUCCESS)
+        return err;
+    return target.end();
+}
+
+/* Sort and merge overlapping or touching ranges */
+void canfilter_fit::normalize(std::vector<range_t> &ranges) {
+    std::sort(ranges.begin(), ranges.end(), [](const range_t &a, const range_t &b) { return a.begin < b.begin; });
+
+    std::vector<range_t> merged;
+    for (const range_t &r : ranges) {
+        if (!merged.empty() && (uint64_t)r.begin <= (uint64_t)merged.back().end + 1)
+            merged.back().end = std::max(merged.back().end, r.end);
+        else
+            merged.push_back(r);
+    }
+    ranges.swap(merged);
+}
+
+bool canfilter_fit::matches(const accept_t &accept, bool ext, uint32_t id) {
+    if (accept.ext != ext)
+        return false;
+    if (accept.is_mask)
+        return (id & accept.b) == accept.a;
+    return id >= accept.a && id <= accept.b;
+}
+
+std::vector<std::pair<uint32_t, uint32_t>> canfilter_fit::get_ranges(bool ext) const {
+    std::vector<std::pair<uint32_t, uint32_t>> result;
+    for (const range_t &r : ext ? ext_ranges : std_ranges)
+        result.push_back(std::make_pair(r.begin, r.end));
+    return result;
+}
+
+bool canfilter_fit::is_wanted(bool ext, uint32_t id) const {
+    const std::vector<range_t> &ranges = ext ? ext_ranges : std_ranges;
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), id,
+                               [](uint32_t value, const range_t &r) { return value < r.begin; });
+    return it != ranges.begin() && (it - 1)->end >= id;
+}
+
+uint64_t canfilter_fit::count_wanted_mask(bool ext, uint32_t id, uint32_t mask) const {
+    const std::vector<range_t> &ranges = ext ? ext_ranges : std_ranges;
+    int bits = id_bits(ext);
+
+    // only ranges overlapping [lowest, highest] matching id can contribute
+    uint32_t lowest = id;
+    uint32_t highest = id | (~mask & id_space(ext));
+    auto it = std::lower_bound(ranges.begin(), ranges.end(), lowest,
+                               [](const range_t &r, uint32_t value) { return r.end < value; });
+
+    uint64_t count = 0;
+    for (; it != ranges.end() && it->begin <= highest; ++it) {
+        count += count_matching(it->end, id, mask, bits);
+        if (it->begin)
+            count -= count_matching(it->begin - 1, id, mask, bits);
+    }
+    return count;
+}
+
+uint64_t canfilter_fit::count_wanted_range(bool ext, uint32_t begin, uint32_t end) const {
+    const std::vector<range_t> &ranges = ext ? ext_ranges : std_ranges;
+    auto it = std::lower_bound(ranges.begin(), ranges.end(), begin,
+                               [](const range_t &r, uint32_t value) { return r.end < value; });
+
+    uint64_t count = 0;
+    for (; it != ranges.end() && it->begin <= end; ++it)
+        count += (uint64_t)std::min(it->end, end) - std::max(it->begin, begin) + 1;
+    return count;
+}
+
+/* Frames seen on the bus outweigh any number of IDs never seen */
+double canfilter_fit::cost(uint64_t ids, uint64_t frames) const {
+    return (double)frames * ((double)max_ext_id + 1) + (double)ids;
+}
+
+double canfilter_fit::mask_cost(bool ext, uint32_t id, uint32_t mask) const {
+    uint64_t accepted = 1ULL << (id_bits(ext) - __builtin_popcount(mask));
+    uint64_t ids = accepted - count_wanted_mask(ext, id, mask);
+
+    const std::map<uint32_t, uint64_t> &traffic = ext ? ext_traffic : std_traffic;
+    uint64_t frames = 0;
+    auto last = traffic.upper_bound(id | (~mask & id_space(ext)));
+    for (auto it = traffic.lower_bound(id); it != last; ++it) {
+        if ((it->first & mask) == id && !is_wanted(ext, it->first))
+            frames += it->second;
+    }
+
+    return cost(ids, frames);
+}
+
+double canfilter_fit::gap_cost(bool ext, uint32_t begin, uint32_t end) const {
+    const std::map<uint32_t, uint64_t> &traffic = ext ? ext_traffic : std_traffic;
+    uint64_t frames = 0;
+    auto last = traffic.upper_bound(end);
+    for (auto it = traffic.lower_bound(begin); it != last; ++it)
+        frames += it->second;
+
+    return cost((uint64_t)end - begin + 1, frames);
+}
+
+canfilter_error_t canfilter_fit::fit_bxcan(uint32_t max_banks) {
+    std::vector<entry_t> entries;
+
+    // exact CIDR decomposition of the wanted ranges
+    for (int ext = 0; ext < 2; ext++) {
+        uint32_t space = id_space(ext);
+        int bits = id_bits(ext);
+        for (const range_t &r : ext ? ext_ranges : std_ranges) {
+            uint32_t begin = r.begin;
+            while (begin <= r.end) {
+                int size_bits = 0;
+                while (size_bits < bits) {
+                    uint32_t block = 1U << (size_bits + 1);
+                    if ((begin & (block - 1)) || begin + block - 1 > r.end)
+                        break;
+                    size_bits++;
+                }
+                entries.push_back({ext != 0, begin, (space << size_bits) & space, 0, true, 0});
+                begin += 1U << size_bits;
+            }
+        }
+    }
+
+    // a list slot takes a quarter (std) or half (ext) bank, a mask half (std) or a full bank (ext)
+    auto units = [](const entry_t &e) -> double {
+        bool list = e.mask == id_space(e.ext);
+        if (e.ext)
+            return list ? 0.5 : 1.0;
+        return list ? 0.25 : 0.5;
+    };
+
+    auto banks = [&entries]() -> uint32_t {
+        uint32_t std_list = 0, std_mask = 0, ext_list = 0, ext_mask = 0;
+        for (const entry_t &e : entries) {
+            if (!e.alive)
+                continue;
+            bool list = e.mask == id_space(e.ext);
+            if (e.ext)
+                (list ? ext_list : ext_mask)++;
+            else
+                (list ? std_list : std_mask)++;
+        }
+        return (std_list + 3) / 4 + (std_mask + 1) / 2 + (ext_list + 1) / 2 + ext_mask;
+    };
+
+    struct candidate_t {
+        double score;
+        size_t a, b;
+        uint32_t version_a, version_b;
+        uint32_t id, mask;
+        double cost;
+        bool operator<(const candidate_t &other) const {
+            return score > other.score; // cheapest on top
+        }
+    };
+    std::priority_queue<candidate_t> queue;
+
+    auto evaluate = [&](size_t a, size_t b) {
+        const entry_t &x = entries[a];
+        const entry_t &y = entries[b];
+        uint32_t mask = x.mask & y.mask & ~(x.id ^ y.id);
+        uint32_t id = x.id & mask;
+        entry_t merged = {x.ext, id, mask, 0, true, 0};
+        double c = mask_cost(x.ext, id, mask);
+        double gain = units(x) + units(y) - units(merged);
+        double score = (c - x.cost - y.cost) / std::max(gain, 0.25);
+        queue.push({score, a, b, x.version, y.version, id, mask, c});
+    };
+
+    // pair every entry with the next few of the same kind, in id order
+    auto push_all = [&]() {
+        for (int ext = 0; ext < 2; ext++) {
+            std::vector<size_t> sorted;
+            for (size_t i = 0; i < entries.size(); i++) {
+                if (entries[i].alive && entries[i].ext == (ext != 0))
+                    sorted.push_back(i);
+            }
+            std::sort(sorted.begin(), sorted.end(),
+                      [&entries](size_t a, size_t b) { return entries[a].id < entries[b].id; });
+            for (size_t i = 0; i < sorted.size(); i++) {
+                for (size_t j = i + 1; j < sorted.size() && j <= i + merge_window; j++)
+                    evaluate(sorted[i], sorted[j]);
+            }
+        }
+    };
+
+    // pair a freshly merged entry with its nearest neighbours
+    auto push_neighbours = [&](size_t a) {
+        std::vector<size_t> near;
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (i != a && entries[i].alive && entries[i].ext == entries[a].ext)
+                near.push_back(i);
+        }
+        auto distance = [&](size_t i) {
+            return entries[i].id > entries[a].id ? entries[i].id - entries[a].id : entries[a].id - entries[i].id;
+        };
+        size_t n = std::min(near.size(), 2 * merge_window);
+        std::partial_sort(near.begin(), near.begin() + n, near.end(),
+                          [&](size_t x, size_t y) { return distance(x) < distance(y); });
+        for (size_t i = 0; i < n; i++)
+            evaluate(a, near[i]);
+    };
+
+    push_all();
+    while (banks() > max_banks) {
+        if (queue.empty()) {
+            push_all();
+            if (queue.empty())
+                return CANFILTER_ERROR_FULL;
+        }
+
+        candidate_t c = queue.top();
+        queue.pop();
+
+        entry_t &x = entries[c.a];
+        entry_t &y = entries[c.b];
+        if (!x.alive || !y.alive || x.version != c.version_a || y.version != c.version_b)
+            continue;
+
+        x.id = c.id;
+        x.mask = c.mask;
+        x.cost = c.cost;
+        x.version++;
+        y.alive = false;
+
+        // drop entries the merged one covers
+        for (entry_t &e : entries) {
+            if (&e != &x && e.alive && e.ext == x.ext && !(x.mask & ~e.mask) && (e.id & x.mask) == x.id)
+                e.alive = false;
+        }
+
+        push_neighbours(c.a);
+    }
+
+    canfilter_error_t err = target.begin();
+    for (const entry_t &e : entries) {
+        if (!e.alive)
+            continue;
+        if (err != CANFILTER_SUCCESS)
+            return err;
+
+        if (e.mask == id_space(e.ext)) {
+            err = e.ext ? target.add_ext_id(e.id) : target.add_std_id(e.id);
+        } else {
+            err = e.ext ? target.add_ext_mask(e.id, e.mask) : target.add_std_mask(e.id, e.mask);
+            if (verbose)
+                std::cout << "fit " << (e.ext ? "ext" : "std") << " mask id " << FORMAT_HEX(e.id, e.ext ? 8 : 3)
+                          << " mask " << FORMAT_HEX(e.mask, e.ext ? 8 : 3) << std::endl;
+        }
+        accepts.push_back({e.ext, true, e.id, e.mask});
+    }
+    if (err != CANFILTER_SUCCESS)
+        return err;
+    return target.end();
+}
+
+canfilter_error_t canfilter_fit::fit_fdcan(uint32_t max_std_elements, uint32_t max_ext_elements) {
+    std::vector<range_t> std_fit = std_ranges;
+    std::vector<range_t> ext_fit = ext_ranges;
+    fit_ranges(std_fit, false, max_std_elements);
+    fit_ranges(ext_fit, true, max_ext_elements);
+
+    canfilter_error_t err = target.begin();
+    for (int ext = 0; ext < 2; ext++) {
+        for (const range_t &r : ext ? ext_fit : std_fit) {
+            if (err != CANFILTER_SUCCESS)
+                return err;
+
+            if (r.begin == r.end) {
+                err = ext ? target.add_ext_id(r.begin) : target.add_std_id(r.begin);
+            } else {
+                err = ext ? target.add_ext_range(r.begin, r.end) : target.add_std_range(r.begin, r.end);
+                if (verbose)
+                    std::cout << "fit " << (ext ? "ext" : "std") << " range " << FORMAT_HEX(r.begin, ext ? 8 : 3)
+                              << "-" << FORMAT_HEX(r.end, ext ? 8 : 3) << std::endl;
+            }
+            accepts.push_back({ext != 0, false, r.begin, r.end});
+        }
+    }
+    if (err != CANFILTER_SUCCESS)
+        return err;
+    return target.end();
+}
+
+/* A range takes one element, two single IDs share one */
+void canfilter_fit::fit_ranges(std::vector<range_t> &ranges, bool ext, uint32_t max_elements) const {
+    uint32_t singles = 0;
+    uint32_t wide = 0;
+    for (const range_t &r : ranges)
+        (r.begin == r.end ? singles : wide)++;
+
+    // gaps[i] lies between ranges[i] and ranges[i + 1], closing one doesn't change the others
+    std::vector<double> gaps;
+    for (size_t i = 0; i + 1 < ranges.size(); i++)
+        gaps.push_back(gap_cost(ext, ranges[i].end + 1, ranges[i + 1].begin - 1));
+
+    while (ranges.size() > 1 && wide + (singles + 1) / 2 > max_elements) {
+        size_t best = 0;
+        double best_score = 0;
+        for (size_t i = 0; i < gaps.size(); i++) {
+            uint32_t s = singles - (ranges[i].begin == ranges[i].end) - (ranges[i + 1].begin == ranges[i + 1].end);
+            uint32_t w = wide - (ranges[i].begin != ranges[i].end) - (ranges[i + 1].begin != ranges[i + 1].end) + 1;
+            int gain = (int)(wide + (singles + 1) / 2) - (int)(w + (s + 1) / 2);
+            double score = gaps[i] / std::max((double)gain, 0.5);
+            if (i == 0 || score < best_score) {
+                best = i;
+                best_score = score;
+            }
+        }
+
+        singles -= (ranges[best].begin == ranges[best].end) + (ranges[best + 1].begin == ranges[best + 1].end);
+        wide -= (ranges[best].begin != ranges[best].end) + (ranges[best + 1].begin != ranges[best + 1].end);
+        wide++;
+
+        ranges[best].end = ranges[best + 1].end;
+        ranges.erase(ranges.begin() + best + 1);
+        gaps.erase(gaps.begin() + best);
+    }
+}
+
+void canfilter_fit::make_report() {
+    uint64_t unwanted_std = 0;
+    for (uint32_t id = 0; id <= max_std_id; id++) {
+        if (is_wanted(false, id))
+            continue;
+        unwanted_std++;
+        for (const accept_t &accept : accepts) {
+            if (matches(accept, false, id)) {
+                report.false_std_ids++;
+                break;
+            }
+        }
+    }
+
+    // ext space is too big to walk, sum up per filter
+    uint64_t wanted_ext = 0;
+    for (const range_t &r : ext_ranges)
+        wanted_ext += (uint64_t)r.end - r.begin + 1;
+    for (const accept_t &accept : accepts) {
+        if (!accept.ext)
+            continue;
+        if (accept.is_mask) {
+            uint64_t accepted = 1ULL << (id_bits(true) - __builtin_popcount(accept.b));
+            report.false_ext_ids += accepted - count_wanted_mask(true, accept.a, accept.b);
+        } else {
+            report.false_ext_ids +=
+                (uint64_t)accept.b - accept.a + 1 - count_wanted_range(true, accept.a, accept.b);
+        }
+    }
+    uint64_t unwanted_ext = (uint64_t)max_ext_id + 1 - wanted_ext;
+    report.false_ext_ids = std::min(report.false_ext_ids, unwanted_ext);
+
+    uint64_t unwanted_frames = 0;
+    for (int ext = 0; ext < 2; ext++) {
+        for (const auto &traffic : ext ? ext_traffic : std_traffic) {
+            if (is_wanted(ext, traffic.first))
+                continue;
+            unwanted_frames += traffic.second;
+            for (const accept_t &accept : accepts) {
+                if (matches(accept, ext, traffic.first)) {
+                    report.false_frames += traffic.second;
+                    break;
+                }
+            }
+        }
+    }
+
+    report.false_std_rate = unwanted_std ? (double)report.false_std_ids / unwanted_std : 0;
+    report.false_ext_rate = unwanted_ext ? (double)report.false_ext_ids / unwanted_ext : 0;
+    report.false_traffic_rate = unwanted_frames ? (double)report.false_frames / unwanted_frames : 0;
+}
+
+void *canfilter_fit::get_hw_config() {
+    return target.get_hw_config();
+}
+
+size_t canfilter_fit::get_hw_size() {
+    return target.get_hw_size();
+}
+
+void canfilter_fit::debug_print_reg() const {
+    target.debug_print_reg();
+}
+
+void canfilter_fit::debug_print() const {
+    target.debug_print();
+}
+
+void canfilter_fit::print_usage() const {
+    target.print_usage();
+    if (report.approximated) {
+        std::cout << "Approximated filter: " << report.false_std_ids << " unwanted std IDs ("
+                  << report.false_std_rate * 100 << "%), " << report.false_ext_ids << " unwanted ext IDs ("
+                  << report.false_ext_rate * 100 << "%), " << report.false_frames << " unwanted frames ("
+                  << report.false_traffic_rate * 100 << "%)" << std::endl;
+    }
+}
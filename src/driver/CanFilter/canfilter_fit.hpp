@@ -0,0 +1,122 @@
+#ifndef CANFILTER_FIT_H
+#define CANFILTER_FIT_H
+
+// canfilter_fit
+//
+// Best-effort front end for a hardware filter builder (bxCAN or FDCAN).
+// Collects the wanted standard and extended IDs and ranges, and on end()
+// first tries to build the exact filter. When the controller runs out of
+// banks or elements (CANFILTER_ERROR_FULL), it searches for a filter that
+// still accepts every wanted ID and lets through as few unwanted IDs as
+// possible:
+//   • bxCAN: greedy merging of list/mask entries into wider id/mask pairs,
+//     cheapest merge per saved bank first
+//   • FDCAN: greedy merging of neighbouring ranges across the cheapest gaps
+//
+// Optional per-ID traffic (frames seen on the bus) weights the search: an
+// unwanted ID that was seen costs its frame count times the size of the ID
+// space, so avoiding observed traffic always wins over avoiding unseen IDs.
+//
+// After end(), get_report() tells whether the filter was approximated and
+// how many unwanted IDs and frames it lets through.
+//
+// Like the builders, this class is compute-only; get_hw_config() returns
+// the image of the wrapped builder.
+
+#include "canfilter.hpp"
+#include <map>
+#include <utility>
+#include <vector>
+
+class canfilter_fit : public canfilter {
+  public:
+    // What the filter lets through, valid after end()
+    struct report_t {
+        bool approximated = false;       // false: the exact filter fits
+        uint64_t false_std_ids = 0;      // unwanted std IDs accepted
+        uint64_t false_ext_ids = 0;      // unwanted ext IDs accepted, upper bound for overlapping masks
+        double false_std_rate = 0;       // false_std_ids / unwanted std IDs
+        double false_ext_rate = 0;       // false_ext_ids / unwanted ext IDs
+        uint64_t false_frames = 0;       // observed frames of unwanted IDs accepted
+        double false_traffic_rate = 0;   // false_frames / observed frames of unwanted IDs
+    };
+
+    canfilter_fit(canfilter &target, canfilter_hardware_t dev);
+
+    canfilter_error_t begin() override;
+    canfilter_error_t add_std_id(uint32_t id) override;
+    canfilter_error_t add_ext_id(uint32_t id) override;
+    canfilter_error_t add_std_range(uint32_t begin, uint32_t end) override;
+    canfilter_error_t add_ext_range(uint32_t begin, uint32_t end) override;
+    canfilter_error_t end() override;
+
+    // Observed traffic, kept across begin()
+    void add_std_traffic(uint32_t id, uint64_t frames);
+    void add_ext_traffic(uint32_t id, uint64_t frames);
+    void clear_traffic();
+
+    const report_t &get_report() const;
+
+    // The wanted set, valid after end()
+    bool is_wanted(bool ext, uint32_t id) const;
+    std::vector<std::pair<uint32_t, uint32_t>> get_ranges(bool ext) const;
+
+    void *get_hw_config() override;
+    size_t get_hw_size() override;
+
+    void debug_print_reg() const override;
+    void debug_print() const override;
+    void print_usage() const override;
+
+  private:
+    struct range_t {
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    // One accepting filter: a range [a, b], or an id a with mask b
+    struct accept_t {
+        bool ext;
+        bool is_mask;
+        uint32_t a;
+        uint32_t b;
+    };
+
+    // bxCAN list (mask all ones) or mask entry
+    struct entry_t {
+        bool ext;
+        uint32_t id;
+        uint32_t mask;
+        double cost;
+        bool alive;
+        uint32_t version;
+    };
+
+    canfilter &target;
+    canfilter_hardware_t dev;
+
+    std::vector<range_t> std_ranges;
+    std::vector<range_t> ext_ranges;
+    std::map<uint32_t, uint64_t> std_traffic;
+    std::map<uint32_t, uint64_t> ext_traffic;
+
+    std::vector<accept_t> accepts;
+    report_t report;
+
+    canfilter_error_t build_exact();
+    canfilter_error_t fit_bxcan(uint32_t max_banks);
+    canfilter_error_t fit_fdcan(uint32_t max_std_elements, uint32_t max_ext_elements);
+    void fit_ranges(std::vector<range_t> &ranges, bool ext, uint32_t max_elements) const;
+    void make_report();
+
+    static void normalize(std::vector<range_t> &ranges);
+    static bool matches(const accept_t &accept, bool ext, uint32_t id);
+
+    uint64_t count_wanted_mask(bool ext, uint32_t id, uint32_t mask) const;
+    uint64_t count_wanted_range(bool ext, uint32_t begin, uint32_t end) const;
+    double mask_cost(bool ext, uint32_t id, uint32_t mask) const;
+    double gap_cost(bool ext, uint32_t begin, uint32_t end) const;
+    double cost(uint64_t ids, uint64_t frames) const;
+};
+
+#endif
@@ -22,6 +22,7 @@
 #include "CanInterface.h"
 
 #include <QList>
+#include <core/CanMessage.h>
 
 CanInterface::CanInterface(CanDriver *driver)
   :QObject(0), _id(-1), _driver(driver)
@@ -72,6 +73,15 @@ bool CanInterface::isOpen()
     return false;
 }
 
+int CanInterface::sendMessages(const QList<CanMessage> &msgs)
+{
+    // drivers that can hand over several frames at once should override this
+    foreach (const CanMessage &msg, msgs) {
+        sendMessage(msg);
+    }
+    return msgs.size();
+}
+
 bool CanInterface::updateStatistics()
 {
     return false;
@@ -75,6 +75,7 @@ public:
     virtual bool isOpen();
 
     virtual void sendMessage(const CanMessage &msg) = 0;
+    virtual int sendMessages(const QList<CanMessage> &msgs);
     virtual bool readMessage(QList<CanMessage> &msglist, unsigned int timeout_ms) = 0;
 
     virtual bool updateStatistics();
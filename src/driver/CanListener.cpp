@@ -22,20 +22,25 @@
 #include "CanListener.h"
 
 #include <QThread>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+
+#include <algorithm>
 
 #include <core/Backend.h>
 #include <core/CanTrace.h>
 #include <core/CanMessage.h>
+#include <core/CanMetrics.h>
 #include "CanInterface.h"
 
-#include <QMessageBox>
-
 CanListener::CanListener(QObject *parent, Backend &backend, CanInterface &intf)
   : QObject(parent),
     _backend(backend),
     _intf(intf),
     _shouldBeRunning(true),
-    _openComplete(false)
+    _openComplete(false),
+    _openSucceeded(false),
+    _openTime(0)
 {
     _thread = new QThread();
 }
@@ -55,21 +60,89 @@ CanInterface &CanListener::getInterface()
     return _intf;
 }
 
+void CanListener::setSoftwareFilter(const SoftwareFilter &filter)
+{
+    QMutexLocker locker(&_filterMutex);
+    _pendingFilter = filter;
+    _filterChanged.storeRelease(1);
+}
+
+QMap<uint32_t, quint64> CanListener::getTrafficById()
+{
+    QMap<uint32_t, quint64> traffic;
+    QMutexLocker locker(&_trafficMutex);
+    for (QHash<uint32_t, quint64>::const_iterator it = _traffic.constBegin(); it != _traffic.constEnd(); ++it) {
+        traffic.insert(it.key(), it.value());
+    }
+    return traffic;
+}
+
 void CanListener::run()
 {
     // Note: open and close done from run() so all operations take place in the same thread
     //CanMessage msg;
     QList<CanMessage> rxMessages;
     CanTrace *trace = _backend.getTrace();
+    QElapsedTimer openTimer;
+    openTimer.start();
     _intf.open();
+    CanMetrics::setThreadInterface(_intf.getId());
     qRegisterMetaType<log_level_t >("log_level_t");
     log_info(QString(tr("interface: %1, Version: %2")).arg(_intf.getName(),_intf.getVersion()));
-    _openComplete = true;
+    {
+        QMutexLocker locker(&_openMutex);
+        _openSucceeded = _intf.isOpen();
+        _openTime = openTimer.elapsed();
+        _openComplete = true;
+        _openCondition.wakeAll();
+    }
     while (_shouldBeRunning) {
+        if (_filterChanged.testAndSetAcquire(1, 0)) {
+            QMutexLocker locker(&_filterMutex);
+            _filter = _pendingFilter;
+        }
+
         if (_intf.readMessage(rxMessages, 1000)) {
-            for(const CanMessage &msg: qAsConst(rxMessages))
+            CanMetrics::count(CanMetrics::counter_rx_frames, rxMessages.size());
+            CanMetrics::count(CanMetrics::counter_rx_batches);
+            CanMetrics::sample(CanMetrics::histogram_rx_batch_size, rxMessages.size());
+
+            // weights the hardware filter approximation, new IDs stop counting
+            // once the table is full so random traffic can't grow it forever
+            {
+                QMutexLocker locker(&_trafficMutex);
+                for (const CanMessage &msg: qAsConst(rxMessages)) {
+                    if (!msg.isRX() || msg.isErrorFrame()) {
+                        continue;
+                    }
+                    QHash<uint32_t, quint64>::iterator it = _traffic.find(msg.getRawId());
+                    if (it != _traffic.end()) {
+                        it.value()++;
+                    } else if (_traffic.size() < max_traffic_ids) {
+                        _traffic.insert(msg.getRawId(), 1);
+                    }
+                }
+            }
+
+            // unwanted frames are dropped here, before observers and the trace see them
+            if (_filter.isEnabled()) {
+                int received = rxMessages.size();
+                rxMessages.erase(std::remove_if(rxMessages.begin(), rxMessages.end(),
+                                                [this](const CanMessage &msg) { return !_filter.accepts(msg); }),
+                                 rxMessages.end());
+                CanMetrics::count(CanMetrics::counter_rx_filtered, received - rxMessages.size());
+                if (rxMessages.isEmpty()) {
+                    continue;
+                }
+            }
+
+            _backend.notifyRxObservers(_intf.getId(), rxMessages);
+            if (_backend.isTraceEnabled())
             {
-                trace->enqueueMessage(msg, false);
+                for(const CanMessage &msg: qAsConst(rxMessages))
+                {
+                    trace->enqueueMessage(msg, false);
+                }
             }
             rxMessages.clear();
         }
@@ -94,10 +167,21 @@ void CanListener::startThread()
     moveToThread(_thread);
     connect(_thread, SIGNAL(started()), this, SLOT(run()));
     _thread->start();
+}
+
+bool CanListener::waitOpen()
+{
+    QMutexLocker locker(&_openMutex);
+    while (!_openComplete) {
+        _openCondition.wait(&_openMutex);
+    }
+    return _openSucceeded;
+}
 
-    // Wait for interface to be open before returning so that beginMeasurement is emitted after interface open
-    while(!_openComplete)
-      QThread().usleep(250);
+qint64 CanListener::getOpenTime()
+{
+    QMutexLocker locker(&_openMutex);
+    return _openTime;
 }
 
 void CanListener::requestStop()
@@ -23,8 +23,14 @@
 
 #include <QThread>
 #include <QObject>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QHash>
+#include <QMap>
 #include <driver/CanDriver.h>
 #include <driver/CanInterface.h>
+#include <driver/SoftwareFilter.h>
 
 //class QThread;
 class CanMessage;
@@ -41,6 +47,18 @@ public:
     CanInterfaceId getInterfaceId();
     CanInterface &getInterface();
 
+    // blocks until run() has tried to open the interface, true if it is open
+    bool waitOpen();
+    // milliseconds the interface took to open
+    qint64 getOpenTime();
+
+    // takes effect with the next batch of received frames
+    void setSoftwareFilter(const SoftwareFilter &filter);
+
+    // frames received per raw ID since the listener started, counted ahead
+    // of the software filter
+    QMap<uint32_t, quint64> getTrafficById();
+
 signals:
     void messageReceived(const CanMessage &msg);
 
@@ -52,9 +70,25 @@ public slots:
     void waitFinish();
 
 private:
+    enum {
+        max_traffic_ids = 65536
+    };
+
     Backend &_backend;
     CanInterface &_intf;
     bool _shouldBeRunning;
     bool _openComplete;
+    bool _openSucceeded;
+    qint64 _openTime;
+    QMutex _openMutex;
+    QWaitCondition _openCondition;
     QThread *_thread;
+
+    QMutex _filterMutex;
+    SoftwareFilter _pendingFilter;
+    QAtomicInt _filterChanged;
+    SoftwareFilter _filter; // listener thread only
+
+    QMutex _trafficMutex;
+    QHash<uint32_t, quint64> _traffic;
 };
@@ -23,13 +23,18 @@
 #include "api/candle.h"
 
 #include "CandleApiInterface.h"
+#ifndef CANGAROO_HEADLESS
 #include <driver/GenericCanSetupPage.h>
+#endif
 
 CandleApiDriver::CandleApiDriver(Backend &backend)
   : CanDriver(backend),
-    setupPage(new GenericCanSetupPage(0))
+    setupPage(0)
 {
+#ifndef CANGAROO_HEADLESS
+    setupPage = new GenericCanSetupPage();
     QObject::connect(&backend, SIGNAL(onSetupDialogCreated(SetupDialog&)), setupPage, SLOT(onSetupDialogCreated(SetupDialog&)));
+#endif
 }
 
 QString CandleApiDriver::getName()
@@ -31,6 +31,13 @@ GenericCanSetupPage::GenericCanSetupPage(QWidget *parent) :
 
     connect(ui->CustomBitrateSet, SIGNAL(textChanged(QString)), this, SLOT(updateUI()));
     connect(ui->CustomFdBitrateSet, SIGNAL(textChanged(QString)), this, SLOT(updateUI()));
+
+    ui->cbHwFilterMode->addItem(tr("Off"), MeasurementInterface::hw_filter_off);
+    ui->cbHwFilterMode->addItem(tr("Manual"), MeasurementInterface::hw_filter_manual);
+    ui->cbHwFilterMode->addItem(tr("DBC messages"), MeasurementInterface::hw_filter_dbc);
+    ui->cbHwFilterMode->addItem(tr("Trace selection"), MeasurementInterface::hw_filter_ids);
+    connect(ui->cbHwFilterMode, SIGNAL(currentIndexChanged(int)), this, SLOT(updateUI()));
+    connect(ui->hwFilterLineEdit, SIGNAL(textChanged(QString)), this, SLOT(updateUI()));
 }
 
 GenericCanSetupPage::~GenericCanSetupPage()
@@ -72,6 +79,9 @@ void GenericCanSetupPage::onShowInterfacePage(SetupDialog &dlg, MeasurementInter
     ui->CustomBitrateSet->setText(QString("%1").arg(_mi->customBitrate(), 6, 16,QLatin1Char('0')).toUpper());
     ui->CustomFdBitrateSet->setText(QString("%1").arg(_mi->customFdBitrate(), 6, 16,QLatin1Char('0')).toUpper());
 
+    ui->cbHwFilterMode->setCurrentIndex(ui->cbHwFilterMode->findData(_mi->hwFilterMode()));
+    ui->hwFilterLineEdit->setText(_mi->hwFilter());
+
     disenableUI(_mi->doConfigure());
     dlg.displayPage(this);
 
@@ -96,6 +106,9 @@ void GenericCanSetupPage::updateUI()
         _mi->setCustomBitrateEn(ui->cbCustomBitrate->isChecked());
         _mi->setCustomFdBitrateEn(ui->cbCustomFdBitrate->isChecked());
 
+        _mi->setHwFilterMode((MeasurementInterface::hw_filter_mode_t)ui->cbHwFilterMode->currentData().toInt());
+        _mi->setHwFilter(ui->hwFilterLineEdit->text());
+
         _enable_ui_updates = false;
 
         if(ui->cbCustomBitrate->isChecked())
@@ -316,6 +329,11 @@ void GenericCanSetupPage::disenableUI(bool enabled)
 
     ui->CustomBitrateSet->setEnabled(ui->cbCustomBitrate->isChecked());
     ui->CustomFdBitrateSet->setEnabled(ui->cbCustomFdBitrate->isChecked());
+
+    // the other modes are programmed from the setup when it is applied
+    bool manualFilter = ui->cbHwFilterMode->currentData().toInt() == MeasurementInterface::hw_filter_manual;
+    ui->hwFilterLineEdit->setEnabled(manualFilter);
+    ui->setFilterPushButton->setEnabled(manualFilter);
 }
 
 Backend &GenericCanSetupPage::backend()
@@ -327,6 +345,11 @@ Backend &GenericCanSetupPage::backend()
 void GenericCanSetupPage::on_setFilterPushButton_clicked()
 {
     CanInterface *intf = backend().getInterfaceById(_mi->canInterface());
+    // an empty filter would silence the interface
+    if (ui->hwFilterLineEdit->text().trimmed().isEmpty()) {
+        log_warning(tr("hwfilter: empty filter, filter not changed"));
+        return;
+    }
     setHardwareFilter(intf, ui->hwFilterLineEdit->text());
 }
 
@@ -3,13 +3,32 @@
 #include "CanFilter/canfilter.hpp"
 #include "CanFilter/canfilter_bxcan.hpp"
 #include "CanFilter/canfilter_fdcan.hpp"
+#include "CanFilter/canfilter_fit.hpp"
 #include "CanFilter/canfilter_usb.hpp"
 #include "CanFilter/usb_info.hpp"
 #include "core/Backend.h"
 
-bool setHardwareFilter(CanInterface *intf, QString filter_def) {
+// extended flag of CanMessage::getRawId()
+static const uint32_t raw_id_extended = 0x80000000;
 
-  log_info(QString("interface: %1, filter: %2").arg(intf->getName(),filter_def));
+bool hasHardwareFilter(CanInterface *intf) {
+  if (intf->getDriver()->getName() != "SocketCAN") {
+    return false;
+  }
+
+  uint16_t vendor_id, product_id;
+  std::string serial;
+  canfilter_usb usb_device;
+  return getUsbInfoFromDeviceName(intf->getName().toStdString(), vendor_id, product_id, serial)
+      && usb_device.open(vendor_id, product_id, serial)
+      && usb_device.hasHardwareFilter();
+}
+
+static bool programHardwareFilter(CanInterface *intf, QString description,
+                                  std::function<bool(canfilter &)> fill,
+                                  hw_filter_traffic_t getTraffic) {
+
+  log_info(QString("interface: %1, filter: %2").arg(intf->getName(),description));
 
   QString driver_name = intf->getDriver()->getName();
   if (driver_name != "SocketCAN") {
@@ -65,14 +84,51 @@ bool setHardwareFilter(CanInterface *intf, QString filter_def) {
     break;
   }
 
-  filter->begin();
-  if (!filter->parse(filter_def.toStdString())) {
+  // approximates the filter if it does not fit the banks
+  canfilter_fit fit(*filter, hw_filter);
+  fit.begin();
+  if (!fill(fit)) {
     log_error("hwfilter: filter syntax error");
     return false;
   }
-  filter->end();
+  if (fit.end() != CANFILTER_SUCCESS) {
+    log_error("hwfilter: filter does not fit");
+    return false;
+  }
 
-  if (!usb_device.programFilter(filter->get_hw_config(), filter->get_hw_size())) {
+  // traffic only matters for an approximation, fetch it and fit again
+  QMap<uint32_t, quint64> traffic;
+  if (fit.get_report().approximated && getTraffic) {
+    traffic = getTraffic();
+  }
+  if (!traffic.isEmpty()) {
+    for (QMap<uint32_t, quint64>::const_iterator it = traffic.constBegin(); it != traffic.constEnd(); ++it) {
+      if (it.key() & raw_id_extended) {
+        fit.add_ext_traffic(it.key() & canfilter::max_ext_id, it.value());
+      } else {
+        fit.add_std_traffic(it.key() & canfilter::max_std_id, it.value());
+      }
+    }
+    fit.begin();
+    fill(fit);
+    if (fit.end() != CANFILTER_SUCCESS) {
+      log_error("hwfilter: filter does not fit");
+      return false;
+    }
+  }
+
+  const canfilter_fit::report_t &report = fit.get_report();
+  if (report.approximated) {
+    log_warning(QString("hwfilter: filter approximated, also accepts %1 unwanted standard IDs (%2%), %3 unwanted extended IDs (%4%)")
+                .arg(report.false_std_ids).arg(report.false_std_rate * 100, 0, 'f', 1)
+                .arg(report.false_ext_ids).arg(report.false_ext_rate * 100, 0, 'f', 4));
+    if (!traffic.isEmpty()) {
+      log_warning(QString("hwfilter: %1 of the unwanted frames seen would pass (%2%)")
+                  .arg(report.false_frames).arg(report.false_traffic_rate * 100, 0, 'f', 1));
+    }
+  }
+
+  if (!usb_device.programFilter(fit.get_hw_config(), fit.get_hw_size())) {
     log_error("hwfilter: filter fail");
     return false;
   }
@@ -81,3 +137,29 @@ bool setHardwareFilter(CanInterface *intf, QString filter_def) {
 
   return true;
 }
+
+bool setHardwareFilter(CanInterface *intf, QString filter_def, hw_filter_traffic_t traffic) {
+  return programHardwareFilter(intf, filter_def, [&filter_def](canfilter &filter) {
+    return filter.parse(filter_def.toStdString());
+  }, traffic);
+}
+
+bool clearHardwareFilter(CanInterface *intf) {
+  return programHardwareFilter(intf, "all IDs", [](canfilter &filter) {
+    return filter.allow_all() == CANFILTER_SUCCESS;
+  }, hw_filter_traffic_t());
+}
+
+bool setHardwareFilter(CanInterface *intf, const QList<uint32_t> &rawIds, hw_filter_traffic_t traffic) {
+  return programHardwareFilter(intf, QString("%1 IDs").arg(rawIds.size()), [&rawIds](canfilter &filter) {
+    foreach (uint32_t id, rawIds) {
+      canfilter_error_t err = (id & raw_id_extended)
+        ? filter.add_ext_id(id & canfilter::max_ext_id)
+        : filter.add_std_id(id & canfilter::max_std_id);
+      if (err != CANFILTER_SUCCESS) {
+        return false;
+      }
+    }
+    return true;
+  }, traffic);
+}
@@ -1,9 +1,29 @@
 #ifndef HARDWAREFILTER_H
 #define HARDWAREFILTER_H
 
+#include <QList>
+#include <QMap>
 #include <QString>
 #include <driver/CanInterface.h>
 
-bool setHardwareFilter(CanInterface *intf, QString filter_def);
+#include <functional>
+
+// frames seen per ID, keyed by CanMessage::getRawId()
+typedef std::function<QMap<uint32_t, quint64>()> hw_filter_traffic_t;
+
+// whether the interface is a candleLight device with a filter, without logging
+bool hasHardwareFilter(CanInterface *intf);
+
+// traffic: only called, and only used to weight the approximation, when the
+// filter does not fit the controller.
+bool setHardwareFilter(CanInterface *intf, QString filter_def,
+                       hw_filter_traffic_t traffic = hw_filter_traffic_t());
+
+// accept every ID, undoes an earlier filter
+bool clearHardwareFilter(CanInterface *intf);
+
+// accept the given raw IDs (CanMessage::getRawId())
+bool setHardwareFilter(CanInterface *intf, const QList<uint32_t> &rawIds,
+                       hw_filter_traffic_t traffic = hw_filter_traffic_t());
 
 #endif // HARDWAREFILTER_H
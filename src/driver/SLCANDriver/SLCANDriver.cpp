@@ -23,7 +23,9 @@
 #include "SLCANDriver.h"
 #include "SLCANInterface.h"
 #include <core/Backend.h>
+#ifndef CANGAROO_HEADLESS
 #include <driver/GenericCanSetupPage.h>
+#endif
 
 #include <unistd.h>
 #include <iostream>
@@ -35,9 +37,12 @@
 
 SLCANDriver::SLCANDriver(Backend &backend)
   : CanDriver(backend),
-    setupPage(new GenericCanSetupPage())
+    setupPage(0)
 {
+#ifndef CANGAROO_HEADLESS
+    setupPage = new GenericCanSetupPage();
     QObject::connect(&backend, SIGNAL(onSetupDialogCreated(SetupDialog&)), setupPage, SLOT(onSetupDialogCreated(SetupDialog&)));
+#endif
 }
 
 SLCANDriver::~SLCANDriver() {
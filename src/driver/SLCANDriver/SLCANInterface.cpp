@@ -20,7 +20,7 @@
 */
 
 #include "SLCANInterface.h"
-#include "qapplication.h"
+#include <QCoreApplication>
 #include "qdebug.h"
 
 #include <core/Backend.h>
@@ -892,6 +892,11 @@ bool SLCANInterface::readMessage(QList<CanMessage> &msglist, unsigned int timeou
                             if(_status.can_state == state_tx_success)
                             {
                                 msgtx.cloneFrom(_can_msg_tx_queue.front());
+                                // the adapter acknowledged the frame just now, use that as TX time
+                                struct timeval tv;
+                                gettimeofday(&tv,NULL);
+                                msgtx.setTimestamp(tv);
+                                msgtx.setRX(false);
                                 if(msgtx.isShow())
                                     msglist.append(msgtx);
                             }
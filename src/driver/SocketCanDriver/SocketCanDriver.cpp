@@ -23,7 +23,9 @@
 #include "SocketCanDriver.h"
 #include "SocketCanInterface.h"
 #include <core/Backend.h>
+#ifndef CANGAROO_HEADLESS
 #include <driver/GenericCanSetupPage.h>
+#endif
 
 #include <sys/socket.h>
 #include <linux/if.h>
@@ -39,9 +41,12 @@
 
 SocketCanDriver::SocketCanDriver(Backend &backend)
   : CanDriver(backend),
-    setupPage(new GenericCanSetupPage())
+    setupPage(0)
 {
+#ifndef CANGAROO_HEADLESS
+    setupPage = new GenericCanSetupPage();
     QObject::connect(&backend, SIGNAL(onSetupDialogCreated(SetupDialog&)), setupPage, SLOT(onSetupDialogCreated(SetupDialog&)));
+#endif
 }
 
 SocketCanDriver::~SocketCanDriver() {
@@ -27,6 +27,7 @@
 
 #include <stdio.h>
 #include <unistd.h>
+#include <string.h>
 #include <time.h>
 #include <QString>
 #include <QStringList>
@@ -50,6 +51,7 @@ SocketCanInterface::SocketCanInterface(SocketCanDriver *driver, int index, QStri
 	_idx(index),
     _isOpen(false),
 	_fd(0),
+    _fdFrames(false),
     _name(name),
     _ts_mode(ts_mode_SIOCSHWTSTAMP)
 {
@@ -362,6 +364,15 @@ void SocketCanInterface::open() {
 	addr.can_family  = AF_CAN;
 	addr.can_ifindex = ifr.ifr_ifindex;
 
+	// loop our own frames back, so they show up in the trace with the time they actually hit the bus.
+	// readMessage() tells them apart by MSG_CONFIRM.
+	int recv_own_msgs = 1;
+	setsockopt(_fd, SOL_CAN_RAW, CAN_RAW_RECV_OWN_MSGS, &recv_own_msgs, sizeof(recv_own_msgs));
+
+	// send and receive CAN FD frames; the socket then reads both frame sizes
+	int fd_frames = 1;
+	_fdFrames = setsockopt(_fd, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &fd_frames, sizeof(fd_frames)) == 0;
+
 	if(bind(_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
 		perror("Error in socket bind");
         _isOpen = false;
@@ -380,9 +391,10 @@ void SocketCanInterface::close() {
     _isOpen = false;
 }
 
-void SocketCanInterface::sendMessage(const CanMessage &msg) {
-	struct can_frame frame;
-
+// fills a classic or FD frame and returns the number of bytes to write
+static size_t fill_can_frame(struct canfd_frame &frame, const CanMessage &msg, bool fdFrames)
+{
+	memset(&frame, 0, sizeof(frame));
 	frame.can_id = msg.getId();
 
 	if (msg.isExtended()) {
@@ -397,20 +409,60 @@ void SocketCanInterface::sendMessage(const CanMessage &msg) {
 		frame.can_id |= CAN_ERR_FLAG;
 	}
 
+	bool fd = fdFrames && msg.isFD();
 	uint8_t len = msg.getLength();
-	if (len>8) { len = 8; }
+	if (len > (fd ? CANFD_MAX_DLEN : CAN_MAX_DLEN)) { len = fd ? CANFD_MAX_DLEN : CAN_MAX_DLEN; }
 
-	frame.can_dlc = len;
+	frame.len = len;
+	if (fd && msg.isBRS()) {
+		frame.flags |= CANFD_BRS;
+	}
 	for (int i=0; i<len; i++) {
 		frame.data[i] = msg.getByte(i);
 	}
+	return fd ? CANFD_MTU : CAN_MTU;
+}
 
-	::write(_fd, &frame, sizeof(struct can_frame));
+void SocketCanInterface::sendMessage(const CanMessage &msg) {
+	struct canfd_frame frame;
+	size_t size = fill_can_frame(frame, msg, _fdFrames);
+	::write(_fd, &frame, size);
+}
+
+int SocketCanInterface::sendMessages(const QList<CanMessage> &msgs)
+{
+    enum { batch_size = 64 };
+    struct canfd_frame frames[batch_size];
+    struct iovec iov[batch_size];
+    struct mmsghdr hdr[batch_size];
+
+    int sent = 0;
+    while (sent < msgs.size()) {
+        int num = qMin((int)batch_size, msgs.size() - sent);
+        for (int i=0; i<num; i++) {
+            iov[i].iov_len = fill_can_frame(frames[i], msgs[sent+i], _fdFrames);
+            iov[i].iov_base = &frames[i];
+            memset(&hdr[i], 0, sizeof(struct mmsghdr));
+            hdr[i].msg_hdr.msg_iov = &iov[i];
+            hdr[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int rv = sendmmsg(_fd, hdr, num, 0);
+        if (rv <= 0) {
+            // tx queue full (ENOBUFS) or socket error: the rest is dropped
+            break;
+        }
+        sent += rv;
+        if (rv < num) {
+            break;
+        }
+    }
+    return sent;
 }
 
 bool SocketCanInterface::readMessage(QList<CanMessage> &msglist, unsigned int timeout_ms) {
 
-    struct can_frame frame;
+    struct canfd_frame frame;
     struct timespec ts_rcv;
     struct timeval tv_rcv;
     struct timeval timeout;
@@ -428,9 +480,22 @@ bool SocketCanInterface::readMessage(QList<CanMessage> &msglist, unsigned int ti
     int rv = select(_fd+1, &fdset, NULL, NULL, &timeout);
     if (rv>0) {
 
-        if (read(_fd, &frame, sizeof(struct can_frame)) < 0) {
+        struct iovec iov;
+        struct msghdr hdr;
+        iov.iov_base = &frame;
+        iov.iov_len = sizeof(struct canfd_frame);
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_iov = &iov;
+        hdr.msg_iovlen = 1;
+
+        ssize_t nbytes = recvmsg(_fd, &hdr, 0);
+        if (nbytes < 0) {
             return false;
         }
+        bool fd = (nbytes == CANFD_MTU);
+
+        // frames we sent ourselves come back with MSG_CONFIRM set
+        msg.setRX((hdr.msg_flags & MSG_CONFIRM) == 0);
 
         if (_ts_mode == ts_mode_SIOCSHWTSTAMP) {
             // TODO implement me
@@ -456,8 +521,11 @@ bool SocketCanInterface::readMessage(QList<CanMessage> &msglist, unsigned int ti
         msg.setErrorFrame((frame.can_id & CAN_ERR_FLAG)!=0);
         msg.setInterfaceId(getId());
 
-        uint8_t len = frame.can_dlc;
-        if (len>8) { len = 8; }
+        msg.setFD(fd);
+        msg.setBRS(fd && (frame.flags & CANFD_BRS));
+
+        uint8_t len = frame.len;
+        if (len > (fd ? CANFD_MAX_DLEN : CAN_MAX_DLEN)) { len = fd ? CANFD_MAX_DLEN : CAN_MAX_DLEN; }
 
         msg.setLength(len);
         for (int i=0; i<len; i++) {
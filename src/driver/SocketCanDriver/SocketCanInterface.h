@@ -76,6 +76,7 @@ public:
 	virtual void close();
 
     virtual void sendMessage(const CanMessage &msg);
+    virtual int sendMessages(const QList<CanMessage> &msgs);
     virtual bool readMessage(QList<CanMessage> &msglist, unsigned int timeout_ms);
 
     virtual bool updateStatistics();
@@ -101,6 +102,7 @@ private:
     int _idx;
     bool _isOpen;
 	int _fd;
+    bool _fdFrames; // CAN_RAW_FD_FRAMES enabled on the socket
     QString _name;
 
     can_config_t _config;
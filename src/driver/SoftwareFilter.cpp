@@ -0,0 +1,165 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SoftwareFilter.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include "CanFilter/canfilter.hpp"
+
+// extended flag of CanMessage::getRawId()
+static const uint32_t raw_id_extended = 0x80000000;
+
+// parses a filter definition into a SoftwareFilter
+class SoftwareFilterCollector : public canfilter
+{
+public:
+    explicit SoftwareFilterCollector(SoftwareFilter &filter) : _filter(filter) {}
+
+    canfilter_error_t begin() override { _filter.reset(); return CANFILTER_SUCCESS; }
+    canfilter_error_t add_std_id(uint32_t id) override { return add_std_range(id, id); }
+    canfilter_error_t add_ext_id(uint32_t id) override { return add_ext_range(id, id); }
+
+    canfilter_error_t add_std_range(uint32_t start, uint32_t end) override
+    {
+        if (start > max_std_id || end > max_std_id) {
+            return CANFILTER_ERROR_PARAM;
+        }
+        _filter.addStdRange(qMin(start, end), qMax(start, end));
+        return CANFILTER_SUCCESS;
+    }
+
+    canfilter_error_t add_ext_range(uint32_t start, uint32_t end) override
+    {
+        if (start > max_ext_id || end > max_ext_id) {
+            return CANFILTER_ERROR_PARAM;
+        }
+        _filter.addExtRange(qMin(start, end), qMax(start, end));
+        return CANFILTER_SUCCESS;
+    }
+
+    canfilter_error_t end() override { _filter.finish(); return CANFILTER_SUCCESS; }
+
+    void *get_hw_config() override { return 0; }
+    size_t get_hw_size() override { return 0; }
+    void debug_print_reg() const override {}
+    void debug_print() const override {}
+    void print_usage() const override {}
+
+private:
+    SoftwareFilter &_filter;
+};
+
+SoftwareFilter::SoftwareFilter()
+{
+    clear();
+}
+
+void SoftwareFilter::clear()
+{
+    reset();
+    _enabled = false;
+}
+
+bool SoftwareFilter::setDefinition(const QString &definition)
+{
+    SoftwareFilterCollector collector(*this);
+    collector.begin();
+    if (!collector.parse(definition.toStdString())) {
+        clear();
+        return false;
+    }
+    collector.end();
+    return true;
+}
+
+void SoftwareFilter::setIds(const QList<uint32_t> &rawIds)
+{
+    reset();
+    foreach (uint32_t id, rawIds) {
+        if (id & raw_id_extended) {
+            addExtRange(id & canfilter::max_ext_id, id & canfilter::max_ext_id);
+        } else {
+            addStdRange(id & std_id_mask, id & std_id_mask);
+        }
+    }
+    finish();
+}
+
+void SoftwareFilter::reset()
+{
+    _enabled = true;
+    memset(_std, 0, sizeof(_std));
+    _extIds.clear();
+    _extRanges.clear();
+}
+
+void SoftwareFilter::addStdRange(uint32_t first, uint32_t last)
+{
+    for (uint32_t id=first; id<=last; id++) {
+        _std[id >> 6] |= 1ULL << (id & 63);
+    }
+}
+
+void SoftwareFilter::addExtRange(uint32_t first, uint32_t last)
+{
+    ext_range_t range = { first, last };
+    _extRanges.append(range);
+}
+
+/* Sort and merge the extended ranges, single IDs go to the hash set */
+void SoftwareFilter::finish()
+{
+    std::sort(_extRanges.begin(), _extRanges.end(), [](const ext_range_t &a, const ext_range_t &b) {
+        return a.first < b.first;
+    });
+
+    QVector<ext_range_t> merged;
+    foreach (const ext_range_t &range, _extRanges) {
+        if (!merged.isEmpty() && ((quint64)range.first <= (quint64)merged.last().last + 1)) {
+            merged.last().last = qMax(merged.last().last, range.last);
+        } else {
+            merged.append(range);
+        }
+    }
+
+    _extRanges.clear();
+    foreach (const ext_range_t &range, merged) {
+        if (range.first == range.last) {
+            _extIds.insert(range.first);
+        } else {
+            _extRanges.append(range);
+        }
+    }
+}
+
+bool SoftwareFilter::acceptsExtended(uint32_t id) const
+{
+    if (_extIds.contains(id)) {
+        return true;
+    }
+
+    // last range starting at or below id
+    QVector<ext_range_t>::const_iterator it = std::upper_bound(_extRanges.constBegin(), _extRanges.constEnd(), id,
+        [](uint32_t value, const ext_range_t &range) { return value < range.first; });
+    return (it != _extRanges.constBegin()) && ((it - 1)->last >= id);
+}
@@ -0,0 +1,87 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+#include <core/CanMessage.h>
+
+// Acceptance filter applied to received frames in the listener thread, for
+// adapters without a hardware filter and to make an approximated hardware
+// filter exact. Takes the same definitions as the hardware filter.
+class SoftwareFilter
+{
+public:
+    SoftwareFilter();
+
+    // accept everything
+    void clear();
+
+    // IDs and ranges as for the hardware filter, false on a syntax error
+    bool setDefinition(const QString &definition);
+
+    // raw IDs as returned by CanMessage::getRawId()
+    void setIds(const QList<uint32_t> &rawIds);
+
+    bool isEnabled() const { return _enabled; }
+
+    bool accepts(const CanMessage &msg) const
+    {
+        // our own transmit echoes and error frames are never filtered
+        if (!_enabled || !msg.isRX() || msg.isErrorFrame()) {
+            return true;
+        }
+        uint32_t id = msg.getId();
+        if (msg.isExtended()) {
+            return acceptsExtended(id);
+        }
+        id &= std_id_mask;
+        return (_std[id >> 6] >> (id & 63)) & 1;
+    }
+
+private:
+    friend class SoftwareFilterCollector;
+
+    enum {
+        std_id_mask = 0x7FF,
+        std_words = 2048 / 64
+    };
+
+    typedef struct {
+        uint32_t first;
+        uint32_t last;
+    } ext_range_t;
+
+    bool _enabled;
+    quint64 _std[std_words];          // one bit per standard ID
+    QSet<uint32_t> _extIds;           // single extended IDs
+    QVector<ext_range_t> _extRanges;  // sorted, disjoint extended ranges
+
+    void reset();
+    void addStdRange(uint32_t first, uint32_t last);
+    void addExtRange(uint32_t first, uint32_t last);
+    void finish();
+    bool acceptsExtended(uint32_t id) const;
+};
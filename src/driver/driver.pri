@@ -1,7 +1,9 @@
 SOURCES += \
     $$PWD/CanFilter/canfilter.cpp \
     $$PWD/CanFilter/canfilter_bxcan.cpp \
+    $$PWD/CanFilter/canfilter_emu.cpp \
     $$PWD/CanFilter/canfilter_fdcan.cpp \
+    $$PWD/CanFilter/canfilter_fit.cpp \
     $$PWD/CanFilter/canfilter_usb.cpp \
     $$PWD/CanFilter/usb_device.cpp \
     $$PWD/CanFilter/usb_info.cpp \
@@ -9,13 +11,15 @@ SOURCES += \
     $$PWD/CanListener.cpp \
     $$PWD/CanDriver.cpp \
     $$PWD/CanTiming.cpp \
-    $$PWD/GenericCanSetupPage.cpp \
-    $$PWD/HardwareFilter.cpp
+    $$PWD/HardwareFilter.cpp \
+    $$PWD/SoftwareFilter.cpp
 
 HEADERS  += \
     $$PWD/CanFilter/canfilter.hpp \
     $$PWD/CanFilter/canfilter_bxcan.hpp \
+    $$PWD/CanFilter/canfilter_emu.hpp \
     $$PWD/CanFilter/canfilter_fdcan.hpp \
+    $$PWD/CanFilter/canfilter_fit.hpp \
     $$PWD/CanFilter/canfilter_usb.hpp \
     $$PWD/CanFilter/usb_device.hpp \
     $$PWD/CanFilter/usb_info.hpp \
@@ -23,8 +27,13 @@ HEADERS  += \
     $$PWD/CanListener.h \
     $$PWD/CanDriver.h \
     $$PWD/CanTiming.h \
-    $$PWD/GenericCanSetupPage.h \
-    $$PWD/HardwareFilter.h
+    $$PWD/HardwareFilter.h \
+    $$PWD/SoftwareFilter.h
 
-FORMS += \
-    $$PWD/GenericCanSetupPage.ui
+# the setup page is only used by SetupDialog, leave it out of the
+# command-line build
+!headless {
+    SOURCES += $$PWD/GenericCanSetupPage.cpp
+    HEADERS += $$PWD/GenericCanSetupPage.h
+    FORMS += $$PWD/GenericCanSetupPage.ui
+}
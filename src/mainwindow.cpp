@@ -36,6 +36,12 @@
 #include <window/GraphWindow/GraphWindow.h>
 #include <window/CanStatusWindow/CanStatusWindow.h>
 #include <window/RawTxWindow/RawTxWindow.h>
+#include <window/SignalTxWindow/SignalTxWindow.h>
+#include <window/LoadGeneratorWindow/LoadGeneratorWindow.h>
+#include <window/LatencyWindow/LatencyWindow.h>
+#include <window/BridgeWindow/BridgeWindow.h>
+#include <window/TriggerWindow/TriggerWindow.h>
+#include <window/MetricsWindow/MetricsWindow.h>
 
 #include <driver/SLCANDriver/SLCANDriver.h>
 #include <driver/CANBlastDriver/CANBlasterDriver.h>
@@ -62,6 +68,12 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->actionGraph_View_2, SIGNAL(triggered()), this, SLOT(addGraphWidget()));
     connect(ui->actionSetup, SIGNAL(triggered()), this, SLOT(showSetupDialog()));
     connect(ui->actionTransmit_View, SIGNAL(triggered()), this, SLOT(addRawTxWidget()));
+    connect(ui->actionSignal_Transmit_View, SIGNAL(triggered()), this, SLOT(addSignalTxWidget()));
+    connect(ui->actionLoad_Generator_View, SIGNAL(triggered()), this, SLOT(addLoadGeneratorWidget()));
+    connect(ui->actionLatency_View, SIGNAL(triggered()), this, SLOT(addLatencyWidget()));
+    connect(ui->actionBridge_View, SIGNAL(triggered()), this, SLOT(addBridgeWidget()));
+    connect(ui->actionTrigger_Capture_View, SIGNAL(triggered()), this, SLOT(addTriggerWidget()));
+    connect(ui->actionMetrics_View, SIGNAL(triggered()), this, SLOT(addMetricsWidget()));
 
     connect(ui->actionStart_Measurement, SIGNAL(triggered()), this, SLOT(startMeasurement()));
     connect(ui->actionStop_Measurement, SIGNAL(triggered()), this, SLOT(stopMeasurement()));
@@ -168,11 +180,67 @@ bool MainWindow::loadWorkspaceTab(QDomElement el)
         if (mdi) {
             mdi->loadXML(backend(), el);
         }
+        loadWorkspaceDocks(mw, el);
     }
 
     return true;
 }
 
+void MainWindow::loadWorkspaceDocks(QMainWindow *mw, QDomElement el)
+{
+    // docks are matched to the ones the tab already has by type, in order.
+    // Docks the tab does not create by itself are added.
+    typedef QDockWidget *(MainWindow::*dock_factory_t)(QMainWindow *parent);
+    static const struct {
+        const char *type;
+        dock_factory_t factory;
+    } dockTypes[] = {
+        { "GraphWindow", &MainWindow::addGraphWidget },
+        { "RawTxWindow", &MainWindow::addRawTxWidget },
+        { "SignalTxWindow", &MainWindow::addSignalTxWidget },
+        { "LoadGeneratorWindow", &MainWindow::addLoadGeneratorWidget },
+        { "LatencyWindow", &MainWindow::addLatencyWidget },
+        { "BridgeWindow", &MainWindow::addBridgeWidget },
+        { "TriggerWindow", &MainWindow::addTriggerWidget },
+        { "MetricsWindow", &MainWindow::addMetricsWidget },
+        { "LogWindow", &MainWindow::addLogWidget },
+        { "CanStatusWindow", &MainWindow::addStatusWidget },
+    };
+
+    QList<QWidget*> used;
+
+    for (QDomElement dockEl = el.firstChildElement("dock"); !dockEl.isNull(); dockEl = dockEl.nextSiblingElement("dock")) {
+        QString type = dockEl.attribute("type");
+        ConfigurableWidget *widget = 0;
+
+        foreach (QDockWidget *dock, mw->findChildren<QDockWidget*>()) {
+            ConfigurableWidget *w = dynamic_cast<ConfigurableWidget*>(dock->widget());
+            if (w && !used.contains(w) && (type == w->metaObject()->className())) {
+                widget = w;
+                break;
+            }
+        }
+
+        if (!widget) {
+            QDockWidget *dock = 0;
+            for (unsigned i=0; i<sizeof(dockTypes)/sizeof(dockTypes[0]); i++) {
+                if (type == dockTypes[i].type) {
+                    dock = (this->*dockTypes[i].factory)(mw);
+                    break;
+                }
+            }
+            if (dock) {
+                widget = dynamic_cast<ConfigurableWidget*>(dock->widget());
+            }
+        }
+
+        if (widget) {
+            widget->loadXML(backend(), dockEl);
+            used.append(widget);
+        }
+    }
+}
+
 bool MainWindow::loadWorkspaceSetup(QDomElement el)
 {
     MeasurementSetup setup(&backend());
@@ -243,6 +311,21 @@ bool MainWindow::saveWorkspaceToFile(QString filename)
             return false;
         }
 
+        foreach (QDockWidget *dock, w->findChildren<QDockWidget*>()) {
+            ConfigurableWidget *dockWidget = dynamic_cast<ConfigurableWidget*>(dock->widget());
+            if (!dockWidget) {
+                continue;
+            }
+
+            QDomElement dockEl = doc.createElement("dock");
+            dockEl.setAttribute("type", dockWidget->metaObject()->className());
+            if (!dockWidget->saveXML(backend(), doc, dockEl)) {
+                log_error(QString("Cannot save window settings to file: %1").arg(filename));
+                return false;
+            }
+            tabEl.appendChild(dockEl);
+        }
+
         tabsRoot.appendChild(tabEl);
     }
 
@@ -360,10 +443,13 @@ QMainWindow *MainWindow::createTraceWindow(QString title)
     QDockWidget *dockLogWidget = addLogWidget(mm);
     QDockWidget *dockStatusWidget = addStatusWidget(mm);
     QDockWidget *dockRawTxWidget = addRawTxWidget(mm);
+    QDockWidget *dockSignalTxWidget = addSignalTxWidget(mm);
 
     mm->splitDockWidget(dockRawTxWidget,dockLogWidget,Qt::Horizontal);
     mm->splitDockWidget(dockStatusWidget,dockLogWidget,Qt::Horizontal);
     mm->tabifyDockWidget(dockStatusWidget,dockLogWidget);
+    mm->tabifyDockWidget(dockRawTxWidget,dockSignalTxWidget);
+    dockRawTxWidget->raise();
     ui->mainTabs->setCurrentWidget(mm);
     return mm;
 }
@@ -380,7 +466,7 @@ QMainWindow *MainWindow::createGraphWindow(QString title)
     return mm;
 }
 
-void MainWindow::addGraphWidget(QMainWindow *parent)
+QDockWidget *MainWindow::addGraphWidget(QMainWindow *parent)
 {
     if (!parent) {
         parent = currentTab();
@@ -388,6 +474,7 @@ void MainWindow::addGraphWidget(QMainWindow *parent)
     QDockWidget *dock = new QDockWidget(tr("Graph"), parent);
     dock->setWidget(new GraphWindow(dock, backend()));
     parent->addDockWidget(Qt::BottomDockWidgetArea, dock);
+    return dock;
 }
 
 QDockWidget *MainWindow::addRawTxWidget(QMainWindow *parent)
@@ -401,6 +488,71 @@ QDockWidget *MainWindow::addRawTxWidget(QMainWindow *parent)
     return dock;
 }
 
+QDockWidget *MainWindow::addSignalTxWidget(QMainWindow *parent)
+{
+    if (!parent) {
+        parent = currentTab();
+    }
+    QDockWidget *dock = new QDockWidget(tr("Signal Transmit"), parent);
+    dock->setWidget(new SignalTxWindow(dock, backend()));
+    parent->addDockWidget(Qt::BottomDockWidgetArea, dock);
+    return dock;
+}
+
+QDockWidget *MainWindow::addLoadGeneratorWidget(QMainWindow *parent)
+{
+    if (!parent) {
+        parent = currentTab();
+    }
+    QDockWidget *dock = new QDockWidget(tr("Load Generator"), parent);
+    dock->setWidget(new LoadGeneratorWindow(dock, backend()));
+    parent->addDockWidget(Qt::BottomDockWidgetArea, dock);
+    return dock;
+}
+
+QDockWidget *MainWindow::addLatencyWidget(QMainWindow *parent)
+{
+    if (!parent) {
+        parent = currentTab();
+    }
+    QDockWidget *dock = new QDockWidget(tr("Latency"), parent);
+    dock->setWidget(new LatencyWindow(dock, backend()));
+    parent->addDockWidget(Qt::BottomDockWidgetArea, dock);
+    return dock;
+}
+
+QDockWidget *MainWindow::addBridgeWidget(QMainWindow *parent)
+{
+    if (!parent) {
+        parent = currentTab();
+    }
+    QDockWidget *dock = new QDockWidget(tr("Bridge"), parent);
+    dock->setWidget(new BridgeWindow(dock, backend()));
+    parent->addDockWidget(Qt::BottomDockWidgetArea, dock);
+    return dock;
+}
+
+QDockWidget *MainWindow::addTriggerWidget(QMainWindow *parent)
+{
+    if (!parent) {
+        parent = currentTab();
+    }
+    QDockWidget *dock = new QDockWidget(tr("Trigger Capture"), parent);
+    dock->setWidget(new TriggerWindow(dock, backend()));
+    parent->addDockWidget(Qt::BottomDockWidgetArea, dock);
+    return dock;
+}
+
+QDockWidget *MainWindow::addMetricsWidget(QMainWindow *parent)
+{
+    if (!parent) {
+        parent = currentTab();
+    }
+    QDockWidget *dock = new QDockWidget(tr("Metrics"), parent);
+    dock->setWidget(new MetricsWindow(dock, backend()));
+    parent->addDockWidget(Qt::BottomDockWidgetArea, dock);
+    return dock;
+}
 
 QDockWidget *MainWindow::addLogWidget(QMainWindow *parent)
 {
@@ -56,8 +56,14 @@ protected:
 public slots:
     QMainWindow *createTraceWindow(QString title=QString());
     QMainWindow *createGraphWindow(QString title=QString());
-    void addGraphWidget(QMainWindow *parent=0);
+    QDockWidget *addGraphWidget(QMainWindow *parent=0);
     QDockWidget *addRawTxWidget(QMainWindow *parent=0);
+    QDockWidget *addSignalTxWidget(QMainWindow *parent=0);
+    QDockWidget *addLoadGeneratorWidget(QMainWindow *parent=0);
+    QDockWidget *addLatencyWidget(QMainWindow *parent=0);
+    QDockWidget *addBridgeWidget(QMainWindow *parent=0);
+    QDockWidget *addTriggerWidget(QMainWindow *parent=0);
+    QDockWidget *addMetricsWidget(QMainWindow *parent=0);
     QDockWidget *addLogWidget(QMainWindow *parent=0);
     QDockWidget *addStatusWidget(QMainWindow *parent=0);
 
@@ -98,6 +104,7 @@ private:
 
     void clearWorkspace();
     bool loadWorkspaceTab(QDomElement el);
+    void loadWorkspaceDocks(QMainWindow *mw, QDomElement el);
     bool loadWorkspaceSetup(QDomElement el);
     void loadWorkspaceFromFile(QString filename);
     bool saveWorkspaceToFile(QString filename);
@@ -41,6 +41,12 @@ include($$PWD/window/LogWindow/LogWindow.pri)
 include($$PWD/window/GraphWindow/GraphWindow.pri)
 include($$PWD/window/CanStatusWindow/CanStatusWindow.pri)
 include($$PWD/window/RawTxWindow/RawTxWindow.pri)
+include($$PWD/window/SignalTxWindow/SignalTxWindow.pri)
+include($$PWD/window/LoadGeneratorWindow/LoadGeneratorWindow.pri)
+include($$PWD/window/LatencyWindow/LatencyWindow.pri)
+include($$PWD/window/BridgeWindow/BridgeWindow.pri)
+include($$PWD/window/TriggerWindow/TriggerWindow.pri)
+include($$PWD/window/MetricsWindow/MetricsWindow.pri)
 
 
 unix:PKGCONFIG += libnl-3.0 
@@ -0,0 +1,216 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "BridgeWindow.h"
+#include "ui_BridgeWindow.h"
+
+#include <QDomDocument>
+#include <QTimer>
+#include <QStringList>
+
+#include <core/Backend.h>
+#include <core/CanTxSequence.h>
+#include <driver/CanDriver.h>
+#include <driver/CanInterface.h>
+
+BridgeWindow::BridgeWindow(QWidget *parent, Backend &backend) :
+    ConfigurableWidget(parent),
+    ui(new Ui::BridgeWindow),
+    _backend(backend)
+{
+    ui->setupUi(this);
+
+    connect(ui->pushButtonStart, SIGNAL(toggled(bool)), this, SLOT(startStop(bool)));
+    connect(&backend, SIGNAL(beginMeasurement()), this, SLOT(refreshInterfaces()));
+    connect(&backend, SIGNAL(endMeasurement()), this, SLOT(refreshInterfaces()));
+
+    _timer = new QTimer(this);
+    _timer->setInterval(500);
+    connect(_timer, SIGNAL(timeout()), this, SLOT(updateStats()));
+
+    refreshInterfaces();
+}
+
+BridgeWindow::~BridgeWindow()
+{
+    if (ui->pushButtonStart->isChecked()) {
+        _backend.getBridge().stop();
+    }
+    delete ui;
+}
+
+void BridgeWindow::refreshInterfaces()
+{
+    if (ui->pushButtonStart->isChecked()) {
+        ui->pushButtonStart->setChecked(false);
+    }
+
+    ui->comboBoxA->clear();
+    ui->comboBoxB->clear();
+
+    foreach (CanInterfaceId ifid, _backend.getInterfaceList()) {
+        CanInterface *intf = _backend.getInterfaceById(ifid);
+        if (intf && intf->isOpen()) {
+            QString name = intf->getName() + " " + intf->getDriver()->getName();
+            ui->comboBoxA->addItem(name, QVariant(ifid));
+            ui->comboBoxB->addItem(name, QVariant(ifid));
+        }
+    }
+
+    if (ui->comboBoxB->count() > 1) {
+        ui->comboBoxB->setCurrentIndex(1);
+    }
+
+    ui->pushButtonStart->setEnabled(ui->comboBoxA->count() > 1);
+}
+
+bool BridgeWindow::parseDirection(bool enabled, const QString &filters, const QString &remap, CanBridgeDirectionConfig &config)
+{
+    config.enabled = enabled;
+    config.filters.clear();
+    config.remap.clear();
+
+    foreach (QString s, filters.split(QChar(','), Qt::SkipEmptyParts)) {
+        CanFrameMatcher matcher;
+        if (!matcher.parse(s)) {
+            log_error(tr("Bridge: invalid filter '%1'").arg(s.trimmed()));
+            return false;
+        }
+        config.filters.append(matcher);
+    }
+
+    foreach (QString s, remap.split(QChar(','), Qt::SkipEmptyParts)) {
+        QStringList ids = s.trimmed().split('=');
+        uint32_t from, to;
+        bool from_ext, to_ext;
+        if ((ids.size() != 2)
+         || !CanTxSequence::parseId(ids[0].trimmed(), &from, &from_ext)
+         || !CanTxSequence::parseId(ids[1].trimmed(), &to, &to_ext)) {
+            log_error(tr("Bridge: invalid remapping '%1'").arg(s.trimmed()));
+            return false;
+        }
+        config.remap[from | (from_ext ? 0x80000000 : 0)] = to | (to_ext ? 0x80000000 : 0);
+    }
+
+    return true;
+}
+
+void BridgeWindow::startStop(bool start)
+{
+    CanBridge &bridge = _backend.getBridge();
+
+    if (start) {
+        CanBridgeDirectionConfig a_to_b;
+        CanBridgeDirectionConfig b_to_a;
+        bool ok = parseDirection(ui->checkBoxAtoB->isChecked(), ui->lineEditFilterAtoB->text(), ui->lineEditRemapAtoB->text(), a_to_b)
+               && parseDirection(ui->checkBoxBtoA->isChecked(), ui->lineEditFilterBtoA->text(), ui->lineEditRemapBtoA->text(), b_to_a);
+
+        if (ok) {
+            ok = bridge.start((CanInterfaceId)ui->comboBoxA->currentData().toUInt(),
+                              (CanInterfaceId)ui->comboBoxB->currentData().toUInt(),
+                              a_to_b, b_to_a);
+            if (!ok) {
+                log_error(tr("Bridge: select two different interfaces"));
+            }
+        }
+
+        if (!ok) {
+            ui->pushButtonStart->blockSignals(true);
+            ui->pushButtonStart->setChecked(false);
+            ui->pushButtonStart->blockSignals(false);
+            return;
+        }
+
+        ui->pushButtonStart->setText(tr("Stop"));
+        _timer->start();
+    } else {
+        bridge.stop();
+        _timer->stop();
+        ui->pushButtonStart->setText(tr("Start"));
+    }
+
+    bool editable = !start;
+    ui->comboBoxA->setEnabled(editable);
+    ui->comboBoxB->setEnabled(editable);
+    ui->checkBoxAtoB->setEnabled(editable);
+    ui->checkBoxBtoA->setEnabled(editable);
+    ui->lineEditFilterAtoB->setEnabled(editable);
+    ui->lineEditFilterBtoA->setEnabled(editable);
+    ui->lineEditRemapAtoB->setEnabled(editable);
+    ui->lineEditRemapBtoA->setEnabled(editable);
+
+    updateStats();
+}
+
+QString BridgeWindow::formatStats(const CanBridgeStats &stats)
+{
+    return tr("Forwarded: %1\nFiltered: %2\nDropped: %3\nLatency p50/p99/max: %4 / %5 / %6 us")
+        .arg(stats.forwarded)
+        .arg(stats.filtered)
+        .arg(stats.dropped)
+        .arg(stats.latency.getValueAtPercentile(50))
+        .arg(stats.latency.getValueAtPercentile(99))
+        .arg(stats.latency.getMax());
+}
+
+void BridgeWindow::updateStats()
+{
+    CanBridge &bridge = _backend.getBridge();
+    ui->labelStatsAtoB->setText(tr("A → B\n") + formatStats(bridge.getStats(CanBridge::direction_a_to_b)));
+    ui->labelStatsBtoA->setText(tr("B → A\n") + formatStats(bridge.getStats(CanBridge::direction_b_to_a)));
+}
+
+bool BridgeWindow::saveXML(Backend &backend, QDomDocument &xml, QDomElement &root)
+{
+    if (!ConfigurableWidget::saveXML(backend, xml, root)) { return false; }
+    root.setAttribute("type", "BridgeWindow");
+
+    QDomElement elAtoB = xml.createElement("AtoB");
+    elAtoB.setAttribute("enabled", ui->checkBoxAtoB->isChecked() ? 1 : 0);
+    elAtoB.setAttribute("filter", ui->lineEditFilterAtoB->text());
+    elAtoB.setAttribute("remap", ui->lineEditRemapAtoB->text());
+    root.appendChild(elAtoB);
+
+    QDomElement elBtoA = xml.createElement("BtoA");
+    elBtoA.setAttribute("enabled", ui->checkBoxBtoA->isChecked() ? 1 : 0);
+    elBtoA.setAttribute("filter", ui->lineEditFilterBtoA->text());
+    elBtoA.setAttribute("remap", ui->lineEditRemapBtoA->text());
+    root.appendChild(elBtoA);
+
+    return true;
+}
+
+bool BridgeWindow::loadXML(Backend &backend, QDomElement &el)
+{
+    if (!ConfigurableWidget::loadXML(backend, el)) { return false; }
+
+    QDomElement elAtoB = el.firstChildElement("AtoB");
+    ui->checkBoxAtoB->setChecked(elAtoB.attribute("enabled", "1").toInt() != 0);
+    ui->lineEditFilterAtoB->setText(elAtoB.attribute("filter"));
+    ui->lineEditRemapAtoB->setText(elAtoB.attribute("remap"));
+
+    QDomElement elBtoA = el.firstChildElement("BtoA");
+    ui->checkBoxBtoA->setChecked(elBtoA.attribute("enabled", "1").toInt() != 0);
+    ui->lineEditFilterBtoA->setText(elBtoA.attribute("filter"));
+    ui->lineEditRemapBtoA->setText(elBtoA.attribute("remap"));
+
+    return true;
+}
@@ -0,0 +1,8 @@
+SOURCES += \
+    $$PWD/BridgeWindow.cpp
+
+HEADERS  += \
+    $$PWD/BridgeWindow.h
+
+FORMS    += \
+    $$PWD/BridgeWindow.ui
@@ -0,0 +1,234 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "GraphSignalBuffer.h"
+
+#include <algorithm>
+#include <math.h>
+
+GraphSignalBuffer::GraphSignalBuffer()
+{
+}
+
+void GraphSignalBuffer::clear()
+{
+    _time.clear();
+    _value.clear();
+    _levels.clear();
+    _blockSize.clear();
+}
+
+void GraphSignalBuffer::append(double time, double value)
+{
+    // messages from different interfaces may arrive slightly out of order
+    if (!_time.isEmpty() && (time < _time.last())) {
+        time = _time.last();
+    }
+
+    _time.append(time);
+    _value.append(value);
+
+    if (_levels.isEmpty()) {
+        _levels.append(QVector<bucket_t>());
+        _blockSize.append(pyramid_factor);
+    }
+
+    int idx = _time.size() - 1;
+    for (int level=0; level<_levels.size(); level++) {
+        QVector<bucket_t> &buckets = _levels[level];
+        int b = idx / _blockSize[level];
+        if (b >= buckets.size()) {
+            bucket_t bucket;
+            bucket.min = value;
+            bucket.max = value;
+            bucket.sum = value;
+            buckets.append(bucket);
+        } else {
+            bucket_t &bucket = buckets[b];
+            bucket.min = qMin(bucket.min, value);
+            bucket.max = qMax(bucket.max, value);
+            bucket.sum += value;
+        }
+    }
+
+    // start a new level once the top level has more than one bucket
+    while (_levels.last().size() > 1) {
+        const QVector<bucket_t> &top = _levels.last();
+        bucket_t b = top[0];
+        for (int i=1; i<top.size(); i++) {
+            b.min = qMin(b.min, top[i].min);
+            b.max = qMax(b.max, top[i].max);
+            b.sum += top[i].sum;
+        }
+        _levels.append(QVector<bucket_t>() << b);
+        _blockSize.append(_blockSize.last() * pyramid_factor);
+    }
+}
+
+int GraphSignalBuffer::size() const
+{
+    return _time.size();
+}
+
+double GraphSignalBuffer::timeAt(int idx) const
+{
+    return _time[idx];
+}
+
+double GraphSignalBuffer::valueAt(int idx) const
+{
+    return _value[idx];
+}
+
+int GraphSignalBuffer::lowerBound(double time) const
+{
+    return std::lower_bound(_time.constBegin(), _time.constEnd(), time) - _time.constBegin();
+}
+
+int GraphSignalBuffer::upperBound(double time) const
+{
+    return std::upper_bound(_time.constBegin(), _time.constEnd(), time) - _time.constBegin();
+}
+
+int GraphSignalBuffer::sampleAt(double time) const
+{
+    return upperBound(time) - 1;
+}
+
+bool GraphSignalBuffer::rangeStats(int first, int end, double &min, double &max, double &sum) const
+{
+    first = qMax(0, first);
+    end = qMin(_time.size(), end);
+    if (first >= end) {
+        return false;
+    }
+
+    min = max = _value[first];
+    sum = 0;
+
+    int i = first;
+    while (i < end) {
+        int level = largestBlockAt(i, end, _levels.size()-1);
+        if (level >= 0) {
+            const bucket_t &b = _levels[level][i / _blockSize[level]];
+            min = qMin(min, b.min);
+            max = qMax(max, b.max);
+            sum += b.sum;
+            i += _blockSize[level];
+        } else {
+            min = qMin(min, _value[i]);
+            max = qMax(max, _value[i]);
+            sum += _value[i];
+            i++;
+        }
+    }
+    return true;
+}
+
+int GraphSignalBuffer::largestBlockAt(int idx, int end, int maxLevel) const
+{
+    // largest pyramid block that starts at idx and ends before end, or -1
+    for (int level=qMin(maxLevel, _levels.size()-1); level>=0; level--) {
+        int blockSize = _blockSize[level];
+        if (((idx % blockSize) == 0) && ((idx + blockSize) <= end)) {
+            return level;
+        }
+    }
+    return -1;
+}
+
+void GraphSignalBuffer::decimate(double t0, double t1, int columns, QVector<QPointF> &points, double &ymin, double &ymax) const
+{
+    points.clear();
+    if (_time.isEmpty() || (columns < 1) || (t1 <= t0)) {
+        return;
+    }
+
+    // one sample beyond each end, so the line runs to the border
+    int first = qMax(0, lowerBound(t0) - 1);
+    int end = qMin(_time.size(), upperBound(t1) + 1);
+    int n = end - first;
+    if (n <= 0) {
+        return;
+    }
+
+    if (n <= 2*columns) {
+        points.reserve(n);
+        for (int i=first; i<end; i++) {
+            points.append(QPointF(_time[i], _value[i]));
+            ymin = qMin(ymin, _value[i]);
+            ymax = qMax(ymax, _value[i]);
+        }
+        return;
+    }
+
+    // coarsest level whose blocks still fit into one column
+    int maxLevel = -1;
+    while (((maxLevel+1) < _blockSize.size()) && (_blockSize[maxLevel+1] <= (n / columns))) {
+        maxLevel++;
+    }
+
+    double columnWidth = (t1 - t0) / columns;
+    points.reserve(2*columns + 4);
+
+    int column = -2;
+    double colTime = 0, colMin = 0, colMax = 0;
+
+    int i = first;
+    while (i < end) {
+        int level = largestBlockAt(i, end, maxLevel);
+        double t = _time[i];
+        double vmin, vmax;
+        if (level >= 0) {
+            const bucket_t &b = _levels[level][i / _blockSize[level]];
+            vmin = b.min;
+            vmax = b.max;
+            i += _blockSize[level];
+        } else {
+            vmin = vmax = _value[i];
+            i++;
+        }
+
+        int c = (int)floor((t - t0) / columnWidth);
+        if (c != column) {
+            if (column != -2) {
+                points.append(QPointF(colTime, colMin));
+                if (colMax != colMin) {
+                    points.append(QPointF(colTime, colMax));
+                }
+            }
+            column = c;
+            colTime = t;
+            colMin = vmin;
+            colMax = vmax;
+        } else {
+            colMin = qMin(colMin, vmin);
+            colMax = qMax(colMax, vmax);
+        }
+        ymin = qMin(ymin, vmin);
+        ymax = qMax(ymax, vmax);
+    }
+
+    points.append(QPointF(colTime, colMin));
+    if (colMax != colMin) {
+        points.append(QPointF(colTime, colMax));
+    }
+}
@@ -0,0 +1,76 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <QList>
+#include <QPointF>
+#include <QVector>
+
+/*
+ * Samples of one plotted signal, stored as separate time and value
+ * columns in time order, plus a decimation pyramid: level k holds
+ * min/max/sum of blocks of pyramid_factor^(k+1) samples. The pyramid is
+ * updated as samples are appended, so drawing any time span needs to
+ * visit about as many blocks as there are pixels, however many samples
+ * the span contains.
+ */
+class GraphSignalBuffer
+{
+public:
+    typedef struct {
+        double min;
+        double max;
+        double sum;
+    } bucket_t;
+
+    GraphSignalBuffer();
+
+    void clear();
+    void append(double time, double value);
+
+    int size() const;
+    double timeAt(int idx) const;
+    double valueAt(int idx) const;
+
+    int lowerBound(double time) const; // first sample at or after time
+    int upperBound(double time) const; // first sample after time
+    int sampleAt(double time) const;   // last sample at or before time, or -1
+
+    // min/max/sum of samples [first, end), from the pyramid where possible
+    bool rangeStats(int first, int end, double &min, double &max, double &sum) const;
+
+    // min/max envelope of the samples between t0 and t1, at most two
+    // points per column. ymin/ymax are extended by the returned values.
+    void decimate(double t0, double t1, int columns, QVector<QPointF> &points, double &ymin, double &ymax) const;
+
+private:
+    enum {
+        pyramid_factor = 16
+    };
+
+    QVector<double> _time;
+    QVector<double> _value;
+    QList< QVector<bucket_t> > _levels;
+    QVector<int> _blockSize; // samples per bucket of each level
+
+    int largestBlockAt(int idx, int end, int maxLevel) const;
+};
@@ -23,114 +23,527 @@
 #include "ui_GraphWindow.h"
 
 #include <QDomDocument>
+#include <QMouseEvent>
 
 #include <core/Backend.h>
+#include <core/CanTrace.h>
+#include <core/CanDb.h>
+#include <core/CanDbMessage.h>
+#include <core/CanDbSignal.h>
+#include <core/MeasurementNetwork.h>
 #include <QtCharts/QChartView>
 
-#define NUM_GRAPH_POINTS 20
-
 GraphWindow::GraphWindow(QWidget *parent, Backend &backend) :
     ConfigurableWidget(parent),
     ui(new Ui::GraphWindow),
-    _backend(backend)
+    _backend(backend),
+    _nextRow(0),
+    _dirty(false),
+    _settingRange(false),
+    _viewStart(0),
+    _viewEnd(10),
+    _dragCursor(-1)
 {
     ui->setupUi(this);
 
+    // axis ranges we set ourselves must not look like a zoom
+    _settingRange = true;
 
-    data_series = new QLineSeries();
+    _chart = new QChart();
+    _chart->legend()->setAlignment(Qt::AlignTop);
+    _axisX = new QValueAxis();
+    _axisX->setTitleText(tr("time [s]"));
+    _axisY = new QValueAxis();
+    _chart->addAxis(_axisX, Qt::AlignBottom);
+    _chart->addAxis(_axisY, Qt::AlignLeft);
+    connect(_axisX, SIGNAL(rangeChanged(qreal,qreal)), this, SLOT(onXRangeChanged(qreal,qreal)));
 
-    for(uint32_t i=0; i<NUM_GRAPH_POINTS; i++)
-    {
-        data_series->append(i, i);
+    ui->chartView->setChart(_chart);
+    ui->chartView->setRenderHint(QPainter::Antialiasing);
+    ui->chartView->setRubberBand(QChartView::HorizontalRubberBand);
+    ui->chartView->viewport()->installEventFilter(this);
+
+    for (int i=0; i<2; i++) {
+        _cursorTime[i] = 0;
+        _cursorSeries[i] = new QLineSeries();
+        _cursorSeries[i]->setName(tr("Cursor %1").arg(i+1));
+        _cursorSeries[i]->setPen(QPen(Qt::darkGray, 1, Qt::DashLine));
+        _cursorSeries[i]->setVisible(false);
+        _chart->addSeries(_cursorSeries[i]);
+        _cursorSeries[i]->attachAxis(_axisX);
+        _cursorSeries[i]->attachAxis(_axisY);
+        foreach (QLegendMarker *marker, _chart->legend()->markers(_cursorSeries[i])) {
+            marker->setVisible(false);
+        }
     }
+    _settingRange = false;
+
+    ui->cursorTable->setColumnCount(7);
+    ui->cursorTable->setHorizontalHeaderLabels(QStringList()
+        << tr("Signal") << tr("Cursor 1") << tr("Cursor 2") << tr("Delta")
+        << tr("Min") << tr("Max") << tr("Mean")
+    );
+    ui->cursorTable->verticalHeader()->hide();
+    ui->cursorTable->setVisible(false);
+
+    ui->cbSpan->addItem(tr("1 s"), 1);
+    ui->cbSpan->addItem(tr("10 s"), 10);
+    ui->cbSpan->addItem(tr("1 min"), 60);
+    ui->cbSpan->addItem(tr("10 min"), 600);
+    ui->cbSpan->addItem(tr("1 h"), 3600);
+    ui->cbSpan->addItem(tr("all"), 0);
+    ui->cbSpan->setCurrentIndex(1);
+
+    connect(&backend, SIGNAL(onSetupChanged()), this, SLOT(onSetupChanged()));
+    connect(&backend, SIGNAL(beginMeasurement()), this, SLOT(resetSamples()));
+    connect(backend.getTrace(), SIGNAL(afterClear()), this, SLOT(resetSamples()));
+
+    connect(&_updateTimer, SIGNAL(timeout()), this, SLOT(onUpdateTimer()));
+    _updateTimer.start(update_interval_ms);
+
+    populateSignalList();
+}
 
-    data_chart = new QChart();
-    data_chart->legend()->hide();
-    data_chart->addSeries(data_series);
-    data_chart->createDefaultAxes();
-    data_chart->setTitle("Simple line chart example");
+GraphWindow::~GraphWindow()
+{
+    foreach (plotted_signal_t *sig, _signals) {
+        delete sig;
+    }
+    delete ui;
+    delete _chart;
+}
 
+bool GraphWindow::addSignal(QString name)
+{
+    foreach (plotted_signal_t *sig, _signals) {
+        if (sig->name == name) {
+            return false;
+        }
+    }
 
-    // Have a box pop up that allows the user to select a signal from the loaded DBC to graph
-    // On OK, add that CanDbMessage to a list.
-    // Either sample the values regularly with a timer or somehow emit a signal when the message
-    // is received that we catch here...
+    plotted_signal_t *sig = new plotted_signal_t;
+    sig->name = name;
+    sig->series = new QLineSeries();
+    sig->series->setName(name);
+    _settingRange = true;
+    _chart->addSeries(sig->series);
+    sig->series->attachAxis(_axisX);
+    sig->series->attachAxis(_axisY);
+    _settingRange = false;
+    resolveSignal(sig);
+
+    _signals.append(sig);
+    ui->signalList->addItem(name);
+
+    // new signals are read from the start of the trace
+    rebuildSignalIndex();
+    resetSamples();
+    emit(settingsChanged(this));
+    return true;
+}
 
-    //backend.findDbMessage()
+void GraphWindow::removeSignal(int idx)
+{
+    if ((idx < 0) || (idx >= _signals.size())) {
+        return;
+    }
 
-//    CanDbMessage *result = 0;
+    plotted_signal_t *sig = _signals.takeAt(idx);
+    _chart->removeSeries(sig->series);
+    delete sig->series;
+    delete sig;
+    delete ui->signalList->takeItem(idx);
 
-//    foreach (MeasurementNetwork *network, _networks) {
-//        foreach (pCanDb db, network->_canDbs) {
-//            result = db->getMessageById(msg.getRawId());
-//            if (result != 0) {
-//                return result;
-//            }
-//        }
-//    }
-//    return result;
+    rebuildSignalIndex();
+    _dirty = true;
+    emit(settingsChanged(this));
+}
 
+void GraphWindow::resolveSignal(plotted_signal_t *sig)
+{
+    sig->dbmsg = 0;
+    sig->signal = 0;
 
+    QStringList names = sig->name.split('.');
+    if (names.size() != 2) {
+        return;
+    }
 
-    ui->chartView->setChart(data_chart);
-    ui->chartView->setRenderHint(QPainter::Antialiasing);
+    foreach (MeasurementNetwork *network, _backend.getSetup().getNetworks()) {
+        foreach (pCanDb db, network->_canDbs) {
+            foreach (CanDbMessage *m, db->getMessages()) {
+                if (!sig->signal && (m->getName() == names[0])) {
+                    sig->dbmsg = m;
+                    sig->signal = m->getSignalByName(names[1]);
+                }
+            }
+        }
+    }
+
+    if (sig->signal && !sig->signal->getUnit().isEmpty()) {
+        sig->series->setName(QString("%1 [%2]").arg(sig->name, sig->signal->getUnit()));
+    } else {
+        sig->series->setName(sig->name);
+    }
+}
 
-//    connect(ui->buttonTest, SIGNAL(released()), this, SLOT(testAddData()));
+void GraphWindow::rebuildSignalIndex()
+{
+    _signalsByRawId.clear();
+    foreach (plotted_signal_t *sig, _signals) {
+        if (sig->signal) {
+            _signalsByRawId.insert(sig->dbmsg->getRaw_id(), sig);
+        }
+    }
+}
 
+void GraphWindow::populateSignalList()
+{
+    QString current = ui->cbSignal->currentText();
+    ui->cbSignal->clear();
+
+    QStringList names;
+    foreach (MeasurementNetwork *network, _backend.getSetup().getNetworks()) {
+        foreach (pCanDb db, network->_canDbs) {
+            foreach (CanDbMessage *m, db->getMessages()) {
+                foreach (CanDbSignal *signal, m->getSignals()) {
+                    names.append(m->getName() + "." + signal->name());
+                }
+            }
+        }
+    }
+    names.sort();
+    names.removeDuplicates();
+    ui->cbSignal->addItems(names);
 
+    int idx = ui->cbSignal->findText(current);
+    if (idx >= 0) {
+        ui->cbSignal->setCurrentIndex(idx);
+    }
 }
 
-void GraphWindow::testAddData(qreal new_yval)
+void GraphWindow::onSetupChanged()
 {
-    QLineSeries* serbuf = new QLineSeries();
+    populateSignalList();
+    foreach (plotted_signal_t *sig, _signals) {
+        resolveSignal(sig);
+    }
+    rebuildSignalIndex();
+    resetSamples();
+}
 
-    // Start autorange at first point
-    qreal ymin = data_series->at(1).y();
-    qreal ymax = ymin;
+void GraphWindow::resetSamples()
+{
+    foreach (plotted_signal_t *sig, _signals) {
+        sig->samples.clear();
+    }
+    _nextRow = 0;
+    _dirty = true;
+}
 
-    // Copy all points but first one
-    for(uint32_t i=1; i < data_series->count(); i++)
-    {
-        serbuf->append(data_series->at(i).x()-1, data_series->at(i).y());
+bool GraphWindow::readTrace()
+{
+    CanTrace *trace = _backend.getTrace();
+    int size = trace->size();
 
-        // Autoranging
-        if(data_series->at(i).y() < ymin)
-            ymin = data_series->at(i).y();
-        if(data_series->at(i).y() > ymax)
-            ymax = data_series->at(i).y();
+    if (_signalsByRawId.isEmpty()) {
+        _nextRow = size;
+        return false;
     }
 
-    // Apply Y margin and set range
-    ymin -= 1;
-    ymax += 1;
-    data_chart->axisY()->setRange(ymin, ymax);
+    double t0 = _backend.getTimestampAtMeasurementStart();
+    int end = qMin(size, _nextRow + rows_per_update);
+    bool added = false;
+
+    QVector<CanMessage> block;
+    while (_nextRow < end) {
+        int n = trace->copyMessages(_nextRow, qMin((int)read_block_size, end - _nextRow), block);
+        if (n <= 0) {
+            break;
+        }
+        for (int i=0; i<n; i++) {
+            const CanMessage &msg = block[i];
+            QMultiHash<uint32_t, plotted_signal_t*>::const_iterator it = _signalsByRawId.constFind(msg.getRawId());
+            for (; (it != _signalsByRawId.constEnd()) && (it.key() == msg.getRawId()); ++it) {
+                plotted_signal_t *sig = it.value();
+                if (sig->signal->isPresentInMessage(msg)) {
+                    sig->samples.append(msg.getFloatTimestamp() - t0, sig->signal->extractPhysicalFromMessage(msg));
+                    added = true;
+                }
+            }
+        }
+        _nextRow += n;
+    }
 
-    // Add new point in
-    serbuf->append(serbuf->points().at(serbuf->count()-1).x() + 1, new_yval);
-    testcount++;
+    return added;
+}
 
-    // Replace data
-    data_series->replace(serbuf->points());
+void GraphWindow::onUpdateTimer()
+{
+    if (readTrace()) {
+        _dirty = true;
+    }
 
-    delete serbuf;
+    if (_dirty && isVisible()) {
+        redraw();
+        _dirty = false;
+    }
 }
 
-GraphWindow::~GraphWindow()
+double GraphWindow::span() const
 {
-    delete ui;
-    delete data_chart;
-    delete data_series;
+    return ui->cbSpan->currentData().toDouble();
+}
+
+bool GraphWindow::isFollowing() const
+{
+    return ui->cbFollow->isChecked();
+}
+
+void GraphWindow::redraw()
+{
+    double first = 0, last = 0;
+    bool haveSamples = false;
+    foreach (plotted_signal_t *sig, _signals) {
+        if (sig->samples.size() > 0) {
+            double t0 = sig->samples.timeAt(0);
+            double t1 = sig->samples.timeAt(sig->samples.size()-1);
+            first = haveSamples ? qMin(first, t0) : t0;
+            last = haveSamples ? qMax(last, t1) : t1;
+            haveSamples = true;
+        }
+    }
+
+    double t0 = _viewStart;
+    double t1 = _viewEnd;
+    if (isFollowing()) {
+        t1 = qMax(last, first + 1e-3);
+        t0 = (span() > 0) ? (t1 - span()) : first;
+    }
+
+    int columns = qMax(100, (int)_chart->plotArea().width());
+    double ymin = 0, ymax = 0;
+    bool first_y = true;
+
+    QVector<QPointF> points;
+    foreach (plotted_signal_t *sig, _signals) {
+        double smin = 1e300, smax = -1e300;
+        sig->samples.decimate(t0, t1, columns, points, smin, smax);
+        sig->series->replace(points);
+        if (!points.isEmpty()) {
+            ymin = first_y ? smin : qMin(ymin, smin);
+            ymax = first_y ? smax : qMax(ymax, smax);
+            first_y = false;
+        }
+    }
+
+    double margin = (ymax > ymin) ? (ymax - ymin) * 0.05 : 1;
+
+    _settingRange = true;
+    _axisX->setRange(t0, t1);
+    _axisY->setRange(ymin - margin, ymax + margin);
+    _settingRange = false;
+
+    updateCursors();
+}
+
+double GraphWindow::timeAtPosition(QPoint pos) const
+{
+    QPointF scenePos = ui->chartView->mapToScene(pos);
+    return _chart->mapToValue(_chart->mapFromScene(scenePos), _cursorSeries[0]).x();
+}
+
+void GraphWindow::setCursor(int idx, double time)
+{
+    _cursorTime[idx] = time;
+    updateCursors();
+}
+
+void GraphWindow::setCursorCell(int row, int column, QString text)
+{
+    QTableWidgetItem *item = ui->cursorTable->item(row, column);
+    if (!item) {
+        item = new QTableWidgetItem();
+        ui->cursorTable->setItem(row, column, item);
+    }
+    item->setText(text);
+}
+
+void GraphWindow::updateCursors()
+{
+    bool enabled = ui->cbCursors->isChecked();
+    for (int i=0; i<2; i++) {
+        _cursorSeries[i]->setVisible(enabled);
+    }
+    ui->cursorTable->setVisible(enabled);
+    if (!enabled) {
+        return;
+    }
+
+    for (int i=0; i<2; i++) {
+        _cursorSeries[i]->replace(QVector<QPointF>()
+            << QPointF(_cursorTime[i], _axisY->min())
+            << QPointF(_cursorTime[i], _axisY->max())
+        );
+    }
+
+    double c1 = _cursorTime[0];
+    double c2 = _cursorTime[1];
+    ui->cursorTable->setRowCount(_signals.size() + 1);
+    setCursorCell(0, 0, tr("time [s]"));
+    setCursorCell(0, 1, QString::number(c1, 'f', 6));
+    setCursorCell(0, 2, QString::number(c2, 'f', 6));
+    setCursorCell(0, 3, QString::number(c2 - c1, 'f', 6));
+    for (int col=4; col<7; col++) {
+        setCursorCell(0, col, QString());
+    }
+
+    for (int row=1; row<=_signals.size(); row++) {
+        const GraphSignalBuffer &samples = _signals[row-1]->samples;
+        setCursorCell(row, 0, _signals[row-1]->name);
+
+        int s1 = samples.sampleAt(c1);
+        int s2 = samples.sampleAt(c2);
+        setCursorCell(row, 1, (s1 >= 0) ? QString::number(samples.valueAt(s1), 'g', 8) : QString("-"));
+        setCursorCell(row, 2, (s2 >= 0) ? QString::number(samples.valueAt(s2), 'g', 8) : QString("-"));
+        setCursorCell(row, 3, ((s1 >= 0) && (s2 >= 0)) ? QString::number(samples.valueAt(s2) - samples.valueAt(s1), 'g', 8) : QString("-"));
+
+        int first = samples.lowerBound(qMin(c1, c2));
+        int end = samples.upperBound(qMax(c1, c2));
+        double min, max, sum;
+        if (samples.rangeStats(first, end, min, max, sum)) {
+            setCursorCell(row, 4, QString::number(min, 'g', 8));
+            setCursorCell(row, 5, QString::number(max, 'g', 8));
+            setCursorCell(row, 6, QString::number(sum / (end - first), 'g', 8));
+        } else {
+            for (int col=4; col<7; col++) {
+                setCursorCell(row, col, QString("-"));
+            }
+        }
+    }
+}
+
+bool GraphWindow::eventFilter(QObject *obj, QEvent *event)
+{
+    if ((obj != ui->chartView->viewport()) || !ui->cbCursors->isChecked()) {
+        return ConfigurableWidget::eventFilter(obj, event);
+    }
+
+    switch (event->type()) {
+        case QEvent::MouseButtonPress: {
+            QMouseEvent *mouseEvent = static_cast<QMouseEvent*>(event);
+            if (mouseEvent->button() != Qt::LeftButton) {
+                break;
+            }
+            // grab the cursor closest to the click
+            double t = timeAtPosition(mouseEvent->pos());
+            _dragCursor = (qAbs(t - _cursorTime[0]) <= qAbs(t - _cursorTime[1])) ? 0 : 1;
+            setCursor(_dragCursor, t);
+            return true;
+        }
+        case QEvent::MouseMove:
+            if (_dragCursor >= 0) {
+                setCursor(_dragCursor, timeAtPosition(static_cast<QMouseEvent*>(event)->pos()));
+                return true;
+            }
+            break;
+        case QEvent::MouseButtonRelease:
+            if (_dragCursor >= 0) {
+                _dragCursor = -1;
+                return true;
+            }
+            break;
+        default:
+            break;
+    }
+
+    return ConfigurableWidget::eventFilter(obj, event);
+}
+
+void GraphWindow::on_cbCursors_stateChanged(int state)
+{
+    (void) state;
+    bool enabled = ui->cbCursors->isChecked();
+
+    // clicks move the cursors instead of zooming
+    ui->chartView->setRubberBand(enabled ? QChartView::NoRubberBand : QChartView::HorizontalRubberBand);
+
+    if (enabled) {
+        double width = _axisX->max() - _axisX->min();
+        _cursorTime[0] = _axisX->min() + width / 3;
+        _cursorTime[1] = _axisX->min() + 2 * width / 3;
+    }
+    updateCursors();
+}
+
+void GraphWindow::onXRangeChanged(qreal min, qreal max)
+{
+    if (_settingRange) {
+        return;
+    }
+
+    // zoomed with the rubber band: stop following and keep this range
+    _viewStart = min;
+    _viewEnd = max;
+    ui->cbFollow->setChecked(false);
+    _dirty = true;
+}
+
+void GraphWindow::on_btnAddSignal_released()
+{
+    addSignal(ui->cbSignal->currentText());
+}
+
+void GraphWindow::on_btnRemoveSignal_released()
+{
+    removeSignal(ui->signalList->currentRow());
+}
+
+void GraphWindow::on_cbSpan_currentIndexChanged(int index)
+{
+    (void) index;
+    if (!isFollowing() && (span() > 0)) {
+        _viewStart = _viewEnd - span();
+    }
+    _dirty = true;
+    emit(settingsChanged(this));
+}
+
+void GraphWindow::on_cbFollow_stateChanged(int state)
+{
+    (void) state;
+    _dirty = true;
+    emit(settingsChanged(this));
 }
 
 bool GraphWindow::saveXML(Backend &backend, QDomDocument &xml, QDomElement &root)
 {
     if (!ConfigurableWidget::saveXML(backend, xml, root)) { return false; }
     root.setAttribute("type", "GraphWindow");
+    root.setAttribute("Span", span());
+    root.setAttribute("Follow", isFollowing() ? 1 : 0);
+
+    foreach (plotted_signal_t *sig, _signals) {
+        QDomElement elSignal = xml.createElement("Signal");
+        elSignal.setAttribute("name", sig->name);
+        root.appendChild(elSignal);
+    }
     return true;
 }
 
 bool GraphWindow::loadXML(Backend &backend, QDomElement &el)
 {
     if (!ConfigurableWidget::loadXML(backend, el)) { return false; }
+
+    int idx = ui->cbSpan->findData(el.attribute("Span", "10").toInt());
+    if (idx >= 0) {
+        ui->cbSpan->setCurrentIndex(idx);
+    }
+    ui->cbFollow->setChecked(el.attribute("Follow", "1").toInt() != 0);
+
+    QDomNodeList signalNodes = el.elementsByTagName("Signal");
+    for (int i=0; i<signalNodes.length(); i++) {
+        addSignal(signalNodes.item(i).toElement().attribute("name"));
+    }
     return true;
 }
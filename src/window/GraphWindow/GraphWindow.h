@@ -27,6 +27,11 @@
 #include <QtCharts/QChartView>
 #include <QtCharts/QtCharts>
 #include <QtCharts/QLineSeries>
+#include <QTimer>
+
+#include "GraphSignalBuffer.h"
+
+QT_CHARTS_USE_NAMESPACE
 
 namespace Ui {
 class GraphWindow;
@@ -34,7 +39,15 @@ class GraphWindow;
 
 class QDomDocument;
 class QDomElement;
+class CanDbMessage;
+class CanDbSignal;
 
+/*
+ * Plots DBC signals over time. Samples are extracted from the trace into
+ * one GraphSignalBuffer per signal, a bounded number of trace rows per
+ * update so a large trace is read in the background without blocking the
+ * GUI. The chart only ever gets about two points per horizontal pixel.
+ */
 class GraphWindow : public ConfigurableWidget
 {
     Q_OBJECT
@@ -45,14 +58,72 @@ public:
     virtual bool saveXML(Backend &backend, QDomDocument &xml, QDomElement &root);
     virtual bool loadXML(Backend &backend, QDomElement &el);
 
+    bool addSignal(QString name);
+    void removeSignal(int idx);
+
 private slots:
-    void testAddData(qreal new_yval);
+    void onSetupChanged();
+    void resetSamples();
+    void onUpdateTimer();
+    void onXRangeChanged(qreal min, qreal max);
+
+    void on_btnAddSignal_released();
+    void on_btnRemoveSignal_released();
+    void on_cbSpan_currentIndexChanged(int index);
+    void on_cbFollow_stateChanged(int state);
+    void on_cbCursors_stateChanged(int state);
+
+protected:
+    virtual bool eventFilter(QObject *obj, QEvent *event);
 
 private:
-    QLineSeries *data_series;
-    QChart *data_chart;
-    uint32_t testcount;
+    enum {
+        update_interval_ms = 50,
+        rows_per_update = 200000,
+        read_block_size = 4096
+    };
+
+    typedef struct {
+        QString name; // Message.Signal
+        CanDbMessage *dbmsg;
+        CanDbSignal *signal;
+        GraphSignalBuffer samples;
+        QLineSeries *series;
+    } plotted_signal_t;
 
     Ui::GraphWindow *ui;
     Backend &_backend;
+
+    QChart *_chart;
+    QValueAxis *_axisX;
+    QValueAxis *_axisY;
+    QTimer _updateTimer;
+
+    QList<plotted_signal_t*> _signals;
+    QMultiHash<uint32_t, plotted_signal_t*> _signalsByRawId;
+
+    int _nextRow;      // next trace row to extract samples from
+    bool _dirty;
+    bool _settingRange;
+    double _viewStart; // shown range when not following
+    double _viewEnd;
+
+    // two measurement cursors; values at the cursors are found by binary
+    // search, statistics between them come from the decimation pyramid
+    QLineSeries *_cursorSeries[2];
+    double _cursorTime[2];
+    int _dragCursor;
+
+    void resolveSignal(plotted_signal_t *sig);
+    void rebuildSignalIndex();
+    void populateSignalList();
+    bool readTrace();
+    void redraw();
+    double span() const;
+    bool isFollowing() const;
+
+    double timeAtPosition(QPoint pos) const;
+    void setCursor(int idx, double time);
+    void updateCursors();
+    void setCursorCell(int row, int column, QString text);
 };
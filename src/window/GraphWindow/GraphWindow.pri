@@ -1,8 +1,10 @@
 SOURCES += \     
-    $$PWD/GraphWindow.cpp
+    $$PWD/GraphWindow.cpp \
+    $$PWD/GraphSignalBuffer.cpp
 
 HEADERS  += \
-    $$PWD/GraphWindow.h
+    $$PWD/GraphWindow.h \
+    $$PWD/GraphSignalBuffer.h
 
 FORMS    += \
     $$PWD/GraphWindow.ui
@@ -0,0 +1,95 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "LatencyHistogramWidget.h"
+
+#include <QPainter>
+
+LatencyHistogramWidget::LatencyHistogramWidget(QWidget *parent)
+  : QWidget(parent),
+    _histogram(1)
+{
+    setMinimumHeight(120);
+}
+
+void LatencyHistogramWidget::setHistogram(const HdrHistogram &histogram)
+{
+    _histogram = histogram;
+    update();
+}
+
+void LatencyHistogramWidget::clear()
+{
+    _histogram = HdrHistogram(1);
+    update();
+}
+
+void LatencyHistogramWidget::paintEvent(QPaintEvent *event)
+{
+    (void) event;
+
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().base());
+
+    if (_histogram.getTotalCount() == 0) {
+        painter.setPen(palette().color(QPalette::Disabled, QPalette::Text));
+        painter.drawText(rect(), Qt::AlignCenter, tr("no samples"));
+        return;
+    }
+
+    // buckets are log-linear, so drawing them side by side gives a log-like time axis
+    int first = -1;
+    int last = 0;
+    uint64_t peak = 0;
+    for (int i=0; i<_histogram.getBucketCount(); i++) {
+        uint64_t count = _histogram.getCountAt(i);
+        if (count) {
+            if (first < 0) { first = i; }
+            last = i;
+            peak = qMax(peak, count);
+        }
+    }
+
+    QFontMetrics fm = painter.fontMetrics();
+    QRect plot = rect().adjusted(4, fm.height() + 4, -4, -fm.height() - 4);
+    int n = last - first + 1;
+    double w = (double)plot.width() / n;
+
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(palette().highlight());
+    for (int i=first; i<=last; i++) {
+        uint64_t count = _histogram.getCountAt(i);
+        if (!count) { continue; }
+        int h = qMax(1, (int)(plot.height() * count / peak));
+        painter.drawRect(QRectF(plot.left() + (i-first) * w, plot.bottom() - h, qMax(w, 1.0), h));
+    }
+
+    painter.setPen(palette().color(QPalette::Text));
+    painter.drawText(rect().adjusted(4, 2, -4, -2), Qt::AlignBottom | Qt::AlignLeft,
+                     QString("%1 us").arg(_histogram.getBucketLowerBound(first)));
+    painter.drawText(rect().adjusted(4, 2, -4, -2), Qt::AlignBottom | Qt::AlignRight,
+                     QString("%1 us").arg(_histogram.getBucketUpperBound(last)));
+    painter.drawText(rect().adjusted(4, 2, -4, -2), Qt::AlignTop | Qt::AlignLeft,
+                     tr("n=%1  mean=%2 us  p99=%3 us")
+                         .arg(_histogram.getTotalCount())
+                         .arg(_histogram.getMean(), 0, 'f', 1)
+                         .arg(_histogram.getValueAtPercentile(99)));
+}
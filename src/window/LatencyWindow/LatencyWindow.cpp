@@ -0,0 +1,213 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "LatencyWindow.h"
+#include "ui_LatencyWindow.h"
+#include "LatencyHistogramWidget.h"
+
+#include <QDomDocument>
+#include <QTimer>
+
+#include <core/Backend.h>
+#include <core/CanLatencyAnalyzer.h>
+
+LatencyWindow::LatencyWindow(QWidget *parent, Backend &backend) :
+    ConfigurableWidget(parent),
+    ui(new Ui::LatencyWindow),
+    _backend(backend)
+{
+    ui->setupUi(this);
+
+    _histogram = new LatencyHistogramWidget(this);
+    ui->verticalLayout->addWidget(_histogram);
+
+    ui->tableRules->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+
+    connect(ui->addRuleButton, SIGNAL(released()), this, SLOT(addRule()));
+    connect(ui->removeRuleButton, SIGNAL(released()), this, SLOT(removeRule()));
+    connect(ui->resetButton, SIGNAL(released()), this, SLOT(resetStatistics()));
+    connect(ui->tableRules, SIGNAL(itemSelectionChanged()), this, SLOT(updateStatistics()));
+
+    _timer = new QTimer(this);
+    _timer->setInterval(250);
+    connect(_timer, SIGNAL(timeout()), this, SLOT(updateStatistics()));
+    _timer->start();
+
+    refreshTable();
+}
+
+LatencyWindow::~LatencyWindow()
+{
+    delete ui;
+}
+
+void LatencyWindow::addRule()
+{
+    CanLatencyRule rule;
+    rule.name = ui->lineEditName->text();
+    rule.timeout_us = ui->spinBoxTimeout->value() * 1000;
+
+    if (!rule.request.setId(ui->lineEditRequestId->text(), ui->lineEditRequestMask->text())
+     || !rule.request.setPayloadPattern(ui->lineEditRequestData->text())) {
+        log_error(tr("Invalid latency request definition"));
+        return;
+    }
+    if (!rule.response.setId(ui->lineEditResponseId->text(), ui->lineEditResponseMask->text())
+     || !rule.response.setPayloadPattern(ui->lineEditResponseData->text())) {
+        log_error(tr("Invalid latency response definition"));
+        return;
+    }
+
+    if (rule.name.isEmpty()) {
+        rule.name = rule.request.getIdString() + " -> " + rule.response.getIdString();
+    }
+
+    int row = _backend.getLatencyAnalyzer().addRule(rule);
+    refreshTable();
+    ui->tableRules->selectRow(row);
+}
+
+void LatencyWindow::removeRule()
+{
+    int row = ui->tableRules->currentRow();
+    if (row < 0) {
+        return;
+    }
+    _backend.getLatencyAnalyzer().removeRule(row);
+    refreshTable();
+}
+
+void LatencyWindow::resetStatistics()
+{
+    _backend.getLatencyAnalyzer().reset();
+    updateStatistics();
+}
+
+void LatencyWindow::refreshTable()
+{
+    CanLatencyAnalyzer &analyzer = _backend.getLatencyAnalyzer();
+    int count = analyzer.getRuleCount();
+
+    ui->tableRules->setRowCount(count);
+    for (int row=0; row<count; row++) {
+        CanLatencyRule rule = analyzer.getRule(row);
+
+        QString request = rule.request.getIdString();
+        if (!rule.request.getPayloadPattern().isEmpty()) {
+            request += " [" + rule.request.getPayloadPattern() + "]";
+        }
+        QString response = rule.response.getIdString();
+        if (!rule.response.getPayloadPattern().isEmpty()) {
+            response += " [" + rule.response.getPayloadPattern() + "]";
+        }
+
+        ui->tableRules->setItem(row, 0, new QTableWidgetItem(rule.name));
+        ui->tableRules->setItem(row, 1, new QTableWidgetItem(request));
+        ui->tableRules->setItem(row, 2, new QTableWidgetItem(response));
+        for (int col=3; col<ui->tableRules->columnCount(); col++) {
+            QTableWidgetItem *item = new QTableWidgetItem();
+            item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            ui->tableRules->setItem(row, col, item);
+        }
+    }
+
+    updateStatistics();
+}
+
+void LatencyWindow::updateStatistics()
+{
+    CanLatencyAnalyzer &analyzer = _backend.getLatencyAnalyzer();
+    if (analyzer.getRuleCount() != ui->tableRules->rowCount()) {
+        refreshTable();
+        return;
+    }
+
+    CanLatencyResult result;
+    for (int row=0; row<ui->tableRules->rowCount(); row++) {
+        if (!analyzer.getResult(row, result)) {
+            continue;
+        }
+
+        const HdrHistogram &h = result.histogram;
+        bool any = h.getTotalCount() > 0;
+        ui->tableRules->item(row, 3)->setText(QString::number(result.requests));
+        ui->tableRules->item(row, 4)->setText(QString::number(result.responses));
+        ui->tableRules->item(row, 5)->setText(QString::number(result.timeouts));
+        ui->tableRules->item(row, 6)->setText(any ? QString::number(h.getMin()) : "");
+        ui->tableRules->item(row, 7)->setText(any ? QString::number(h.getValueAtPercentile(50)) : "");
+        ui->tableRules->item(row, 8)->setText(any ? QString::number(h.getValueAtPercentile(90)) : "");
+        ui->tableRules->item(row, 9)->setText(any ? QString::number(h.getValueAtPercentile(99)) : "");
+        ui->tableRules->item(row, 10)->setText(any ? QString::number(h.getValueAtPercentile(99.9)) : "");
+        ui->tableRules->item(row, 11)->setText(any ? QString::number(h.getMax()) : "");
+
+        if (row == ui->tableRules->currentRow()) {
+            _histogram->setHistogram(h);
+        }
+    }
+
+    if (ui->tableRules->currentRow() < 0) {
+        _histogram->clear();
+    }
+}
+
+bool LatencyWindow::saveXML(Backend &backend, QDomDocument &xml, QDomElement &root)
+{
+    if (!ConfigurableWidget::saveXML(backend, xml, root)) { return false; }
+    root.setAttribute("type", "LatencyWindow");
+
+    CanLatencyAnalyzer &analyzer = backend.getLatencyAnalyzer();
+    for (int i=0; i<analyzer.getRuleCount(); i++) {
+        CanLatencyRule rule = analyzer.getRule(i);
+        QDomElement elRule = xml.createElement("Rule");
+        elRule.setAttribute("name", rule.name);
+        elRule.setAttribute("timeout-us", rule.timeout_us);
+        elRule.setAttribute("request-id", rule.request.getIdString());
+        elRule.setAttribute("request-mask", rule.request.getMaskString());
+        elRule.setAttribute("request-data", rule.request.getPayloadPattern());
+        elRule.setAttribute("response-id", rule.response.getIdString());
+        elRule.setAttribute("response-mask", rule.response.getMaskString());
+        elRule.setAttribute("response-data", rule.response.getPayloadPattern());
+        root.appendChild(elRule);
+    }
+
+    return true;
+}
+
+bool LatencyWindow::loadXML(Backend &backend, QDomElement &el)
+{
+    if (!ConfigurableWidget::loadXML(backend, el)) { return false; }
+
+    CanLatencyAnalyzer &analyzer = backend.getLatencyAnalyzer();
+    for (QDomElement elRule = el.firstChildElement("Rule"); !elRule.isNull(); elRule = elRule.nextSiblingElement("Rule")) {
+        CanLatencyRule rule;
+        rule.name = elRule.attribute("name");
+        rule.timeout_us = elRule.attribute("timeout-us", "1000000").toUInt();
+        if (rule.request.setId(elRule.attribute("request-id"), elRule.attribute("request-mask"))
+         && rule.request.setPayloadPattern(elRule.attribute("request-data"))
+         && rule.response.setId(elRule.attribute("response-id"), elRule.attribute("response-mask"))
+         && rule.response.setPayloadPattern(elRule.attribute("response-data"))) {
+            analyzer.addRule(rule);
+        }
+    }
+
+    refreshTable();
+    return true;
+}
@@ -0,0 +1,10 @@
+SOURCES += \
+    $$PWD/LatencyWindow.cpp \
+    $$PWD/LatencyHistogramWidget.cpp
+
+HEADERS  += \
+    $$PWD/LatencyWindow.h \
+    $$PWD/LatencyHistogramWidget.h
+
+FORMS    += \
+    $$PWD/LatencyWindow.ui
@@ -0,0 +1,131 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "LoadGeneratorWindow.h"
+#include "ui_LoadGeneratorWindow.h"
+
+#include <QTimer>
+
+#include <core/Backend.h>
+#include <core/CanLoadGenerator.h>
+#include <driver/CanDriver.h>
+#include <driver/CanInterface.h>
+
+LoadGeneratorWindow::LoadGeneratorWindow(QWidget *parent, Backend &backend) :
+    ConfigurableWidget(parent),
+    ui(new Ui::LoadGeneratorWindow),
+    _backend(backend)
+{
+    ui->setupUi(this);
+
+    connect(ui->pushButtonStart, SIGNAL(toggled(bool)), this, SLOT(startStop(bool)));
+    connect(&backend, SIGNAL(beginMeasurement()), this, SLOT(refreshInterfaces()));
+    connect(&backend, SIGNAL(endMeasurement()), this, SLOT(refreshInterfaces()));
+
+    _timer = new QTimer(this);
+    _timer->setInterval(500);
+    connect(_timer, SIGNAL(timeout()), this, SLOT(updateStats()));
+
+    refreshInterfaces();
+}
+
+LoadGeneratorWindow::~LoadGeneratorWindow()
+{
+    delete ui;
+}
+
+void LoadGeneratorWindow::refreshInterfaces()
+{
+    ui->comboBoxInterface->clear();
+
+    foreach (CanInterfaceId ifid, _backend.getInterfaceList()) {
+        CanInterface *intf = _backend.getInterfaceById(ifid);
+        if (intf && intf->isOpen()) {
+            ui->comboBoxInterface->addItem(intf->getName() + " " + intf->getDriver()->getName(), QVariant(ifid));
+        }
+    }
+
+    bool enable = ui->comboBoxInterface->count() > 0;
+    if (!enable && ui->pushButtonStart->isChecked()) {
+        ui->pushButtonStart->setChecked(false);
+    }
+    setEnabled(enable);
+}
+
+void LoadGeneratorWindow::startStop(bool start)
+{
+    CanLoadGenerator &generator = _backend.getLoadGenerator();
+
+    if (!start) {
+        generator.stopLoad();
+        _timer->stop();
+        updateStats();
+        ui->pushButtonStart->setText(tr("Start"));
+        return;
+    }
+
+    CanLoadGeneratorConfig config;
+    config.interface = (CanInterfaceId)ui->comboBoxInterface->currentData().toUInt();
+    config.targetLoad = ui->doubleSpinBoxLoad->value();
+    config.idMin = ui->lineEditIdMin->text().toUInt(NULL, 16);
+    config.idMax = ui->lineEditIdMax->text().toUInt(NULL, 16);
+    config.extended = ui->checkBoxExtended->isChecked();
+    config.fdPercent = ui->spinBoxFd->value();
+    config.brsPercent = ui->spinBoxBrs->value();
+    config.burstLength = ui->spinBoxBurst->value();
+
+    uint32_t id_limit = config.extended ? 0x1FFFFFFF : 0x7FF;
+    config.idMin = qMin(config.idMin, id_limit);
+    config.idMax = qMin(config.idMax, id_limit);
+
+    foreach (QString s, ui->lineEditLengths->text().split(QChar(','), Qt::SkipEmptyParts)) {
+        bool ok;
+        int length = s.trimmed().toInt(&ok);
+        if (ok && (length >= 0) && (length <= 64)) {
+            config.lengths.append(length);
+        }
+    }
+
+    if (!generator.startLoad(config)) {
+        ui->pushButtonStart->blockSignals(true);
+        ui->pushButtonStart->setChecked(false);
+        ui->pushButtonStart->blockSignals(false);
+        return;
+    }
+
+    ui->pushButtonStart->setText(tr("Stop"));
+    _timer->start();
+}
+
+void LoadGeneratorWindow::updateStats()
+{
+    CanLoadGeneratorStats stats = _backend.getLoadGenerator().getStats();
+
+    ui->labelStats->setText(
+        tr("Frames sent: %1\nRejected by driver: %2\nAchieved load: %3 %\nTX errors: %4\nTX dropped: %5\nElapsed: %6 s")
+            .arg(stats.framesSent)
+            .arg(stats.framesRejected)
+            .arg(stats.achievedLoad, 0, 'f', 1)
+            .arg(stats.txErrors)
+            .arg(stats.txDropped)
+            .arg(stats.elapsed, 0, 'f', 1)
+    );
+}
@@ -0,0 +1,8 @@
+SOURCES += \
+    $$PWD/LoadGeneratorWindow.cpp
+
+HEADERS  += \
+    $$PWD/LoadGeneratorWindow.h
+
+FORMS    += \
+    $$PWD/LoadGeneratorWindow.ui
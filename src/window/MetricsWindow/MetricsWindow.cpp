@@ -0,0 +1,267 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "MetricsWindow.h"
+#include "ui_MetricsWindow.h"
+
+#include <QDomDocument>
+#include <QFile>
+#include <QFileDialog>
+#include <QTextStream>
+#include <QTimer>
+
+#include <core/Backend.h>
+#include <core/CanStreamServer.h>
+#include <driver/CanDriver.h>
+#include <driver/CanInterface.h>
+
+MetricsWindow::MetricsWindow(QWidget *parent, Backend &backend) :
+    ConfigurableWidget(parent),
+    ui(new Ui::MetricsWindow),
+    _backend(backend),
+    _lastStreamDropped(0)
+{
+    ui->setupUi(this);
+    ui->treeMetrics->setHeaderLabels(QStringList()
+                                     << tr("Metric") << tr("Total") << tr("Rate [1/s]")
+                                     << tr("Mean") << tr("p50") << tr("p99") << tr("Max"));
+    ui->treeMetrics->setColumnWidth(column_metric, 200);
+
+    connect(ui->exportButton, SIGNAL(released()), this, SLOT(exportCsv()));
+
+    CanMetrics::snapshot(_last, _lastPerInterface);
+    _lastStreamDropped = _backend.getStreamServer().getFramesDropped();
+    _interval.start();
+
+    _timer = new QTimer(this);
+    _timer->setInterval(update_interval);
+    connect(_timer, SIGNAL(timeout()), this, SLOT(updateMetrics()));
+    _timer->start();
+
+    updateMetrics();
+}
+
+MetricsWindow::~MetricsWindow()
+{
+    delete ui;
+}
+
+QTreeWidgetItem *MetricsWindow::getItem(QTreeWidgetItem *parent, QString key, QString name)
+{
+    QTreeWidgetItem *item = _items.value(key, 0);
+    if (!item) {
+        if (parent) {
+            item = new QTreeWidgetItem(parent);
+        } else {
+            item = new QTreeWidgetItem(ui->treeMetrics);
+            item->setExpanded(true);
+        }
+        item->setText(column_metric, name);
+        for (int i=column_total; i<column_count; i++) {
+            item->setTextAlignment(i, Qt::AlignRight | Qt::AlignVCenter);
+        }
+        _items[key] = item;
+    }
+    return item;
+}
+
+void MetricsWindow::setCounter(QTreeWidgetItem *item, quint64 total, quint64 delta, double seconds)
+{
+    item->setText(column_total, QString::number(total));
+    item->setText(column_rate, QString::number(delta / seconds, 'f', 0));
+}
+
+void MetricsWindow::setHistogram(QTreeWidgetItem *item, const CanMetrics::values_t &total, const CanMetrics::values_t &interval, CanMetrics::histogram_t histogram, double seconds)
+{
+    quint64 n = CanMetrics::histogramCount(total, histogram);
+    item->setText(column_total, QString::number(n));
+    item->setText(column_rate, QString::number(CanMetrics::histogramCount(interval, histogram) / seconds, 'f', 0));
+    item->setText(column_mean, n ? QString::number(CanMetrics::histogramMean(total, histogram), 'f', 1) : "");
+    item->setText(column_p50, n ? QString::number(CanMetrics::histogramPercentile(total, histogram, 0.50)) : "");
+    item->setText(column_p99, n ? QString::number(CanMetrics::histogramPercentile(total, histogram, 0.99)) : "");
+    item->setText(column_max, n ? QString::number(total.max[histogram]) : "");
+}
+
+QStringList MetricsWindow::pipelineColumns()
+{
+    QStringList columns;
+    for (int i=0; i<CanMetrics::counter_count; i++) {
+        columns << CanMetrics::counterName((CanMetrics::counter_t)i) + " [1/s]";
+    }
+    for (int h=0; h<CanMetrics::histogram_count; h++) {
+        QString name = CanMetrics::histogramName((CanMetrics::histogram_t)h);
+        columns << name + " count" << name + " mean" << name + " p99";
+    }
+    columns << tr("stream server dropped [1/s]");
+    return columns;
+}
+
+void MetricsWindow::updateMetrics()
+{
+    double seconds = qMax<qint64>(1, _interval.restart()) / 1000.0;
+
+    CanMetrics::values_t total;
+    QMap<CanInterfaceId, CanMetrics::values_t> perInterface;
+    CanMetrics::snapshot(total, perInterface);
+
+    CanMetrics::values_t interval = total;
+    CanMetrics::subtractValues(interval, _last);
+
+    history_t entry;
+    entry.time = QDateTime::currentDateTime();
+    entry.seconds = seconds;
+
+    // whole pipeline
+    QTreeWidgetItem *pipeline = getItem(0, "pipeline", tr("Pipeline"));
+    for (int i=0; i<CanMetrics::counter_count; i++) {
+        CanMetrics::counter_t counter = (CanMetrics::counter_t)i;
+        QTreeWidgetItem *item = getItem(pipeline, QString("counter%1").arg(i), CanMetrics::counterName(counter));
+        setCounter(item, total.counters[i], interval.counters[i], seconds);
+        entry.pipeline.append(interval.counters[i] / seconds);
+    }
+    for (int h=0; h<CanMetrics::histogram_count; h++) {
+        CanMetrics::histogram_t histogram = (CanMetrics::histogram_t)h;
+        QTreeWidgetItem *item = getItem(pipeline, QString("histogram%1").arg(h), CanMetrics::histogramName(histogram));
+        setHistogram(item, total, interval, histogram, seconds);
+        entry.pipeline.append(CanMetrics::histogramCount(interval, histogram));
+        entry.pipeline.append(CanMetrics::histogramMean(interval, histogram));
+        entry.pipeline.append(CanMetrics::histogramPercentile(interval, histogram, 0.99));
+    }
+
+    quint64 streamDropped = _backend.getStreamServer().getFramesDropped();
+    quint64 streamDelta = streamDropped - qMin(streamDropped, _lastStreamDropped);
+    setCounter(getItem(pipeline, "streamdropped", tr("stream server dropped")), streamDropped, streamDelta, seconds);
+    entry.pipeline.append(streamDelta / seconds);
+    _lastStreamDropped = streamDropped;
+
+    // per listener thread
+    foreach (CanInterfaceId id, perInterface.keys()) {
+        const CanMetrics::values_t &values = perInterface[id];
+        CanMetrics::values_t intfInterval = values;
+        if (_lastPerInterface.contains(id)) {
+            CanMetrics::subtractValues(intfInterval, _lastPerInterface[id]);
+        }
+
+        QString key = QString("intf%1").arg(id);
+        QTreeWidgetItem *intfItem = getItem(0, key, _backend.getDriverName(id) + " " + _backend.getInterfaceName(id));
+
+        setCounter(getItem(intfItem, key + "frames", CanMetrics::counterName(CanMetrics::counter_rx_frames)),
+                   values.counters[CanMetrics::counter_rx_frames], intfInterval.counters[CanMetrics::counter_rx_frames], seconds);
+        setCounter(getItem(intfItem, key + "batches", CanMetrics::counterName(CanMetrics::counter_rx_batches)),
+                   values.counters[CanMetrics::counter_rx_batches], intfInterval.counters[CanMetrics::counter_rx_batches], seconds);
+        setCounter(getItem(intfItem, key + "filtered", CanMetrics::counterName(CanMetrics::counter_rx_filtered)),
+                   values.counters[CanMetrics::counter_rx_filtered], intfInterval.counters[CanMetrics::counter_rx_filtered], seconds);
+        setHistogram(getItem(intfItem, key + "batchsize", CanMetrics::histogramName(CanMetrics::histogram_rx_batch_size)),
+                     values, intfInterval, CanMetrics::histogram_rx_batch_size, seconds);
+        setHistogram(getItem(intfItem, key + "lockwait", CanMetrics::histogramName(CanMetrics::histogram_lock_wait)),
+                     values, intfInterval, CanMetrics::histogram_lock_wait, seconds);
+
+        // overruns are counted by the driver, frames that never made it to the listener
+        quint64 overruns = 0;
+        CanInterface *intf = _backend.getInterfaceById(id);
+        if (intf) {
+            overruns = qMax(0, intf->getNumRxOverruns());
+        }
+        quint64 lastOverruns = _lastOverruns.value(id, overruns);
+        quint64 overrunDelta = overruns - qMin(overruns, lastOverruns);
+        setCounter(getItem(intfItem, key + "overruns", tr("rx overruns")), overruns, overrunDelta, seconds);
+        _lastOverruns[id] = overruns;
+
+        interface_sample_t sample;
+        sample.rxFrames = intfInterval.counters[CanMetrics::counter_rx_frames];
+        sample.rxOverruns = overrunDelta;
+        entry.interfaces[id] = sample;
+    }
+
+    _last = total;
+    _lastPerInterface = perInterface;
+
+    _history.append(entry);
+    while (_history.size() > max_history) {
+        _history.removeFirst();
+    }
+}
+
+void MetricsWindow::exportCsv()
+{
+    QString filename = QFileDialog::getSaveFileName(this, tr("Export metrics"), "", tr("CSV files (*.csv);;All files (*)"));
+    if (filename.isEmpty()) {
+        return;
+    }
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        log_error(tr("Cannot open file for writing: %1").arg(filename));
+        return;
+    }
+
+    // interfaces can come and go between measurements, use all of them
+    QList<CanInterfaceId> interfaces;
+    foreach (const history_t &entry, _history) {
+        foreach (CanInterfaceId id, entry.interfaces.keys()) {
+            if (!interfaces.contains(id)) {
+                interfaces.append(id);
+            }
+        }
+    }
+
+    QStringList header;
+    header << "time" << "interval [s]" << pipelineColumns();
+    foreach (CanInterfaceId id, interfaces) {
+        QString name = _backend.getInterfaceName(id);
+        header << name + " rx frames [1/s]" << name + " rx overruns [1/s]";
+    }
+
+    QTextStream stream(&file);
+    stream << header.join(",") << "\n";
+
+    foreach (const history_t &entry, _history) {
+        QStringList line;
+        line << entry.time.toString(Qt::ISODateWithMs) << QString::number(entry.seconds, 'f', 3);
+        foreach (double value, entry.pipeline) {
+            line << QString::number(value, 'f', 1);
+        }
+        foreach (CanInterfaceId id, interfaces) {
+            if (entry.interfaces.contains(id)) {
+                const interface_sample_t &sample = entry.interfaces[id];
+                line << QString::number(sample.rxFrames / entry.seconds, 'f', 1)
+                     << QString::number(sample.rxOverruns / entry.seconds, 'f', 1);
+            } else {
+                line << "" << "";
+            }
+        }
+        stream << line.join(",") << "\n";
+    }
+
+    log_info(tr("Exported %1 metrics intervals to %2").arg(_history.size()).arg(filename));
+}
+
+bool MetricsWindow::saveXML(Backend &backend, QDomDocument &xml, QDomElement &root)
+{
+    if (!ConfigurableWidget::saveXML(backend, xml, root)) { return false; }
+    root.setAttribute("type", "MetricsWindow");
+    return true;
+}
+
+bool MetricsWindow::loadXML(Backend &backend, QDomElement &el)
+{
+    return ConfigurableWidget::loadXML(backend, el);
+}
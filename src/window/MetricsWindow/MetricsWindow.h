@@ -0,0 +1,104 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QVector>
+
+#include <core/ConfigurableWidget.h>
+#include <core/CanMetrics.h>
+
+namespace Ui {
+class MetricsWindow;
+}
+
+class Backend;
+class QTimer;
+class QTreeWidgetItem;
+
+class MetricsWindow : public ConfigurableWidget
+{
+    Q_OBJECT
+
+public:
+    explicit MetricsWindow(QWidget *parent, Backend &backend);
+    ~MetricsWindow();
+
+    virtual bool saveXML(Backend &backend, QDomDocument &xml, QDomElement &root);
+    virtual bool loadXML(Backend &backend, QDomElement &el);
+
+private slots:
+    void updateMetrics();
+    void exportCsv();
+
+private:
+    enum {
+        column_metric,
+        column_total,
+        column_rate,
+        column_mean,
+        column_p50,
+        column_p99,
+        column_max,
+        column_count
+    };
+
+    enum {
+        update_interval = 1000, // [ms]
+        max_history = 3600      // one hour of one second intervals
+    };
+
+    typedef struct {
+        quint64 rxFrames;
+        quint64 rxOverruns;
+    } interface_sample_t;
+
+    // one line of the CSV export, everything per interval
+    typedef struct {
+        QDateTime time;
+        double seconds;
+        QVector<double> pipeline;
+        QMap<CanInterfaceId, interface_sample_t> interfaces;
+    } history_t;
+
+    Ui::MetricsWindow *ui;
+    Backend &_backend;
+    QTimer *_timer;
+
+    QElapsedTimer _interval;
+    CanMetrics::values_t _last;
+    QMap<CanInterfaceId, CanMetrics::values_t> _lastPerInterface;
+    QMap<CanInterfaceId, quint64> _lastOverruns;
+    quint64 _lastStreamDropped;
+
+    QHash<QString, QTreeWidgetItem*> _items;
+    QList<history_t> _history;
+
+    QTreeWidgetItem *getItem(QTreeWidgetItem *parent, QString key, QString name);
+    void setCounter(QTreeWidgetItem *item, quint64 total, quint64 delta, double seconds);
+    void setHistogram(QTreeWidgetItem *item, const CanMetrics::values_t &total, const CanMetrics::values_t &interval, CanMetrics::histogram_t histogram, double seconds);
+    static QStringList pipelineColumns();
+};
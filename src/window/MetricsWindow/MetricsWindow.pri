@@ -0,0 +1,8 @@
+SOURCES += \
+    $$PWD/MetricsWindow.cpp
+
+HEADERS  += \
+    $$PWD/MetricsWindow.h
+
+FORMS    += \
+    $$PWD/MetricsWindow.ui
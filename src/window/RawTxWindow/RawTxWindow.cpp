@@ -24,13 +24,21 @@
 
 #include <QDomDocument>
 #include <QTimer>
+#include <QFile>
+#include <QFileDialog>
+#include <QMessageBox>
 #include <core/Backend.h>
+#include <core/CanTxScheduler.h>
+#include <core/CanTxSequence.h>
+#include <core/CanTxSequencer.h>
 #include <driver/CanInterface.h>
 
 RawTxWindow::RawTxWindow(QWidget *parent, Backend &backend) :
     ConfigurableWidget(parent),
     ui(new Ui::RawTxWindow),
-    _backend(backend)
+    _backend(backend),
+    _repeatHandle(-1),
+    _sequenceInterface(0)
 {
     ui->setupUi(this);
 
@@ -48,10 +56,15 @@ RawTxWindow::RawTxWindow(QWidget *parent, Backend &backend) :
 
     connect(&backend, SIGNAL(endMeasurement()),  this, SLOT(refreshInterfaces()));
 
-    // Timer for repeating messages
-    repeatmsg_timer = new QTimer(this);
-    repeatmsg_timer->setTimerType(Qt::PreciseTimer);
-    connect(repeatmsg_timer, SIGNAL(timeout()), this, SLOT(repeatmsg_timer_timeout()));
+    connect(ui->addCyclicButton, SIGNAL(released()), this, SLOT(addCyclicMessage()));
+    connect(ui->updateCyclicButton, SIGNAL(released()), this, SLOT(updateCyclicMessage()));
+    connect(ui->removeCyclicButton, SIGNAL(released()), this, SLOT(removeCyclicMessage()));
+    connect(ui->tableCyclic, SIGNAL(itemChanged(QTableWidgetItem*)), this, SLOT(cyclicItemChanged(QTableWidgetItem*)));
+
+    connect(ui->runSequenceButton, SIGNAL(toggled(bool)), this, SLOT(runSequence(bool)));
+    connect(ui->loadSequenceButton, SIGNAL(released()), this, SLOT(loadSequence()));
+    connect(ui->saveSequenceButton, SIGNAL(released()), this, SLOT(saveSequence()));
+    connect(&backend.getTxSequencer(), SIGNAL(sequenceFinished(CanInterfaceId)), this, SLOT(sequenceFinished(CanInterfaceId)));
 
     sendstate_timer = new QTimer(this);
     sendstate_timer->setInterval(100);
@@ -68,6 +81,15 @@ RawTxWindow::RawTxWindow(QWidget *parent, Backend &backend) :
 
 RawTxWindow::~RawTxWindow()
 {
+    if (_repeatHandle >= 0) {
+        _backend.getTxScheduler().removeCyclicMessage(_repeatHandle);
+    }
+    foreach (int handle, _cyclicHandles) {
+        _backend.getTxScheduler().removeCyclicMessage(handle);
+    }
+    if (ui->runSequenceButton->isChecked()) {
+        _backend.getTxSequencer().stop(_sequenceInterface);
+    }
     delete ui;
 }
 
@@ -259,7 +281,6 @@ void RawTxWindow::changeDLC()
         ui->fieldByte7_7->setEnabled(false);
 
     }
-//    repeatmsg_timer->setInterval(ms);
 }
 
 void RawTxWindow::updateCapabilities()
@@ -364,7 +385,10 @@ void RawTxWindow::updateCapabilities()
 void RawTxWindow::changeRepeatRate(int ms)
 {
     if(ms)
-        repeatmsg_timer->setInterval(ms);
+    {
+        if(_repeatHandle >= 0)
+            _backend.getTxScheduler().setCyclicPeriod(_repeatHandle, ms * 1000);
+    }
     else
         ui->spinBox_RepeatRate->setValue(1);
 }
@@ -382,36 +406,33 @@ void RawTxWindow::sendRepeatMessage(bool enable)
                  _can_msg.isExtended(), _can_msg.isRTR(), _can_msg.isErrorFrame(), _can_msg.isFD(), _can_msg.isBRS());
         log_info(outmsg);
 
-        repeatmsg_timer->start(ui->spinBox_RepeatRate->value());
+        _can_msg.setInterfaceId(_intf->getId());
+        _repeatHandle = _backend.getTxScheduler().addCyclicMessage(_intf->getId(), _can_msg, ui->spinBox_RepeatRate->value() * 1000);
         ui->spinBox_RepeatRate->setEnabled(false);
         ui->singleSendButton->setEnabled(false);
         ui->comboBoxInterface->setEnabled(false);
     }
     else
     {
-        repeatmsg_timer->stop();
+        if(_repeatHandle >= 0)
+        {
+            _backend.getTxScheduler().removeCyclicMessage(_repeatHandle);
+            _repeatHandle = -1;
+        }
         ui->spinBox_RepeatRate->setEnabled(true);
         ui->singleSendButton->setEnabled(true);
         ui->comboBoxInterface->setEnabled(true);
     }
 }
 
-void RawTxWindow::repeatmsg_timer_timeout()
-{
-    if(!_intf->isOpen())
-    {
-        log_error(_intf->getName() + " not Open!");
-        return;
-    }
-    _intf->sendMessage(_can_msg);
-}
-
 void RawTxWindow::disableTxWindow(int disable)
 {
     if(disable)
     {
         if(ui->repeatSendButton->isChecked())
             ui->repeatSendButton->toggle();
+        if(ui->runSequenceButton->isChecked())
+            ui->runSequenceButton->toggle();
         this->setDisabled(1);
     }
     else
@@ -624,18 +645,355 @@ void RawTxWindow::sendstate_timer_timeout()
         else
             ui->label_3->setText("");
     }
+
+    refreshCyclicStats();
+    refreshSequenceState();
+}
+
+void RawTxWindow::addCyclicMessage()
+{
+    reflash_can_msg();
+
+    CanInterface *intf = _backend.getInterfaceById((CanInterfaceId)ui->comboBoxInterface->currentData().toUInt());
+    if(intf == NULL)
+    {
+        return;
+    }
+
+    _can_msg.setInterfaceId(intf->getId());
+    int handle = _backend.getTxScheduler().addCyclicMessage(intf->getId(), _can_msg, ui->spinBox_RepeatRate->value() * 1000);
+    if(handle < 0)
+    {
+        log_error(tr("Cannot schedule cyclic message on %1").arg(intf->getName()));
+        return;
+    }
+
+    _cyclicHandles.append(handle);
+    refreshCyclicTable();
+    ui->tableCyclic->selectRow(_cyclicHandles.size() - 1);
+}
+
+void RawTxWindow::updateCyclicMessage()
+{
+    int row = ui->tableCyclic->currentRow();
+    if(row < 0 || row >= _cyclicHandles.size())
+    {
+        return;
+    }
+
+    reflash_can_msg();
+
+    int handle = _cyclicHandles[row];
+    _can_msg.setInterfaceId(_backend.getTxScheduler().getInterfaceId(handle));
+    _backend.getTxScheduler().updateCyclicMessage(handle, _can_msg);
+    refreshCyclicTable();
+    ui->tableCyclic->selectRow(row);
+}
+
+void RawTxWindow::removeCyclicMessage()
+{
+    int row = ui->tableCyclic->currentRow();
+    if(row < 0 || row >= _cyclicHandles.size())
+    {
+        return;
+    }
+
+    _backend.getTxScheduler().removeCyclicMessage(_cyclicHandles.takeAt(row));
+    refreshCyclicTable();
+}
+
+void RawTxWindow::cyclicItemChanged(QTableWidgetItem *item)
+{
+    int row = item->row();
+    if(row < 0 || row >= _cyclicHandles.size())
+    {
+        return;
+    }
+
+    CanTxScheduler &scheduler = _backend.getTxScheduler();
+    int handle = _cyclicHandles[row];
+
+    if(item->column() == 0)
+    {
+        scheduler.setCyclicEnabled(handle, item->checkState() == Qt::Checked);
+    }
+    else if(item->column() == 3)
+    {
+        bool ok;
+        double period_ms = item->text().toDouble(&ok);
+        if(ok && period_ms > 0)
+        {
+            scheduler.setCyclicPeriod(handle, (uint32_t)(period_ms * 1000));
+        }
+
+        ui->tableCyclic->blockSignals(true);
+        item->setText(QString::number(scheduler.getCyclicPeriod(handle) / 1000.0));
+        ui->tableCyclic->blockSignals(false);
+    }
+}
+
+void RawTxWindow::refreshCyclicTable()
+{
+    CanTxScheduler &scheduler = _backend.getTxScheduler();
+
+    ui->tableCyclic->blockSignals(true);
+    ui->tableCyclic->setRowCount(_cyclicHandles.size());
+
+    for(int row=0; row<_cyclicHandles.size(); row++)
+    {
+        int handle = _cyclicHandles[row];
+        CanMessage msg;
+        scheduler.getCyclicMessage(handle, msg);
+
+        QTableWidgetItem *item = new QTableWidgetItem(_backend.getInterfaceName(scheduler.getInterfaceId(handle)));
+        item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsUserCheckable);
+        item->setCheckState(scheduler.isCyclicEnabled(handle) ? Qt::Checked : Qt::Unchecked);
+        ui->tableCyclic->setItem(row, 0, item);
+
+        item = new QTableWidgetItem(msg.getIdString());
+        item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+        ui->tableCyclic->setItem(row, 1, item);
+
+        item = new QTableWidgetItem(msg.getDataHexString());
+        item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+        ui->tableCyclic->setItem(row, 2, item);
+
+        item = new QTableWidgetItem(QString::number(scheduler.getCyclicPeriod(handle) / 1000.0));
+        item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsEditable);
+        ui->tableCyclic->setItem(row, 3, item);
+
+        for(int col=4; col<6; col++)
+        {
+            item = new QTableWidgetItem();
+            item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+            ui->tableCyclic->setItem(row, col, item);
+        }
+    }
+
+    ui->tableCyclic->blockSignals(false);
+    refreshCyclicStats();
+}
+
+void RawTxWindow::refreshCyclicStats()
+{
+    CanTxScheduler &scheduler = _backend.getTxScheduler();
+
+    ui->tableCyclic->blockSignals(true);
+    for(int row=0; row<_cyclicHandles.size(); row++)
+    {
+        CanTxCyclicStats stats;
+        if(scheduler.getCyclicStats(_cyclicHandles[row], stats))
+        {
+            ui->tableCyclic->item(row, 4)->setText(QString::number(stats.sent));
+            ui->tableCyclic->item(row, 5)->setText(QString::number(stats.latenessMaxNs / 1000));
+        }
+    }
+    ui->tableCyclic->blockSignals(false);
+}
+
+void RawTxWindow::runSequence(bool enable)
+{
+    CanTxSequencer &sequencer = _backend.getTxSequencer();
+
+    if(enable)
+    {
+        CanTxSequence sequence;
+        QString error;
+        if(!sequence.parse(ui->plainTextSequence->toPlainText(), &error))
+        {
+            ui->labelSequenceState->setText(error);
+            ui->runSequenceButton->blockSignals(true);
+            ui->runSequenceButton->setChecked(false);
+            ui->runSequenceButton->blockSignals(false);
+            return;
+        }
+
+        _sequenceInterface = (CanInterfaceId)ui->comboBoxInterface->currentData().toUInt();
+        if(!sequencer.start(_sequenceInterface, sequence))
+        {
+            ui->runSequenceButton->blockSignals(true);
+            ui->runSequenceButton->setChecked(false);
+            ui->runSequenceButton->blockSignals(false);
+            return;
+        }
+
+        ui->runSequenceButton->setText(tr("Stop"));
+        ui->plainTextSequence->setReadOnly(true);
+        ui->loadSequenceButton->setEnabled(false);
+    }
+    else
+    {
+        sequencer.stop(_sequenceInterface);
+        ui->runSequenceButton->setText(tr("Run"));
+        ui->plainTextSequence->setReadOnly(false);
+        ui->loadSequenceButton->setEnabled(true);
+    }
+
+    refreshSequenceState();
+}
+
+void RawTxWindow::sequenceFinished(CanInterfaceId interface)
+{
+    if((interface == _sequenceInterface) && ui->runSequenceButton->isChecked())
+    {
+        ui->runSequenceButton->setChecked(false);
+    }
+}
+
+void RawTxWindow::loadSequence()
+{
+    QString filename = QFileDialog::getOpenFileName(this, tr("Load Sequence"), "", tr("Sequence files (*.seq);;All files (*)"));
+    if(filename.isEmpty())
+    {
+        return;
+    }
+
+    CanTxSequence sequence;
+    QString error;
+    if(!sequence.loadFile(filename, &error))
+    {
+        QMessageBox::warning(this, tr("Load Sequence"), tr("Cannot load %1:\n%2").arg(filename, error));
+        return;
+    }
+
+    ui->plainTextSequence->setPlainText(sequence.getText());
+}
+
+void RawTxWindow::saveSequence()
+{
+    QString filename = QFileDialog::getSaveFileName(this, tr("Save Sequence"), "", tr("Sequence files (*.seq);;All files (*)"));
+    if(filename.isEmpty())
+    {
+        return;
+    }
+
+    QFile file(filename);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        QMessageBox::warning(this, tr("Save Sequence"), tr("Cannot write %1:\n%2").arg(filename, file.errorString()));
+        return;
+    }
+    file.write(ui->plainTextSequence->toPlainText().toUtf8());
+}
+
+void RawTxWindow::refreshSequenceState()
+{
+    CanTxSequencerState state;
+    if(!_backend.getTxSequencer().getState(_sequenceInterface, state))
+    {
+        return;
+    }
+
+    if(!state.error.isEmpty())
+    {
+        ui->labelSequenceState->setText(state.error);
+    }
+    else if(state.running)
+    {
+        ui->labelSequenceState->setText(tr("Line %1\nSent: %2\nRX: %3/%4")
+                                        .arg(state.line).arg(state.framesSent)
+                                        .arg(state.rxMatched).arg(state.rxMatched + state.rxTimeouts));
+    }
+    else
+    {
+        ui->labelSequenceState->setText(tr("Done\nSent: %1").arg(state.framesSent));
+    }
+}
+
+void RawTxWindow::setFrameFields(const CanMessage &msg)
+{
+    ui->fieldAddress->setText(QString::number(msg.getId(), 16).toUpper());
+    ui->checkBox_IsExtended->setChecked(msg.isExtended());
+    ui->checkBox_IsRTR->setChecked(msg.isRTR());
+    ui->checkbox_FD->setChecked(msg.isFD());
+    ui->checkbox_BRS->setChecked(msg.isBRS());
+
+    if(ui->comboBoxDLC->findData(msg.getLength()) < 0)
+    {
+        // no interface yet, offer the lengths so updateCapabilities() can restore the selection
+        static const int lengths[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64 };
+        ui->comboBoxDLC->clear();
+        for(unsigned i=0; i<sizeof(lengths)/sizeof(lengths[0]); i++)
+        {
+            ui->comboBoxDLC->addItem(QString::number(lengths[i]), lengths[i]);
+        }
+    }
+    ui->comboBoxDLC->setCurrentIndex(ui->comboBoxDLC->findData(msg.getLength()));
+
+    for(int i=0; i<64; i++)
+    {
+        QLineEdit *field = findChild<QLineEdit*>(QString("fieldByte%1_%2").arg(i % 8).arg(i / 8));
+        if(field)
+        {
+            field->setText(QString("%1").arg(msg.getByte(i), 2, 16, QChar('0')).toUpper());
+        }
+    }
 }
 
 bool RawTxWindow::saveXML(Backend &backend, QDomDocument &xml, QDomElement &root)
 {
     if (!ConfigurableWidget::saveXML(backend, xml, root)) { return false; }
     root.setAttribute("type", "RawTxWindow");
+
+    reflash_can_msg();
+    QDomElement elMessage = xml.createElement("Message");
+    elMessage.setAttribute("frame", CanTxSequence::formatFrame(_can_msg));
+    elMessage.setAttribute("repeat-rate", ui->spinBox_RepeatRate->value());
+    elMessage.setAttribute("display-tx", ui->checkBox_Display_TX->isChecked() ? 1 : 0);
+    root.appendChild(elMessage);
+
+    CanTxScheduler &scheduler = backend.getTxScheduler();
+    foreach (int handle, _cyclicHandles) {
+        CanMessage msg;
+        if (!scheduler.getCyclicMessage(handle, msg)) { continue; }
+        CanInterfaceId ifid = scheduler.getInterfaceId(handle);
+
+        QDomElement elCyclic = xml.createElement("CyclicMessage");
+        elCyclic.setAttribute("driver", backend.getDriverName(ifid));
+        elCyclic.setAttribute("interface", backend.getInterfaceName(ifid));
+        elCyclic.setAttribute("frame", CanTxSequence::formatFrame(msg));
+        elCyclic.setAttribute("period-us", scheduler.getCyclicPeriod(handle));
+        elCyclic.setAttribute("enabled", scheduler.isCyclicEnabled(handle) ? 1 : 0);
+        root.appendChild(elCyclic);
+    }
+
+    QDomElement elSequence = xml.createElement("Sequence");
+    elSequence.appendChild(xml.createTextNode(ui->plainTextSequence->toPlainText()));
+    root.appendChild(elSequence);
+
     return true;
 }
 
 bool RawTxWindow::loadXML(Backend &backend, QDomElement &el)
 {
     if (!ConfigurableWidget::loadXML(backend, el)) { return false; }
+
+    QDomElement elMessage = el.firstChildElement("Message");
+    CanMessage msg;
+    if (!elMessage.isNull() && CanTxSequence::parseFrame(elMessage.attribute("frame"), msg)) {
+        setFrameFields(msg);
+        ui->spinBox_RepeatRate->setValue(elMessage.attribute("repeat-rate", "100").toInt());
+        ui->checkBox_Display_TX->setChecked(elMessage.attribute("display-tx", "1").toInt() != 0);
+    }
+
+    CanTxScheduler &scheduler = backend.getTxScheduler();
+    for (QDomElement elCyclic = el.firstChildElement("CyclicMessage"); !elCyclic.isNull(); elCyclic = elCyclic.nextSiblingElement("CyclicMessage")) {
+        CanInterface *intf = backend.getInterfaceByDriverAndName(elCyclic.attribute("driver"), elCyclic.attribute("interface"));
+        if (!intf || !CanTxSequence::parseFrame(elCyclic.attribute("frame"), msg)) {
+            continue;
+        }
+        msg.setInterfaceId(intf->getId());
+        int handle = scheduler.addCyclicMessage(intf->getId(), msg,
+                                                elCyclic.attribute("period-us", "100000").toUInt(),
+                                                elCyclic.attribute("enabled", "1").toInt() != 0);
+        if (handle >= 0) {
+            _cyclicHandles.append(handle);
+        }
+    }
+    refreshCyclicTable();
+
+    ui->plainTextSequence->setPlainText(el.firstChildElement("Sequence").text());
+
     return true;
 }
 
@@ -31,6 +31,7 @@ class RawTxWindow;
 
 class QDomDocument;
 class QDomElement;
+class QTableWidgetItem;
 
 class RawTxWindow : public ConfigurableWidget
 {
@@ -56,14 +57,23 @@ private slots:
 
     void sendstate_timer_timeout();
 
-    void repeatmsg_timer_timeout();
+    void addCyclicMessage();
+    void updateCyclicMessage();
+    void removeCyclicMessage();
+    void cyclicItemChanged(QTableWidgetItem *item);
 
+    void runSequence(bool enable);
+    void loadSequence();
+    void saveSequence();
+    void sequenceFinished(CanInterfaceId interface);
 
 private:
     Ui::RawTxWindow *ui;
     Backend &_backend;
-    QTimer *repeatmsg_timer;
     QTimer *sendstate_timer;
+    int _repeatHandle;
+    QList<int> _cyclicHandles;
+    CanInterfaceId _sequenceInterface;
 
     CanMessage _can_msg;
     CanInterface *_intf;
@@ -73,4 +83,10 @@ private:
 
     void reflash_can_msg(void);
 
+    void refreshCyclicTable();
+    void refreshCyclicStats();
+    void refreshSequenceState();
+
+    void setFrameFields(const CanMessage &msg);
+
 };
@@ -0,0 +1,320 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "SignalTxWindow.h"
+#include "ui_SignalTxWindow.h"
+
+#include <sys/time.h>
+#include <QTimer>
+#include <QComboBox>
+
+#include <core/Backend.h>
+#include <core/CanDb.h>
+#include <core/CanDbMessage.h>
+#include <core/CanDbSignal.h>
+#include <core/CanTxScheduler.h>
+#include <core/MeasurementSetup.h>
+#include <core/MeasurementNetwork.h>
+#include <driver/CanInterface.h>
+
+SignalTxWindow::SignalTxWindow(QWidget *parent, Backend &backend) :
+    ConfigurableWidget(parent),
+    ui(new Ui::SignalTxWindow),
+    _backend(backend),
+    _cyclicHandle(-1)
+{
+    ui->setupUi(this);
+
+    connect(ui->comboBoxMessage, SIGNAL(currentIndexChanged(int)), this, SLOT(messageChanged(int)));
+    connect(ui->tableSignals, SIGNAL(itemChanged(QTableWidgetItem*)), this, SLOT(signalItemChanged(QTableWidgetItem*)));
+    connect(ui->singleSendButton, SIGNAL(released()), this, SLOT(sendSingleMessage()));
+    connect(ui->cyclicSendButton, SIGNAL(toggled(bool)), this, SLOT(sendCyclicMessage(bool)));
+    connect(ui->spinBoxPeriod, SIGNAL(valueChanged(int)), this, SLOT(changePeriod(int)));
+
+    connect(&backend, SIGNAL(beginMeasurement()), this, SLOT(refreshInterfaces()));
+    connect(&backend, SIGNAL(endMeasurement()), this, SLOT(refreshInterfaces()));
+    connect(&backend, SIGNAL(onSetupChanged()), this, SLOT(refreshMessages()));
+
+    // counters and checksums change every cycle, show their current values
+    _timer = new QTimer(this);
+    _timer->setInterval(200);
+    connect(_timer, SIGNAL(timeout()), this, SLOT(updateValues()));
+
+    refreshMessages();
+    refreshInterfaces();
+}
+
+SignalTxWindow::~SignalTxWindow()
+{
+    stopCyclic();
+    delete ui;
+}
+
+void SignalTxWindow::refreshInterfaces()
+{
+    ui->comboBoxInterface->clear();
+
+    foreach (CanInterfaceId ifid, _backend.getInterfaceList()) {
+        CanInterface *intf = _backend.getInterfaceById(ifid);
+        if (intf && intf->isOpen()) {
+            ui->comboBoxInterface->addItem(intf->getName() + " " + intf->getDriver()->getName(), QVariant(ifid));
+        }
+    }
+
+    bool enable = ui->comboBoxInterface->count() > 0;
+    if (!enable && ui->cyclicSendButton->isChecked()) {
+        ui->cyclicSendButton->setChecked(false);
+    }
+    setEnabled(enable);
+
+    if (enable) {
+        _timer->start();
+    } else {
+        _timer->stop();
+    }
+}
+
+void SignalTxWindow::refreshMessages()
+{
+    // message and signal pointers are owned by the setup, drop everything referring to them
+    if (ui->cyclicSendButton->isChecked()) {
+        ui->cyclicSendButton->setChecked(false);
+    }
+    _encoder.clear();
+
+    ui->comboBoxMessage->blockSignals(true);
+    ui->comboBoxMessage->clear();
+    _dbMessages.clear();
+
+    foreach (MeasurementNetwork *network, _backend.getSetup().getNetworks()) {
+        foreach (pCanDb db, network->_canDbs) {
+            foreach (CanDbMessage *dbmsg, db->getMessages()) {
+                uint32_t raw_id = dbmsg->getRaw_id();
+                QString id_str = (raw_id & 0x80000000) ? QString().asprintf("0x%08X", raw_id & 0x1FFFFFFF) : QString().asprintf("0x%03X", raw_id);
+                ui->comboBoxMessage->addItem(QString("%1 (%2)").arg(dbmsg->getName(), id_str));
+                _dbMessages.append(dbmsg);
+            }
+        }
+    }
+
+    ui->comboBoxMessage->blockSignals(false);
+    messageChanged(ui->comboBoxMessage->currentIndex());
+}
+
+void SignalTxWindow::messageChanged(int index)
+{
+    if (ui->cyclicSendButton->isChecked()) {
+        ui->cyclicSendButton->setChecked(false);
+    }
+
+    ui->tableSignals->blockSignals(true);
+    ui->tableSignals->setRowCount(0);
+
+    if ((index<0) || (index>=_dbMessages.size())) {
+        _encoder.clear();
+        ui->tableSignals->blockSignals(false);
+        return;
+    }
+
+    _encoder = pCanDbMessageEncoder(new CanDbMessageEncoder(_dbMessages[index]));
+    ui->tableSignals->setRowCount(_encoder->getSignalCount());
+
+    for (int i=0; i<_encoder->getSignalCount(); i++) {
+        CanDbSignal *signal = _encoder->getSignal(i);
+
+        QTableWidgetItem *item = new QTableWidgetItem(signal->name());
+        item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+        ui->tableSignals->setItem(i, column_signal, item);
+
+        item = new QTableWidgetItem(QString::number(_encoder->getPhysicalValue(i)));
+        item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsEditable);
+        ui->tableSignals->setItem(i, column_value, item);
+
+        item = new QTableWidgetItem(signal->getUnit());
+        item->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+        ui->tableSignals->setItem(i, column_unit, item);
+
+        QComboBox *cb = new QComboBox(ui->tableSignals);
+        cb->addItem(tr("Value"), role_value);
+        cb->addItem(tr("Alive counter"), role_counter);
+        cb->addItem(tr("CRC8 SAE J1850"), role_crc8_sae_j1850);
+        cb->addItem(tr("CRC8 AUTOSAR"), role_crc8_autosar);
+        cb->addItem(tr("XOR checksum"), role_xor);
+        cb->addItem(tr("Sum checksum"), role_sum);
+        cb->setProperty("signal", i);
+        connect(cb, SIGNAL(currentIndexChanged(int)), this, SLOT(roleChanged(int)));
+        ui->tableSignals->setCellWidget(i, column_role, cb);
+    }
+
+    ui->tableSignals->blockSignals(false);
+}
+
+void SignalTxWindow::signalItemChanged(QTableWidgetItem *item)
+{
+    if (!_encoder || (item->column() != column_value)) {
+        return;
+    }
+
+    bool ok;
+    double value = item->text().toDouble(&ok);
+    if (ok) {
+        _encoder->setPhysicalValue(item->row(), value);
+    }
+
+    // show the value that is actually sent (after rounding and clamping)
+    ui->tableSignals->blockSignals(true);
+    item->setText(QString::number(_encoder->getPhysicalValue(item->row())));
+    ui->tableSignals->blockSignals(false);
+}
+
+void SignalTxWindow::roleChanged(int index)
+{
+    QComboBox *cb = qobject_cast<QComboBox*>(sender());
+    if (!cb || !_encoder) {
+        return;
+    }
+
+    int signal = cb->property("signal").toInt();
+    switch (cb->itemData(index).toInt()) {
+        case role_counter:
+            _encoder->setCounterRole(signal);
+            break;
+        case role_crc8_sae_j1850:
+            _encoder->setChecksumRole(signal, CanDbMessageEncoder::checksum_crc8_sae_j1850);
+            break;
+        case role_crc8_autosar:
+            _encoder->setChecksumRole(signal, CanDbMessageEncoder::checksum_crc8_autosar);
+            break;
+        case role_xor:
+            _encoder->setChecksumRole(signal, CanDbMessageEncoder::checksum_xor);
+            break;
+        case role_sum:
+            _encoder->setChecksumRole(signal, CanDbMessageEncoder::checksum_sum);
+            break;
+        default:
+            _encoder->setValueRole(signal);
+            break;
+    }
+
+    QTableWidgetItem *item = ui->tableSignals->item(signal, column_value);
+    if (item) {
+        Qt::ItemFlags flags = Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+        if (_encoder->getRole(signal) == CanDbMessageEncoder::role_value) {
+            flags |= Qt::ItemIsEditable;
+        }
+        ui->tableSignals->blockSignals(true);
+        item->setFlags(flags);
+        ui->tableSignals->blockSignals(false);
+    }
+}
+
+bool SignalTxWindow::prepareMessage(CanMessage &msg)
+{
+    CanInterface *intf = _backend.getInterfaceById((CanInterfaceId)ui->comboBoxInterface->currentData().toUInt());
+    if (!intf || !_encoder) {
+        return false;
+    }
+
+    if (!intf->isOpen()) {
+        log_error(intf->getName() + " not Open!");
+        return false;
+    }
+
+    msg.setInterfaceId(intf->getId());
+    msg.setRX(false);
+    msg.setShow(true);
+    msg.setErrorFrame(false);
+    msg.setRTR(false);
+    return true;
+}
+
+void SignalTxWindow::sendSingleMessage()
+{
+    CanMessage msg;
+    if (!prepareMessage(msg)) {
+        return;
+    }
+
+    _encoder->encode(msg);
+
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    msg.setTimestamp(tv);
+
+    CanInterface *intf = _backend.getInterfaceById(msg.getInterfaceId());
+    intf->sendMessage(msg);
+    updateValues();
+}
+
+void SignalTxWindow::sendCyclicMessage(bool enable)
+{
+    if (!enable) {
+        stopCyclic();
+        return;
+    }
+
+    CanMessage msg;
+    if (!prepareMessage(msg)) {
+        ui->cyclicSendButton->setChecked(false);
+        return;
+    }
+
+    _cyclicHandle = _backend.getTxScheduler().addCyclicDbMessage(msg.getInterfaceId(), msg, _encoder, ui->spinBoxPeriod->value() * 1000);
+    ui->comboBoxInterface->setEnabled(false);
+    ui->comboBoxMessage->setEnabled(false);
+    ui->singleSendButton->setEnabled(false);
+}
+
+void SignalTxWindow::changePeriod(int ms)
+{
+    if (_cyclicHandle >= 0) {
+        _backend.getTxScheduler().setCyclicPeriod(_cyclicHandle, ms * 1000);
+    }
+}
+
+void SignalTxWindow::stopCyclic()
+{
+    if (_cyclicHandle >= 0) {
+        _backend.getTxScheduler().removeCyclicMessage(_cyclicHandle);
+        _cyclicHandle = -1;
+    }
+    ui->comboBoxInterface->setEnabled(true);
+    ui->comboBoxMessage->setEnabled(true);
+    ui->singleSendButton->setEnabled(true);
+}
+
+void SignalTxWindow::updateValues()
+{
+    if (!_encoder) {
+        return;
+    }
+
+    ui->tableSignals->blockSignals(true);
+    for (int i=0; i<_encoder->getSignalCount(); i++) {
+        if (_encoder->getRole(i) != CanDbMessageEncoder::role_value) {
+            QTableWidgetItem *item = ui->tableSignals->item(i, column_value);
+            if (item) {
+                item->setText(QString::number(_encoder->getPhysicalValue(i)));
+            }
+        }
+    }
+    ui->tableSignals->blockSignals(false);
+}
@@ -0,0 +1,85 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <core/ConfigurableWidget.h>
+#include <core/CanMessage.h>
+#include <core/CanDbMessageEncoder.h>
+
+namespace Ui {
+class SignalTxWindow;
+}
+
+class Backend;
+class CanDbMessage;
+class QTimer;
+class QTableWidgetItem;
+
+class SignalTxWindow : public ConfigurableWidget
+{
+    Q_OBJECT
+
+public:
+    enum {
+        column_signal,
+        column_value,
+        column_unit,
+        column_role,
+        column_count
+    };
+
+    enum {
+        role_value,
+        role_counter,
+        role_crc8_sae_j1850,
+        role_crc8_autosar,
+        role_xor,
+        role_sum
+    };
+
+public:
+    explicit SignalTxWindow(QWidget *parent, Backend &backend);
+    ~SignalTxWindow();
+
+private slots:
+    void refreshInterfaces();
+    void refreshMessages();
+    void messageChanged(int index);
+    void signalItemChanged(QTableWidgetItem *item);
+    void roleChanged(int index);
+    void sendSingleMessage();
+    void sendCyclicMessage(bool enable);
+    void changePeriod(int ms);
+    void updateValues();
+
+private:
+    Ui::SignalTxWindow *ui;
+    Backend &_backend;
+    QTimer *_timer;
+
+    QList<CanDbMessage*> _dbMessages;
+    pCanDbMessageEncoder _encoder;
+    int _cyclicHandle;
+
+    void stopCyclic();
+    bool prepareMessage(CanMessage &msg);
+};
@@ -0,0 +1,8 @@
+SOURCES += \
+    $$PWD/SignalTxWindow.cpp
+
+HEADERS  += \
+    $$PWD/SignalTxWindow.h
+
+FORMS    += \
+    $$PWD/SignalTxWindow.ui
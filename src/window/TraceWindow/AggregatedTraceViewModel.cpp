@@ -21,6 +21,8 @@
 
 #include "AggregatedTraceViewModel.h"
 #include <QColor>
+#include <QMap>
+#include <QPair>
 
 #include <core/Backend.h>
 #include <core/CanTrace.h>
@@ -41,6 +43,7 @@ void AggregatedTraceViewModel::createItem(const CanMessage &msg)
 {
     AggregatedTraceViewItem *item = new AggregatedTraceViewItem(_rootItem);
     item->_lastmsg = msg;
+    item->_prevmsg = CanMessage();
 
     CanDbMessage *dbmsg = backend()->findDbMessage(msg);
     if (dbmsg) {
@@ -49,42 +52,37 @@ void AggregatedTraceViewModel::createItem(const CanMessage &msg)
         }
     }
 
+    _map[makeUniqueKey(msg)] = _rootItem->childCount();
     _rootItem->appendChild(item);
-    _map[makeUniqueKey(msg)] = item;
-}
-
-void AggregatedTraceViewModel::updateItem(const CanMessage &msg)
-{
-    AggregatedTraceViewItem *item = _map.value(makeUniqueKey(msg));
-    if (item) {
-        item->_prevmsg = item->_lastmsg;
-        item->_lastmsg = msg;
-    }
 }
 
 void AggregatedTraceViewModel::onUpdateModel()
 {
-
-    if (!_pendingMessageInserts.isEmpty()) {
-        beginInsertRows(QModelIndex(), _rootItem->childCount(), _rootItem->childCount()+_pendingMessageInserts.size()-1);
-        foreach (CanMessage msg, _pendingMessageInserts) {
-            createItem(msg);
+    struct timeval now;
+    gettimeofday(&now, 0);
+
+    // emit one dataChanged() per run of consecutive changed rows
+    int first = -1;
+    for (int row=0; row<=_rootItem->childCount(); row++) {
+        bool changed = false;
+        if (row < _rootItem->childCount()) {
+            AggregatedTraceViewItem *item = _rootItem->child(row);
+            changed = _dirtyRows.testBit(row) || (getTimeDiff(item->_lastmsg.getTimestamp(), now) < fade_time_ms/1000.0);
+
+            if (_dirtyRows.testBit(row) && item->childCount()>0) {
+                emit dataChanged(createIndex(0, 0, item->firstChild()), createIndex(item->childCount()-1, column_count-1, item->lastChild()));
+            }
         }
-        endInsertRows();
-        _pendingMessageInserts.clear();
-    }
 
-    if (!_pendingMessageUpdates.isEmpty()) {
-        foreach (CanMessage msg, _pendingMessageUpdates) {
-            updateItem(msg);
+        if (changed && (first<0)) {
+            first = row;
+        } else if (!changed && (first>=0)) {
+            emit dataChanged(createIndex(first, 0, _rootItem->child(first)), createIndex(row-1, column_count-1, _rootItem->child(row-1)));
+            first = -1;
         }
-        _pendingMessageUpdates.clear();
-    }
-
-    if (_rootItem->childCount()>0) {
-        dataChanged(createIndex(0, 0, _rootItem->firstChild()), createIndex(_rootItem->childCount()-1, column_count-1, _rootItem->lastChild()));
     }
 
+    _dirtyRows.fill(false);
 }
 
 void AggregatedTraceViewModel::onSetupChanged()
@@ -98,16 +96,55 @@ void AggregatedTraceViewModel::beforeAppend(int num_messages)
     CanTrace *trace = backend()->getTrace();
     int start_id = trace->size();
 
-    for (int i=start_id; i<start_id + num_messages; i++) {
+    // walk the new messages backwards: only the newest message of each id
+    // and the one before it are displayed, so at most two frames per id
+    // are copied per update, however many arrived.
+    typedef QPair<const CanMessage*, const CanMessage*> message_pair_t; // newest, previous
+    QHash<unique_key_t, int> seen; // key -> messages taken so far
+    QMap<unique_key_t, message_pair_t> newItems; // sorted by key, as before
+    for (int i=start_id + num_messages - 1; i>=start_id; i--) {
         const CanMessage *msg = trace->getMessage(i);
+        if (!msg) {
+            continue;
+        }
+
         unique_key_t key = makeUniqueKey(*msg);
-        if (_map.contains(key) || _pendingMessageInserts.contains(key)) {
-            _pendingMessageUpdates.append(*msg);
+        int &taken = seen[key];
+        if (taken >= 2) {
+            continue;
+        }
+
+        CanIdMap::const_iterator it = _map.constFind(key);
+        if (it != _map.constEnd()) {
+            AggregatedTraceViewItem *item = _rootItem->child(it.value());
+            if (taken == 0) {
+                item->_prevmsg = item->_lastmsg;
+                item->_lastmsg = *msg;
+                _dirtyRows.setBit(it.value());
+            } else {
+                item->_prevmsg = *msg;
+            }
+        } else if (taken == 0) {
+            newItems[key] = qMakePair(msg, (const CanMessage*)0);
         } else {
-            _pendingMessageInserts[key] = *msg;
+            newItems[key].second = msg;
+        }
+        taken++;
+    }
+
+    if (!newItems.isEmpty()) {
+        int first = _rootItem->childCount();
+        beginInsertRows(QModelIndex(), first, first+newItems.size()-1);
+        foreach (const message_pair_t &msgs, newItems) {
+            createItem(*msgs.first);
+            if (msgs.second) {
+                _rootItem->lastChild()->_prevmsg = *msgs.second;
+            }
         }
+        endInsertRows();
     }
 
+    _dirtyRows.resize(_rootItem->childCount());
     onUpdateModel();
 }
 
@@ -116,6 +153,7 @@ void AggregatedTraceViewModel::beforeClear()
     beginResetModel();
     delete _rootItem;
     _map.clear();
+    _dirtyRows.clear();
     _rootItem = new AggregatedTraceViewItem(0);
 }
 
@@ -184,6 +222,15 @@ int AggregatedTraceViewModel::rowCount(const QModelIndex &parent) const
     return parentItem->childCount();
 }
 
+const CanMessage *AggregatedTraceViewModel::getMessage(const QModelIndex &index) const
+{
+    AggregatedTraceViewItem *item = (AggregatedTraceViewItem *)index.internalPointer();
+    if (!index.isValid() || !item || (item->parent() != _rootItem)) {
+        return 0;
+    }
+    return &item->_lastmsg;
+}
+
 QVariant AggregatedTraceViewModel::data_DisplayRole(const QModelIndex &index, int role) const
 {
     AggregatedTraceViewItem *item = (AggregatedTraceViewItem *)index.internalPointer();
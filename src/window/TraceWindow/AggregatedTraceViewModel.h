@@ -22,8 +22,9 @@
 #pragma once
 
 #include <QAbstractItemModel>
-#include <QMap>
+#include <QHash>
 #include <QList>
+#include <QBitArray>
 #include <sys/time.h>
 
 #include "BaseTraceViewModel.h"
@@ -41,7 +42,7 @@ class AggregatedTraceViewModel : public BaseTraceViewModel
 
 public:
     typedef uint64_t unique_key_t;
-    typedef QMap<unique_key_t, AggregatedTraceViewItem*> CanIdMap;
+    typedef QHash<unique_key_t, int> CanIdMap; // key -> row
 
 public:
     AggregatedTraceViewModel(Backend &backend);
@@ -50,11 +51,19 @@ public:
     virtual QModelIndex parent(const QModelIndex &child) const;
     virtual int rowCount(const QModelIndex &parent) const;
 
+    virtual const CanMessage *getMessage(const QModelIndex &index) const;
+
 private:
+    enum {
+        fade_time_ms = 2000
+    };
+
     CanIdMap _map;
     AggregatedTraceViewItem *_rootItem;
-    QList<CanMessage> _pendingMessageUpdates;
-    QMap<unique_key_t, CanMessage> _pendingMessageInserts;
+
+    // rows that got new messages since the last update; only these and
+    // the rows still fading out get a dataChanged()
+    QBitArray _dirtyRows;
 
     unique_key_t makeUniqueKey(const CanMessage &msg) const;
     void createItem(const CanMessage &msg, AggregatedTraceViewItem *item, unique_key_t key);
@@ -66,7 +75,6 @@ protected:
 
 private slots:
     void createItem(const CanMessage &msg);
-    void updateItem(const CanMessage &msg);
     void onUpdateModel();
     void onSetupChanged();
 
@@ -146,6 +146,12 @@ void BaseTraceViewModel::setTimestampMode(timestamp_mode_t timestampMode)
     _timestampMode = timestampMode;
 }
 
+const CanMessage *BaseTraceViewModel::getMessage(const QModelIndex &index) const
+{
+    (void) index;
+    return 0;
+}
+
 QVariant BaseTraceViewModel::formatTimestamp(timestamp_mode_t mode, const CanMessage &currentMsg, const CanMessage &lastMsg) const
 {
 
@@ -154,9 +160,9 @@ QVariant BaseTraceViewModel::formatTimestamp(timestamp_mode_t mode, const CanMes
         double t_current = currentMsg.getFloatTimestamp();
         double t_last = lastMsg.getFloatTimestamp();
         if (t_last==0) {
-            return QString().asprintf("%.04lf", 0.00);
+            return QString::number(0.0, 'f', 4);
         } else {
-            return QString().asprintf("%.04lf", t_current-t_last);
+            return QString::number(t_current-t_last, 'f', 4);
         }
 
     } else if (mode==timestamp_mode_absolute) {
@@ -166,7 +172,7 @@ QVariant BaseTraceViewModel::formatTimestamp(timestamp_mode_t mode, const CanMes
     } else if (mode==timestamp_mode_relative) {
 
         double t_current = currentMsg.getFloatTimestamp();
-        return QString().asprintf("%.04lf", t_current - backend()->getTimestampAtMeasurementStart());
+        return QString::number(t_current - backend()->getTimestampAtMeasurementStart(), 'f', 4);
 
     }
 
@@ -183,12 +189,33 @@ QVariant BaseTraceViewModel::data_DisplayRole(const QModelIndex &index, int role
 QVariant BaseTraceViewModel::data_DisplayRole_Message(const QModelIndex &index, int role, const CanMessage &currentMsg, const CanMessage &lastMsg) const
 {
     (void) role;
-    CanDbMessage *dbmsg = backend()->findDbMessage(currentMsg);
 
-    switch (index.column()) {
+    if (index.column() == column_index) {
+        return index.internalId();
+    }
 
-        case column_index:
-            return index.internalId();
+    return formatMessageColumn(index.column(), currentMsg, lastMsg, backend()->findDbMessage(currentMsg));
+}
+
+QString BaseTraceViewModel::formatMessageType(const CanMessage &msg)
+{
+    // all combinations of Fd./Ext./Std./RTR/BRS, built once
+    static QString types[16];
+    static bool initialized = false;
+    if (!initialized) {
+        for (int i=0; i<16; i++) {
+            types[i] = QString((i & 1) ? "Fd." : "") + QString((i & 2) ? "Ext." : "Std.") + QString((i & 4) ? "RTR" : "") + QString((i & 8) ? "BRS" : "");
+        }
+        initialized = true;
+    }
+
+    int i = (msg.isFD() ? 1 : 0) | (msg.isExtended() ? 2 : 0) | (msg.isRTR() ? 4 : 0) | (msg.isBRS() ? 8 : 0);
+    return types[i];
+}
+
+QVariant BaseTraceViewModel::formatMessageColumn(int column, const CanMessage &currentMsg, const CanMessage &lastMsg, CanDbMessage *dbmsg) const
+{
+    switch (column) {
 
         case column_timestamp:
             return formatTimestamp(_timestampMode, currentMsg, lastMsg);
@@ -200,10 +227,7 @@ QVariant BaseTraceViewModel::data_DisplayRole_Message(const QModelIndex &index,
             return currentMsg.isRX()?"rx":"tx";
 
         case column_type:
-        {
-            QString _type = QString(currentMsg.isFD()? "Fd.":"") + QString(currentMsg.isExtended()? "Ext." : "Std.") + QString(currentMsg.isRTR()?"RTR":"") + QString((currentMsg.isBRS()?"BRS":""));
-            return _type;
-        }
+            return formatMessageType(currentMsg);
 
         case column_canid:
             return currentMsg.getIdString();
@@ -28,6 +28,7 @@ class Backend;
 class CanTrace;
 class CanMessage;
 class CanDbSignal;
+class CanDbMessage;
 
 class BaseTraceViewModel : public QAbstractItemModel
 {
@@ -59,7 +60,10 @@ public:
     CanTrace *trace() const;
 
     timestamp_mode_t timestampMode() const;
-    void setTimestampMode(timestamp_mode_t timestampMode);
+    virtual void setTimestampMode(timestamp_mode_t timestampMode);
+
+    // message shown in a top level row, or 0 for other rows
+    virtual const CanMessage *getMessage(const QModelIndex &index) const;
 
 protected:
     virtual QVariant data_DisplayRole(const QModelIndex &index, int role) const;
@@ -70,6 +74,8 @@ protected:
     virtual QVariant data_TextColorRole_Signal(const QModelIndex &index, int role, const CanMessage &msg) const;
 
     QVariant formatTimestamp(timestamp_mode_t mode, const CanMessage &currentMsg, const CanMessage &lastMsg) const;
+    QVariant formatMessageColumn(int column, const CanMessage &currentMsg, const CanMessage &lastMsg, CanDbMessage *dbmsg) const;
+    static QString formatMessageType(const CanMessage &msg);
 
 private:
     Backend *_backend;
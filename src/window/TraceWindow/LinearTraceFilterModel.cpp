@@ -0,0 +1,289 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "LinearTraceFilterModel.h"
+#include "LinearTraceViewModel.h"
+
+#include <algorithm>
+
+#include <core/Backend.h>
+#include <core/CanTrace.h>
+#include <core/CanTraceScanner.h>
+
+LinearTraceFilterModel::LinearTraceFilterModel(Backend &backend, LinearTraceViewModel *source, QObject *parent)
+  : QAbstractProxyModel(parent),
+    _backend(backend),
+    _source(source),
+    _scanner(new CanTraceScanner(*backend.getTrace(), this)),
+    _filter(new CanTraceFilter()),
+    _rowsChecked(0)
+{
+    setSourceModel(source);
+
+    connect(source, SIGNAL(rowsAboutToBeInserted(QModelIndex,int,int)), this, SLOT(sourceRowsAboutToBeInserted(QModelIndex,int,int)));
+    connect(source, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(sourceRowsInserted(QModelIndex,int,int)));
+    connect(source, SIGNAL(modelAboutToBeReset()), this, SLOT(sourceAboutToBeReset()));
+    connect(source, SIGNAL(modelReset()), this, SLOT(sourceReset()));
+    connect(source, SIGNAL(dataChanged(QModelIndex,QModelIndex)), this, SLOT(sourceDataChanged(QModelIndex,QModelIndex)));
+
+    connect(_scanner, SIGNAL(rowsMatched(int,int,QVector<int>)), this, SLOT(scannerRowsMatched(int,int,QVector<int>)));
+    connect(_scanner, SIGNAL(finished(int)), this, SLOT(scannerFinished(int)));
+    connect(&backend, SIGNAL(onSetupChanged()), this, SLOT(setupChanged()));
+}
+
+LinearTraceFilterModel::~LinearTraceFilterModel()
+{
+    delete _scanner;
+}
+
+bool LinearTraceFilterModel::setFilterText(QString filtertext, QString *errorMessage)
+{
+    QSharedPointer<CanTraceFilter> filter(new CanTraceFilter());
+    if (!filter->compile(_backend, filtertext, errorMessage)) {
+        return false;
+    }
+
+    beginResetModel();
+    _scanner->cancel();
+    _filter = filter;
+    _rows.clear();
+    _rowsChecked = isPassthrough() ? _source->rowCount(QModelIndex()) : 0;
+    endResetModel();
+
+    if (isPassthrough()) {
+        emit filteringFinished();
+    } else {
+        _scanner->start(filter);
+    }
+    return true;
+}
+
+QString LinearTraceFilterModel::filterText() const
+{
+    return _filter->getText();
+}
+
+bool LinearTraceFilterModel::isFiltering() const
+{
+    return _scanner->isRunning();
+}
+
+bool LinearTraceFilterModel::isPassthrough() const
+{
+    return _filter->isEmpty();
+}
+
+int LinearTraceFilterModel::proxyRow(int traceIndex) const
+{
+    if (isPassthrough()) {
+        return traceIndex;
+    }
+
+    QVector<int>::const_iterator it = std::lower_bound(_rows.constBegin(), _rows.constEnd(), traceIndex);
+    if ((it == _rows.constEnd()) || (*it != traceIndex)) {
+        return -1;
+    }
+    return it - _rows.constBegin();
+}
+
+QModelIndex LinearTraceFilterModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if ((row < 0) || (column < 0)) {
+        return QModelIndex();
+    }
+
+    if (parent.isValid()) {
+        if (parent.internalId()) { // signal rows have no children
+            return QModelIndex();
+        }
+        QModelIndex sourceParent = mapToSource(parent);
+        return sourceParent.isValid() ? createIndex(row, column, (quintptr)(sourceParent.row()+1)) : QModelIndex();
+    }
+
+    return createIndex(row, column, (quintptr)0);
+}
+
+QModelIndex LinearTraceFilterModel::parent(const QModelIndex &child) const
+{
+    quintptr id = child.internalId();
+    if (!child.isValid() || !id) {
+        return QModelIndex();
+    }
+
+    int row = proxyRow(id-1);
+    return (row >= 0) ? createIndex(row, 0, (quintptr)0) : QModelIndex();
+}
+
+int LinearTraceFilterModel::rowCount(const QModelIndex &parent) const
+{
+    if (!parent.isValid()) {
+        return isPassthrough() ? _source->rowCount(QModelIndex()) : _rows.size();
+    }
+    if (parent.internalId()) {
+        return 0;
+    }
+    return _source->rowCount(mapToSource(parent));
+}
+
+int LinearTraceFilterModel::columnCount(const QModelIndex &parent) const
+{
+    (void) parent;
+    return _source->columnCount(QModelIndex());
+}
+
+bool LinearTraceFilterModel::hasChildren(const QModelIndex &parent) const
+{
+    return rowCount(parent) > 0;
+}
+
+QModelIndex LinearTraceFilterModel::mapToSource(const QModelIndex &proxyIndex) const
+{
+    if (!proxyIndex.isValid()) {
+        return QModelIndex();
+    }
+
+    quintptr id = proxyIndex.internalId();
+    if (id) {
+        QModelIndex sourceParent = _source->index(id-1, 0, QModelIndex());
+        return _source->index(proxyIndex.row(), proxyIndex.column(), sourceParent);
+    }
+
+    int traceIndex = isPassthrough() ? proxyIndex.row() : _rows.value(proxyIndex.row(), -1);
+    return (traceIndex >= 0) ? _source->index(traceIndex, proxyIndex.column(), QModelIndex()) : QModelIndex();
+}
+
+QModelIndex LinearTraceFilterModel::mapFromSource(const QModelIndex &sourceIndex) const
+{
+    if (!sourceIndex.isValid()) {
+        return QModelIndex();
+    }
+
+    QModelIndex sourceParent = sourceIndex.parent();
+    if (sourceParent.isValid()) {
+        if (proxyRow(sourceParent.row()) < 0) {
+            return QModelIndex();
+        }
+        return createIndex(sourceIndex.row(), sourceIndex.column(), (quintptr)(sourceParent.row()+1));
+    }
+
+    int row = proxyRow(sourceIndex.row());
+    return (row >= 0) ? createIndex(row, sourceIndex.column(), (quintptr)0) : QModelIndex();
+}
+
+void LinearTraceFilterModel::sourceRowsAboutToBeInserted(const QModelIndex &parent, int first, int last)
+{
+    if (!parent.isValid() && isPassthrough()) {
+        beginInsertRows(QModelIndex(), first, last);
+    }
+}
+
+void LinearTraceFilterModel::sourceRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    (void) first;
+    if (parent.isValid()) {
+        return;
+    }
+
+    if (isPassthrough()) {
+        _rowsChecked = last + 1;
+        endInsertRows();
+    } else if (!_scanner->isRunning()) {
+        checkNewRows();
+    } // else the scanner picks them up
+}
+
+void LinearTraceFilterModel::checkNewRows()
+{
+    CanTrace *trace = _backend.getTrace();
+    int size = trace->size();
+
+    QVector<int> accepted;
+    for (int i=_rowsChecked; i<size; i++) {
+        const CanMessage *msg = trace->getMessage(i);
+        if (msg && _filter->matches(*msg)) {
+            accepted.append(i);
+        }
+    }
+    _rowsChecked = size;
+
+    if (!accepted.isEmpty()) {
+        beginInsertRows(QModelIndex(), _rows.size(), _rows.size() + accepted.size() - 1);
+        _rows += accepted;
+        endInsertRows();
+    }
+}
+
+void LinearTraceFilterModel::sourceAboutToBeReset()
+{
+    beginResetModel();
+    _scanner->cancel();
+    _rows.clear();
+    _rowsChecked = 0;
+}
+
+void LinearTraceFilterModel::sourceReset()
+{
+    endResetModel();
+}
+
+void LinearTraceFilterModel::sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if (topLeft.parent().isValid() || isPassthrough()) {
+        QModelIndex from = mapFromSource(topLeft);
+        QModelIndex to = mapFromSource(bottomRight);
+        if (from.isValid() && to.isValid()) {
+            emit dataChanged(from, to);
+        }
+        return;
+    }
+
+    QVector<int>::const_iterator lo = std::lower_bound(_rows.constBegin(), _rows.constEnd(), topLeft.row());
+    QVector<int>::const_iterator hi = std::upper_bound(_rows.constBegin(), _rows.constEnd(), bottomRight.row());
+    if (lo < hi) {
+        emit dataChanged(
+            index(lo - _rows.constBegin(), topLeft.column()),
+            index(hi - _rows.constBegin() - 1, bottomRight.column())
+        );
+    }
+}
+
+void LinearTraceFilterModel::scannerRowsMatched(int first, int count, QVector<int> rows)
+{
+    _rowsChecked = first + count;
+    if (!rows.isEmpty()) {
+        beginInsertRows(QModelIndex(), _rows.size(), _rows.size() + rows.size() - 1);
+        _rows += rows;
+        endInsertRows();
+    }
+}
+
+void LinearTraceFilterModel::scannerFinished(int rowsScanned)
+{
+    _rowsChecked = rowsScanned;
+    checkNewRows();
+    emit filteringFinished();
+}
+
+void LinearTraceFilterModel::setupChanged()
+{
+    // DBC and interface names are resolved at compile time
+    setFilterText(filterText());
+}
@@ -0,0 +1,88 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#pragma once
+
+#include <QAbstractProxyModel>
+#include <QSharedPointer>
+#include <QVector>
+
+#include <core/CanTraceFilter.h>
+
+class Backend;
+class CanTraceScanner;
+class LinearTraceViewModel;
+
+/*
+ * Filtered view on the linear trace. Instead of asking a predicate for
+ * every source row like QSortFilterProxyModel does, it keeps the sorted
+ * trace indexes of the accepted rows and maps through them. A new filter
+ * is evaluated by a CanTraceScanner on a thread pool, the view fills up
+ * while the scan runs. Rows appended afterwards are checked as they arrive.
+ */
+class LinearTraceFilterModel : public QAbstractProxyModel
+{
+    Q_OBJECT
+
+public:
+    LinearTraceFilterModel(Backend &backend, LinearTraceViewModel *source, QObject *parent = nullptr);
+    virtual ~LinearTraceFilterModel();
+
+    bool setFilterText(QString filtertext, QString *errorMessage=0);
+    QString filterText() const;
+    bool isFiltering() const;
+
+    virtual QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    virtual QModelIndex parent(const QModelIndex &child) const override;
+    virtual int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    virtual int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    virtual bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+
+    virtual QModelIndex mapToSource(const QModelIndex &proxyIndex) const override;
+    virtual QModelIndex mapFromSource(const QModelIndex &sourceIndex) const override;
+
+signals:
+    void filteringFinished();
+
+private slots:
+    void sourceRowsAboutToBeInserted(const QModelIndex &parent, int first, int last);
+    void sourceRowsInserted(const QModelIndex &parent, int first, int last);
+    void sourceAboutToBeReset();
+    void sourceReset();
+    void sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+
+    void scannerRowsMatched(int first, int count, QVector<int> rows);
+    void scannerFinished(int rowsScanned);
+    void setupChanged();
+
+private:
+    Backend &_backend;
+    LinearTraceViewModel *_source;
+    CanTraceScanner *_scanner;
+    QSharedPointer<CanTraceFilter> _filter;
+
+    QVector<int> _rows;  // accepted trace indexes, ascending
+    int _rowsChecked;    // trace rows already decided by the filter
+
+    bool isPassthrough() const;
+    int proxyRow(int traceIndex) const;
+    void checkNewRows();
+};
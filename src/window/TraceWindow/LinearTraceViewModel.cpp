@@ -25,12 +25,15 @@
 #include <core/Backend.h>
 
 LinearTraceViewModel::LinearTraceViewModel(Backend &backend)
-  : BaseTraceViewModel(backend)
+  : BaseTraceViewModel(backend),
+    _rowCache(row_cache_size)
 {
     connect(backend.getTrace(), SIGNAL(beforeAppend(int)), this, SLOT(beforeAppend(int)));
     connect(backend.getTrace(), SIGNAL(afterAppend()), this, SLOT(afterAppend()));
     connect(backend.getTrace(), SIGNAL(beforeClear()), this, SLOT(beforeClear()));
     connect(backend.getTrace(), SIGNAL(afterClear()), this, SLOT(afterClear()));
+    connect(&backend, SIGNAL(onSetupChanged()), this, SLOT(clearRowCache()));
+    connect(&backend, SIGNAL(beginMeasurement()), this, SLOT(clearRowCache()));
 }
 
 QModelIndex LinearTraceViewModel::index(int row, int column, const QModelIndex &parent) const
@@ -52,6 +55,15 @@ QModelIndex LinearTraceViewModel::parent(const QModelIndex &child) const
     return QModelIndex();
 }
 
+const CanMessage *LinearTraceViewModel::getMessage(const QModelIndex &index) const
+{
+    quintptr id = index.internalId();
+    if (!index.isValid() || !id || (id & 0x80000000)) {
+        return 0;
+    }
+    return trace()->getMessage(id-1);
+}
+
 int LinearTraceViewModel::rowCount(const QModelIndex &parent) const
 {
     if (parent.isValid()) {
@@ -96,6 +108,7 @@ void LinearTraceViewModel::afterAppend()
 void LinearTraceViewModel::beforeClear()
 {
     beginResetModel();
+    _rowCache.clear();
 }
 
 void LinearTraceViewModel::afterClear()
@@ -103,23 +116,65 @@ void LinearTraceViewModel::afterClear()
     endResetModel();
 }
 
+void LinearTraceViewModel::setTimestampMode(timestamp_mode_t timestampMode)
+{
+    if (timestampMode != this->timestampMode()) {
+        clearRowCache();
+    }
+    BaseTraceViewModel::setTimestampMode(timestampMode);
+}
+
+void LinearTraceViewModel::clearRowCache()
+{
+    _rowCache.clear();
+}
+
 QVariant LinearTraceViewModel::data_DisplayRole(const QModelIndex &index, int role) const
 {
     quintptr id = index.internalId();
     int msg_id = (id & ~0x80000000)-1;
 
+    if (id && !(id & 0x80000000)) {
+        if (index.column() == column_index) {
+            return id;
+        }
+        if ((index.column() < 0) || (index.column() >= column_count)) {
+            return QVariant();
+        }
+
+        formatted_row_t *row = _rowCache.object(msg_id);
+        if (row) {
+            return row->columns[index.column()];
+        }
+    }
+
     const CanMessage *msg = trace()->getMessage(msg_id);
     if (!msg) { return QVariant(); }
 
     if (id & 0x80000000) {
         return data_DisplayRole_Signal(index, role, *msg);
     } else if (id) {
+        // format the whole row at once, the view asks for the other
+        // columns right after this one
+        CanMessage prev;
         if (msg_id>=1) {
             const CanMessage *prev_msg = trace()->getMessage(msg_id-1);
-            return data_DisplayRole_Message(index, role, *msg, *prev_msg);
-        } else {
-            return data_DisplayRole_Message(index, role, *msg, CanMessage());
+            if (prev_msg) {
+                prev.cloneFrom(*prev_msg);
+            }
         }
+
+        CanDbMessage *dbmsg = backend()->findDbMessage(*msg);
+        formatted_row_t *row = new formatted_row_t;
+        for (int col=0; col<column_count; col++) {
+            if (col != column_index) {
+                row->columns[col] = formatMessageColumn(col, *msg, prev, dbmsg);
+            }
+        }
+
+        QVariant result = row->columns[index.column()];
+        _rowCache.insert(msg_id, row);
+        return result;
     }
 
     return QVariant();
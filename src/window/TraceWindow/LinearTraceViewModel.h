@@ -22,6 +22,8 @@
 #pragma once
 
 #include <QAbstractItemModel>
+#include <QCache>
+#include <QVariant>
 #include <core/CanDb.h>
 #include <core/CanTrace.h>
 #include "BaseTraceViewModel.h"
@@ -41,13 +43,32 @@ public:
     virtual int columnCount(const QModelIndex &parent) const;
     virtual bool hasChildren(const QModelIndex &parent) const;
 
+    virtual void setTimestampMode(timestamp_mode_t timestampMode);
+
+    virtual const CanMessage *getMessage(const QModelIndex &index) const;
+
 private slots:
     void beforeAppend(int num_messages);
     void afterAppend();
     void beforeClear();
     void afterClear();
+    void clearRowCache();
 
 private:
+    enum {
+        row_cache_size = 4096
+    };
+
+    // formatted display text of the most recently painted message rows,
+    // keyed by trace index. trace rows never change once appended, so
+    // only the timestamp mode, the setup and the measurement start
+    // (relative timestamps) invalidate it.
+    typedef struct {
+        QVariant columns[column_count];
+    } formatted_row_t;
+
+    mutable QCache<int, formatted_row_t> _rowCache;
+
     virtual QVariant data_DisplayRole(const QModelIndex &index, int role) const;
     virtual QVariant data_TextColorRole(const QModelIndex &index, int role) const;
 };
@@ -1,45 +1,70 @@
 #include "TraceFilterModel.h"
 #include "BaseTraceViewModel.h"
 
-TraceFilterModel::TraceFilterModel(QObject *parent)
+#include <QAbstractProxyModel>
+
+#include <core/Backend.h>
+
+TraceFilterModel::TraceFilterModel(Backend &backend, QObject *parent)
     : QSortFilterProxyModel{parent},
-    _filterText("")
+    _backend(backend),
+    _filter(new CanTraceFilter())
 {
    setRecursiveFilteringEnabled(false);
+
+   connect(&backend, SIGNAL(onSetupChanged()), this, SLOT(setupChanged()));
 }
 
+bool TraceFilterModel::setFilterText(QString filtertext, QString *errorMessage)
+{
+    QSharedPointer<CanTraceFilter> filter(new CanTraceFilter());
+    if (!filter->compile(_backend, filtertext, errorMessage)) {
+        return false;
+    }
 
-void TraceFilterModel::setFilterText(QString filtertext)
+    _filter = filter;
+    invalidateFilter();
+    return true;
+}
+
+QString TraceFilterModel::filterText() const
 {
-    _filterText = filtertext;
+    return _filter->getText();
+}
+
+void TraceFilterModel::setupChanged()
+{
+    // DBC and interface names are resolved at compile time
+    setFilterText(filterText());
+}
+
+const BaseTraceViewModel *TraceFilterModel::baseModel(QModelIndex &index) const
+{
+    const QAbstractItemModel *model = index.model();
+    while (const QAbstractProxyModel *proxy = qobject_cast<const QAbstractProxyModel*>(model)) {
+        index = proxy->mapToSource(index);
+        model = proxy->sourceModel();
+    }
+    return qobject_cast<const BaseTraceViewModel*>(model);
 }
 
 bool TraceFilterModel::filterAcceptsRow(int source_row, const QModelIndex & source_parent) const
 {
-    // Pass all on no filter
-    if(_filterText.length() == 0)
+    // signal rows follow their message
+    if (source_parent.isValid()) {
         return true;
+    }
 
-    QModelIndex idx0 = sourceModel()->index(source_row, BaseTraceViewModel::column_channel, source_parent); // Channel
-    QModelIndex idx1 = sourceModel()->index(source_row, BaseTraceViewModel::column_canid, source_parent); // CAN ID
-    QModelIndex idx2 = sourceModel()->index(source_row, BaseTraceViewModel::column_sender, source_parent); // Sender
-    QModelIndex idx3 = sourceModel()->index(source_row, BaseTraceViewModel::column_name, source_parent); // Name
-    QModelIndex idx4 = sourceModel()->index(source_row, BaseTraceViewModel::column_type, source_parent); // type
-
-    QString datastr0 = sourceModel()->data(idx0).toString();
-    QString datastr1 = sourceModel()->data(idx1).toString();
-    QString datastr2 = sourceModel()->data(idx2).toString();
-    QString datastr3 = sourceModel()->data(idx3).toString();
-    QString datastr4 = sourceModel()->data(idx4).toString();
-
-    //fprintf(stderr, "Data for acceptance is %s\r\n", datastr1.toStdString().c_str());
-
-    if( datastr0.contains(_filterText) ||
-        datastr1.contains(_filterText) ||
-        datastr2.contains(_filterText) ||
-        datastr3.contains(_filterText) ||
-        datastr4.contains(_filterText))
+    if (_filter->isEmpty()) {
         return true;
-    else
-        return false;
+    }
+
+    QModelIndex idx = sourceModel()->index(source_row, 0, source_parent);
+    const BaseTraceViewModel *model = baseModel(idx);
+    if (!model) {
+        return true;
+    }
+
+    const CanMessage *msg = model->getMessage(idx);
+    return msg && _filter->matches(*msg);
 }
@@ -2,18 +2,38 @@
 #define TRACEFILTER_H
 
 #include <QSortFilterProxyModel>
+#include <QSharedPointer>
 
+#include <core/CanTraceFilter.h>
+
+class Backend;
+class BaseTraceViewModel;
+
+/*
+ * Filters the rows of the aggregated trace view with a compiled
+ * CanTraceFilter, see there for the filter language. The aggregated view
+ * has one row per id, so the filter is simply evaluated on the last
+ * message of each row. The linear view uses LinearTraceFilterModel.
+ */
 class TraceFilterModel : public QSortFilterProxyModel
 {
+    Q_OBJECT
+
 public:
-    explicit TraceFilterModel(QObject *parent = nullptr);
+    explicit TraceFilterModel(Backend &backend, QObject *parent = nullptr);
 
+    bool setFilterText(QString filtertext, QString *errorMessage=0);
+    QString filterText() const;
 
-public slots:
-    void setFilterText(QString filtertext);
+private slots:
+    void setupChanged();
 
 private:
-    QString _filterText;
+    Backend &_backend;
+    QSharedPointer<CanTraceFilter> _filter;
+
+    const BaseTraceViewModel *baseModel(QModelIndex &index) const;
+
 protected:
     virtual bool filterAcceptsRow(int source_row, const QModelIndex & source_parent) const override;
 };
@@ -23,11 +23,19 @@
 #include "ui_TraceWindow.h"
 
 #include <QDomDocument>
+#include <QMenu>
 #include <QSortFilterProxyModel>
+#include <QTimer>
+#include <QShortcut>
 #include "LinearTraceViewModel.h"
 #include "AggregatedTraceViewModel.h"
 #include "TraceFilterModel.h"
+#include "LinearTraceFilterModel.h"
 #include <core/Backend.h>
+#include <core/CanTrace.h>
+#include <core/CanTraceScanner.h>
+#include <core/MeasurementNetwork.h>
+#include <core/MeasurementInterface.h>
 
 TraceWindow::TraceWindow(QWidget *parent, Backend &backend) :
     ConfigurableWidget(parent),
@@ -40,19 +48,15 @@ TraceWindow::TraceWindow(QWidget *parent, Backend &backend) :
     ui->setupUi(this);
 
     _linearTraceViewModel = new LinearTraceViewModel(backend);
-    _linearProxyModel = new QSortFilterProxyModel(this);
-    _linearProxyModel->setSourceModel(_linearTraceViewModel);
-    _linearProxyModel->setDynamicSortFilter(true);
+    _linFilteredModel = new LinearTraceFilterModel(backend, _linearTraceViewModel, this);
 
     _aggregatedTraceViewModel = new AggregatedTraceViewModel(backend);
     _aggregatedProxyModel = new QSortFilterProxyModel(this);
     _aggregatedProxyModel->setSourceModel(_aggregatedTraceViewModel);
     _aggregatedProxyModel->setDynamicSortFilter(true);
 
-    _aggFilteredModel = new TraceFilterModel(this);
+    _aggFilteredModel = new TraceFilterModel(backend, this);
     _aggFilteredModel->setSourceModel(_aggregatedProxyModel);
-    _linFilteredModel = new TraceFilterModel(this);
-    _linFilteredModel->setSourceModel(_linearProxyModel);
 
     setMode(mode_aggregated);
     setAutoScroll(false);
@@ -81,12 +85,31 @@ TraceWindow::TraceWindow(QWidget *parent, Backend &backend) :
     ui->cbTimestampMode->addItem(tr("delta"), 2);
     setTimestampMode(timestamp_mode_delta);
 
-    connect(_linearTraceViewModel, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(rowsInserted(QModelIndex,int,int)));
+    connect(_linFilteredModel, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(rowsInserted(QModelIndex,int,int)));
 
+    // don't re-filter the whole trace on every keystroke
+    _filterTimer = new QTimer(this);
+    _filterTimer->setSingleShot(true);
+    _filterTimer->setInterval(filter_delay_ms);
+    connect(_filterTimer, SIGNAL(timeout()), this, SLOT(applyFilter()));
     connect(ui->filterLineEdit, SIGNAL(textChanged(QString)), this, SLOT(on_cbFilterChanged()));
+    ui->filterLineEdit->setToolTip(filterHelpText());
+
+    _searchScanner = new CanTraceScanner(*backend.getTrace(), this);
+    connect(_searchScanner, SIGNAL(found(int)), this, SLOT(searchFound(int)));
+    connect(ui->findLineEdit, SIGNAL(returnPressed()), this, SLOT(findNext()));
+    connect(ui->findNextButton, SIGNAL(clicked()), this, SLOT(findNext()));
+    connect(ui->findPrevButton, SIGNAL(clicked()), this, SLOT(findPrevious()));
+    new QShortcut(QKeySequence::FindNext, this, SLOT(findNext()), 0, Qt::WidgetWithChildrenShortcut);
+    new QShortcut(QKeySequence::FindPrevious, this, SLOT(findPrevious()), 0, Qt::WidgetWithChildrenShortcut);
+    ui->findLineEdit->setToolTip(filterHelpText());
 
     connect(ui->TraceClearpushButton, SIGNAL(released()), this, SLOT(on_cbTraceClearpushButton()));
 
+    ui->tree->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    ui->tree->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(ui->tree, SIGNAL(customContextMenuRequested(QPoint)), this, SLOT(treeContextMenu(QPoint)));
+
     connect(ui->cbAggregated,SIGNAL(stateChanged(int)),this,SLOT(on_cbAggregated_stateChanged(int)));
     connect(ui->cbAutoScroll,SIGNAL(stateChanged(int)),this,SLOT(on_cbAutoScroll_stateChanged(int)));
 
@@ -205,11 +228,6 @@ void TraceWindow::rowsInserted(const QModelIndex &parent, int first, int last)
     (void) first;
     (void) last;
 
-    if(_backend->getTrace()->size() > 1000000)
-    {
-        _backend->clearTrace();
-    }
-
     if ((_mode==mode_linear) && (ui->cbAutoScroll->checkState() == Qt::Checked)) {
         ui->tree->scrollToBottom();
     }
@@ -232,10 +250,171 @@ void TraceWindow::on_cbTimestampMode_currentIndexChanged(int index)
 
 void TraceWindow::on_cbFilterChanged()
 {
-    _aggFilteredModel->setFilterText(ui->filterLineEdit->text());
-    _linFilteredModel->setFilterText(ui->filterLineEdit->text());
-    _aggFilteredModel->invalidate();
-    _linFilteredModel->invalidate();
+    _filterTimer->start();
+}
+
+void TraceWindow::applyFilter()
+{
+    QString text = ui->filterLineEdit->text();
+    QString error;
+
+    // on errors, the last valid filter stays active while the user is typing
+    if (_linFilteredModel->setFilterText(text, &error)) {
+        _aggFilteredModel->setFilterText(text, &error);
+    }
+    setLineEditError(ui->filterLineEdit, error);
+}
+
+void TraceWindow::setLineEditError(QLineEdit *edit, QString error)
+{
+    QPalette pal = edit->palette();
+    pal.setColor(QPalette::Text, error.isEmpty() ? palette().color(QPalette::Text) : QColor(Qt::red));
+    edit->setPalette(pal);
+    edit->setToolTip(error.isEmpty() ? filterHelpText() : error);
+}
+
+void TraceWindow::findNext()
+{
+    find(false);
+}
+
+void TraceWindow::findPrevious()
+{
+    find(true);
+}
+
+void TraceWindow::find(bool backward)
+{
+    QString text = ui->findLineEdit->text().trimmed();
+    if (text.isEmpty()) {
+        return;
+    }
+
+    // in the linear view, the trace is searched for rows that also pass the filter
+    QString expression = text;
+    QString filterText = _linFilteredModel->filterText().trimmed();
+    if ((_mode==mode_linear) && !filterText.isEmpty()) {
+        expression = QString("(%1) (%2)").arg(filterText, text);
+    }
+
+    QString error;
+    QSharedPointer<CanTraceFilter> search(new CanTraceFilter());
+    bool ok = search->compile(*_backend, expression, &error);
+    setLineEditError(ui->findLineEdit, error);
+    if (!ok) {
+        return;
+    }
+
+    QModelIndex current = ui->tree->currentIndex();
+    if (current.parent().isValid()) {
+        current = current.parent();
+    }
+
+    if (_mode==mode_aggregated) {
+        findAggregated(*search, current, backward);
+        return;
+    }
+
+    int from;
+    QModelIndex src = _linFilteredModel->mapToSource(current);
+    if (src.isValid()) {
+        from = backward ? (src.row() - 1) : (src.row() + 1);
+    } else {
+        from = backward ? ((int)_backend->getTrace()->size() - 1) : 0;
+    }
+    _searchScanner->find(search, from, backward);
+}
+
+void TraceWindow::findAggregated(const CanTraceFilter &search, QModelIndex current, bool backward)
+{
+    // one row per id, no need for the scanner here
+    int rows = _aggFilteredModel->rowCount(QModelIndex());
+    int step = backward ? -1 : 1;
+    int row = current.isValid() ? (current.row() + step) : (backward ? (rows - 1) : 0);
+
+    for (; (row >= 0) && (row < rows); row += step) {
+        QModelIndex idx = _aggFilteredModel->index(row, 0);
+        const CanMessage *msg = messageAt(idx);
+        if (msg && search.matches(*msg)) {
+            ui->tree->setCurrentIndex(idx);
+            ui->tree->scrollTo(idx, QAbstractItemView::PositionAtCenter);
+            return;
+        }
+    }
+
+    setLineEditError(ui->findLineEdit, tr("not found"));
+}
+
+void TraceWindow::searchFound(int traceIndex)
+{
+    if (_mode!=mode_linear) {
+        return;
+    }
+
+    if (traceIndex < 0) {
+        setLineEditError(ui->findLineEdit, tr("not found"));
+        return;
+    }
+
+    QModelIndex idx = _linFilteredModel->mapFromSource(_linearTraceViewModel->index(traceIndex, 0, QModelIndex()));
+    if (idx.isValid()) {
+        // don't jump away from the result when the next messages arrive
+        setAutoScroll(false);
+        ui->tree->setCurrentIndex(idx);
+        ui->tree->scrollTo(idx, QAbstractItemView::PositionAtCenter);
+    }
+}
+
+QString TraceWindow::filterHelpText() const
+{
+    return tr(
+        "id:123  id:100-1FF  id:100/7F0  if:can0  rx  tx  std  ext  fd  brs  rtr  err\n"
+        "len:8  len:0-4  data:11XX22  bytes:55XXAA  msg:Engine*  sig:Engine.Rpm>3000\n"
+        "combine with whitespace (and), 'or', 'not' and parentheses;\n"
+        "other words match interface, message, sender or id."
+    );
+}
+
+const CanMessage *TraceWindow::messageAt(QModelIndex viewIndex) const
+{
+    if (_mode==mode_aggregated) {
+        return _aggregatedTraceViewModel->getMessage(_aggregatedProxyModel->mapToSource(_aggFilteredModel->mapToSource(viewIndex)));
+    } else {
+        return _linearTraceViewModel->getMessage(_linFilteredModel->mapToSource(viewIndex));
+    }
+}
+
+void TraceWindow::treeContextMenu(const QPoint &pos)
+{
+    QMenu menu(this);
+    QAction *action = menu.addAction(tr("Hardware filter: accept selected IDs only"), this, SLOT(setHardwareFilterToSelection()));
+    action->setEnabled(ui->tree->selectionModel()->hasSelection());
+    menu.exec(ui->tree->viewport()->mapToGlobal(pos));
+}
+
+void TraceWindow::setHardwareFilterToSelection()
+{
+    QMap<CanInterfaceId, QList<uint32_t> > ids;
+    foreach (QModelIndex idx, ui->tree->selectionModel()->selectedRows()) {
+        if (idx.parent().isValid()) {
+            idx = idx.parent();
+        }
+        const CanMessage *msg = messageAt(idx);
+        if (msg && !ids[msg->getInterfaceId()].contains(msg->getRawId())) {
+            ids[msg->getInterfaceId()].append(msg->getRawId());
+        }
+    }
+
+    // stored in the setup, so the filter survives a restart of the measurement
+    foreach (MeasurementNetwork *network, _backend->getSetup().getNetworks()) {
+        foreach (MeasurementInterface *mi, network->interfaces()) {
+            if (ids.contains(mi->canInterface())) {
+                mi->setHwFilterMode(MeasurementInterface::hw_filter_ids);
+                mi->setHwFilterIds(ids[mi->canInterface()]);
+                _backend->applyFilter(*network, *mi);
+            }
+        }
+    }
 }
 
 void TraceWindow::on_cbTraceClearpushButton()
@@ -32,8 +32,14 @@ class Backend;
 class QDomDocument;
 class QDomElement;
 class QSortFilterProxyModel;
+class QTimer;
 class LinearTraceViewModel;
 class AggregatedTraceViewModel;
+class LinearTraceFilterModel;
+class CanTraceScanner;
+class CanTraceFilter;
+class QLineEdit;
+class CanMessage;
 
 
 class TraceWindow : public ConfigurableWidget
@@ -65,10 +71,22 @@ private slots:
 
     void on_cbTimestampMode_currentIndexChanged(int index);
     void on_cbFilterChanged(void);
+    void applyFilter(void);
+
+    void findNext(void);
+    void findPrevious(void);
+    void searchFound(int traceIndex);
 
     void on_cbTraceClearpushButton(void);
 
+    void treeContextMenu(const QPoint &pos);
+    void setHardwareFilterToSelection(void);
+
 private:
+    enum {
+        filter_delay_ms = 250
+    };
+
     Ui::TraceWindow *ui;
     Backend *_backend;
     mode_t _mode;
@@ -76,9 +94,16 @@ private:
     timestamp_mode_t _timestampMode;
 
     TraceFilterModel * _aggFilteredModel;
-    TraceFilterModel * _linFilteredModel;
+    LinearTraceFilterModel * _linFilteredModel;
     LinearTraceViewModel *_linearTraceViewModel;
     AggregatedTraceViewModel *_aggregatedTraceViewModel;
     QSortFilterProxyModel *_aggregatedProxyModel;
-    QSortFilterProxyModel *_linearProxyModel;
+    QTimer *_filterTimer;
+    CanTraceScanner *_searchScanner;
+
+    QString filterHelpText() const;
+    const CanMessage *messageAt(QModelIndex viewIndex) const;
+    void setLineEditError(QLineEdit *edit, QString error);
+    void find(bool backward);
+    void findAggregated(const CanTraceFilter &search, QModelIndex current, bool backward);
 };
@@ -1,5 +1,6 @@
 SOURCES += \
     $$PWD/TraceFilterModel.cpp \
+    $$PWD/LinearTraceFilterModel.cpp \
     $$PWD/LinearTraceViewModel.cpp \
     $$PWD/AggregatedTraceViewModel.cpp \
     $$PWD/BaseTraceViewModel.cpp \
@@ -12,6 +13,7 @@ HEADERS  += \
     $$PWD/BaseTraceViewModel.h \
     $$PWD/AggregatedTraceViewItem.h \
     $$PWD/TraceFilterModel.h \
+    $$PWD/LinearTraceFilterModel.h \
     $$PWD/TraceWindow.h \
     $$PWD/TraceViewTypes.h \
 
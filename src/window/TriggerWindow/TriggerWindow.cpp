@@ -0,0 +1,193 @@
+/*
+
+  Copyright (c) 2015, 2016 Hubert Denkmair <hubert@denkmair.de>
+
+  This file is part of cangaroo.
+
+  cangaroo is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  cangaroo is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with cangaroo.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "TriggerWindow.h"
+#include "ui_TriggerWindow.h"
+
+#include <QDir>
+#include <QDomDocument>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QTimer>
+
+#include <core/Backend.h>
+#include <core/CanTriggerCapture.h>
+
+TriggerWindow::TriggerWindow(QWidget *parent, Backend &backend) :
+    ConfigurableWidget(parent),
+    ui(new Ui::TriggerWindow),
+    _backend(backend)
+{
+    ui->setupUi(this);
+    ui->lineEditDirectory->setText(QDir::homePath());
+
+    connect(ui->pushButtonArm, SIGNAL(toggled(bool)), this, SLOT(armDisarm(bool)));
+    connect(ui->toolButtonBrowse, SIGNAL(released()), this, SLOT(browseDirectory()));
+    connect(&backend, SIGNAL(endMeasurement()), this, SLOT(measurementStopped()));
+
+    _timer = new QTimer(this);
+    _timer->setInterval(250);
+    connect(_timer, SIGNAL(timeout()), this, SLOT(updateState()));
+}
+
+TriggerWindow::~TriggerWindow()
+{
+    if (ui->pushButtonArm->isChecked()) {
+        _backend.getTriggerCapture().disarm();
+    }
+    delete ui;
+}
+
+void TriggerWindow::setEditable(bool editable)
+{
+    ui->plainTextConditions->setReadOnly(!editable);
+    ui->doubleSpinBoxPre->setEnabled(editable);
+    ui->doubleSpinBoxPost->setEnabled(editable);
+    ui->spinBoxBuffer->setEnabled(editable);
+    ui->lineEditDirectory->setEnabled(editable);
+    ui->toolButtonBrowse->setEnabled(editable);
+    ui->checkBoxRearm->setEnabled(editable);
+}
+
+void TriggerWindow::armDisarm(bool arm)
+{
+    CanTriggerCapture &capture = _backend.getTriggerCapture();
+
+    if (!arm) {
+        capture.disarm();
+        _timer->stop();
+        ui->pushButtonArm->setText(tr("Arm"));
+        setEditable(true);
+        updateState();
+        return;
+    }
+
+    CanTriggerCaptureConfig config;
+    config.preTriggerUs = ui->doubleSpinBoxPre->value() * 1000000;
+    config.postTriggerUs = ui->doubleSpinBoxPost->value() * 1000000;
+    config.bufferSize = ui->spinBoxBuffer->value();
+    config.directory = ui->lineEditDirectory->text();
+    config.rearm = ui->checkBoxRearm->isChecked();
+
+    QString error;
+    foreach (QString line, ui->plainTextConditions->toPlainText().split('\n')) {
+        if (line.trimmed().isEmpty()) {
+            continue;
+        }
+        CanTriggerCondition condition;
+        if (!condition.parse(_backend, line, &error)) {
+            error = tr("'%1': %2").arg(line.trimmed(), error);
+            break;
+        }
+        config.conditions.append(condition);
+    }
+
+    if (error.isEmpty() && config.conditions.isEmpty()) {
+        error = tr("no trigger condition");
+    }
+    if (error.isEmpty() && !QFileInfo(config.directory).isDir()) {
+        error = tr("directory %1 does not exist").arg(config.directory);
+    }
+    if (error.isEmpty() && !capture.arm(config)) {
+        error = tr("cannot arm trigger");
+    }
+
+    if (!error.isEmpty()) {
+        ui->labelState->setText(error);
+        ui->pushButtonArm->blockSignals(true);
+        ui->pushButtonArm->setChecked(false);
+        ui->pushButtonArm->blockSignals(false);
+        return;
+    }
+
+    ui->pushButtonArm->setText(tr("Disarm"));
+    setEditable(false);
+    _timer->start();
+    updateState();
+}
+
+void TriggerWindow::browseDirectory()
+{
+    QString dir = QFileDialog::getExistingDirectory(this, tr("Capture Directory"), ui->lineEditDirectory->text());
+    if (!dir.isEmpty()) {
+        ui->lineEditDirectory->setText(dir);
+    }
+}
+
+void TriggerWindow::measurementStopped()
+{
+    // Backend disarms the trigger when the measurement stops
+    if (ui->pushButtonArm->isChecked()) {
+        ui->pushButtonArm->setChecked(false);
+    }
+}
+
+void TriggerWindow::updateState()
+{
+    CanTriggerCapture &capture = _backend.getTriggerCapture();
+
+    QString state;
+    switch (capture.getState()) {
+        case trigger_state_idle: state = tr("Idle"); break;
+        case trigger_state_armed: state = tr("Armed"); break;
+        case trigger_state_capturing: state = tr("Capturing"); break;
+    }
+
+    QString text = tr("%1, %2 trigger(s)").arg(state).arg(capture.getTriggerCount());
+    QString last = capture.getLastFileName();
+    if (!last.isEmpty()) {
+        text += tr(", last: %1").arg(QFileInfo(last).fileName());
+    }
+    ui->labelState->setText(text);
+
+    if (ui->pushButtonArm->isChecked() && (capture.getState() == trigger_state_idle)) {
+        // single shot capture is done
+        ui->pushButtonArm->setChecked(false);
+    }
+}
+
+bool TriggerWindow::saveXML(Backend &backend, QDomDocument &xml, QDomElement &root)
+{
+    if (!ConfigurableWidget::saveXML(backend, xml, root)) { return false; }
+    root.setAttribute("type", "TriggerWindow");
+    root.setAttribute("pre-trigger", ui->doubleSpinBoxPre->value());
+    root.setAttribute("post-trigger", ui->doubleSpinBoxPost->value());
+    root.setAttribute("buffer", ui->spinBoxBuffer->value());
+    root.setAttribute("directory", ui->lineEditDirectory->text());
+    root.setAttribute("rearm", ui->checkBoxRearm->isChecked() ? 1 : 0);
+
+    QDomElement elConditions = xml.createElement("Conditions");
+    elConditions.appendChild(xml.createTextNode(ui->plainTextConditions->toPlainText()));
+    root.appendChild(elConditions);
+    return true;
+}
+
+bool TriggerWindow::loadXML(Backend &backend, QDomElement &el)
+{
+    if (!ConfigurableWidget::loadXML(backend, el)) { return false; }
+    ui->doubleSpinBoxPre->setValue(el.attribute("pre-trigger", "10").toDouble());
+    ui->doubleSpinBoxPost->setValue(el.attribute("post-trigger", "5").toDouble());
+    ui->spinBoxBuffer->setValue(el.attribute("buffer", "200000").toInt());
+    ui->lineEditDirectory->setText(el.attribute("directory", QDir::homePath()));
+    ui->checkBoxRearm->setChecked(el.attribute("rearm", "1").toInt() != 0);
+    ui->plainTextConditions->setPlainText(el.firstChildElement("Conditions").text());
+    return true;
+}
@@ -0,0 +1,8 @@
+SOURCES += \
+    $$PWD/TriggerWindow.cpp
+
+HEADERS  += \
+    $$PWD/TriggerWindow.h
+
+FORMS    += \
+    $$PWD/TriggerWindow.ui